@@ -0,0 +1,161 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "pcilib.h"
+#include "pcilib/pci.h"
+#include "pcilib/dma.h"
+#include "pcilib/aggregate.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Measures the throughput of the aggregate stream reading the emulated DMA engines of multiple emulated
+ * devices. The number of devices is increased from 1 to the specified number and the merged stream is
+ * consumed as fast as possible. Then, the consumer is slowed down to process blocks at the specified rate
+ * and the back pressure is compared with dropping the data. The consumer verifies that the blocks are
+ * delivered in order, that the counter pattern generated by each engine is continuous, and that the gaps
+ * in the sequence numbers of the sources match the reported drops. The data rate of each emulated engine
+ * may be limited with PCILIB_SOFTDMA_RATE.
+ *
+ * Usage: aggregate_benchmark [devices] [run_time] [slow_rate] [model]
+ */
+
+#define DEFAULT_DEVICES		4
+#define DEFAULT_RUN_TIME	1000000		/**< us */
+#define DEFAULT_SLOW_RATE	1000		/**< blocks per second consumed in slow mode */
+#define DEFAULT_MODEL		"softdma"
+#define QUEUE_SIZE		256
+#define MAX_DEVICES		16
+
+typedef struct {
+    pcilib_time_t block_time;			/**< Minimal processing time of a block (ns), 0 - as fast as possible */
+    size_t next_seqnum;				/**< Expected sequence number in the merged stream */
+    size_t next_source_seqnum[MAX_DEVICES];	/**< Expected sequence number of each source */
+    uint32_t next_value[MAX_DEVICES];		/**< Expected counter value of each source */
+    size_t gaps[MAX_DEVICES];			/**< Number of blocks missing in the stream of each source */
+    size_t errors;				/**< Number of detected order and data errors */
+} consumer_t;
+
+static int consume(const pcilib_aggregate_block_t *block, void *user) {
+    size_t n = block->size / sizeof(uint32_t);
+    pcilib_time_t start = pcilib_time_ns();
+    uint32_t *data = (uint32_t*)block->data;
+    consumer_t *ctx = (consumer_t*)user;
+
+    if (block->seqnum != ctx->next_seqnum) ctx->errors++;
+    ctx->next_seqnum = block->seqnum + 1;
+
+	// Counter is not continuous if blocks are dropped
+    if (block->source_seqnum != ctx->next_source_seqnum[block->source]) {
+	ctx->gaps[block->source] += block->source_seqnum - ctx->next_source_seqnum[block->source];
+    } else if ((block->source_seqnum)&&(data[0] != ctx->next_value[block->source])) {
+	ctx->errors++;
+    }
+
+    ctx->next_source_seqnum[block->source] = block->source_seqnum + 1;
+    if (n) ctx->next_value[block->source] = data[n - 1] + 1;
+
+    if (ctx->block_time)
+	while ((pcilib_time_ns() - start) < ctx->block_time);
+
+    return PCILIB_STREAMING_CONTINUE;
+}
+
+static double cpu_time(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000000.;
+}
+
+static int run(pcilib_t **pci, size_t devices, pcilib_timeout_t run_time, size_t rate, pcilib_aggregate_flags_t flags) {
+    int err;
+    size_t i, gaps = 0;
+    double cpu;
+    consumer_t consumer;
+    pcilib_aggregate_t *agg;
+    pcilib_aggregate_stats_t st;
+
+    memset(&consumer, 0, sizeof(consumer_t));
+    if (rate) consumer.block_time = 1000000000ull / rate;
+
+    agg = pcilib_aggregate_create(QUEUE_SIZE, 0, flags);
+    if (!agg) return PCILIB_ERROR_FAILED;
+
+    for (i = 0; i < devices; i++) {
+	err = pcilib_aggregate_add_source(agg, pci[i], pcilib_find_dma_by_addr(pci[i], PCILIB_DMA_FROM_DEVICE, 0), NULL);
+	if (err) {
+	    pcilib_aggregate_destroy(agg);
+	    return err;
+	}
+    }
+
+    cpu = cpu_time();
+    err = pcilib_aggregate_stream(agg, run_time, PCILIB_TIMEOUT_INFINITE, consume, &consumer);
+    cpu = cpu_time() - cpu;
+
+    if (!err) {
+	pcilib_aggregate_get_stats(agg, PCILIB_AGGREGATE_ALL, &st);
+	for (i = 0; i < devices; i++) gaps += consumer.gaps[i];
+
+	printf("%2zu devices, %-7s: %10.1lf MB/s, %8.0lf blocks/s, Dropped: %8zu (gaps: %8zu), Stalls: %6zu (%6.1lf%% of time), Errors: %zu, CPU: %5.1lf%%\n",
+	    devices, rate?((flags&PCILIB_AGGREGATE_FLAG_DROP)?"drop":"stall"):"fast", st.throughput, 1000000. * st.blocks / st.run_time,
+	    st.dropped_blocks, gaps, st.stalls, 100. * st.stall_time / st.run_time / devices, consumer.errors, 100000000. * cpu / st.run_time);
+
+	for (i = 0; (i < devices)&&(devices > 1); i++) {
+	    pcilib_aggregate_get_stats(agg, i, &st);
+	    printf("    device %2zu: %10.1lf MB/s, Blocks: %8zu, Dropped: %8zu, Max queued: %4zu\n", i, st.throughput, st.blocks, st.dropped_blocks, st.max_queued);
+	}
+    } else {
+	printf("%2zu devices: failed with error %i\n", devices, err);
+    }
+
+    pcilib_aggregate_destroy(agg);
+
+    return err;
+}
+
+int main(int argc, char *argv[]) {
+    size_t i;
+    size_t devices = DEFAULT_DEVICES;
+    size_t slow_rate = DEFAULT_SLOW_RATE;
+    pcilib_timeout_t run_time = DEFAULT_RUN_TIME;
+    const char *model = DEFAULT_MODEL;
+    pcilib_t *pci[MAX_DEVICES];
+
+    if (argc > 1) devices = atol(argv[1]);
+    if (argc > 2) run_time = atol(argv[2]);
+    if (argc > 3) slow_rate = atol(argv[3]);
+    if (argc > 4) model = argv[4];
+
+    if ((!devices)||(devices > MAX_DEVICES)||(!run_time)||(!slow_rate)) {
+	printf("Usage: %s [devices] [run_time] [slow_rate] [model]\n", argv[0]);
+	exit(1);
+    }
+
+    for (i = 0; i < devices; i++) {
+	pci[i] = pcilib_open(PCILIB_DEVICE_EMULATED, model);
+	if (!pci[i]) {
+	    printf("Error opening emulated device with model %s\n", model);
+	    exit(1);
+	}
+    }
+
+    printf("Aggregate stream, %lu us per run, queue of %u blocks\n", (unsigned long)run_time, QUEUE_SIZE);
+    for (i = 1; i <= devices; i++)
+	run(pci, i, run_time, 0, PCILIB_AGGREGATE_FLAGS_DEFAULT);
+
+    printf("Slow consumer, %zu blocks per second\n", slow_rate);
+    run(pci, devices, run_time, slow_rate, PCILIB_AGGREGATE_FLAGS_DEFAULT);
+    run(pci, devices, run_time, slow_rate, PCILIB_AGGREGATE_FLAG_DROP);
+
+    for (i = 0; i < devices; i++)
+	pcilib_close(pci[i]);
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Counts the memory allocations of the process. The library is preloaded with LD_PRELOAD and replaces
+ * malloc/calloc/realloc by the wrappers below. The benchmarks look up alloc_count_get() at run-time and
+ * report the allocations only if the library is loaded, e.g.:
+ *    LD_PRELOAD=./liballoc_count.so ./list_benchmark
+ */
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static size_t alloc_count = 0;
+static size_t alloc_bytes = 0;
+
+void *malloc(size_t size) {
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_bytes, size, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_bytes, nmemb * size, __ATOMIC_RELAXED);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_bytes, size, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+    /**
+     * Returns the number of allocations and the number of allocated bytes since the start of the process
+     * @param[out] count	- number of malloc/calloc/realloc calls
+     * @param[out] bytes	- total number of requested bytes
+     */
+void alloc_count_get(size_t *count, size_t *bytes) {
+    *count = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+    *bytes = __atomic_load_n(&alloc_bytes, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,84 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pcilib.h"
+#include "pcilib/cpu.h"
+#include "pcilib/timing.h"
+#include "pcilib/pagecpy.h"
+
+/*
+ * Reports detected CPU features and compares the cost of the uncached feature detection with
+ * the cached lookup performed by the copy routines. The throughput of pcilib_pagecpy is
+ * compared with the standard memcpy.
+ *
+ * Usage: cpu_benchmark [iterations] [copy_size]
+ */
+
+#define DEFAULT_ITERATIONS	100000
+#define DEFAULT_COPY_SIZE	(4 * 1024 * 1024)
+#define COPY_ITERATIONS		100
+
+int main(int argc, char *argv[]) {
+    size_t i;
+    char features[256];
+    pcilib_time_t start, end;
+    pcilib_cpu_info_t info;
+    volatile int sink = 0;
+    void *src, *dst;
+
+    size_t iterations = DEFAULT_ITERATIONS;
+    size_t copy_size = DEFAULT_COPY_SIZE;
+    const pcilib_cpu_info_t *cpu_info = pcilib_get_cpu_info();
+
+    if (argc > 1) iterations = atol(argv[1]);
+    if (argc > 2) copy_size = atol(argv[2]);
+
+    if ((!iterations)||(!copy_size)||(copy_size%4096)) {
+	printf("Usage: %s [iterations] [copy_size (multiple of 4096)]\n", argv[0]);
+	exit(1);
+    }
+
+    printf("CPU: %s (%s), gen: %i, LLC: %zu KB\n", cpu_info->model, cpu_info->vendor, cpu_info->gen, cpu_info->llc_size / 1024);
+    printf("Features: %s\n", pcilib_format_cpu_features(features, sizeof(features)));
+
+    start = pcilib_time_ns();
+    for (i = 0; i < iterations; i++) {
+	pcilib_detect_cpu_info(&info);
+	sink += info.gen;
+    }
+    end = pcilib_time_ns();
+    printf("Detection (uncached)   : %8.1lf ns per call\n", 1. * (end - start) / iterations);
+
+    start = pcilib_time_ns();
+    for (i = 0; i < iterations; i++) {
+	sink += pcilib_get_cpu_gen();
+    }
+    end = pcilib_time_ns();
+    printf("pcilib_get_cpu_gen     : %8.1lf ns per call\n", 1. * (end - start) / iterations);
+
+    if ((posix_memalign(&src, 4096, copy_size))||(posix_memalign(&dst, 4096, copy_size))) {
+	printf("Error allocating %zu bytes for copy benchmark\n", copy_size);
+	exit(1);
+    }
+    memset(src, 0x5A, copy_size);
+    memset(dst, 0, copy_size);
+
+    start = pcilib_time_ns();
+    for (i = 0; i < COPY_ITERATIONS; i++) memcpy(dst, src, copy_size);
+    end = pcilib_time_ns();
+    printf("memcpy                 : %8.1lf MB/s\n", 1000. * COPY_ITERATIONS * copy_size / (end - start));
+
+    start = pcilib_time_ns();
+    for (i = 0; i < COPY_ITERATIONS; i++) pcilib_pagecpy(dst, src, copy_size);
+    end = pcilib_time_ns();
+    printf("pcilib_pagecpy         : %8.1lf MB/s\n", 1000. * COPY_ITERATIONS * copy_size / (end - start));
+
+    free(src);
+    free(dst);
+
+    return 0;
+}
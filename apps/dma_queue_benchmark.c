@@ -0,0 +1,345 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "pcilib.h"
+#include "pcilib/pci.h"
+#include "pcilib/dma.h"
+#include "pcilib/dmaqueue.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Compares the DMA queue with synchronous transfers using the emulated C2S and S2C engines. In synchronous
+ * mode, each direction is served by a dedicated thread reading or writing blocks in DMA session. In queue
+ * mode, a single thread keeps the specified number of requests in flight for each direction, waits on the
+ * completion descriptor, and resubmits the completed requests. The read data is verified against the
+ * counter pattern generated by the emulated engine. The written blocks span multiple DMA pages and are
+ * filled with the counter pattern as well, the emulated S2C engine verifies it and reports the broken
+ * pages in dma_s2c_errors register. The reported CPU usage includes the threads emulating the device. The
+ * data rate of emulated engines may be limited with PCILIB_SOFTDMA_RATE.
+ *
+ * Usage: dma_queue_benchmark [run_time] [block_size] [inflight] [model]
+ */
+
+#define DEFAULT_RUN_TIME	1000000		/**< us */
+#define DEFAULT_BLOCK_SIZE	65536
+#define DEFAULT_INFLIGHT	4		/**< requests per direction */
+#define DEFAULT_MODEL		"softdma"
+#define DMA_TIMEOUT		1000000		/**< us */
+#define MAX_INFLIGHT		64
+
+typedef struct {
+    pcilib_t *pci;
+    pcilib_dma_engine_t dma;
+    pcilib_dma_direction_t direction;
+    pcilib_time_t deadline;			/**< Stop submitting new transfers after this moment */
+    size_t block_size;
+    void *buf;
+
+    int err;
+    size_t bytes;				/**< Number of transferred bytes */
+    uint32_t next_value;			/**< Expected value of the counter (next value to write for S2C) */
+    size_t errors;				/**< Number of blocks (pages for S2C) with unexpected data */
+    int verify;					/**< Indicates if the written data is verified by the engine */
+} stream_t;
+
+static void fill_counter(stream_t *s, void *buf, size_t size) {
+    size_t i, n = size / sizeof(uint32_t);
+    uint32_t *data = (uint32_t*)buf;
+
+    for (i = 0; i < n; i++)
+	data[i] = s->next_value++;
+}
+
+    /**
+     * Waits until the emulated S2C engine has consumed all pushed pages and reads the number of pages
+     * which were not continuing the counter pattern.
+     */
+static void check_written(stream_t *s) {
+    size_t i;
+    pcilib_register_value_t value;
+    pcilib_dma_engine_status_t status;
+
+    if (!s->verify) return;
+
+    for (i = 0; i < DMA_TIMEOUT / 1000; i++) {
+	if ((pcilib_get_dma_status(s->pci, s->dma, &status, 0, NULL))||(!status.written_buffers)) break;
+	usleep(1000);
+    }
+
+    if (!pcilib_read_register(s->pci, "dmaconf", "dma_s2c_errors", &value))
+	s->errors = value;
+}
+
+static void check_counter(stream_t *s, const void *buf, size_t size) {
+    size_t i, n = size / sizeof(uint32_t);
+    const uint32_t *data = (const uint32_t*)buf;
+
+    for (i = 0; i < n; i++) {
+	if (data[i] != s->next_value) {
+	    s->errors++;
+	    s->next_value = data[n - 1] + 1;
+	    return;
+	}
+	s->next_value++;
+    }
+}
+
+typedef struct {
+    stream_t *s;
+    void *buf;					/**< Buffer used by the request */
+} slot_t;
+
+static void prepare_request(pcilib_dma_request_t *req, slot_t *slot) {
+    memset(req, 0, sizeof(pcilib_dma_request_t));
+    req->dma = slot->s->dma;
+    req->direction = slot->s->direction;
+    req->flags = (slot->s->direction == PCILIB_DMA_FROM_DEVICE)?PCILIB_DMA_FLAG_MULTIPACKET:PCILIB_DMA_FLAG_EOP;
+    req->size = slot->s->block_size;
+    req->buf = slot->buf;
+    req->timeout = DMA_TIMEOUT;
+    req->user = slot;
+
+	// The requests are executed in order, so the counter is continued in the order of submission
+    if (slot->s->direction == PCILIB_DMA_TO_DEVICE)
+	fill_counter(slot->s, slot->buf, slot->s->block_size);
+}
+
+static void *sync_thread(void *arg) {
+    size_t bytes;
+    stream_t *s = (stream_t*)arg;
+    pcilib_dma_session_t *session;
+
+    session = pcilib_open_dma_session(s->pci, s->dma, s->direction, PCILIB_DMA_FLAGS_DEFAULT);
+    if (!session) {
+	s->err = PCILIB_ERROR_FAILED;
+	return NULL;
+    }
+
+    while (pcilib_time_ns() < s->deadline) {
+	bytes = 0;
+	if (s->direction == PCILIB_DMA_FROM_DEVICE) {
+	    s->err = pcilib_session_read_dma(session, 0, s->block_size, PCILIB_DMA_FLAG_MULTIPACKET, DMA_TIMEOUT, s->buf, &bytes);
+	    if (!s->err) check_counter(s, s->buf, bytes);
+	} else {
+	    fill_counter(s, s->buf, s->block_size);
+	    s->err = pcilib_session_push_dma(session, 0, s->block_size, PCILIB_DMA_FLAG_EOP, DMA_TIMEOUT, s->buf, &bytes);
+	}
+
+	s->bytes += bytes;
+	if (s->err) break;
+    }
+
+    pcilib_close_dma_session(session);
+
+    return NULL;
+}
+
+static double cpu_time(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000000.;
+}
+
+static void report(const char *mode, const char *dirs, stream_t *s, pcilib_time_t ns, double cpu, const pcilib_dma_queue_stats_t *st) {
+    int err = s[0].err?s[0].err:s[1].err;
+
+    if (err) {
+	printf("%-5s %-13s: failed with error %i\n", mode, dirs, err);
+	return;
+    }
+
+    printf("%-5s %-13s: Read: %8.1lf MB/s, Write: %8.1lf MB/s, Errors: %zu/%zu, CPU: %5.1lf%%", mode, dirs,
+	1000. * s[0].bytes / ns, 1000. * s[1].bytes / ns, s[0].errors, s[1].errors, 100000000000. * cpu / ns);
+    if (st) printf(", Polls: %zu, Sleeps: %zu", st->polls, st->sleeps);
+    printf("\n");
+}
+
+static void run_sync(stream_t *s, int use[2], pcilib_timeout_t run_time, const char *dirs) {
+    int i;
+    double cpu;
+    pcilib_time_t start;
+    pthread_t thread[2];
+
+    start = pcilib_time_ns();
+    cpu = cpu_time();
+
+    for (i = 0; i < 2; i++) {
+	s[i].err = 0;
+	s[i].bytes = 0;
+	s[i].deadline = start + 1000ull * run_time;
+	if ((use[i])&&(pthread_create(thread + i, NULL, sync_thread, s + i))) {
+	    s[i].err = PCILIB_ERROR_FAILED;
+	    use[i] = 0;
+	}
+    }
+
+    for (i = 0; i < 2; i++)
+	if (use[i]) pthread_join(thread[i], NULL);
+
+    cpu = cpu_time() - cpu;
+    start = pcilib_time_ns() - start;
+
+    if (use[1]) check_written(s + 1);
+    report("sync", dirs, s, start, cpu, NULL);
+}
+
+static void run_queue(pcilib_t *pci, stream_t *s, int use[2], pcilib_timeout_t run_time, size_t inflight, const char *dirs) {
+    int i, err = 0;
+    size_t j, n, outstanding = 0;
+    double cpu;
+    pcilib_time_t start, deadline;
+    struct pollfd pfd;
+    slot_t *slot;
+    slot_t slots[2 * MAX_INFLIGHT];
+    pcilib_dma_queue_t *q;
+    pcilib_dma_queue_stats_t st;
+    pcilib_dma_request_t req[2 * MAX_INFLIGHT];
+    pcilib_dma_completion_t comp[2 * MAX_INFLIGHT];
+
+    q = pcilib_dma_queue_create(pci, 2 * inflight);
+    if (!q) {
+	printf("queue %-13s: failed to create queue\n", dirs);
+	return;
+    }
+
+    start = pcilib_time_ns();
+    deadline = start + 1000ull * run_time;
+    cpu = cpu_time();
+
+    for (i = 0, n = 0; i < 2; i++) {
+	s[i].err = 0;
+	s[i].bytes = 0;
+	for (j = 0; (use[i])&&(j < inflight); j++, n++) {
+	    slots[n].s = s + i;
+	    slots[n].buf = s[i].buf + j * s[i].block_size;
+	    prepare_request(req + n, slots + n);
+	}
+    }
+
+    err = pcilib_dma_queue_submit(q, req, n, &outstanding);
+
+    pfd.fd = pcilib_dma_queue_get_fd(q);
+    pfd.events = POLLIN;
+
+    while ((!err)&&(outstanding)) {
+	if (poll(&pfd, 1, DMA_TIMEOUT / 1000) <= 0) {
+	    err = PCILIB_ERROR_TIMEOUT;
+	    break;
+	}
+
+	err = pcilib_dma_queue_reap(q, comp, 2 * MAX_INFLIGHT, 0, PCILIB_TIMEOUT_IMMEDIATE, &n);
+	outstanding -= n;
+
+	    // The requests are completed in order within the direction, so the counter should be continuous
+	for (j = 0; (!err)&&(j < n); j++) {
+	    slot = (slot_t*)comp[j].user;
+	    slot->s->bytes += comp[j].bytes;
+	    if (comp[j].error) {
+		slot->s->err = comp[j].error;
+		continue;
+	    }
+
+	    if (comp[j].direction == PCILIB_DMA_FROM_DEVICE)
+		check_counter(slot->s, slot->buf, comp[j].bytes);
+
+	    if (pcilib_time_ns() >= deadline) continue;
+
+	    prepare_request(req, slot);
+	    err = pcilib_dma_queue_submit(q, req, 1, NULL);
+	    if (!err) outstanding++;
+	}
+    }
+
+    cpu = cpu_time() - cpu;
+    start = pcilib_time_ns() - start;
+
+    pcilib_dma_queue_get_stats(q, &st);
+    pcilib_dma_queue_destroy(q);
+
+    if ((err)&&(!s[0].err)) s[0].err = err;
+    if (use[1]) check_written(s + 1);
+    report("queue", dirs, s, start, cpu, &st);
+}
+
+int main(int argc, char *argv[]) {
+    int i;
+    size_t block_size = DEFAULT_BLOCK_SIZE;
+    size_t inflight = DEFAULT_INFLIGHT;
+    pcilib_timeout_t run_time = DEFAULT_RUN_TIME;
+    const char *model = DEFAULT_MODEL;
+    pcilib_t *pci;
+    pcilib_register_value_t value;
+    stream_t s[2];
+
+    static const char *dirs[] = { "read", "write", "bidirectional" };
+    static const int use[3][2] = { { 1, 0 }, { 0, 1 }, { 1, 1 } };
+
+    if (argc > 1) run_time = atol(argv[1]);
+    if (argc > 2) block_size = atol(argv[2]);
+    if (argc > 3) inflight = atol(argv[3]);
+    if (argc > 4) model = argv[4];
+
+    if ((!run_time)||(!block_size)||(block_size % sizeof(uint32_t))||(!inflight)||(inflight > MAX_INFLIGHT)) {
+	printf("Usage: %s [run_time] [block_size] [inflight] [model]\n", argv[0]);
+	exit(1);
+    }
+
+    pci = pcilib_open(PCILIB_DEVICE_EMULATED, model);
+    if (!pci) {
+	printf("Error opening emulated device with model %s\n", model);
+	exit(1);
+    }
+
+    memset(s, 0, sizeof(s));
+    s[0].dma = pcilib_find_dma_by_addr(pci, PCILIB_DMA_FROM_DEVICE, 0);
+    s[0].direction = PCILIB_DMA_FROM_DEVICE;
+    s[1].dma = pcilib_find_dma_by_addr(pci, PCILIB_DMA_TO_DEVICE, 0);
+    s[1].direction = PCILIB_DMA_TO_DEVICE;
+
+    if ((s[0].dma == PCILIB_DMA_ENGINE_INVALID)||(s[1].dma == PCILIB_DMA_ENGINE_INVALID)) {
+	printf("The model %s does not provide C2S and S2C engines\n", model);
+	exit(1);
+    }
+
+	// The emulated engine expects the written counter to start from the configured value
+    if ((!pcilib_read_register(pci, "dmaconf", "dma_pattern", &value))&&(value == 1)&&(!pcilib_read_register(pci, "dmaconf", "dma_pattern_value", &value))) {
+	s[1].verify = 1;
+	s[1].next_value = value;
+    }
+
+    for (i = 0; i < 2; i++) {
+	s[i].pci = pci;
+	s[i].block_size = block_size;
+	if (posix_memalign(&s[i].buf, 4096, inflight * block_size)) {
+	    printf("Error allocating %zu bytes\n", inflight * block_size);
+	    exit(1);
+	}
+	memset(s[i].buf, 0, inflight * block_size);
+    }
+
+    printf("DMA transfers of %zu bytes, %lu us per run, %zu requests per direction in flight\n", block_size, (unsigned long)run_time, inflight);
+    for (i = 0; i < 3; i++) {
+	int u[2] = { use[i][0], use[i][1] };
+
+	    // The counter is continued from the data of the previous run
+	run_sync(s, u, run_time, dirs[i]);
+	run_queue(pci, s, u, run_time, inflight, dirs[i]);
+    }
+
+    for (i = 0; i < 2; i++)
+	free(s[i].buf);
+
+    pcilib_close(pci);
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "pcilib.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Measures the per-call latency of small DMA reads. The reads are executed with the engine started
+ * and stopped for each call (as by separate pci invocations), with plain pcilib_read_dma_custom()
+ * calls, and within the DMA session. The emulated DMA engine is used by default.
+ *
+ * Usage: dma_session_benchmark [iterations] [size] [device] [model]
+ */
+
+#define DEFAULT_ITERATIONS	10000
+#define DEFAULT_SIZE		4096
+#define DEFAULT_DEVICE		"emulated"
+#define DEFAULT_MODEL		"softdma"
+#define DMA_TIMEOUT		100000		/**< us */
+
+typedef enum {
+    MODE_RESTART,
+    MODE_PLAIN,
+    MODE_SESSION
+} session_mode_t;
+
+static const char *mode_names[] = { "start/stop", "plain", "session" };
+
+static int cmp_ns(const void *a, const void *b) {
+    pcilib_time_t va = *(const pcilib_time_t*)a, vb = *(const pcilib_time_t*)b;
+    return (va > vb) - (va < vb);
+}
+
+static int run(pcilib_t *pci, pcilib_dma_engine_t dma, session_mode_t mode, size_t iterations, size_t size, void *buf, pcilib_time_t *lat) {
+    int err = 0;
+    size_t i, bytes;
+    pcilib_time_t start, sum = 0;
+    pcilib_dma_session_t *session = NULL;
+
+	// Engine is started in advance, we only measure the cost of reads
+    if (mode == MODE_SESSION) {
+	session = pcilib_open_dma_session(pci, dma, PCILIB_DMA_FROM_DEVICE, PCILIB_DMA_FLAGS_DEFAULT);
+	if (!session) return PCILIB_ERROR_FAILED;
+    } else if (mode == MODE_PLAIN) {
+	err = pcilib_start_dma(pci, dma, PCILIB_DMA_FLAGS_DEFAULT);
+	if (err) return err;
+    }
+
+    for (i = 0; i < iterations; i++) {
+	start = pcilib_time_ns();
+	switch (mode) {
+	 case MODE_RESTART:
+	    err = pcilib_start_dma(pci, dma, PCILIB_DMA_FLAGS_DEFAULT);
+	    if (!err) err = pcilib_read_dma_custom(pci, dma, 0, size, PCILIB_DMA_FLAGS_DEFAULT, DMA_TIMEOUT, buf, &bytes);
+	    if (!err) err = pcilib_stop_dma(pci, dma, PCILIB_DMA_FLAGS_DEFAULT);
+	    break;
+	 case MODE_PLAIN:
+	    err = pcilib_read_dma_custom(pci, dma, 0, size, PCILIB_DMA_FLAGS_DEFAULT, DMA_TIMEOUT, buf, &bytes);
+	    break;
+	 case MODE_SESSION:
+	    err = pcilib_session_read_dma(session, 0, size, PCILIB_DMA_FLAGS_DEFAULT, DMA_TIMEOUT, buf, &bytes);
+	    break;
+	}
+	lat[i] = pcilib_time_ns() - start;
+	sum += lat[i];
+	if (err) break;
+    }
+
+    if (session) pcilib_close_dma_session(session);
+    if (mode != MODE_RESTART) pcilib_stop_dma(pci, dma, PCILIB_DMA_FLAGS_DEFAULT);
+
+    if (err) {
+	printf("%-10s: failed with error %i after %zu reads\n", mode_names[mode], err, i);
+	return err;
+    }
+
+    qsort(lat, iterations, sizeof(pcilib_time_t), cmp_ns);
+    printf("%-10s: Reads: %7zu, Latency: mean %8.2lf us, median %8.2lf us, 99%% %8.2lf us\n", mode_names[mode], iterations,
+	sum / 1000. / iterations, lat[iterations / 2] / 1000., lat[iterations * 99 / 100] / 1000.);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t iterations = DEFAULT_ITERATIONS;
+    size_t size = DEFAULT_SIZE;
+    const char *device = DEFAULT_DEVICE;
+    const char *model = DEFAULT_MODEL;
+    pcilib_dma_engine_t dma;
+    pcilib_time_t *lat;
+    pcilib_t *pci;
+    void *buf;
+
+    if (argc > 1) iterations = atol(argv[1]);
+    if (argc > 2) size = atol(argv[2]);
+    if (argc > 3) device = argv[3];
+    if (argc > 4) model = argv[4];
+
+    if ((!iterations)||(!size)) {
+	printf("Usage: %s [iterations] [size] [device] [model]\n", argv[0]);
+	exit(1);
+    }
+
+    pci = pcilib_open(device, model);
+    if (!pci) {
+	printf("Error opening device %s with model %s\n", device, model);
+	exit(1);
+    }
+
+    dma = pcilib_find_dma_by_addr(pci, PCILIB_DMA_FROM_DEVICE, 0);
+    if (dma == PCILIB_DMA_ENGINE_INVALID) {
+	printf("DMA engine 0 is not found\n");
+	exit(1);
+    }
+
+    buf = malloc(size);
+    lat = (pcilib_time_t*)malloc(iterations * sizeof(pcilib_time_t));
+    if ((!buf)||(!lat)) {
+	printf("Error allocating memory\n");
+	exit(1);
+    }
+
+    run(pci, dma, MODE_RESTART, (iterations > 100)?(iterations / 100):1, size, buf, lat);
+    run(pci, dma, MODE_PLAIN, iterations, size, buf, lat);
+    run(pci, dma, MODE_SESSION, iterations, size, buf, lat);
+
+    free(lat);
+    free(buf);
+
+    pcilib_close(pci);
+
+    return 0;
+}
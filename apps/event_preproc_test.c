@@ -0,0 +1,367 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pcilib.h"
+#include "pcilib/pci.h"
+#include "pcilib/cpu.h"
+#include "pcilib/event.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Runs the events of a synthetic event engine through the pcilib preprocessing pool. The engine is
+ * installed on top of the emulated device and produces frames of 12-bit packed pixels, the first two
+ * pixels hold the event number. The engine provides the preprocess callback unpacking the frame to
+ * 16-bit pixels, so pcilib decodes the events in conf/max_threads threads if started with
+ * PCILIB_EVENT_FLAG_PREPROCESS. With a single thread, the engine decodes events on pcilib_get_data().
+ * The events are consumed with pcilib_stream() and pcilib_get_next_event(), the order, the event
+ * info, and the decoded pixels are verified, and the rates are compared with the single thread.
+ *
+ * Usage: event_preproc_test [max_threads] [events] [frame_size_in_pixels]
+ */
+
+#define DEFAULT_DEVICE		"emulated"
+#define DEFAULT_MODEL		"softdma"
+#define DEFAULT_EVENTS		1000
+#define DEFAULT_PIXELS		(1024 * 1024)
+#define RING_SIZE		8
+#define CHECK_STRIDE		997
+
+typedef struct {
+    pcilib_context_t event;
+    size_t max_events;				/**< Number of events to produce */
+    pcilib_event_id_t event_id;			/**< Last produced event */
+    int run_flag;				/**< Cleared when the engine is stopped */
+    size_t raw_size;				/**< Size of raw frame */
+    uint8_t *raw[RING_SIZE];			/**< Ring of raw frames */
+    uint16_t *frame;				/**< Buffer for the frame decoded on request */
+} synthetic_t;
+
+typedef struct {
+    pcilib_t *pci;
+    size_t events;				/**< Number of consumed events */
+    int err;					/**< Verification error */
+} consumer_t;
+
+static size_t pixels = DEFAULT_PIXELS;
+
+static inline uint16_t pixel(pcilib_event_id_t event_id, size_t i) {
+    if (i == 0) return event_id&0xFFF;
+    if (i == 1) return (event_id >> 12)&0xFFF;
+    return ((event_id % RING_SIZE) * 31 + i * 7)&0xFFF;
+}
+
+static pcilib_context_t *synthetic_init(pcilib_t *pcilib) {
+    size_t i, j;
+    synthetic_t *ctx = (synthetic_t*)malloc(sizeof(synthetic_t));
+    if (!ctx) return NULL;
+
+    memset(ctx, 0, sizeof(synthetic_t));
+    ctx->raw_size = 3 * pixels / 2;
+    ctx->frame = (uint16_t*)malloc(pixels * sizeof(uint16_t));
+    if (!ctx->frame) return NULL;
+
+    for (i = 0; i < RING_SIZE; i++) {
+	ctx->raw[i] = (uint8_t*)malloc(ctx->raw_size);
+	if (!ctx->raw[i]) return NULL;
+
+	for (j = 0; j < pixels; j += 2) {
+	    uint16_t p0 = pixel(i, j), p1 = pixel(i, j + 1);
+	    ctx->raw[i][3 * j / 2] = p0&0xFF;
+	    ctx->raw[i][3 * j / 2 + 1] = (p0 >> 8) | ((p1&0x0F) << 4);
+	    ctx->raw[i][3 * j / 2 + 2] = p1 >> 4;
+	}
+    }
+
+    return (pcilib_context_t*)ctx;
+}
+
+static void synthetic_free(pcilib_context_t *vctx) {
+    size_t i;
+    synthetic_t *ctx = (synthetic_t*)vctx;
+    if (!ctx) return;
+
+    for (i = 0; i < RING_SIZE; i++)
+	free(ctx->raw[i]);
+    free(ctx->frame);
+    free(ctx);
+}
+
+static int synthetic_start(pcilib_context_t *vctx, pcilib_event_t event_mask, pcilib_event_flags_t flags) {
+    synthetic_t *ctx = (synthetic_t*)vctx;
+
+    ctx->max_events = ctx->event.params.autostop.max_events;
+    ctx->event_id = 0;
+    __atomic_store_n(&ctx->run_flag, 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static int synthetic_stop(pcilib_context_t *vctx, pcilib_event_flags_t flags) {
+    synthetic_t *ctx = (synthetic_t*)vctx;
+    __atomic_store_n(&ctx->run_flag, 0, __ATOMIC_RELEASE);
+    return 0;
+}
+
+    // The event number is stamped in the first two pixels of the raw frame
+static void synthetic_produce(synthetic_t *ctx, pcilib_event_info_t *info) {
+    uint8_t *raw;
+    pcilib_event_id_t event_id = ++ctx->event_id;
+
+    raw = ctx->raw[event_id % RING_SIZE];
+    raw[0] = event_id&0xFF;
+    raw[1] = ((event_id >> 8)&0x0F) | ((event_id >> 12)&0x0F) << 4;
+    raw[2] = (event_id >> 16)&0xFF;
+
+    if (info) {
+	memset(info, 0, sizeof(pcilib_event_info_t));
+	info->type = PCILIB_EVENT0;
+	info->seqnum = event_id;
+	pcilib_gettime(&info->timestamp);
+    }
+}
+
+static int synthetic_stream(pcilib_context_t *vctx, pcilib_event_callback_t callback, void *user) {
+    int ret;
+    pcilib_event_info_t info;
+    synthetic_t *ctx = (synthetic_t*)vctx;
+
+    while ((__atomic_load_n(&ctx->run_flag, __ATOMIC_ACQUIRE))&&(ctx->event_id < ctx->max_events)) {
+	synthetic_produce(ctx, &info);
+
+	ret = callback(ctx->event_id, &info, user);
+	if (ret < 0) return -ret;
+	if (ret == PCILIB_STREAMING_STOP) break;
+    }
+
+    return 0;
+}
+
+static int synthetic_next_event(pcilib_context_t *vctx, pcilib_timeout_t timeout, pcilib_event_id_t *evid, size_t info_size, pcilib_event_info_t *info) {
+    synthetic_t *ctx = (synthetic_t*)vctx;
+
+    if ((!__atomic_load_n(&ctx->run_flag, __ATOMIC_ACQUIRE))||(ctx->event_id >= ctx->max_events))
+	return PCILIB_ERROR_NOTAVAILABLE;
+
+    synthetic_produce(ctx, (info_size >= sizeof(pcilib_event_info_t))?info:NULL);
+    *evid = ctx->event_id;
+
+    return 0;
+}
+
+static int synthetic_preprocess(pcilib_context_t *vctx, pcilib_event_id_t event_id, const void *raw, size_t raw_size, void *buf, size_t *size) {
+    size_t i, n = 2 * (raw_size / 3);
+    const uint8_t *src = (const uint8_t*)raw;
+    uint16_t *dst = (uint16_t*)buf;
+
+    if ((n * sizeof(uint16_t)) > *size) {
+	*size = n * sizeof(uint16_t);
+	return PCILIB_ERROR_TOOBIG;
+    }
+
+    for (i = 0; i < n; i += 2, src += 3) {
+	dst[i] = src[0] | ((src[1]&0x0F) << 8);
+	dst[i + 1] = (src[1] >> 4) | (src[2] << 4);
+    }
+
+    *size = n * sizeof(uint16_t);
+    return 0;
+}
+
+static int synthetic_get_data(pcilib_context_t *vctx, pcilib_event_id_t event_id, pcilib_event_data_type_t data_type, size_t arg_size, void *arg, size_t *size, void **data) {
+    size_t frame_size;
+    synthetic_t *ctx = (synthetic_t*)vctx;
+
+    if ((event_id > ctx->event_id)||((event_id + RING_SIZE) <= ctx->event_id))
+	return PCILIB_ERROR_OVERWRITTEN;
+
+    if (data_type == PCILIB_EVENT_RAW_DATA) {
+	*size = ctx->raw_size;
+	*data = ctx->raw[event_id % RING_SIZE];
+	return 0;
+    }
+
+    frame_size = pixels * sizeof(uint16_t);
+    if (!*data) *data = ctx->frame;
+    else if (*size < frame_size) return PCILIB_ERROR_TOOBIG;
+
+    *size = frame_size;
+    return synthetic_preprocess(vctx, event_id, ctx->raw[event_id % RING_SIZE], ctx->raw_size, *data, size);
+}
+
+static int synthetic_return_data(pcilib_context_t *vctx, pcilib_event_id_t event_id, pcilib_event_data_type_t data_type, void *data) {
+    synthetic_t *ctx = (synthetic_t*)vctx;
+    if ((event_id + RING_SIZE) <= ctx->event_id) return PCILIB_ERROR_OVERWRITTEN;
+    return 0;
+}
+
+static pcilib_event_api_description_t synthetic_api = {
+    PCILIB_VERSION,
+
+    synthetic_init,
+    synthetic_free,
+
+    NULL,
+
+    NULL,
+
+    synthetic_start,
+    synthetic_stop,
+    NULL,
+
+    synthetic_stream,
+    synthetic_next_event,
+    synthetic_get_data,
+    synthetic_return_data,
+
+    synthetic_preprocess
+};
+
+static int consume(pcilib_event_id_t event_id, const pcilib_event_info_t *info, void *user) {
+    int err;
+    size_t i, size;
+    uint16_t *data;
+    consumer_t *consumer = (consumer_t*)user;
+    pcilib_event_id_t expected = consumer->events + 1;
+
+    if ((event_id != expected)||(info->seqnum != expected)) {
+	printf("Event %lu (seqnum %lu) is delivered instead of %lu\n", (unsigned long)event_id, (unsigned long)info->seqnum, (unsigned long)expected);
+	consumer->err = PCILIB_ERROR_VERIFY;
+	return PCILIB_STREAMING_STOP;
+    }
+
+    data = (uint16_t*)pcilib_get_data(consumer->pci, event_id, PCILIB_EVENT_DATA, &size);
+    if (!data) {
+	printf("Error (%i) getting data of event %lu\n", (int)size, (unsigned long)event_id);
+	consumer->err = (int)size;
+	return PCILIB_STREAMING_STOP;
+    }
+
+    if (size != pixels * sizeof(uint16_t)) {
+	printf("Event %lu is decoded into %zu bytes, expected %zu\n", (unsigned long)event_id, size, pixels * sizeof(uint16_t));
+	consumer->err = PCILIB_ERROR_VERIFY;
+    }
+
+    for (i = 0; (!consumer->err)&&(i < pixels); i = (i < 2)?(i + 1):(i + CHECK_STRIDE)) {
+	if (data[i] != pixel(expected, i)) {
+	    printf("Pixel %zu of event %lu is 0x%x, expected 0x%x\n", i, (unsigned long)event_id, data[i], pixel(expected, i));
+	    consumer->err = PCILIB_ERROR_VERIFY;
+	}
+    }
+
+    err = pcilib_return_data(consumer->pci, event_id, PCILIB_EVENT_DATA, data);
+    if ((err)&&(!consumer->err)) {
+	printf("Error (%i) returning data of event %lu\n", err, (unsigned long)event_id);
+	consumer->err = err;
+    }
+
+    if (consumer->err) return PCILIB_STREAMING_STOP;
+
+    consumer->events++;
+    return PCILIB_STREAMING_CONTINUE;
+}
+
+static int run(pcilib_t *pci, int streaming, size_t threads, size_t events, double *rate) {
+    int err;
+    pcilib_event_id_t event_id;
+    pcilib_event_info_t info;
+    pcilib_time_t start, elapsed;
+    consumer_t consumer = { pci, 0, 0 };
+
+    synthetic_api.stream = streaming?synthetic_stream:NULL;
+
+    pcilib_configure_autostop(pci, events, 0);
+    pcilib_write_register(pci, "conf", "max_threads", threads);
+
+    start = pcilib_time_ns();
+    err = pcilib_start(pci, PCILIB_EVENTS_ALL, PCILIB_EVENT_FLAG_PREPROCESS);
+    if (err) {
+	printf("Error (%i) starting the event engine\n", err);
+	return err;
+    }
+
+    if ((threads != 1)&&(!pci->event_preproc)) {
+	printf("The preprocessing pool is not started with %zu threads\n", threads);
+	pcilib_stop(pci, PCILIB_EVENT_FLAGS_DEFAULT);
+	return PCILIB_ERROR_FAILED;
+    }
+
+    if (streaming) {
+	err = pcilib_stream(pci, consume, &consumer);
+    } else {
+	while (!consumer.err) {
+	    err = pcilib_get_next_event(pci, PCILIB_TIMEOUT_INFINITE, &event_id, sizeof(info), &info);
+	    if (err) break;
+	    consume(event_id, &info, &consumer);
+	}
+	if (err == PCILIB_ERROR_NOTAVAILABLE) err = 0;
+    }
+    elapsed = pcilib_time_ns() - start;
+
+    pcilib_stop(pci, PCILIB_EVENT_FLAGS_DEFAULT);
+
+    if (!err) err = consumer.err;
+    if ((!err)&&(consumer.events != events)) {
+	printf("Only %zu of %zu events are delivered\n", consumer.events, events);
+	err = PCILIB_ERROR_VERIFY;
+    }
+
+    if (err) {
+	printf("%-10s: Threads: %2zu, failed with error %i\n", streaming?"stream":"next_event", threads, err);
+	return err;
+    }
+
+    *rate = 1000000000. * events / elapsed;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int streaming, err = 0;
+    size_t threads, max_threads = pcilib_get_cpu_count();
+    size_t events = DEFAULT_EVENTS;
+    double rate, ref_rate = 0;
+    pcilib_t *pci;
+
+    if (argc > 1) max_threads = atol(argv[1]);
+    if (argc > 2) events = atol(argv[2]);
+    if (argc > 3) pixels = atol(argv[3]) & ~1ul;
+
+    if ((!max_threads)||(!events)||(pixels < 2)) {
+	printf("Usage: %s [max_threads] [events] [frame_size_in_pixels]\n", argv[0]);
+	exit(1);
+    }
+
+    pci = pcilib_open(DEFAULT_DEVICE, DEFAULT_MODEL);
+    if (!pci) {
+	printf("Error opening device %s with model %s\n", DEFAULT_DEVICE, DEFAULT_MODEL);
+	exit(1);
+    }
+
+    pci->model_info.api = &synthetic_api;
+    pcilib_init_event_engine(pci);
+    if (!pci->event_ctx) {
+	printf("Error initializing synthetic event engine\n");
+	exit(1);
+    }
+
+    printf("Synthetic event engine, frame: %zu pixels (%zu bytes raw)\n", pixels, 3 * pixels / 2);
+    for (streaming = 1; streaming >= 0; streaming--) {
+	for (threads = 1; threads <= max_threads; threads++) {
+	    if (run(pci, streaming, threads, events, &rate)) {
+		err = 1;
+		continue;
+	    }
+
+	    if (threads == 1) ref_rate = rate;
+	    printf("%-10s: Threads: %2zu, Events: %zu, Rate: %8.1lf events/s, Speedup: %.2lf\n", streaming?"stream":"next_event", threads, events, rate, ref_rate?(rate / ref_rate):0);
+	}
+    }
+
+    pcilib_close(pci);
+
+    return err;
+}
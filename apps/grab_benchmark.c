@@ -0,0 +1,230 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pcilib.h"
+#include "pcilib/pci.h"
+#include "pcilib/event.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Measures the throughput of repeated grabs with pcilib_grab() allocating a new buffer for each
+ * event, with a pool of reused buffers, and borrowing the event data from the engine in place. The
+ * synthetic event engine is installed on top of the emulated device. It produces an event on every
+ * request and fills the frame with the event number, either in the internal buffer or directly in
+ * the buffer supplied by the caller.
+ *
+ * Usage: grab_benchmark [events] [frame_size] [device] [model]
+ */
+
+#define DEFAULT_EVENTS		10000
+#define DEFAULT_SIZE		(4 * 1024 * 1024)
+#define DEFAULT_DEVICE		"emulated"
+#define DEFAULT_MODEL		"softdma"
+#define POOL_SIZE		4
+
+typedef enum {
+    MODE_GRAB,
+    MODE_POOL,
+    MODE_BORROW
+} grab_mode_t;
+
+static const char *mode_names[] = { "grab", "pool", "borrow" };
+
+typedef struct {
+    pcilib_context_t event;
+    size_t size;				/**< Frame size */
+    pcilib_event_id_t event_id;			/**< Last produced event */
+    uint32_t *frame;				/**< Internal frame buffer */
+} synthetic_t;
+
+static size_t frame_size = DEFAULT_SIZE;
+
+static pcilib_context_t *synthetic_init(pcilib_t *pcilib) {
+    synthetic_t *ctx = (synthetic_t*)malloc(sizeof(synthetic_t));
+    if (!ctx) return NULL;
+
+    memset(ctx, 0, sizeof(synthetic_t));
+    ctx->size = frame_size;
+    if (posix_memalign((void**)&ctx->frame, 4096, ctx->size)) {
+	free(ctx);
+	return NULL;
+    }
+    memset(ctx->frame, 0, ctx->size);
+
+    return (pcilib_context_t*)ctx;
+}
+
+static void synthetic_free(pcilib_context_t *vctx) {
+    synthetic_t *ctx = (synthetic_t*)vctx;
+    if (!ctx) return;
+
+    free(ctx->frame);
+    free(ctx);
+}
+
+static int synthetic_start(pcilib_context_t *vctx, pcilib_event_t event_mask, pcilib_event_flags_t flags) {
+    return 0;
+}
+
+static int synthetic_stop(pcilib_context_t *vctx, pcilib_event_flags_t flags) {
+    return 0;
+}
+
+static int synthetic_trigger(pcilib_context_t *vctx, pcilib_event_t event, size_t trigger_size, void *trigger_data) {
+    return 0;
+}
+
+static int synthetic_next_event(pcilib_context_t *vctx, pcilib_timeout_t timeout, pcilib_event_id_t *evid, size_t info_size, pcilib_event_info_t *info) {
+    synthetic_t *ctx = (synthetic_t*)vctx;
+    *evid = ++ctx->event_id;
+    return 0;
+}
+
+    // The frame is "decoded" directly into the caller buffer if it is supplied
+static int synthetic_get_data(pcilib_context_t *vctx, pcilib_event_id_t event_id, pcilib_event_data_type_t data_type, size_t arg_size, void *arg, size_t *size, void **data) {
+    size_t i;
+    uint32_t *frame;
+    synthetic_t *ctx = (synthetic_t*)vctx;
+
+    if (*data) {
+	if (*size < ctx->size) return PCILIB_ERROR_TOOBIG;
+	frame = (uint32_t*)*data;
+    } else {
+	frame = ctx->frame;
+    }
+
+    for (i = 0; i < ctx->size / sizeof(uint32_t); i += 1024)
+	frame[i] = event_id;
+
+    *size = ctx->size;
+    *data = frame;
+
+    return 0;
+}
+
+static int synthetic_return_data(pcilib_context_t *vctx, pcilib_event_id_t event_id, pcilib_event_data_type_t data_type, void *data) {
+    synthetic_t *ctx = (synthetic_t*)vctx;
+    if (event_id != ctx->event_id) return PCILIB_ERROR_OVERWRITTEN;
+    return 0;
+}
+
+static const pcilib_event_api_description_t synthetic_api = {
+    PCILIB_VERSION,
+
+    synthetic_init,
+    synthetic_free,
+
+    NULL,
+
+    NULL,
+
+    synthetic_start,
+    synthetic_stop,
+    synthetic_trigger,
+
+    NULL,
+    synthetic_next_event,
+    synthetic_get_data,
+    synthetic_return_data
+};
+
+static int run(pcilib_t *pci, grab_mode_t mode, size_t events) {
+    int err = 0;
+    size_t i, size;
+    void *data;
+    uint32_t check = 0;
+    pcilib_time_t start, elapsed;
+    pcilib_grab_pool_t *pool = NULL;
+
+    if (mode == MODE_POOL) {
+	pool = pcilib_alloc_grab_pool(pci, POOL_SIZE, frame_size);
+	if (!pool) return PCILIB_ERROR_MEMORY;
+    }
+
+    start = pcilib_time_ns();
+    for (i = 0; (!err)&&(i < events); i++) {
+	switch (mode) {
+	 case MODE_GRAB:
+	    data = NULL;
+	    err = pcilib_grab(pci, PCILIB_EVENTS_ALL, &size, &data, PCILIB_TIMEOUT_IMMEDIATE);
+	    if (err) break;
+	    check += *(uint32_t*)data;
+	    free(data);
+	    break;
+	 case MODE_POOL:
+	    err = pcilib_grab_pooled(pci, pool, PCILIB_EVENTS_ALL, &size, &data, PCILIB_TIMEOUT_IMMEDIATE);
+	    if (err) break;
+	    check += *(uint32_t*)data;
+	    err = pcilib_release_pooled(pci, pool, data);
+	    break;
+	 case MODE_BORROW:
+	    err = pcilib_grab_borrow(pci, PCILIB_EVENTS_ALL, &size, &data, PCILIB_TIMEOUT_IMMEDIATE);
+	    if (err) break;
+	    check += *(uint32_t*)data;
+	    err = pcilib_grab_release(pci, data);
+	    break;
+	}
+    }
+    elapsed = pcilib_time_ns() - start;
+
+    if (pool) pcilib_free_grab_pool(pci, pool);
+
+    if (err) {
+	printf("%-6s: failed with error %i after %zu events\n", mode_names[mode], err, i);
+	return err;
+    }
+
+    printf("%-6s: Events: %7zu, Rate: %10.1lf events/s, Throughput: %9.1lf MB/s (checksum %u)\n", mode_names[mode], events,
+	1000000000. * events / elapsed, 1000. * frame_size * events / elapsed, check);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t events = DEFAULT_EVENTS;
+    const char *device = DEFAULT_DEVICE;
+    const char *model = DEFAULT_MODEL;
+    pcilib_t *pci;
+
+    if (argc > 1) events = atol(argv[1]);
+    if (argc > 2) frame_size = atol(argv[2]);
+    if (argc > 3) device = argv[3];
+    if (argc > 4) model = argv[4];
+
+    if ((!events)||(frame_size < sizeof(uint32_t))||(frame_size % sizeof(uint32_t))) {
+	printf("Usage: %s [events] [frame_size] [device] [model]\n", argv[0]);
+	exit(1);
+    }
+
+    pci = pcilib_open(device, model);
+    if (!pci) {
+	printf("Error opening device %s with model %s\n", device, model);
+	exit(1);
+    }
+
+    if (pci->model_info.api) {
+	printf("The model %s provides its own event engine\n", model);
+	exit(1);
+    }
+
+    pci->model_info.api = &synthetic_api;
+    pcilib_init_event_engine(pci);
+    if (!pci->event_ctx) {
+	printf("Error initializing synthetic event engine\n");
+	exit(1);
+    }
+
+    printf("Synthetic event engine, frame size: %zu bytes\n", frame_size);
+    run(pci, MODE_GRAB, events);
+    run(pci, MODE_POOL, events);
+    run(pci, MODE_BORROW, events);
+
+    pcilib_close(pci);
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "pcilib.h"
+#include "pcilib/timing.h"
+
+/*
+ * Emulates the trigger/grab handshake of 'pci --trigger --grab' with a synthetic event source
+ * producing the event after the specified delay. The trigger-to-event latency, the time needed by
+ * trigger thread to notice that the event is read (wakeup), and the CPU usage are compared for the 
+ * flag polling with usleep and for the condition variable signalling.
+ *
+ * Usage: handshake_benchmark [events] [event_delay_us]
+ */
+
+#define DEFAULT_EVENTS		1000
+#define DEFAULT_DELAY		1000
+
+typedef struct {
+    int use_cond;				/**< Use condition variable instead of polling */
+    size_t events;				/**< Number of events to generate */
+    size_t delay;				/**< Delay between trigger and event in us */
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    int triggered;				/**< Set by trigger thread, cleared by event source */
+    int event_ready;				/**< Set by event source, cleared by grabbing thread */
+    int event_pending;				/**< Set by trigger thread, cleared by grabbing thread */
+    int run_flag;
+
+    pcilib_time_t trigger_timestamp;
+    pcilib_time_t latency_sum;
+    pcilib_time_t latency_max;
+    size_t latency_count;
+
+    pcilib_time_t release_timestamp;		/**< Time the grabbing thread have released the trigger thread */
+    pcilib_time_t wakeup_sum;
+    pcilib_time_t wakeup_max;
+} handshake_t;
+
+static void set_flag(handshake_t *hs, int *flag, int value) {
+    pthread_mutex_lock(&hs->mutex);
+    __atomic_store_n(flag, value, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&hs->cond);
+    pthread_mutex_unlock(&hs->mutex);
+}
+
+static void wait_flag(handshake_t *hs, int *flag, int value) {
+    pthread_mutex_lock(&hs->mutex);
+    while ((__atomic_load_n(flag, __ATOMIC_ACQUIRE) != value)&&(__atomic_load_n(&hs->run_flag, __ATOMIC_ACQUIRE)))
+	pthread_cond_wait(&hs->cond, &hs->mutex);
+    pthread_mutex_unlock(&hs->mutex);
+}
+
+    // Emulates hardware, always signalled with condition variable
+static void *source_thread(void *arg) {
+    handshake_t *hs = (handshake_t*)arg;
+
+    while (1) {
+	wait_flag(hs, &hs->triggered, 1);
+	if (!__atomic_load_n(&hs->run_flag, __ATOMIC_ACQUIRE)) break;
+
+	pcilib_sleep_until_ns(__atomic_load_n(&hs->trigger_timestamp, __ATOMIC_ACQUIRE) + hs->delay * 1000);
+
+	__atomic_store_n(&hs->triggered, 0, __ATOMIC_RELEASE);
+	set_flag(hs, &hs->event_ready, 1);
+    }
+
+    return NULL;
+}
+
+    // Emulates GrabCallback
+static void *grab_thread(void *arg) {
+    pcilib_time_t latency;
+    handshake_t *hs = (handshake_t*)arg;
+
+    while (1) {
+	wait_flag(hs, &hs->event_ready, 1);
+	if (!__atomic_load_n(&hs->run_flag, __ATOMIC_ACQUIRE)) break;
+
+	latency = pcilib_time_ns() - __atomic_load_n(&hs->trigger_timestamp, __ATOMIC_ACQUIRE);
+	hs->latency_sum += latency;
+	if (latency > hs->latency_max) hs->latency_max = latency;
+	hs->latency_count++;
+
+	__atomic_store_n(&hs->event_ready, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&hs->release_timestamp, pcilib_time_ns(), __ATOMIC_RELEASE);
+	if (hs->use_cond) set_flag(hs, &hs->event_pending, 0);
+	else __atomic_store_n(&hs->event_pending, 0, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+static void run(int use_cond, size_t events, size_t delay) {
+    size_t i;
+    pcilib_time_t wakeup;
+    pthread_t source, grab;
+    struct rusage ru_start, ru_end;
+    pcilib_time_t start, end;
+    double cpu;
+
+    handshake_t hs = {0};
+    hs.use_cond = use_cond;
+    hs.events = events;
+    hs.delay = delay;
+    hs.run_flag = 1;
+    pthread_mutex_init(&hs.mutex, NULL);
+    pthread_cond_init(&hs.cond, NULL);
+
+    if ((pthread_create(&source, NULL, source_thread, &hs))||(pthread_create(&grab, NULL, grab_thread, &hs))) {
+	printf("Error spawning threads\n");
+	exit(1);
+    }
+
+    getrusage(RUSAGE_SELF, &ru_start);
+    start = pcilib_time_ns();
+
+	// Emulates the trigger thread of pcitool
+    for (i = 0; i < events; i++) {
+	__atomic_store_n(&hs.event_pending, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&hs.trigger_timestamp, pcilib_time_ns(), __ATOMIC_RELEASE);
+	set_flag(&hs, &hs.triggered, 1);
+
+	if (use_cond) wait_flag(&hs, &hs.event_pending, 0);
+	else while (__atomic_load_n(&hs.event_pending, __ATOMIC_ACQUIRE)) usleep(10);
+
+	    // Time needed by the trigger thread to notice that event is read
+	wakeup = pcilib_time_ns() - __atomic_load_n(&hs.release_timestamp, __ATOMIC_ACQUIRE);
+	hs.wakeup_sum += wakeup;
+	if (wakeup > hs.wakeup_max) hs.wakeup_max = wakeup;
+    }
+
+    end = pcilib_time_ns();
+    getrusage(RUSAGE_SELF, &ru_end);
+
+    set_flag(&hs, &hs.run_flag, 0);
+    pthread_join(source, NULL);
+    pthread_join(grab, NULL);
+
+    cpu = pcilib_timediff(&ru_start.ru_utime, &ru_end.ru_utime) + pcilib_timediff(&ru_start.ru_stime, &ru_end.ru_stime);
+    printf("%-9s: Events: %6zu, Latency: mean %7.1lf us, max %8.1lf us, Wakeup: mean %6.1lf us, max %7.1lf us, CPU usage: %5.1lf%%\n", use_cond?"condvar":"polling",
+	hs.latency_count, hs.latency_sum / 1000. / hs.latency_count, hs.latency_max / 1000., hs.wakeup_sum / 1000. / events, hs.wakeup_max / 1000., 100000. * cpu / (end - start));
+
+    pthread_cond_destroy(&hs.cond);
+    pthread_mutex_destroy(&hs.mutex);
+}
+
+int main(int argc, char *argv[]) {
+    size_t events = DEFAULT_EVENTS;
+    size_t delay = DEFAULT_DELAY;
+
+    if (argc > 1) events = atol(argv[1]);
+    if (argc > 2) delay = atol(argv[2]);
+
+    if (!events) {
+	printf("Usage: %s [events] [event_delay_us]\n", argv[0]);
+	exit(1);
+    }
+
+    run(0, events, delay);
+    run(1, events, delay);
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "pcilib.h"
+#include "pcilib/timing.h"
+#include "pcilib/kmem.h"
+#include "dma/ipe_private.h"
+#include "dma/ipe.h"
+
+/*
+ * Measures the time needed to reset IPEDMA engine and to program the ring of DMA pages. The DMA
+ * registers are emulated in memory, the emulated firmware accepts each DMA page and leaves reset
+ * only after the specified settle time. The fixed delays used previously are compared with polling
+ * of the page count register and with the bulk upload mode.
+ *
+ * Usage: ipedma_start_benchmark [settle_us] [gen] [pages1 pages2 ...]
+ */
+
+#define DEFAULT_SETTLE		5
+#define DEFAULT_GEN		3
+#define DEFAULT_PAGES		{ 64, 256, 1024, 0 }
+
+typedef enum {
+    MODE_FIXED,
+    MODE_READY,
+    MODE_BULK
+} start_mode_t;
+
+static const char *mode_names[] = { "fixed delay", "ready status", "bulk upload" };
+
+typedef struct {
+    ipe_dma_t *ctx;
+    size_t settle;				/**< Time needed by the firmware to accept a page or leave reset (us) */
+    int run_flag;
+} firmware_t;
+
+#define EMU_REG(fw, reg) ((volatile uint32_t*)((fw)->ctx->base_addr[((reg)&IPEDMA_REG_BANK_MASK)>>IPEDMA_REG_BANK_SHIFT] + ((reg)&IPEDMA_REG_ADDR_MASK)))
+
+static uint64_t emu_page_addr(firmware_t *fw) {
+    if (fw->ctx->addr64) return __atomic_load_n((volatile uint64_t*)EMU_REG(fw, IPEDMA_REG3_PAGE_ADDR), __ATOMIC_ACQUIRE);
+    return __atomic_load_n(EMU_REG(fw, IPEDMA_REG2_PAGE_ADDR), __ATOMIC_ACQUIRE);
+}
+
+    // The pages are numbered from 1 and placed at the addresses 4096 * page
+static void *firmware_thread(void *arg) {
+    firmware_t *fw = (firmware_t*)arg;
+    uint64_t addr, last_addr = 0;
+    int in_reset = 0;
+
+    while (__atomic_load_n(&fw->run_flag, __ATOMIC_ACQUIRE)) {
+	uint32_t reset = __atomic_load_n(EMU_REG(fw, IPEDMA_REG_RESET), __ATOMIC_ACQUIRE);
+	if (reset == 1) in_reset = 1;
+	else if ((in_reset)&&(!reset)) {
+	    pcilib_sleep_until_ns(pcilib_time_ns() + fw->settle * 1000);
+	    __atomic_store_n(EMU_REG(fw, IPEDMA_REG_RESET), 0x14031700, __ATOMIC_RELEASE);
+	    in_reset = 0;
+	}
+
+	addr = emu_page_addr(fw);
+	if (addr != last_addr) {
+	    if (addr) {
+		pcilib_sleep_until_ns(pcilib_time_ns() + fw->settle * 1000);
+		__atomic_store_n(EMU_REG(fw, fw->ctx->reg_page_count), addr / 4096, __ATOMIC_RELEASE);
+	    }
+	    last_addr = addr;
+	}
+
+	sched_yield();
+    }
+
+    return NULL;
+}
+
+static void run(ipe_dma_t *ctx, firmware_t *fw, start_mode_t mode, size_t pages, const uintptr_t *bus_addr) {
+    int err;
+    pcilib_time_t start, reset_end, program_start, end;
+
+    ctx->dma_flags = (mode == MODE_BULK)?IPEDMA_FLAG_BULK_UPLOAD:0;
+    ctx->page_count_broken = (mode == MODE_FIXED)?1:0;
+
+    start = pcilib_time_ns();
+    if (mode == MODE_FIXED) {
+	    // Reset sequence with fixed delays as used before
+	*EMU_REG(fw, IPEDMA_REG_CONTROL) = 0;
+	usleep(IPEDMA_RESET_DELAY);
+	*EMU_REG(fw, IPEDMA_REG_RESET) = 1;
+	usleep(IPEDMA_RESET_DELAY);
+	*EMU_REG(fw, IPEDMA_REG_RESET) = 0;
+	usleep(IPEDMA_RESET_DELAY);
+	if (ctx->gen < 3) *EMU_REG(fw, IPEDMA_REG2_PAGE_COUNT) = 0;
+	usleep(IPEDMA_RESET_DELAY);
+	err = 0;
+    } else {
+	err = dma_ipe_reset((pcilib_dma_context_t*)ctx);
+    }
+    reset_end = pcilib_time_ns();
+
+	// The count is not reset by gen3 firmware, we emulate it here
+    *EMU_REG(fw, ctx->reg_page_count) = 0;
+    while (emu_page_addr(fw)) {
+	if (ctx->addr64) *(volatile uint64_t*)EMU_REG(fw, IPEDMA_REG3_PAGE_ADDR) = 0;
+	else *EMU_REG(fw, IPEDMA_REG2_PAGE_ADDR) = 0;
+	usleep(fw->settle + 100);
+    }
+
+    program_start = pcilib_time_ns();
+    if (!err) err = dma_ipe_program_pages((pcilib_dma_context_t*)ctx, pages, bus_addr);
+    end = pcilib_time_ns();
+
+    printf("%-13s: Pages: %6zu, Reset: %8.1lf ms, Programming: %9.1lf ms, Total: %9.1lf ms%s\n", mode_names[mode], pages,
+	(reset_end - start) / 1000000., (end - program_start) / 1000000., (reset_end - start + end - program_start) / 1000000., err?" (failed)":"");
+}
+
+int main(int argc, char *argv[]) {
+    int i;
+    size_t j;
+    int gen = DEFAULT_GEN;
+    size_t settle = DEFAULT_SETTLE;
+    size_t default_pages[] = DEFAULT_PAGES;
+    size_t num_sizes;
+    size_t pages, max_pages = 0;
+    uintptr_t *bus_addr;
+    pthread_t thr;
+    void *banks;
+
+    ipe_dma_t ctx;
+    firmware_t fw;
+
+    if (argc > 1) settle = atol(argv[1]);
+    if (argc > 2) gen = atoi(argv[2]);
+    num_sizes = (argc > 3)?(argc - 3):(sizeof(default_pages) / sizeof(default_pages[0]) - 1);
+
+    if ((gen != 2)&&(gen != 3)) {
+	printf("Usage: %s [settle_us] [gen] [pages1 pages2 ...]\n", argv[0]);
+	exit(1);
+    }
+
+    for (i = 0; i < num_sizes; i++) {
+	pages = (argc > 3)?atol(argv[i + 3]):default_pages[i];
+	if (!pages) {
+	    printf("Invalid number of pages (%s) is specified\n", argv[i + 3]);
+	    exit(1);
+	}
+	if (pages > max_pages) max_pages = pages;
+    }
+
+    bus_addr = (uintptr_t*)malloc(max_pages * sizeof(uintptr_t));
+    if ((!bus_addr)||(posix_memalign(&banks, 4096, 3 * 4096))) {
+	printf("Error allocating memory\n");
+	exit(1);
+    }
+
+    for (j = 0; j < max_pages; j++)
+	bus_addr[j] = 4096 * (j + 1);
+
+    memset(banks, 0, 3 * 4096);
+    memset(&ctx, 0, sizeof(ctx));
+    for (i = 0; i < 3; i++)
+	ctx.base_addr[i] = (char*)banks + i * 4096;
+
+    ctx.gen = gen;
+    if (gen > 2) {
+	ctx.mode64 = 1;
+	ctx.addr64 = 1;
+	ctx.reg_page_count = IPEDMA_REG3_PAGE_COUNT;
+    } else {
+	ctx.reg_page_count = IPEDMA_REG2_PAGE_COUNT;
+    }
+
+    fw.ctx = &ctx;
+    fw.settle = settle;
+    fw.run_flag = 1;
+    *EMU_REG(&fw, IPEDMA_REG_RESET) = 0x14031700;
+
+    if (pthread_create(&thr, NULL, firmware_thread, &fw)) {
+	printf("Error spawning firmware thread\n");
+	exit(1);
+    }
+
+    printf("Emulated IPEDMA gen%i, settle time: %zu us\n", gen, settle);
+    for (i = 0; i < num_sizes; i++) {
+	pages = (argc > 3)?atol(argv[i + 3]):default_pages[i];
+	run(&ctx, &fw, MODE_FIXED, pages, bus_addr);
+	run(&ctx, &fw, MODE_READY, pages, bus_addr);
+	run(&ctx, &fw, MODE_BULK, pages, bus_addr);
+    }
+
+    __atomic_store_n(&fw.run_flag, 0, __ATOMIC_RELEASE);
+    pthread_join(thr, NULL);
+
+    free(banks);
+    free(bus_addr);
+
+    return 0;
+}
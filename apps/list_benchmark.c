@@ -0,0 +1,184 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dlfcn.h>
+
+#include "pcilib.h"
+#include "pcilib/pci.h"
+#include "pcilib/bank.h"
+#include "pcilib/register.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Measures the latency and the memory allocations of the register and property listings. The specified
+ * number of registers is added to the RAM-backed software register bank 'conf' of the emulated device,
+ * a property is created for each of them. Then, the complete lists, the listings with iterators, and the
+ * information about a single register are requested repeatedly. The allocations are only reported if
+ * the allocation counter (liballoc_count.so) is preloaded, the benchmark itself does not replace the
+ * allocator.
+ *
+ * Usage: list_benchmark [registers] [iterations] [device] [model]
+ */
+
+#define DEFAULT_REGISTERS	20000
+#define DEFAULT_ITERATIONS	100
+#define DEFAULT_DEVICE		"emulated"
+#define DEFAULT_MODEL		"softdma"
+#define DEFAULT_BANK		"conf"
+
+typedef void (*alloc_count_get_t)(size_t *count, size_t *bytes);
+
+static alloc_count_get_t alloc_count_get = NULL;	/**< Provided by preloaded liballoc_count.so */
+
+typedef enum {
+    TEST_REGISTER_LIST,
+    TEST_REGISTER_ITERATOR,
+    TEST_REGISTER_INFO,
+    TEST_PROPERTY_LIST,
+    TEST_PROPERTY_ITERATOR
+} list_test_t;
+
+static const char *test_names[] = { "register list", "register iterator", "register info", "property list", "property iterator" };
+
+static int run(pcilib_t *pci, list_test_t test, const char *arg, size_t iterations) {
+    size_t i, n = 0;
+    size_t count = 0, bytes = 0, end_count, end_bytes;
+    pcilib_time_t start, elapsed;
+    pcilib_register_info_t *reg_list;
+    pcilib_property_info_t *prop_list;
+    pcilib_register_iterator_t reg_iter;
+    pcilib_property_iterator_t prop_iter;
+
+    if (alloc_count_get) alloc_count_get(&count, &bytes);
+
+    start = pcilib_time_ns();
+    for (i = 0; i < iterations; i++) {
+	switch (test) {
+	 case TEST_REGISTER_LIST:
+	    reg_list = pcilib_get_register_list(pci, arg, PCILIB_LIST_FLAGS_DEFAULT);
+	    if (!reg_list) return PCILIB_ERROR_FAILED;
+	    for (n = 0; reg_list[n].name; n++);
+	    pcilib_free_register_info(pci, reg_list);
+	    break;
+	 case TEST_REGISTER_ITERATOR:
+	    if (pcilib_init_register_iterator(pci, &reg_iter, arg, PCILIB_LIST_FLAGS_DEFAULT)) return PCILIB_ERROR_FAILED;
+	    for (n = 0; pcilib_get_next_register(pci, &reg_iter); n++);
+	    break;
+	 case TEST_REGISTER_INFO:
+	    reg_list = pcilib_get_register_info(pci, DEFAULT_BANK, arg, PCILIB_LIST_FLAGS_DEFAULT);
+	    if (!reg_list) return PCILIB_ERROR_FAILED;
+	    n = 1;
+	    pcilib_free_register_info(pci, reg_list);
+	    break;
+	 case TEST_PROPERTY_LIST:
+	    prop_list = pcilib_get_property_list(pci, arg, PCILIB_LIST_FLAGS_DEFAULT);
+	    if (!prop_list) return PCILIB_ERROR_FAILED;
+	    for (n = 0; prop_list[n].path; n++);
+	    pcilib_free_property_info(pci, prop_list);
+	    break;
+	 case TEST_PROPERTY_ITERATOR:
+	    if (pcilib_init_property_iterator(pci, &prop_iter, arg, PCILIB_LIST_FLAGS_DEFAULT)) return PCILIB_ERROR_FAILED;
+	    for (n = 0; pcilib_get_next_property(pci, &prop_iter); n++);
+	    break;
+	}
+    }
+    elapsed = pcilib_time_ns() - start;
+
+    printf("%-18s (%-16s): Entries: %6zu, Latency: %10.1lf us", test_names[test], arg?arg:"all", n, elapsed / 1000. / iterations);
+    if (alloc_count_get) {
+	alloc_count_get(&end_count, &end_bytes);
+	printf(", Allocations: %6zu (%9zu bytes) per call", (end_count - count) / iterations, (end_bytes - bytes) / iterations);
+    }
+    printf("\n");
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int err;
+    size_t i;
+    size_t num = DEFAULT_REGISTERS;
+    size_t iterations = DEFAULT_ITERATIONS;
+    const char *device = DEFAULT_DEVICE;
+    const char *model = DEFAULT_MODEL;
+    pcilib_register_description_t *regs;
+    pcilib_register_bank_t bank;
+    pcilib_time_t start;
+    char reg_name[32];
+    char *names;
+    pcilib_t *pci;
+
+    if (argc > 1) num = atol(argv[1]);
+    if (argc > 2) iterations = atol(argv[2]);
+    if (argc > 3) device = argv[3];
+    if (argc > 4) model = argv[4];
+
+    if ((!num)||(num > 60000)||(!iterations)) {
+	printf("Usage: %s [registers] [iterations] [device] [model]\n", argv[0]);
+	exit(1);
+    }
+
+    alloc_count_get = (alloc_count_get_t)dlsym(RTLD_DEFAULT, "alloc_count_get");
+
+    pci = pcilib_open(device, model);
+    if (!pci) {
+	printf("Error opening device %s with model %s\n", device, model);
+	exit(1);
+    }
+
+    bank = pcilib_find_register_bank_by_name(pci, DEFAULT_BANK);
+    if (bank == PCILIB_REGISTER_BANK_INVALID) {
+	printf("Bank %s is not found\n", DEFAULT_BANK);
+	exit(1);
+    }
+
+    regs = (pcilib_register_description_t*)calloc(num, sizeof(pcilib_register_description_t));
+    names = (char*)malloc(num * 16);
+    if ((!regs)||(!names)) {
+	printf("Error allocating memory\n");
+	exit(1);
+    }
+
+    for (i = 0; i < num; i++) {
+	sprintf(names + 16 * i, "bench%05zu", i);
+	regs[i] = (pcilib_register_description_t){
+	    .addr = 0,
+	    .bits = 32,
+	    .mode = PCILIB_REGISTER_RW,
+	    .type = PCILIB_REGISTER_STANDARD,
+	    .bank = pci->banks[bank].addr,
+	    .name = names + 16 * i
+	};
+    }
+
+    start = pcilib_time_ns();
+    err = pcilib_add_registers(pci, PCILIB_MODEL_MODIFICATON_FLAGS_DEFAULT, num, regs, NULL);
+    if (err) {
+	printf("Error (%i) adding registers\n", err);
+	exit(1);
+    }
+    printf("Added %zu registers in %.1lf ms, the model has %zu registers and %zu views\n", num, (pcilib_time_ns() - start) / 1000000., pci->num_reg, pci->num_views);
+
+    sprintf(reg_name, "bench%05zu", num / 2);
+
+    run(pci, TEST_REGISTER_LIST, NULL, iterations);
+    run(pci, TEST_REGISTER_ITERATOR, NULL, iterations);
+    run(pci, TEST_REGISTER_LIST, DEFAULT_BANK, iterations);
+    run(pci, TEST_REGISTER_ITERATOR, DEFAULT_BANK, iterations);
+    run(pci, TEST_REGISTER_INFO, reg_name, iterations);
+    run(pci, TEST_PROPERTY_LIST, "/", iterations);
+    run(pci, TEST_PROPERTY_ITERATOR, "/", iterations);
+    run(pci, TEST_PROPERTY_LIST, "/registers/" DEFAULT_BANK, iterations);
+    run(pci, TEST_PROPERTY_ITERATOR, "/registers/" DEFAULT_BANK, iterations);
+
+    pcilib_close(pci);
+
+    free(names);
+    free(regs);
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pcilib.h"
+#include "pcilib/pci.h"
+#include "pcilib/dma.h"
+#include "pcilib/kmem.h"
+#include "pcilib/error.h"
+#include "dma/nwl_private.h"
+#include "dma/nwl_defines.h"
+
+/*
+ * Checks the multi-page writes of NWL S2C engine. The engine registers are emulated in memory and the
+ * DMA ring is allocated in the emulated kernel memory, so no hardware is needed. The data is written with
+ * dma_nwl_write_fragment() and the pages, the descriptors, and the software descriptor pointer are compared
+ * with the expected state. The engine is never completing descriptors, so the number of pages written at
+ * once is limited by the ring size.
+ *
+ * Usage: nwl_write_test [size1 size2 ...]
+ */
+
+#define DEFAULT_MODEL		"softdma"
+#define DEFAULT_SIZES		{ 4096, 3 * 4096, 5 * 4096 + 2048, 100, 0 }
+#define REGISTER_SPACE		4096
+
+#define NWL_RING_GET(data, offset)  *(uint32_t*)(((char*)(data)) + (offset))
+
+static int check_write(nwl_dma_t *ctx, size_t size) {
+    int err;
+    size_t i, n, pos, len, written = 0;
+    uint32_t ctrl, expected, ring_pa, next_bd;
+    uint32_t *data;
+    unsigned char *ring, *page;
+
+    pcilib_nwl_engine_context_t *ectx = ctx->engines;
+
+    data = (uint32_t*)malloc(size + sizeof(uint32_t));
+    if (!data) {
+	printf("Error allocating %zu bytes\n", size);
+	return PCILIB_ERROR_MEMORY;
+    }
+
+    for (i = 0; i < (size + sizeof(uint32_t) - 1) / sizeof(uint32_t); i++)
+	data[i] = i;
+
+    ring = (unsigned char*)pcilib_kmem_get_ua(ctx->dmactx.pcilib, ectx->ring);
+    ring_pa = pcilib_kmem_get_ba(ctx->dmactx.pcilib, ectx->ring);
+
+    memset(ring, 0, ectx->ring_size * PCILIB_NWL_DMA_DESCRIPTOR_SIZE);
+    for (i = 0; i < ectx->ring_size; i++)
+	memset((void*)pcilib_kmem_get_block_ua(ctx->dmactx.pcilib, ectx->pages, i), 0, ectx->page_size);
+
+    ectx->head = 0;
+    ectx->tail = 0;
+    ectx->writting = 0;
+
+	// The engine is prepared by hand, so dma_nwl_start() is skipped
+    err = dma_nwl_write_fragment((pcilib_dma_context_t*)ctx, 0, 0, size, PCILIB_DMA_FLAG_PREPARED|PCILIB_DMA_FLAG_EOP, PCILIB_TIMEOUT_IMMEDIATE, data, &written);
+    if (err) {
+	printf("%8zu bytes: write failed with error %i, %zu bytes written\n", size, err, written);
+	free(data);
+	return err;
+    }
+
+    n = (size + ectx->page_size - 1) / ectx->page_size;
+    for (i = 0, pos = 0; i < n; i++, pos += len) {
+	len = size - pos;
+	if (len > ectx->page_size) len = ectx->page_size;
+
+	expected = len;
+	if (!i) expected |= DMA_BD_SOP_MASK;
+	if (i == (n - 1)) expected |= DMA_BD_EOP_MASK;
+
+	ctrl = NWL_RING_GET(ring + i * PCILIB_NWL_DMA_DESCRIPTOR_SIZE, DMA_BD_BUFL_CTRL_OFFSET);
+	if (ctrl != expected) {
+	    printf("%8zu bytes: descriptor %zu has control 0x%x, expected 0x%x\n", size, i, ctrl, expected);
+	    err = PCILIB_ERROR_VERIFY;
+	    break;
+	}
+
+	page = (unsigned char*)pcilib_kmem_get_block_ua(ctx->dmactx.pcilib, ectx->pages, i);
+	if (memcmp(page, (char*)data + pos, len)) {
+	    printf("%8zu bytes: page %zu does not match the written data at offset %zu\n", size, i, pos);
+	    err = PCILIB_ERROR_VERIFY;
+	    break;
+	}
+    }
+
+    nwl_read_register(next_bd, ctx, ectx->base_addr, REG_SW_NEXT_BD);
+    if ((!err)&&(next_bd != ring_pa + n * PCILIB_NWL_DMA_DESCRIPTOR_SIZE)) {
+	printf("%8zu bytes: software descriptor pointer is not advanced to descriptor %zu\n", size, n);
+	err = PCILIB_ERROR_VERIFY;
+    }
+
+    if (!err) printf("%8zu bytes: %zu pages are written correctly\n", size, n);
+
+    free(data);
+    return err;
+}
+
+int main(int argc, char *argv[]) {
+    int i, err = 0;
+    size_t size;
+    size_t default_sizes[] = DEFAULT_SIZES;
+    size_t num_sizes;
+    void *regs;
+    pcilib_t *pci;
+
+    nwl_dma_t ctx;
+    pcilib_nwl_engine_context_t *ectx = ctx.engines;
+    pcilib_register_bank_description_t bank = { 0 };
+    pcilib_dma_engine_description_t engine = { 0, PCILIB_DMA_TYPE_PACKET, PCILIB_DMA_TO_DEVICE, 32, "dma", "Emulated NWL S2C engine" };
+
+    num_sizes = (argc > 1)?(argc - 1):(sizeof(default_sizes) / sizeof(default_sizes[0]) - 1);
+
+    pci = pcilib_open(PCILIB_DEVICE_EMULATED, DEFAULT_MODEL);
+    if (!pci) {
+	printf("Error opening emulated device with model %s\n", DEFAULT_MODEL);
+	exit(1);
+    }
+
+    if (posix_memalign(&regs, 4096, REGISTER_SPACE)) {
+	printf("Error allocating memory\n");
+	exit(1);
+    }
+    memset(regs, 0, REGISTER_SPACE);
+
+    bank.raw_endianess = PCILIB_HOST_ENDIAN;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.dmactx.pcilib = pci;
+    ctx.dma_bank = &bank;
+    ctx.base_addr = regs;
+    ctx.wait_mode = NWL_WAIT_POLL;
+    ctx.sync_pages = 1;
+
+    ectx->desc = &engine;
+    ectx->base_addr = regs;
+    ectx->ring = pcilib_alloc_kernel_memory(pci, PCILIB_KMEM_TYPE_CONSISTENT, 1, PCILIB_NWL_DMA_PAGES * PCILIB_NWL_DMA_DESCRIPTOR_SIZE, PCILIB_NWL_ALIGNMENT, PCILIB_KMEM_USE(PCILIB_KMEM_USE_DMA_RING, 0x80), 0);
+    ectx->pages = pcilib_alloc_kernel_memory(pci, PCILIB_KMEM_TYPE_DMA_S2C_PAGE, PCILIB_NWL_DMA_PAGES, 0, 0, PCILIB_KMEM_USE(PCILIB_KMEM_USE_DMA_PAGES, 0x80), 0);
+    if ((!ectx->ring)||(!ectx->pages)) {
+	printf("Error allocating DMA ring\n");
+	exit(1);
+    }
+
+    ectx->ring_size = PCILIB_NWL_DMA_PAGES;
+    ectx->page_size = pcilib_kmem_get_block_size(pci, ectx->pages, 0);
+    ectx->started = 1;
+
+    printf("Emulated NWL S2C engine: %zu pages of %zu bytes\n", ectx->ring_size, ectx->page_size);
+    for (i = 0; i < num_sizes; i++) {
+	size = (argc > 1)?atol(argv[i + 1]):default_sizes[i];
+	if ((!size)||(size >= (ectx->ring_size - 1) * ectx->page_size)) {
+	    printf("Invalid size (%zu) is specified, up to %zu bytes can be written\n", size, (ectx->ring_size - 2) * ectx->page_size);
+	    exit(1);
+	}
+
+	if (check_write(&ctx, size)) err = 1;
+    }
+
+    pcilib_free_kernel_memory(pci, ectx->pages, 0);
+    pcilib_free_kernel_memory(pci, ectx->ring, 0);
+    pcilib_close(pci);
+    free(regs);
+
+    return err;
+}
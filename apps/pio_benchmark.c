@@ -0,0 +1,109 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pcilib.h"
+#include "pcilib/bar.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Measures the bandwidth of PIO reads and writes to the PCI BAR mapped with different caching
+ * modes. The driver built with PCIDRIVER_DUMMY_DEVICE provides RAM-backed BAR0 which can be used
+ * to test the modes without hardware. If the driver rejects a mode, pcilib warns and the default
+ * mode is measured instead. Do not run it on BARs with registers having side effects.
+ *
+ * Usage: pio_benchmark [device] [bar] [size] [iterations]
+ */
+
+#define DEFAULT_DEVICE		"/dev/fpga0"
+#define DEFAULT_BAR		0
+#define DEFAULT_SIZE		65536
+#define DEFAULT_ITERATIONS	1000
+
+static const char *cache_names[] = { "default", "uc", "wc", "wb" };
+
+static void run(const char *device, pcilib_bar_t bar, pcilib_bar_cache_t mode, size_t size, size_t iterations, void *buf) {
+    int err;
+    size_t i;
+    pcilib_t *pci;
+    const pcilib_bar_info_t *bar_info;
+    pcilib_time_t start, write_time, read_time;
+
+    pci = pcilib_open(device, NULL);
+    if (!pci) {
+	printf("Error opening device %s\n", device);
+	exit(1);
+    }
+
+    bar_info = pcilib_get_bar_info(pci, bar);
+    if ((!bar_info)||(bar_info->size < size)) {
+	printf("BAR %i is not available or smaller than %zu bytes\n", bar, size);
+	exit(1);
+    }
+
+    err = pcilib_set_bar_cache(pci, bar, mode);
+    if (err) {
+	printf("%-7s: not supported\n", cache_names[mode]);
+	pcilib_close(pci);
+	return;
+    }
+
+    if (!pcilib_map_bar(pci, bar)) {
+	printf("%-7s: failed to map BAR %i\n", cache_names[mode], bar);
+	pcilib_close(pci);
+	return;
+    }
+
+    start = pcilib_time_ns();
+    for (i = 0; (!err)&&(i < iterations); i++)
+	err = pcilib_write(pci, bar, 0, 4, size / 4, buf);
+    write_time = pcilib_time_ns() - start;
+
+    start = pcilib_time_ns();
+    for (i = 0; (!err)&&(i < iterations); i++)
+	err = pcilib_read(pci, bar, 0, 4, size / 4, buf);
+    read_time = pcilib_time_ns() - start;
+
+    if (err) printf("%-7s: failed with error %i\n", cache_names[mode], err);
+    else printf("%-7s: Write: %9.1lf MB/s, Read: %9.1lf MB/s\n", cache_names[mode],
+	1000. * size * iterations / write_time, 1000. * size * iterations / read_time);
+
+    pcilib_close(pci);
+}
+
+int main(int argc, char *argv[]) {
+    int mode;
+    const char *device = DEFAULT_DEVICE;
+    pcilib_bar_t bar = DEFAULT_BAR;
+    size_t size = DEFAULT_SIZE;
+    size_t iterations = DEFAULT_ITERATIONS;
+    void *buf;
+
+    if (argc > 1) device = argv[1];
+    if (argc > 2) bar = atoi(argv[2]);
+    if (argc > 3) size = atol(argv[3]);
+    if (argc > 4) iterations = atol(argv[4]);
+
+    if ((bar < 0)||(bar > 5)||(!size)||(size % 4)||(!iterations)) {
+	printf("Usage: %s [device] [bar] [size] [iterations]\n", argv[0]);
+	exit(1);
+    }
+
+    if (posix_memalign(&buf, 4096, size)) {
+	printf("Error allocating memory\n");
+	exit(1);
+    }
+    memset(buf, 0x5A, size);
+
+    printf("Device %s, BAR %i, %zu bytes x %zu iterations\n", device, bar, size, iterations);
+    for (mode = PCILIB_BAR_CACHE_DEFAULT; mode <= PCILIB_BAR_CACHE_WB; mode++)
+	run(device, bar, mode, size, iterations, buf);
+
+    free(buf);
+
+    return 0;
+}
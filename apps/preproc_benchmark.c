@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "pcilib.h"
+#include "pcilib/error.h"
+#include "pcilib/cpu.h"
+#include "pcilib/timing.h"
+#include "pcilib/preproc.h"
+
+/*
+ * Measures scaling of the event preprocessing pool. The synthetic in-memory source produces
+ * frames of 12-bit packed pixels and the workers unpack them to 16-bit pixels.
+ *
+ * Usage: preproc_benchmark [max_threads] [events] [frame_size_in_pixels]
+ */
+
+#define DEFAULT_EVENTS		1000
+#define DEFAULT_PIXELS		(2048 * 1088)
+#define QUEUE_SIZE		32
+
+typedef struct {
+    pcilib_preproc_t *pp;
+    size_t events;
+    size_t raw_size;
+    uint8_t **raw;
+    int err;
+} source_t;
+
+static int decode(void *user, pcilib_event_id_t event_id, const void *raw, size_t raw_size, void *buf, size_t *size) {
+    size_t i, n = 2 * (raw_size / 3);
+    const uint8_t *src = (const uint8_t*)raw;
+    uint16_t *dst = (uint16_t*)buf;
+
+    if ((n * sizeof(uint16_t)) > *size) return PCILIB_ERROR_TOOBIG;
+
+    for (i = 0; i < n; i += 2, src += 3) {
+	dst[i] = src[0] | ((src[1]&0x0F) << 8);
+	dst[i + 1] = (src[1] >> 4) | (src[2] << 4);
+    }
+
+    *size = n * sizeof(uint16_t);
+    return 0;
+}
+
+static void *source(void *arg) {
+    size_t i;
+    source_t *src = (source_t*)arg;
+
+    for (i = 0; i < src->events; i++) {
+	src->err = pcilib_preproc_push(src->pp, src->raw[i % QUEUE_SIZE], src->raw_size, PCILIB_TIMEOUT_INFINITE, NULL);
+	if (src->err) break;
+    }
+
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int err;
+    size_t i, j, threads;
+    size_t max_threads = pcilib_get_cpu_count();
+    size_t events = DEFAULT_EVENTS;
+    size_t pixels = DEFAULT_PIXELS;
+    size_t raw_size;
+    uint8_t *raw[QUEUE_SIZE];
+    uint64_t checksum, ref_checksum = 0;
+    double rate, ref_rate = 0;
+
+    pthread_t thread;
+    struct timeval start, end;
+    source_t src;
+
+    if (argc > 1) max_threads = atol(argv[1]);
+    if (argc > 2) events = atol(argv[2]);
+    if (argc > 3) pixels = atol(argv[3]) & ~1ul;
+
+    if ((!max_threads)||(!events)||(!pixels)) {
+	printf("Usage: %s [max_threads] [events] [frame_size_in_pixels]\n", argv[0]);
+	exit(1);
+    }
+
+    raw_size = 3 * pixels / 2;
+    for (i = 0; i < QUEUE_SIZE; i++) {
+	raw[i] = (uint8_t*)malloc(raw_size);
+	if (!raw[i]) {
+	    printf("Error allocating memory for synthetic events\n");
+	    exit(1);
+	}
+	for (j = 0; j < raw_size; j++)
+	    raw[i][j] = (uint8_t)(i * 31 + j * 7);
+    }
+
+    for (threads = 1; threads <= max_threads; threads++) {
+	src.pp = pcilib_preproc_create(NULL, threads, QUEUE_SIZE, pixels * sizeof(uint16_t), decode, NULL);
+	if (!src.pp) exit(1);
+
+	src.events = events;
+	src.raw_size = raw_size;
+	src.raw = raw;
+	src.err = 0;
+
+	checksum = 0;
+	pcilib_gettime(&start);
+
+	pthread_create(&thread, NULL, source, &src);
+	for (i = 0; i < events; i++) {
+	    void *data;
+	    size_t size;
+	    pcilib_event_id_t event_id;
+
+	    err = pcilib_preproc_get_next(src.pp, PCILIB_TIMEOUT_INFINITE, &event_id);
+	    if (!err) err = pcilib_preproc_get_data(src.pp, event_id, PCILIB_TIMEOUT_INFINITE, &data, &size);
+	    if (err) {
+		printf("Error (%i) getting event %zu\n", err, i + 1);
+		exit(1);
+	    }
+
+	    if (event_id != (i + 1)) {
+		printf("Events are delivered out of order, expected %zu but got %lu\n", i + 1, (unsigned long)event_id);
+		exit(1);
+	    }
+
+	    checksum += ((uint16_t*)data)[(event_id * 13) % (size / sizeof(uint16_t))];
+	    pcilib_preproc_return(src.pp, event_id);
+	}
+	pthread_join(thread, NULL);
+
+	pcilib_gettime(&end);
+	pcilib_preproc_free(src.pp);
+
+	if (src.err) {
+	    printf("Error (%i) pushing synthetic events\n", src.err);
+	    exit(1);
+	}
+
+	if (threads == 1) ref_checksum = checksum;
+	else if (checksum != ref_checksum) {
+	    printf("Checksum mismatch with %zu threads\n", threads);
+	    exit(1);
+	}
+
+	rate = events * 1000000. / pcilib_timediff(&start, &end);
+	if (threads == 1) ref_rate = rate;
+
+	printf("Threads: %2zu, Events: %zu, Rate: %8.1lf events/s, %8.1lf MB/s, Speedup: %.2lf\n", threads, events, rate, rate * raw_size / 1024 / 1024, rate / ref_rate);
+    }
+
+    for (i = 0; i < QUEUE_SIZE; i++)
+	free(raw[i]);
+
+    return 0;
+}
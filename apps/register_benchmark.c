@@ -0,0 +1,113 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pcilib.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Measures the throughput of reading and writing ranges of registers with the block transfers and
+ * with the protocol API accessing registers one by one. By default, the RAM-backed software register
+ * bank 'conf' of the emulated device is used. The registers at the start of the bank are skipped and
+ * the original content of the tested range is restored afterwards. The bank with 32-bit registers
+ * is expected.
+ *
+ * Usage: register_benchmark [iterations] [bank] [device] [model]
+ */
+
+#define DEFAULT_ITERATIONS	10000
+#define DEFAULT_BANK		"conf"
+#define DEFAULT_DEVICE		"emulated"
+#define DEFAULT_MODEL		"softdma"
+#define RANGE_OFFSET		0x100
+#define RANGE_SIZE		0xF00		/**< bytes */
+
+static int run(pcilib_t *pci, const char *bank, pcilib_register_space_flags_t flags, size_t iterations, size_t n, pcilib_register_value_t *buf, pcilib_register_value_t *check) {
+    int err = 0;
+    size_t i;
+    pcilib_time_t start, write_time, read_time;
+    const char *name = (flags&PCILIB_REGISTER_SPACE_FLAG_WORDWISE)?"wordwise":"block";
+
+    for (i = 0; i < n; i++)
+	buf[i] = (i << 8) | flags;
+
+    start = pcilib_time_ns();
+    for (i = 0; (!err)&&(i < iterations); i++)
+	err = pcilib_write_register_space_custom(pci, bank, RANGE_OFFSET, n, flags, buf);
+    write_time = pcilib_time_ns() - start;
+
+    start = pcilib_time_ns();
+    for (i = 0; (!err)&&(i < iterations); i++)
+	err = pcilib_read_register_space_custom(pci, bank, RANGE_OFFSET, n, flags, check);
+    read_time = pcilib_time_ns() - start;
+
+    if (!err) err = pcilib_write_register_space_custom(pci, bank, RANGE_OFFSET, n, flags|PCILIB_REGISTER_SPACE_FLAG_VERIFY, buf);
+
+	// Cross-check with the other access method
+    if (!err) err = pcilib_read_register_space_custom(pci, bank, RANGE_OFFSET, n, flags^PCILIB_REGISTER_SPACE_FLAG_WORDWISE, check);
+    if ((!err)&&(memcmp(buf, check, n * sizeof(pcilib_register_value_t)))) err = PCILIB_ERROR_VERIFY;
+
+    if (err) {
+	printf("%-8s: failed with error %i\n", name, err);
+	return err;
+    }
+
+    printf("%-8s: Registers: %5zu, Write: %8.2lf Mwords/s, Read: %8.2lf Mwords/s, verified\n", name, n,
+	1000. * n * iterations / write_time, 1000. * n * iterations / read_time);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t iterations = DEFAULT_ITERATIONS;
+    const char *bank = DEFAULT_BANK;
+    const char *device = DEFAULT_DEVICE;
+    const char *model = DEFAULT_MODEL;
+    size_t n = RANGE_SIZE / 4;
+    pcilib_register_value_t *saved, *buf, *check;
+    pcilib_t *pci;
+
+    if (argc > 1) iterations = atol(argv[1]);
+    if (argc > 2) bank = argv[2];
+    if (argc > 3) device = argv[3];
+    if (argc > 4) model = argv[4];
+
+    if (!iterations) {
+	printf("Usage: %s [iterations] [bank] [device] [model]\n", argv[0]);
+	exit(1);
+    }
+
+    pci = pcilib_open(device, model);
+    if (!pci) {
+	printf("Error opening device %s with model %s\n", device, model);
+	exit(1);
+    }
+
+    saved = (pcilib_register_value_t*)malloc(3 * n * sizeof(pcilib_register_value_t));
+    if (!saved) {
+	printf("Error allocating memory\n");
+	exit(1);
+    }
+    buf = saved + n;
+    check = buf + n;
+
+    if (pcilib_read_register_space(pci, bank, RANGE_OFFSET, n, saved)) {
+	printf("Error reading %zu registers at offset 0x%x of bank %s\n", n, RANGE_OFFSET, bank);
+	exit(1);
+    }
+
+    run(pci, bank, PCILIB_REGISTER_SPACE_FLAG_WORDWISE, iterations, n, buf, check);
+    run(pci, bank, PCILIB_REGISTER_SPACE_FLAGS_DEFAULT, iterations, n, buf, check);
+
+    pcilib_write_register_space(pci, bank, RANGE_OFFSET, n, saved);
+
+    free(saved);
+
+    pcilib_close(pci);
+
+    return 0;
+}
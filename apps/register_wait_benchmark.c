@@ -0,0 +1,217 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "pcilib.h"
+#include "pcilib/pci.h"
+#include "pcilib/bank.h"
+#include "pcilib/register.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Measures the poll rate and the reaction latency of pcilib_wait_register_custom() with different
+ * waiting policies. A test register is added to the RAM-backed software register bank 'conf' of the
+ * emulated device. To measure the poll rate, the wait for the value which is never written is timed
+ * out after the specified run time. To measure the latency, a second thread writes a new value after
+ * a random delay and the time until the waiting thread detects it is recorded.
+ *
+ * Usage: register_wait_benchmark [changes] [run_time] [device] [model]
+ */
+
+#define DEFAULT_CHANGES		200
+#define DEFAULT_RUN_TIME	200000		/**< us */
+#define DEFAULT_DEVICE		"emulated"
+#define DEFAULT_MODEL		"softdma"
+#define DEFAULT_BANK		"conf"
+#define TEST_REGISTER		"wait_benchmark"
+#define TEST_ADDRESS		0xFF0
+#define MAX_CHANGE_DELAY	2000		/**< us */
+
+typedef struct {
+    const char *name;
+    pcilib_register_wait_policy_t policy;
+} wait_policy_t;
+
+static const wait_policy_t policies[] = {
+    { "spin",    { PCILIB_TIMEOUT_INFINITE, 0, 0, PCILIB_REGISTER_WAIT_FLAGS_DEFAULT } },
+    { "default", { PCILIB_REGISTER_WAIT_SPIN_TIME, PCILIB_REGISTER_WAIT_MIN_SLEEP, PCILIB_REGISTER_WAIT_MAX_SLEEP, PCILIB_REGISTER_WAIT_FLAGS_DEFAULT } },
+    { "sleep",   { 0, 100, 100, PCILIB_REGISTER_WAIT_FLAGS_DEFAULT } },
+    { NULL }
+};
+
+typedef struct {
+    pcilib_t *pci;
+    pcilib_register_t reg;
+    size_t changes;
+    volatile pcilib_time_t written;		/**< Time the last value was written */
+    volatile size_t acknowledged;		/**< Last value detected by the waiting thread */
+} writer_t;
+
+static int check_value(void *arg, pcilib_register_value_t value) {
+    return (value == *(pcilib_register_value_t*)arg);
+}
+
+static void *writer_thread(void *arg) {
+    size_t i;
+    writer_t *ctx = (writer_t*)arg;
+
+    for (i = 1; i <= ctx->changes; i++) {
+	usleep(rand() % MAX_CHANGE_DELAY);
+
+	ctx->written = pcilib_time_ns();
+	__sync_synchronize();
+	pcilib_write_register_by_id(ctx->pci, ctx->reg, i);
+
+	while (ctx->acknowledged != i) usleep(10);
+    }
+
+    return NULL;
+}
+
+static double cpu_time(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000000.;
+}
+
+static int run_poll_rate(pcilib_t *pci, pcilib_register_t reg, const wait_policy_t *p, pcilib_timeout_t run_time) {
+    int err;
+    double cpu;
+    pcilib_register_value_t never = (pcilib_register_value_t)-1;
+    pcilib_register_wait_stats_t stats;
+
+    cpu = cpu_time();
+    err = pcilib_wait_register_custom(pci, reg, check_value, &never, &p->policy, run_time, NULL, &stats);
+    cpu = cpu_time() - cpu;
+
+    if (err != PCILIB_ERROR_TIMEOUT) {
+	printf("%-8s: failed with error %i\n", p->name, err);
+	return err?err:PCILIB_ERROR_FAILED;
+    }
+
+    printf("%-8s: Polls: %9zu, Rate: %12.1lf polls/s, Sleeps: %6zu, CPU: %5.1lf%%\n", p->name, stats.polls,
+	1000000. * stats.polls / stats.wait_time, stats.sleeps, 100000000. * cpu / stats.wait_time);
+
+    return 0;
+}
+
+static int run_latency(pcilib_t *pci, pcilib_register_t reg, const wait_policy_t *p, size_t changes) {
+    int err = 0;
+    size_t i, polls = 0;
+    double cpu;
+    pthread_t thread;
+    pcilib_register_value_t expected;
+    pcilib_register_wait_stats_t stats;
+    pcilib_time_t latency, sum = 0, max = 0, start;
+    writer_t writer = { pci, reg, changes, 0, 0 };
+
+    err = pcilib_write_register_by_id(pci, reg, 0);
+    if (err) return err;
+
+    if (pthread_create(&thread, NULL, writer_thread, &writer)) {
+	printf("%-8s: failed to start writer thread\n", p->name);
+	return PCILIB_ERROR_FAILED;
+    }
+
+    start = pcilib_time_ns();
+    cpu = cpu_time();
+    for (i = 1; i <= changes; i++) {
+	expected = i;
+	err = pcilib_wait_register_custom(pci, reg, check_value, &expected, &p->policy, 10 * MAX_CHANGE_DELAY, NULL, &stats);
+	latency = pcilib_time_ns();
+	__sync_synchronize();
+	latency -= writer.written;
+
+	writer.acknowledged = i;
+	if (err) break;
+
+	sum += latency;
+	if (latency > max) max = latency;
+	polls += stats.polls;
+    }
+    cpu = cpu_time() - cpu;
+    start = pcilib_time_ns() - start;
+
+    if (err) writer.acknowledged = changes;
+    pthread_join(thread, NULL);
+
+    if (err) {
+	printf("%-8s: failed with error %i after %zu changes\n", p->name, err, i - 1);
+	return err;
+    }
+
+    printf("%-8s: Changes: %6zu, Latency: %8.1lf us (max: %8.1lf us), Polls: %8zu per change, CPU: %5.1lf%%\n", p->name, changes,
+	sum / 1000. / changes, max / 1000., polls / changes, 100000000000. * cpu / start);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int err;
+    size_t i;
+    size_t changes = DEFAULT_CHANGES;
+    pcilib_timeout_t run_time = DEFAULT_RUN_TIME;
+    const char *device = DEFAULT_DEVICE;
+    const char *model = DEFAULT_MODEL;
+    pcilib_register_bank_t bank;
+    pcilib_register_t reg;
+    pcilib_register_description_t desc;
+    pcilib_t *pci;
+
+    if (argc > 1) changes = atol(argv[1]);
+    if (argc > 2) run_time = atol(argv[2]);
+    if (argc > 3) device = argv[3];
+    if (argc > 4) model = argv[4];
+
+    if ((!changes)||(!run_time)) {
+	printf("Usage: %s [changes] [run_time] [device] [model]\n", argv[0]);
+	exit(1);
+    }
+
+    pci = pcilib_open(device, model);
+    if (!pci) {
+	printf("Error opening device %s with model %s\n", device, model);
+	exit(1);
+    }
+
+    bank = pcilib_find_register_bank_by_name(pci, DEFAULT_BANK);
+    if (bank == PCILIB_REGISTER_BANK_INVALID) {
+	printf("Bank %s is not found\n", DEFAULT_BANK);
+	exit(1);
+    }
+
+    desc = (pcilib_register_description_t){
+	.addr = TEST_ADDRESS,
+	.bits = 32,
+	.mode = PCILIB_REGISTER_RW,
+	.type = PCILIB_REGISTER_STANDARD,
+	.bank = pci->banks[bank].addr,
+	.name = TEST_REGISTER
+    };
+
+    err = pcilib_add_registers(pci, PCILIB_MODEL_MODIFICATON_FLAGS_DEFAULT, 1, &desc, &reg);
+    if (err) {
+	printf("Error (%i) adding test register\n", err);
+	exit(1);
+    }
+
+    printf("Poll rate, %lu us per policy\n", (unsigned long)run_time);
+    for (i = 0; policies[i].name; i++)
+	run_poll_rate(pci, reg, &policies[i], run_time);
+
+    printf("Reaction latency, changes every 0 - %u us\n", MAX_CHANGE_DELAY);
+    for (i = 0; policies[i].name; i++)
+	run_latency(pci, reg, &policies[i], changes);
+
+    pcilib_close(pci);
+
+    return 0;
+}
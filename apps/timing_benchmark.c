@@ -0,0 +1,132 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "pcilib.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Measures the cost of the clock reads used in pcilib polling loops and the overshoot of the
+ * absolute sleeps. Set PCILIB_TIMING_TSC=1 to benchmark TSC-based pcilib_time_ns_fast().
+ *
+ * Usage: timing_benchmark [iterations] [sleep_samples] [sleep1_us sleep2_us ...]
+ */
+
+#define DEFAULT_ITERATIONS	10000000
+#define DEFAULT_SLEEP_SAMPLES	1000
+#define DEFAULT_SLEEPS		{ 10, 100, 1000, 10000, 0 }
+
+typedef enum {
+    TIMING_GETTIMEOFDAY,
+    TIMING_GETTIME,
+    TIMING_PCILIB,
+    TIMING_PCILIB_FAST,
+    TIMING_PCILIB_DEADLINE
+} timing_clock_t;
+
+static const char *clock_names[] = { "gettimeofday", "clock_gettime", "pcilib_time_ns", "pcilib_time_ns_fast", "pcilib_check_deadline" };
+
+static int cmp_ns(const void *a, const void *b) {
+    pcilib_time_t va = *(const pcilib_time_t*)a, vb = *(const pcilib_time_t*)b;
+    return (va > vb) - (va < vb);
+}
+
+static double measure_call_cost(timing_clock_t type, size_t iterations) {
+    size_t i;
+    volatile uint64_t sink = 0;
+    pcilib_time_t start, end;
+    struct timeval tv, deadline;
+    struct timespec ts;
+
+    pcilib_calc_deadline(&deadline, 1000000000);
+
+    start = pcilib_time_ns();
+    for (i = 0; i < iterations; i++) {
+	switch (type) {
+	 case TIMING_GETTIMEOFDAY:
+	    gettimeofday(&tv, NULL);
+	    sink += tv.tv_usec;
+	    break;
+	 case TIMING_GETTIME:
+	    clock_gettime(CLOCK_MONOTONIC, &ts);
+	    sink += ts.tv_nsec;
+	    break;
+	 case TIMING_PCILIB:
+	    sink += pcilib_time_ns();
+	    break;
+	 case TIMING_PCILIB_FAST:
+	    sink += pcilib_time_ns_fast();
+	    break;
+	 case TIMING_PCILIB_DEADLINE:
+	    sink += pcilib_check_deadline(&deadline, 0);
+	    break;
+	}
+    }
+    end = pcilib_time_ns();
+
+    return 1. * (end - start) / iterations;
+}
+
+int main(int argc, char *argv[]) {
+    int i;
+    size_t j;
+    size_t num_sleeps;
+    size_t default_sleeps[] = DEFAULT_SLEEPS;
+    size_t iterations = DEFAULT_ITERATIONS;
+    size_t samples = DEFAULT_SLEEP_SAMPLES;
+    pcilib_time_t *overshoot;
+
+    if (argc > 1) iterations = atol(argv[1]);
+    if (argc > 2) samples = atol(argv[2]);
+    num_sleeps = (argc > 3)?(argc - 3):(sizeof(default_sleeps) / sizeof(default_sleeps[0]) - 1);
+
+    if ((!iterations)||(!samples)) {
+	printf("Usage: %s [iterations] [sleep_samples] [sleep1_us sleep2_us ...]\n", argv[0]);
+	exit(1);
+    }
+
+    overshoot = (pcilib_time_t*)malloc(samples * sizeof(pcilib_time_t));
+    if (!overshoot) {
+	printf("Error allocating memory for %zu samples\n", samples);
+	exit(1);
+    }
+
+	// Forces TSC calibration before measurements
+    printf("Fast clock: %s\n", pcilib_time_is_tsc()?"TSC":"CLOCK_MONOTONIC");
+
+    for (i = TIMING_GETTIMEOFDAY; i <= TIMING_PCILIB_DEADLINE; i++) {
+	printf("%-22s: %7.1lf ns per call\n", clock_names[i], measure_call_cost(i, iterations));
+    }
+
+    for (i = 0; i < num_sleeps; i++) {
+	pcilib_time_t deadline, now;
+	size_t sleep_time = (argc > 3)?atol(argv[i + 3]):default_sleeps[i];
+	if (!sleep_time) {
+	    printf("Invalid sleep time (%s) is specified\n", argv[i + 3]);
+	    exit(1);
+	}
+
+	deadline = pcilib_time_ns();
+	for (j = 0; j < samples; j++) {
+	    deadline += sleep_time * 1000;
+	    pcilib_sleep_until_ns(deadline);
+	    now = pcilib_time_ns();
+	    overshoot[j] = now - deadline;
+		// Do not accumulate the delays, each sleep is measured independently
+	    deadline = now;
+	}
+
+	qsort(overshoot, samples, sizeof(pcilib_time_t), cmp_ns);
+	printf("Sleep %7zu us, overshoot: median %7.1lf us, 90%% %7.1lf us, 99%% %7.1lf us, max %8.1lf us\n", sleep_time,
+	    overshoot[samples / 2] / 1000., overshoot[samples * 9 / 10] / 1000., overshoot[samples * 99 / 100] / 1000., overshoot[samples - 1] / 1000.);
+    }
+
+    free(overshoot);
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "pcilib.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+#include "pcilib/autotrigger.h"
+
+/*
+ * Measures achievable rates and jitter of the software trigger generator. The stub trigger
+ * backend just counts the calls and optionally spins for the specified time emulating the
+ * trigger latency of the hardware.
+ *
+ * Usage: trigger_benchmark [run_time_us] [trigger_cost_us] [rate1 rate2 ...]
+ */
+
+#define DEFAULT_RUN_TIME	1000000
+#define DEFAULT_RATES		{ 100, 1000, 10000, 50000, 100000, 0 }
+
+typedef struct {
+    size_t calls;
+    size_t cost;
+} stub_trigger_t;
+
+static int stub_trigger(void *user) {
+    struct timeval deadline;
+    stub_trigger_t *stub = (stub_trigger_t*)user;
+
+    if (stub->cost) {
+	pcilib_calc_deadline(&deadline, stub->cost);
+	while (!pcilib_check_deadline(&deadline, 0));
+    }
+
+    stub->calls++;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int i;
+    size_t num_rates;
+    size_t default_rates[] = DEFAULT_RATES;
+    size_t run_time = DEFAULT_RUN_TIME;
+
+    stub_trigger_t stub = {0};
+    pcilib_autotrigger_t *at;
+    pcilib_autotrigger_stats_t stats;
+
+    if (argc > 1) run_time = atol(argv[1]);
+    if (argc > 2) stub.cost = atol(argv[2]);
+    num_rates = (argc > 3)?(argc - 3):(sizeof(default_rates) / sizeof(default_rates[0]) - 1);
+
+    if (!run_time) {
+	printf("Usage: %s [run_time_us] [trigger_cost_us] [rate1 rate2 ...]\n", argv[0]);
+	exit(1);
+    }
+
+    for (i = 0; i < num_rates; i++) {
+	size_t rate = (argc > 3)?atol(argv[i + 3]):default_rates[i];
+	if ((!rate)||(rate > 1000000)) {
+	    printf("Invalid trigger rate (%zu) is specified\n", rate);
+	    exit(1);
+	}
+
+	stub.calls = 0;
+	at = pcilib_autotrigger_start(NULL, 1000000 / rate, 0, run_time, stub_trigger, &stub);
+	if (!at) exit(1);
+
+	pcilib_autotrigger_wait(at, PCILIB_TIMEOUT_INFINITE);
+	pcilib_autotrigger_stop(at, &stats);
+
+	printf("Requested: %7zu Hz, Achieved: %10.1lf Hz, Triggers: %8zu, Missed: %8zu, Latency: mean %7.1lf us, max %8.1lf us\n", rate, stats.rate, stats.triggers, stats.missed, stats.mean_latency, stats.max_latency);
+    }
+
+    return 0;
+}
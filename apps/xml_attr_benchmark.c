@@ -0,0 +1,159 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <malloc.h>
+
+#include <libxml/xmlmemory.h>
+
+#include "pcilib.h"
+#include "pcilib/pci.h"
+#include "pcilib/xml.h"
+#include "pcilib/register.h"
+#include "pcilib/bank.h"
+#include "pcilib/view.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Reports the memory used by the parsed tables of XML attributes and by libxml2 (DOM, schemas,
+ * etc.), and measures the latency of attribute lookups using the parsed tables and the libxml2
+ * nodes. Each attribute of each XML register is looked up and, if numeric, converted to integer.
+ *
+ * Usage: xml_attr_benchmark [iterations] [device] [model]
+ */
+
+#define DEFAULT_ITERATIONS	1000
+#define DEFAULT_DEVICE		"emulated"
+#define DEFAULT_MODEL		"test"
+
+static size_t xml_mem = 0;
+
+static void *count_malloc(size_t size) {
+    void *res = malloc(size);
+    if (res) xml_mem += malloc_usable_size(res);
+    return res;
+}
+
+static void *count_realloc(void *ptr, size_t size) {
+    void *res;
+    size_t old = ptr?malloc_usable_size(ptr):0;
+
+    res = realloc(ptr, size);
+    if (res) xml_mem += malloc_usable_size(res) - old;
+    return res;
+}
+
+static void count_free(void *ptr) {
+    if (ptr) xml_mem -= malloc_usable_size(ptr);
+    free(ptr);
+}
+
+static char *count_strdup(const char *str) {
+    char *res = strdup(str);
+    if (res) xml_mem += malloc_usable_size(res);
+    return res;
+}
+
+static int run(pcilib_t *pci, int use_table, size_t iterations, size_t *lookups) {
+    int err = 0;
+    size_t i, j;
+    pcilib_register_t reg;
+    pcilib_time_t start, elapsed;
+    pcilib_value_t val = {0};
+    const char *name = use_table?"table":"libxml2";
+
+    *lookups = 0;
+
+    start = pcilib_time_ns();
+    for (i = 0; i < iterations; i++) {
+	for (reg = 0; reg < pci->num_reg; reg++) {
+	    const pcilib_xml_attrs_t *attrs = pci->register_ctx[reg].attrs;
+	    if (!attrs) continue;
+
+	    for (j = 0; j < attrs->num; j++) {
+		if (use_table) err = pcilib_get_register_attr_by_id(pci, reg, attrs->attrs[j].name, &val);
+		else err = pcilib_get_xml_attr(pci, pci->register_ctx[reg].xml, attrs->attrs[j].name, &val);
+		if (err) break;
+
+		if (attrs->attrs[j].type == PCILIB_TYPE_LONG) {
+		    err = pcilib_convert_value_type(pci, &val, PCILIB_TYPE_LONG);
+		    if ((!err)&&(val.ival != attrs->attrs[j].ival)) err = PCILIB_ERROR_VERIFY;
+		    if (err) break;
+		}
+		(*lookups)++;
+	    }
+	    if (err) break;
+	}
+	if (err) break;
+    }
+    elapsed = pcilib_time_ns() - start;
+
+    pcilib_clean_value(pci, &val);
+
+    if (err) {
+	printf("%-8s: failed with error %i\n", name, err);
+	return err;
+    }
+
+    printf("%-8s: Lookups: %9zu, Latency: %8.1lf ns\n", name, *lookups, 1. * elapsed / *lookups);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t iterations = DEFAULT_ITERATIONS;
+    const char *device = DEFAULT_DEVICE;
+    const char *model = DEFAULT_MODEL;
+    size_t i, lookups;
+    size_t num_attrs = 0, table_mem = 0;
+    pcilib_view_context_t *view_ctx, *tmp;
+    pcilib_t *pci;
+
+    if (argc > 1) iterations = atol(argv[1]);
+    if (argc > 2) device = argv[2];
+    if (argc > 3) model = argv[3];
+
+    if (!iterations) {
+	printf("Usage: %s [iterations] [device] [model]\n", argv[0]);
+	exit(1);
+    }
+
+    xmlMemSetup(count_free, count_malloc, count_realloc, count_strdup);
+
+    pci = pcilib_open(device, model);
+    if (!pci) {
+	printf("Error opening device %s with model %s\n", device, model);
+	exit(1);
+    }
+
+    for (i = 0; i < pci->num_reg; i++) {
+	if (!pci->register_ctx[i].attrs) continue;
+	num_attrs += pci->register_ctx[i].attrs->num;
+	table_mem += pci->register_ctx[i].attrs->size;
+    }
+
+    for (i = 0; i < PCILIB_MAX_REGISTER_BANKS; i++) {
+	if (!pci->xml.bank_attrs[i]) continue;
+	num_attrs += pci->xml.bank_attrs[i]->num;
+	table_mem += pci->xml.bank_attrs[i]->size;
+    }
+
+    HASH_ITER(hh, pci->view_hash, view_ctx, tmp) {
+	if (!view_ctx->attrs) continue;
+	num_attrs += view_ctx->attrs->num;
+	table_mem += view_ctx->attrs->size;
+    }
+
+    printf("Model %s: %zu registers, %zu attributes\n", model, pci->num_reg, num_attrs);
+    printf("Memory  : attribute tables %zu bytes, libxml2 %zu bytes\n", table_mem, xml_mem);
+
+    run(pci, 0, iterations, &lookups);
+    run(pci, 1, iterations, &lookups);
+
+    pcilib_close(pci);
+
+    return 0;
+}
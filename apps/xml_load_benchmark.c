@@ -0,0 +1,177 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pcilib.h"
+#include "pcilib/pci.h"
+#include "pcilib/xml.h"
+#include "pcilib/error.h"
+#include "pcilib/timing.h"
+
+/*
+ * Measures the start-up time of a synthetic model split across multiple XML files. The model is
+ * generated in a temporary directory, each file defines a software register bank with a part of the
+ * registers. The schemas are linked from the specified model directory. The model is loaded with
+ * a single thread and with the specified (by default, one per CPU) number of threads parsing and
+ * validating the files. The pre-validated model cache is disabled. The registers are expected to be
+ * created in the same order in both cases.
+ *
+ * The total number of registers is limited by pcilib_register_t and the number of banks (files) by
+ * PCILIB_MAX_REGISTER_BANKS.
+ *
+ * Usage: xml_load_benchmark [registers] [files] [iterations] [model_dir] [threads]
+ */
+
+#define DEFAULT_REGISTERS	60000
+#define DEFAULT_FILES		24
+#define DEFAULT_ITERATIONS	3
+#define DEFAULT_DEVICE		"emulated"
+#define MODEL_NAME		"synthetic"
+
+static const char *schemas[] = { "model.xsd", "references.xsd", "types.xsd", NULL };
+
+static int generate(const char *dir, const char *model_dir, size_t num, size_t files) {
+    size_t i, j, first, last;
+    char path[1024], target[1024];
+    FILE *f;
+
+    for (i = 0; schemas[i]; i++) {
+	sprintf(path, "%s/%s", dir, schemas[i]);
+	if (!realpath(model_dir, target)) return PCILIB_ERROR_NOTFOUND;
+	sprintf(target + strlen(target), "/%s", schemas[i]);
+	if (symlink(target, path)) return PCILIB_ERROR_FAILED;
+    }
+
+    sprintf(path, "%s/%s", dir, MODEL_NAME);
+    if (mkdir(path, 0755)) return PCILIB_ERROR_FAILED;
+
+    for (i = 0; i < files; i++) {
+	first = i * num / files;
+	last = (i + 1) * num / files;
+
+	sprintf(path, "%s/%s/bank%02zu.xml", dir, MODEL_NAME, i);
+	f = fopen(path, "w");
+	if (!f) return PCILIB_ERROR_FAILED;
+
+	fprintf(f, "<?xml version=\"1.0\"?>\n<model xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">\n");
+	fprintf(f, "  <bank size=\"0x1000\" protocol=\"software_registers\" read_address=\"0x0\" write_address=\"0x0\" word_size=\"32\" endianess=\"little\" format=\"0x%%lx\" name=\"bank%02zu\" description=\"Synthetic bank %zu\">\n", i, i);
+	for (j = first; j < last; j++)
+	    fprintf(f, "    <register address=\"0x%zx\" offset=\"0\" size=\"32\" default=\"0\" rwmask=\"all\" mode=\"RW\" name=\"reg%05zu\" description=\"Synthetic register %zu\"/>\n", 4 * ((j - first) % 1024), j, j);
+	fprintf(f, "  </bank>\n</model>\n");
+
+	if (fclose(f)) return PCILIB_ERROR_FAILED;
+    }
+
+    return 0;
+}
+
+static void cleanup(const char *dir, size_t files) {
+    size_t i;
+    char path[1024];
+
+    for (i = 0; i < files; i++) {
+	sprintf(path, "%s/%s/bank%02zu.xml", dir, MODEL_NAME, i);
+	unlink(path);
+    }
+
+    sprintf(path, "%s/%s", dir, MODEL_NAME);
+    rmdir(path);
+
+    for (i = 0; schemas[i]; i++) {
+	sprintf(path, "%s/%s", dir, schemas[i]);
+	unlink(path);
+    }
+
+    rmdir(dir);
+}
+
+static int run(const char *name, const char *threads, size_t iterations, size_t *checksum) {
+    size_t i, j, sum = 0;
+    pcilib_time_t start, elapsed, best = 0;
+    pcilib_timeout_t load_time = 0, parse_time = 0;
+    size_t load_threads = 0, num_reg = 0;
+    pcilib_t *pci;
+
+    if (threads) setenv("PCILIB_XML_THREADS", threads, 1);
+    else unsetenv("PCILIB_XML_THREADS");
+
+    for (i = 0; i < iterations; i++) {
+	start = pcilib_time_ns();
+	pci = pcilib_open(DEFAULT_DEVICE, MODEL_NAME);
+	elapsed = pcilib_time_ns() - start;
+	if (!pci) {
+	    printf("Error opening device %s with model %s\n", DEFAULT_DEVICE, MODEL_NAME);
+	    return PCILIB_ERROR_FAILED;
+	}
+
+	    // Position-weighted checksum of register names to verify the order of registers
+	for (sum = 0, j = 0; j < pci->num_reg; j++)
+	    sum += (j + 1) * atol(pci->registers[j].name + 3);
+
+	if ((!best)||(elapsed < best)) {
+	    best = elapsed;
+	    load_time = pci->xml.load_time;
+	    parse_time = pci->xml.parse_time;
+	}
+	load_threads = pci->xml.load_threads;
+	num_reg = pci->num_reg;
+
+	pcilib_close(pci);
+    }
+
+    printf("%-8s: Threads: %2zu, Registers: %6zu, Open: %8.1lf ms, XML: %8.1lf ms, Parsing: %8.1lf ms (checksum %zu)\n", name, load_threads, num_reg, best / 1000000., load_time / 1000., parse_time / 1000., sum);
+
+    *checksum = sum;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int err;
+    size_t num = DEFAULT_REGISTERS;
+    size_t files = DEFAULT_FILES;
+    size_t iterations = DEFAULT_ITERATIONS;
+    const char *model_dir = getenv("PCILIB_MODEL_DIR");
+    const char *threads = NULL;
+    size_t serial_sum = 0, parallel_sum = 0;
+    char dir[] = "/tmp/pcilib_xml_XXXXXX";
+
+    if (argc > 1) num = atol(argv[1]);
+    if (argc > 2) files = atol(argv[2]);
+    if (argc > 3) iterations = atol(argv[3]);
+    if (argc > 4) model_dir = argv[4];
+    if (argc > 5) threads = argv[5];
+
+    if ((!num)||(num > 60000)||(!files)||(files > PCILIB_MAX_REGISTER_BANKS - 4)||(files > num)||(!iterations)||(!model_dir)) {
+	printf("Usage: %s [registers] [files] [iterations] [model_dir] [threads]\n", argv[0]);
+	exit(1);
+    }
+
+    if (!mkdtemp(dir)) {
+	printf("Error creating temporary directory\n");
+	exit(1);
+    }
+
+    err = generate(dir, model_dir, num, files);
+    if (err) {
+	printf("Error (%i) generating the synthetic model in %s\n", err, dir);
+	cleanup(dir, files);
+	exit(1);
+    }
+
+    setenv("PCILIB_MODEL_DIR", dir, 1);
+    setenv("PCILIB_CACHE_DIR", "", 1);
+
+    printf("Synthetic model: %zu registers in %zu files\n", num, files);
+    err = run("serial", "1", iterations, &serial_sum);
+    if (!err) err = run("parallel", threads, iterations, &parallel_sum);
+    if ((!err)&&(serial_sum != parallel_sum)) printf("The order of registers differs between serial and parallel loading\n");
+
+    cleanup(dir, files);
+
+    return err?1:0;
+}
@@ -78,6 +78,7 @@ pcilib_dma_context_t *dma_ipe_init(pcilib_t *pcilib, const char *model, const vo
 #endif /* IPEDMA_STREAMING_MODE */
 
 	    ctx->reg_last_read = IPEDMA_REG3_LAST_READ;
+	    ctx->reg_page_count = IPEDMA_REG3_PAGE_COUNT;
 	    if (!err) 
 		err = pcilib_add_registers(pcilib, PCILIB_MODEL_MODIFICATON_FLAGS_DEFAULT, 0, ipe_dma_v3_registers, NULL);
         } else {
@@ -89,6 +90,7 @@ pcilib_dma_context_t *dma_ipe_init(pcilib_t *pcilib, const char *model, const vo
             ctx->streaming = 0;
 
 	    ctx->reg_last_read = IPEDMA_REG2_LAST_READ;
+	    ctx->reg_page_count = IPEDMA_REG2_PAGE_COUNT;
 	    if (!err)
 	        err = pcilib_add_registers(pcilib, PCILIB_MODEL_MODIFICATON_FLAGS_DEFAULT, 0, ipe_dma_v2_registers, NULL);
         }
@@ -115,22 +117,101 @@ void  dma_ipe_free(pcilib_dma_context_t *vctx) {
 }
 
 
-static void dma_ipe_disable(ipe_dma_t *ctx) {
-	    // Disable DMA
+    /**
+     * Polls the register until the masked value matches or the timeout is expired
+     */
+static int dma_ipe_wait_register(ipe_dma_t *ctx, reg_t reg, uint32_t mask, uint32_t expected, pcilib_timeout_t timeout) {
+    uint32_t value;
+    struct timeval deadline;
+
+    pcilib_calc_deadline(&deadline, timeout);
+
+    do {
+	RD(reg, value);
+	if ((value&mask) == expected) return 0;
+	sched_yield();
+    } while (!pcilib_check_deadline(&deadline, 0));
+
+    return PCILIB_ERROR_TIMEOUT;
+}
+
+int dma_ipe_reset(pcilib_dma_context_t *vctx) {
+    int err;
+    ipe_dma_t *ctx = (ipe_dma_t*)vctx;
+
+	    // Disable DMA, the transfers in flight are given time to finish
     WR(IPEDMA_REG_CONTROL, 0x0);
     usleep(IPEDMA_RESET_DELAY);
 	
-	    // Reset DMA engine
+	    // Reset DMA engine, we wait until the PCIe link is reported ready instead of fixed delay
     WR(IPEDMA_REG_RESET, 0x1);
     usleep(IPEDMA_RESET_DELAY);
     WR(IPEDMA_REG_RESET, 0x0);
-    usleep(IPEDMA_RESET_DELAY);
+    err = dma_ipe_wait_register(ctx, IPEDMA_REG_RESET, IPEDMA_PCIE_READY_MASK, IPEDMA_PCIE_READY_VALUE, IPEDMA_RESET_DELAY);
 
         // Reseting configured DMA pages
     if (ctx->gen < 3) {
 	WR(IPEDMA_REG2_PAGE_COUNT, 0);
+	if (!err) err = dma_ipe_wait_register(ctx, IPEDMA_REG2_PAGE_COUNT, 0xFFFFFFFF, 0, IPEDMA_RESET_DELAY);
     }
-    usleep(IPEDMA_RESET_DELAY);
+
+    return err;
+}
+
+int dma_ipe_program_pages(pcilib_dma_context_t *vctx, size_t num_pages, const uintptr_t *bus_addr) {
+    int err;
+    size_t i;
+    uint32_t initial, value;
+    uintptr_t bus_addr_check;
+
+    ipe_dma_t *ctx = (ipe_dma_t*)vctx;
+    int bulk = (ctx->dma_flags&IPEDMA_FLAG_BULK_UPLOAD)?1:0;
+
+	// The count is expected to be reset, but we are not relying on it
+    RD(ctx->reg_page_count, initial);
+
+    for (i = 0; i < num_pages; i++) {
+	if (bus_addr[i]%4096) {
+	    pcilib_error("Bus address (0x%lx) of DMA page %zu is not aligned to 4096 bytes", bus_addr[i], i);
+	    return PCILIB_ERROR_INVALID_ADDRESS;
+	}
+
+	if (ctx->addr64) {
+	    WR64(IPEDMA_REG3_PAGE_ADDR, bus_addr[i]);
+	} else {
+	    WR(IPEDMA_REG2_PAGE_ADDR, bus_addr[i]);
+	}
+
+	    // Firmware is buffering descriptors, the count is only checked once all pages are submitted
+	if (bulk) continue;
+
+	if ((!ctx->addr64)&&(!ctx->streaming)) {
+	    RD(IPEDMA_REG2_PAGE_ADDR, bus_addr_check);
+	    if (bus_addr_check != bus_addr[i]) {
+		pcilib_error("Written (%x) and read (%x) bus addresses does not match\n", bus_addr[i], bus_addr_check);
+	    }
+	}
+
+	    // Proceeding as soon as firmware reports the page is accepted, old firmware is handled with fixed delays
+	if (ctx->page_count_broken) {
+	    usleep(IPEDMA_ADD_PAGE_DELAY);
+	} else if (dma_ipe_wait_register(ctx, ctx->reg_page_count, 0xFFFFFFFF, initial + i + 1, IPEDMA_ADD_PAGE_DELAY)) {
+	    RD(ctx->reg_page_count, value);
+	    pcilib_warning("Firmware does not report the number of configured DMA pages (%u after submitting %zu pages), falling back to fixed delays", value - initial, i + 1);
+	    ctx->page_count_broken = 1;
+	}
+    }
+
+    if (bulk) {
+	err = dma_ipe_wait_register(ctx, ctx->reg_page_count, 0xFFFFFFFF, initial + num_pages, num_pages * IPEDMA_ADD_PAGE_DELAY);
+	if (err) {
+	    RD(ctx->reg_page_count, value);
+	    pcilib_error("Firmware has accepted only %u of %zu DMA pages in bulk upload mode, clear ipedma_bulk flag if firmware does not buffer DMA descriptors", value - initial, num_pages);
+	    return err;
+	}
+    }
+
+    return 0;
 }
 
 int dma_ipe_start(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcilib_dma_flags_t flags) {
@@ -157,6 +238,7 @@ int dma_ipe_start(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcilib_dm
     pcilib_register_value_t value;
 
     uintptr_t dma_region = 0;
+    uintptr_t *bus_addr;
     int tlp_size;
     uint32_t address64;
 
@@ -242,7 +324,7 @@ int dma_ipe_start(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcilib_dm
     reuse_pages = pcilib_kmem_is_reused(ctx->dmactx.pcilib, pages);
 
     if ((reuse_pages & PCILIB_KMEM_REUSE_PARTIAL)||(reuse_desc & PCILIB_KMEM_REUSE_PARTIAL)) {
-	dma_ipe_disable(ctx);
+	dma_ipe_reset(vctx);
 
 	pcilib_free_kernel_memory(ctx->dmactx.pcilib, pages, KMEM_FLAG_REUSE);
 	pcilib_free_kernel_memory(ctx->dmactx.pcilib, desc, KMEM_FLAG_REUSE);
@@ -308,11 +390,11 @@ int dma_ipe_start(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcilib_dm
     } else {
 	ctx->reused = 0;
 	
-	dma_ipe_disable(ctx);
+	dma_ipe_reset(vctx);
 
 	    // Verify PCIe link status
 	RD(IPEDMA_REG_RESET, value);
-	if ((value != 0x14031700)&&(value != 0x14021700))
+	if (!IPEDMA_PCIE_READY(value))
 	    pcilib_warning("PCIe is not ready, code is %lx", value);
 
 	    // Enable 64 bit addressing and configure TLP and PACKET sizes (40 bit mode can be used with big pre-allocated buffers later)
@@ -352,24 +434,23 @@ int dma_ipe_start(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcilib_dm
 	num_pages = ctx->ring_size;
 	if (ctx->streaming) num_pages--;
 	
-	for (i = 0; i < num_pages; i++) {
-	    uintptr_t bus_addr_check, bus_addr = pcilib_kmem_get_block_ba(ctx->dmactx.pcilib, pages, i);
-	    if (ctx->addr64) {
-		WR64(IPEDMA_REG3_PAGE_ADDR, bus_addr);
-	    } else {
-		WR(IPEDMA_REG2_PAGE_ADDR, bus_addr);
-	    }
-
-	    if (bus_addr%4096) printf("Bad address %lu: %lx\n", i, bus_addr);
+	bus_addr = (uintptr_t*)malloc(num_pages * sizeof(uintptr_t));
+	if (bus_addr) {
+	    for (i = 0; i < num_pages; i++)
+		bus_addr[i] = pcilib_kmem_get_block_ba(ctx->dmactx.pcilib, pages, i);
 
-	    if ((!ctx->addr64)&&(!ctx->streaming)) {
-	        RD(IPEDMA_REG2_PAGE_ADDR, bus_addr_check);
-		if (bus_addr_check != bus_addr) {
-		    pcilib_error("Written (%x) and read (%x) bus addresses does not match\n", bus_addr, bus_addr_check);
-		}
-	    }
+	    err = dma_ipe_program_pages(vctx, num_pages, bus_addr);
+	    free(bus_addr);
+	} else {
+	    pcilib_error("Error allocating memory for the list of %zu DMA pages", num_pages);
+	    err = PCILIB_ERROR_MEMORY;
+	}
 
-	    usleep(IPEDMA_ADD_PAGE_DELAY);
+	if (err) {
+	    dma_ipe_reset(vctx);
+	    pcilib_free_kernel_memory(ctx->dmactx.pcilib, pages, KMEM_FLAG_REUSE);
+	    pcilib_free_kernel_memory(ctx->dmactx.pcilib, desc, KMEM_FLAG_REUSE);
+	    return err;
 	}
 
 	    // Enable DMA
@@ -407,7 +488,7 @@ int dma_ipe_stop(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcilib_dma
 
 	ctx->started  = 0;
 
-	dma_ipe_disable(ctx);
+	dma_ipe_reset(vctx);
     }
 
 	// Clean buffers
@@ -537,7 +618,8 @@ int dma_ipe_get_status(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcil
 
 
 int dma_ipe_stream_read(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, pcilib_dma_callback_t cb, void *cbattr) {
-    int err, ret = PCILIB_STREAMING_REQ_PACKET;
+	// Only data which is already available is processed if waiting is not allowed
+    int err, ret = (flags&PCILIB_DMA_FLAG_NOWAIT)?PCILIB_STREAMING_CHECK:PCILIB_STREAMING_REQ_PACKET;
 
 
     pcilib_timeout_t wait = 0;
@@ -557,8 +639,11 @@ int dma_ipe_stream_read(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, uin
 
     ipe_dma_t *ctx = (ipe_dma_t*)vctx;
 
-    err = dma_ipe_start(vctx, dma, PCILIB_DMA_FLAGS_DEFAULT);
-    if (err) return err;
+	// The DMA session has already started the engine
+    if ((flags&PCILIB_DMA_FLAG_PREPARED) == 0) {
+	err = dma_ipe_start(vctx, dma, PCILIB_DMA_FLAGS_DEFAULT);
+	if (err) return err;
+    }
 
     desc_va = (void*)pcilib_kmem_get_ua(ctx->dmactx.pcilib, ctx->desc);
 
@@ -600,7 +685,7 @@ int dma_ipe_stream_read(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, uin
 	    case PCILIB_STREAMING_WAIT: 
 		wait = (timeout > ctx->dma_timeout)?timeout:ctx->dma_timeout;
 	    break;
-//	    case PCILIB_STREAMING_CHECK: wait = 0; break;
+	    case PCILIB_STREAMING_CHECK: wait = 0; break;
 	}
 
 	pcilib_debug(DMA, "Waiting for data in %4u - last_read: %4u, last_read_addr: %4u (0x%08x), last_written: %4u (0x%08x)", ctx->last_read + 1, ctx->last_read, 
@@ -608,7 +693,7 @@ int dma_ipe_stream_read(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, uin
 		dma_ipe_find_buffer_by_bus_addr(ctx, DEREF(last_written_addr_ptr)), DEREF(last_written_addr_ptr)
 	);
 
-	gettimeofday(&start, NULL);
+	pcilib_gettime(&start);
 	memcpy(&cur, &start, sizeof(struct timeval));
 	while (((DEREF(last_written_addr_ptr) == 0)||(ctx->last_read_addr == DEREF(last_written_addr_ptr)))&&((wait == PCILIB_TIMEOUT_INFINITE)||(((cur.tv_sec - start.tv_sec)*1000000 + (cur.tv_usec - start.tv_usec)) < wait))) {
 	    if (nodata_sleep) {
@@ -619,7 +704,7 @@ int dma_ipe_stream_read(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, uin
 #ifdef IPEDMA_SUPPORT_EMPTY_DETECTED
 	    if ((ret != PCILIB_STREAMING_REQ_PACKET)&&(empty_detected_ptr)&&(*empty_detected_ptr)) break;
 #endif /* IPEDMA_SUPPORT_EMPTY_DETECTED */
-	    gettimeofday(&cur, NULL);
+	    pcilib_gettime(&cur);
 	}
 	
 	    // Failing out if we exited on timeout
@@ -99,7 +99,7 @@ double dma_ipe_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
 	    // Starting DMA
 	WR(IPEDMA_REG_CONTROL, 0x1);
 
-	gettimeofday(&start, NULL);
+	pcilib_gettime(&start);
 	pcilib_calc_deadline(&start, ctx->dma_timeout * IPEDMA_DMA_PAGES);
 
 #ifdef IPEDMA_BUG_LAST_READ
@@ -127,7 +127,7 @@ double dma_ipe_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
 	    return -1;
 	}
 
-	gettimeofday(&start, NULL);
+	pcilib_gettime(&start);
 	for (iter = 0; iter < iterations; iter++) {
 	    for (bytes = 0; bytes < (size + dma_buffer_space); bytes += rbytes) {
 		err = read_dma(ctx->dmactx.pcilib, 0, addr, size + dma_buffer_space - bytes, PCILIB_DMA_FLAG_MULTIPACKET, ctx->dma_timeout,  buf + bytes, &rbytes);
@@ -139,7 +139,7 @@ double dma_ipe_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
 	    dma_buffer_space = 0;
 	}
 
-        gettimeofday(&cur, NULL);
+        pcilib_gettime(&cur);
 	us += ((cur.tv_sec - start.tv_sec)*1000000 + (cur.tv_usec - start.tv_usec));
 
 	    // Stopping DMA
@@ -165,7 +165,7 @@ double dma_ipe_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
 	if ((err)||(!buf)) return -1;
 
 	for (iter = 0; iter <= iterations; iter++) {
-	    gettimeofday(&start, NULL);
+	    pcilib_gettime(&start);
 
 	    // Starting DMA
 	    WR(IPEDMA_REG_CONTROL, 0x1);
@@ -178,7 +178,7 @@ double dma_ipe_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
 		}
 	    }
 
-	    gettimeofday(&cur, NULL);
+	    pcilib_gettime(&cur);
 
 		// Stopping DMA
 	    WR(IPEDMA_REG_CONTROL, 0x0);
@@ -56,12 +56,16 @@
 
 #define IPEDMA_FLAG_NOSYNC		0x01		/**< Do not call kernel space for page synchronization */
 #define IPEDMA_FLAG_NOSLEEP		0x02		/**< Do not sleep in the loop while waiting for the data */
+#define IPEDMA_FLAG_BULK_UPLOAD		0x04		/**< Firmware buffers descriptors, pages are submitted back-to-back and only the final count is verified */
 
 //#define IPEDMA_MASK_PCIE_GEN		0xF
 //#define IPEDMA_MASK_STREAMING_MODE	0x10
 
-#define IPEDMA_RESET_DELAY		10000		/**< Sleep between accessing DMA control and reset registers */
-#define IPEDMA_ADD_PAGE_DELAY		1000		/**< Delay between submitting successive DMA pages into IPEDMA_REG_PAGE_ADDR register */
+#define IPEDMA_RESET_DELAY		10000		/**< Sleep between accessing DMA control and reset registers, and maximum time to wait until the engine is out of reset */
+#define IPEDMA_ADD_PAGE_DELAY		1000		/**< Maximum time to wait until the DMA page is accepted by firmware, or fixed delay between the pages if firmware does not report the number of configured pages */
+#define IPEDMA_PCIE_READY_MASK		0xFFFEFFFF	/**< PCIe link status in reset register is either 0x14031700 or 0x14021700 when engine is ready */
+#define IPEDMA_PCIE_READY_VALUE		0x14021700
+#define IPEDMA_PCIE_READY(value)	(((value)&IPEDMA_PCIE_READY_MASK) == IPEDMA_PCIE_READY_VALUE)
 #define IPEDMA_NODATA_SLEEP		100		/**< To keep CPU free, in nanoseconds */
 
 
@@ -110,6 +114,8 @@ struct ipe_dma_s {
     uintptr_t last_read_addr;
 
     reg_t reg_last_read;		/**< actual location of last_read register (removed from hardware for version 3) */
+    reg_t reg_page_count;		/**< location of the register reporting the number of configured DMA pages */
+    int page_count_broken;		/**< indicates that firmware does not update the page count and fixed delays should be used */
 };
 
 #endif /* _PCILIB_DMA_IPE_PRIVATE_H */
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <sys/time.h>
 
@@ -77,6 +78,33 @@ int dma_nwl_stop(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcilib_dma
 }
 
 
+static void dma_nwl_configure(nwl_dma_t *ctx) {
+    const char *env;
+
+    ctx->wait_mode = NWL_WAIT_POLL;
+    ctx->spin_time = PCILIB_NWL_SPIN_TIME;
+    ctx->return_batch = PCILIB_NWL_RETURN_BATCH;
+    ctx->sync_pages = 1;
+
+    env = getenv("PCILIB_NWL_WAIT_MODE");
+    if (env) {
+	if (!strcasecmp(env, "irq")) ctx->wait_mode = NWL_WAIT_IRQ;
+	else if (!strcasecmp(env, "adaptive")) ctx->wait_mode = NWL_WAIT_ADAPTIVE;
+	else if (strcasecmp(env, "poll")) pcilib_warning("Unknown NWL wait mode (%s) is specified, polling is used", env);
+    }
+
+    env = getenv("PCILIB_NWL_SPIN_TIME");
+    if (env) ctx->spin_time = strtoul(env, NULL, 0);
+
+    env = getenv("PCILIB_NWL_RETURN_BATCH");
+    if (env) ctx->return_batch = strtoul(env, NULL, 0);
+    if (!ctx->return_batch) ctx->return_batch = 1;
+    else if (ctx->return_batch > PCILIB_NWL_DMA_PAGES / 2) ctx->return_batch = PCILIB_NWL_DMA_PAGES / 2;
+
+    env = getenv("PCILIB_NWL_SYNC_PAGES");
+    if (env) ctx->sync_pages = atoi(env);
+}
+
 pcilib_dma_context_t *dma_nwl_init(pcilib_t *pcilib, const char *model, const void *arg) {
     int i, j;
     int err;
@@ -89,6 +117,7 @@ pcilib_dma_context_t *dma_nwl_init(pcilib_t *pcilib, const char *model, const vo
     if (!ctx) return NULL;
 
     memset(ctx, 0, sizeof(nwl_dma_t));
+    dma_nwl_configure(ctx);
 
     pcilib_register_bank_t dma_bank = pcilib_find_register_bank_by_addr(pcilib, PCILIB_REGISTER_BANK_DMA);
     if (dma_bank == PCILIB_REGISTER_BANK_INVALID) {
@@ -12,6 +12,7 @@
 #include "error.h"
 #include "tools.h"
 #include "debug.h"
+#include "timing.h"
 
 #include "nwl_private.h"
 #include "nwl_defines.h"
@@ -62,6 +63,12 @@ int dma_nwl_start_engine(nwl_dma_t *ctx, pcilib_dma_engine_t dma) {
     
     if (ectx->started) return 0;
 
+#ifdef NWL_GENERATE_DMA_IRQ
+    ectx->irq = 1;
+#else /* NWL_GENERATE_DMA_IRQ */
+    ectx->irq = (ctx->wait_mode != NWL_WAIT_POLL);
+#endif /* NWL_GENERATE_DMA_IRQ */
+
 	// This will only successed if there are no parallel access to DMA engine
     err = dma_nwl_allocate_engine_buffers(ctx, ectx);
     if (err) {
@@ -75,9 +82,7 @@ int dma_nwl_start_engine(nwl_dma_t *ctx, pcilib_dma_engine_t dma) {
 
 	dma_nwl_acknowledge_irq((pcilib_dma_context_t*)ctx, PCILIB_DMA_IRQ, dma);
 
-#ifdef NWL_GENERATE_DMA_IRQ
-	dma_nwl_enable_engine_irq(ctx, dma);
-#endif /* NWL_GENERATE_DMA_IRQ */
+	if (ectx->irq) dma_nwl_enable_engine_irq(ctx, dma);
     } else {
 	// Disable IRQs
 	err = dma_nwl_disable_engine_irq(ctx, dma);
@@ -91,10 +96,10 @@ int dma_nwl_start_engine(nwl_dma_t *ctx, pcilib_dma_engine_t dma) {
 	val = DMA_ENG_DISABLE|DMA_ENG_USER_RESET;
 	nwl_write_register(val, ctx, base, REG_DMA_ENG_CTRL_STATUS);
 
-	gettimeofday(&start, NULL);
+	pcilib_gettime(&start);
 	do {
 	    nwl_read_register(val, ctx, base, REG_DMA_ENG_CTRL_STATUS);
-    	    gettimeofday(&cur, NULL);
+    	    pcilib_gettime(&cur);
 	} while ((val & (DMA_ENG_STATE_MASK|DMA_ENG_USER_RESET))&&(((cur.tv_sec - start.tv_sec)*1000000 + (cur.tv_usec - start.tv_usec)) < PCILIB_NWL_REGISTER_TIMEOUT));
     
 	if (val & (DMA_ENG_STATE_MASK|DMA_ENG_USER_RESET)) {
@@ -108,10 +113,10 @@ int dma_nwl_start_engine(nwl_dma_t *ctx, pcilib_dma_engine_t dma) {
 	val = DMA_ENG_RESET; 
 	nwl_write_register(val, ctx, base, REG_DMA_ENG_CTRL_STATUS);
     
-	gettimeofday(&start, NULL);
+	pcilib_gettime(&start);
 	do {
 	    nwl_read_register(val, ctx, base, REG_DMA_ENG_CTRL_STATUS);
-    	    gettimeofday(&cur, NULL);
+    	    pcilib_gettime(&cur);
 	} while ((val & DMA_ENG_RESET)&&(((cur.tv_sec - start.tv_sec)*1000000 + (cur.tv_usec - start.tv_usec)) < PCILIB_NWL_REGISTER_TIMEOUT));
     
 	if (val & DMA_ENG_RESET) {
@@ -136,9 +141,7 @@ int dma_nwl_start_engine(nwl_dma_t *ctx, pcilib_dma_engine_t dma) {
 
 	__sync_synchronize();
 
-#ifdef NWL_GENERATE_DMA_IRQ
-	dma_nwl_enable_engine_irq(ctx, dma);
-#endif /* NWL_GENERATE_DMA_IRQ */
+	if (ectx->irq) dma_nwl_enable_engine_irq(ctx, dma);
 
 	if (ectx->desc->direction == PCILIB_DMA_FROM_DEVICE) {
 	    ring_pa += (ectx->ring_size - 1) * PCILIB_NWL_DMA_DESCRIPTOR_SIZE;
@@ -172,6 +175,7 @@ int dma_nwl_stop_engine(nwl_dma_t *ctx, pcilib_dma_engine_t dma) {
     if (!ectx->started) return 0;
     
     ectx->started = 0;
+    ectx->pending = 0;
 
     err = dma_nwl_disable_engine_irq(ctx, dma);
     if (err) return err;
@@ -181,10 +185,10 @@ int dma_nwl_stop_engine(nwl_dma_t *ctx, pcilib_dma_engine_t dma) {
 	val = DMA_ENG_DISABLE|DMA_ENG_USER_RESET|DMA_ENG_RESET;
 	nwl_write_register(val, ctx, base, REG_DMA_ENG_CTRL_STATUS);
 
-	gettimeofday(&start, NULL);
+	pcilib_gettime(&start);
 	do {
 	    nwl_read_register(val, ctx, base, REG_DMA_ENG_CTRL_STATUS);
-    	    gettimeofday(&cur, NULL);
+    	    pcilib_gettime(&cur);
 	} while ((val & (DMA_ENG_RUNNING))&&(((cur.tv_sec - start.tv_sec)*1000000 + (cur.tv_usec - start.tv_usec)) < PCILIB_NWL_REGISTER_TIMEOUT));
 
 	if (ectx->ring) {
@@ -224,8 +228,14 @@ int dma_nwl_write_fragment(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma,
 
     pcilib_nwl_engine_context_t *ectx = ctx->engines + dma;
 
-    err = dma_nwl_start(vctx, dma, PCILIB_DMA_FLAGS_DEFAULT);
-    if (err) return err;
+	// The DMA session has already started the engine
+    if ((flags&PCILIB_DMA_FLAG_PREPARED) == 0) {
+	err = dma_nwl_start(vctx, dma, PCILIB_DMA_FLAGS_DEFAULT);
+	if (err) return err;
+    }
+
+	// Only the free buffers are filled, the number of written bytes is returned along with PCILIB_ERROR_TIMEOUT
+    if (flags&PCILIB_DMA_FLAG_NOWAIT) timeout = PCILIB_TIMEOUT_IMMEDIATE;
 
     if (data) {
 	for (pos = 0; pos < size; pos += ectx->page_size) {
@@ -239,9 +249,17 @@ int dma_nwl_write_fragment(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma,
 	
     	    void *buf = (void*)pcilib_kmem_get_block_ua(ctx->dmactx.pcilib, ectx->pages, bufnum);
 
-	    pcilib_kmem_sync_block(ctx->dmactx.pcilib, ectx->pages, PCILIB_KMEM_SYNC_FROMDEVICE, bufnum);
-	    memcpy(buf, data, block_size);
-	    pcilib_kmem_sync_block(ctx->dmactx.pcilib, ectx->pages, PCILIB_KMEM_SYNC_TODEVICE, bufnum);
+	    if (ctx->sync_pages) {
+		pcilib_kmem_sync_block(ctx->dmactx.pcilib, ectx->pages, PCILIB_KMEM_SYNC_FROMDEVICE, bufnum);
+		ctx->stats.ioctls++;
+	    }
+
+	    memcpy(buf, (char*)data + pos, block_size);
+
+	    if (ctx->sync_pages) {
+		pcilib_kmem_sync_block(ctx->dmactx.pcilib, ectx->pages, PCILIB_KMEM_SYNC_TODEVICE, bufnum);
+		ctx->stats.ioctls++;
+	    }
 
 	    err = dma_nwl_push_buffer(ctx, ectx, block_size, (flags&PCILIB_DMA_FLAG_EOP)&&((pos + block_size) == size), timeout);
 	    if (err) {
@@ -262,7 +280,8 @@ int dma_nwl_write_fragment(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma,
 }
 
 int dma_nwl_stream_read(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, pcilib_dma_callback_t cb, void *cbattr) {
-    int err, ret = PCILIB_STREAMING_REQ_PACKET;
+	// Only data which is already available is processed if waiting is not allowed
+    int err, ret = (flags&PCILIB_DMA_FLAG_NOWAIT)?PCILIB_STREAMING_CHECK:PCILIB_STREAMING_REQ_PACKET;
     pcilib_timeout_t wait = 0;
     size_t res = 0;
     size_t bufnum;
@@ -274,35 +293,48 @@ int dma_nwl_stream_read(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, uin
 
     pcilib_nwl_engine_context_t *ectx = ctx->engines + dma;
 
-    err = dma_nwl_start(vctx, dma, PCILIB_DMA_FLAGS_DEFAULT);
-    if (err) return err;
+	// The DMA session has already started the engine
+    if ((flags&PCILIB_DMA_FLAG_PREPARED) == 0) {
+	err = dma_nwl_start(vctx, dma, PCILIB_DMA_FLAGS_DEFAULT);
+	if (err) return err;
+    }
     
     do {
 	switch (ret&PCILIB_STREAMING_TIMEOUT_MASK) {
 	    case PCILIB_STREAMING_CONTINUE: wait = PCILIB_DMA_TIMEOUT; break;
 	    case PCILIB_STREAMING_WAIT: wait = timeout; break;
-//	    case PCILIB_STREAMING_CHECK: wait = 0; break;
+	    case PCILIB_STREAMING_CHECK: wait = 0; break;
 	}
     
         bufnum = dma_nwl_wait_buffer(ctx, ectx, &bufsize, &eop, wait);
         if (bufnum == PCILIB_DMA_BUFFER_INVALID) {
+	    dma_nwl_flush_returned(ctx, ectx);
 	    return (ret&PCILIB_STREAMING_FAIL)?PCILIB_ERROR_TIMEOUT:0;
 	}
 
 	    // EOP is not respected in IPE Camera
 	if (ctx->ignore_eop) eop = 1;
 	
-	pcilib_kmem_sync_block(ctx->dmactx.pcilib, ectx->pages, PCILIB_KMEM_SYNC_FROMDEVICE, bufnum);
+	    // The page is only read by CPU, so it is not necessary to give its ownership back to the device (TODEVICE)
+	if (ctx->sync_pages) {
+	    pcilib_kmem_sync_block(ctx->dmactx.pcilib, ectx->pages, PCILIB_KMEM_SYNC_FROMDEVICE, bufnum);
+	    ctx->stats.ioctls++;
+	}
+
         void *buf = (void*)pcilib_kmem_get_block_ua(ctx->dmactx.pcilib, ectx->pages, bufnum);
 	ret = cb(cbattr, (eop?PCILIB_DMA_FLAG_EOP:0), bufsize, buf);
-	if (ret < 0) return -ret;
-//	DS: Fixme, it looks like we can avoid calling this for the sake of performance
-//	pcilib_kmem_sync_block(ctx->dmactx.pcilib, ectx->pages, PCILIB_KMEM_SYNC_TODEVICE, bufnum);
+	if (ret < 0) {
+	    dma_nwl_flush_returned(ctx, ectx);
+	    return -ret;
+	}
+
 	dma_nwl_return_buffer(ctx, ectx);
 	
 	res += bufsize;
 
     } while (ret);
+
+    dma_nwl_flush_returned(ctx, ectx);
     
     return 0;
 }
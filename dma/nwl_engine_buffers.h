@@ -2,6 +2,63 @@
 #define NWL_RING_SET(data, offset, val)  *(uint32_t*)(((char*)(data)) + (offset)) = (val)
 #define NWL_RING_UPDATE(data, offset, mask, val) *(uint32_t*)(((char*)(data)) + (offset)) = ((*(uint32_t*)(((char*)(data)) + (offset)))&(mask))|(val)
 
+#define NWL_RING_CTRL(ectx, size) ((ectx)->irq?((size) | DMA_BD_INT_ERROR_MASK | DMA_BD_INT_COMP_MASK):(size))
+
+    /**
+     * Called when the DMA ring was checked and no progress is detected. Depending on the selected wait mode, either
+     * sleeps for a short while, spins, or blocks until the engine interrupt is fired. Interrupt waits are limited to 
+     * PCILIB_NWL_IRQ_WAIT_SLICE to recover if interrupt of another engine sharing the same source is consumed.
+     * @return 0 if the ring should be re-checked or PCILIB_ERROR_TIMEOUT if the timeout is expired
+     */
+static int dma_nwl_wait_progress(nwl_dma_t *ctx, pcilib_nwl_engine_context_t *ectx, struct timeval *start, pcilib_timeout_t timeout) {
+    int err;
+    size_t count;
+    struct timeval cur;
+    pcilib_timeout_t elapsed, slice;
+
+    pcilib_gettime(&cur);
+    elapsed = pcilib_timediff(start, &cur);
+    if ((timeout != PCILIB_TIMEOUT_INFINITE)&&(elapsed >= timeout)) return PCILIB_ERROR_TIMEOUT;
+
+    if ((ectx->irq)&&(ctx->wait_mode != NWL_WAIT_POLL)) {
+	if ((ctx->wait_mode == NWL_WAIT_ADAPTIVE)&&(elapsed < ctx->spin_time)) {
+	    __sync_synchronize();
+	    return 0;
+	}
+
+	slice = PCILIB_NWL_IRQ_WAIT_SLICE;
+	if ((timeout != PCILIB_TIMEOUT_INFINITE)&&((timeout - elapsed) < slice)) slice = timeout - elapsed;
+
+	ctx->stats.sleeps++;
+	ctx->stats.ioctls++;
+	err = pcilib_wait_irq(ctx->dmactx.pcilib, NWL_DMA_IRQ_SOURCE, slice, &count);
+	if (!err) {
+	    ctx->stats.irqs++;
+	    dma_nwl_acknowledge_irq((pcilib_dma_context_t*)ctx, PCILIB_DMA_IRQ, ectx - ctx->engines);
+	} else if (err != PCILIB_ERROR_TIMEOUT) {
+	    pcilib_warning("Interrupt wait is failed (error %i), falling back to polling", err);
+	    ctx->wait_mode = NWL_WAIT_POLL;
+	}
+	return 0;
+    }
+
+    ctx->stats.sleeps++;
+    usleep(PCILIB_NWL_POLL_DELAY);
+    return 0;
+}
+
+static void dma_nwl_account_wait(nwl_dma_t *ctx, struct timeval *start) {
+    struct timeval cur;
+    pcilib_timeout_t elapsed;
+
+    pcilib_gettime(&cur);
+    elapsed = pcilib_timediff(start, &cur);
+
+    ctx->stats.waits++;
+    ctx->stats.wait_time += elapsed;
+    if (elapsed > ctx->stats.max_wait_time) ctx->stats.max_wait_time = elapsed;
+}
+
 static int dma_nwl_compute_read_s2c_pointers(nwl_dma_t *ctx, pcilib_nwl_engine_context_t *ectx, unsigned char *ring, uint32_t ring_pa) {
     uint32_t val;
 
@@ -145,11 +202,7 @@ static int dma_nwl_allocate_engine_buffers(nwl_dma_t *ctx, pcilib_nwl_engine_con
 	    NWL_RING_SET(data, DMA_BD_NDESC_OFFSET, ring_pa + ((i + 1) % PCILIB_NWL_DMA_PAGES) * PCILIB_NWL_DMA_DESCRIPTOR_SIZE);
 	    NWL_RING_SET(data, DMA_BD_BUFAL_OFFSET, buf_pa&0xFFFFFFFF);
 	    NWL_RING_SET(data, DMA_BD_BUFAH_OFFSET, buf_pa>>32);
-#ifdef NWL_GENERATE_DMA_IRQ
-    	    NWL_RING_SET(data, DMA_BD_BUFL_CTRL_OFFSET, buf_sz | DMA_BD_INT_ERROR_MASK | DMA_BD_INT_COMP_MASK);
-#else /* NWL_GENERATE_DMA_IRQ */
-    	    NWL_RING_SET(data, DMA_BD_BUFL_CTRL_OFFSET, buf_sz);
-#endif /* NWL_GENERATE_DMA_IRQ */
+    	    NWL_RING_SET(data, DMA_BD_BUFL_CTRL_OFFSET, NWL_RING_CTRL(ectx, buf_sz));
 	}
 
 	val = ring_pa;
@@ -169,6 +222,28 @@ static int dma_nwl_allocate_engine_buffers(nwl_dma_t *ctx, pcilib_nwl_engine_con
 }
 
 
+    /**
+     * Reports all returned, but not yet reported buffers to the engine with a single write of REG_SW_NEXT_BD
+     */
+static int dma_nwl_flush_returned(nwl_dma_t *ctx, pcilib_nwl_engine_context_t *ectx) {
+    uint32_t val;
+    uint32_t ring_pa;
+
+    if (!ectx->pending) return 0;
+
+    ring_pa = pcilib_kmem_get_ba(ctx->dmactx.pcilib, ectx->ring);
+    val = ring_pa + ectx->returned * PCILIB_NWL_DMA_DESCRIPTOR_SIZE;
+
+	// descriptors should be updated before engine is informed
+    __sync_synchronize();
+    nwl_write_register(val, ctx, ectx->base_addr, REG_SW_NEXT_BD);
+
+    ctx->stats.mmio_writes++;
+    ectx->pending = 0;
+
+    return 0;
+}
+
 static size_t dma_nwl_clean_buffers(nwl_dma_t * ctx, pcilib_nwl_engine_context_t *ectx) {
     size_t res = 0;
     uint32_t status;
@@ -210,7 +285,7 @@ next_buffer:
 
 
 static size_t dma_nwl_get_next_buffer(nwl_dma_t * ctx, pcilib_nwl_engine_context_t *ectx, size_t n_buffers, pcilib_timeout_t timeout) {
-    struct timeval start, cur;
+    struct timeval start, wait_start;
 
     size_t res, n = 0;
     size_t head;
@@ -218,31 +293,28 @@ static size_t dma_nwl_get_next_buffer(nwl_dma_t * ctx, pcilib_nwl_engine_context
     for (head = ectx->head; (((head + 1)%ectx->ring_size) != ectx->tail)&&(n < n_buffers); head++, n++);
     if (n == n_buffers) return ectx->head;
 
-    gettimeofday(&start, NULL);
+    pcilib_gettime(&start);
+    wait_start = start;
 
     res = dma_nwl_clean_buffers(ctx, ectx);
     if (res == (size_t)-1) return PCILIB_DMA_BUFFER_INVALID;
     else n += res;
 
-    
     while (n < n_buffers) {
-	if (timeout != PCILIB_TIMEOUT_INFINITE) {
-	    gettimeofday(&cur, NULL);
-	    if  (((cur.tv_sec - start.tv_sec)*1000000 + (cur.tv_usec - start.tv_usec)) > timeout) break;
-	}
-	
-	usleep (10);	
+	if (dma_nwl_wait_progress(ctx, ectx, &start, timeout)) break;
 
         res = dma_nwl_clean_buffers(ctx, ectx);
         if (res == (size_t)-1) return PCILIB_DMA_BUFFER_INVALID;
 	else if (res > 0) {
-	    gettimeofday(&start, NULL);
+	    pcilib_gettime(&start);
 	    n += res;
 	}
     }
 
     if (n < n_buffers) return PCILIB_DMA_BUFFER_INVALID;
-    
+
+    dma_nwl_account_wait(ctx, &wait_start);
+
     return ectx->head;
 }
 
@@ -273,20 +345,21 @@ static int dma_nwl_push_buffer(nwl_dma_t *ctx, pcilib_nwl_engine_context_t *ectx
     
     val = ring_pa + ectx->head * PCILIB_NWL_DMA_DESCRIPTOR_SIZE;
     nwl_write_register(val, ctx, ectx->base_addr, REG_SW_NEXT_BD);
+    ctx->stats.mmio_writes++;
     
     return 0;
 }
 
 
 static size_t dma_nwl_wait_buffer(nwl_dma_t *ctx, pcilib_nwl_engine_context_t *ectx, size_t *size, int *eop, pcilib_timeout_t timeout) {
-    struct timeval start, cur;
+    struct timeval start;
     uint32_t status_size, status;
 
     volatile unsigned char *ring = pcilib_kmem_get_ua(ctx->dmactx.pcilib, ectx->ring);
     
     ring += ectx->tail * PCILIB_NWL_DMA_DESCRIPTOR_SIZE;
 
-    gettimeofday(&start, NULL);
+    pcilib_gettime(&start);
     
     do {
 	status_size = NWL_RING_GET(ring, DMA_BD_BUFL_STATUS_OFFSET);
@@ -310,13 +383,14 @@ static size_t dma_nwl_wait_buffer(nwl_dma_t *ctx, pcilib_nwl_engine_context_t *e
 		*mrd = NWL_RING_GET(ring, DMA_BD_BUFL_STATUS_OFFSET)&DMA_BD_COMP_MASK;
 	    }
 */
-	
+
+	    dma_nwl_account_wait(ctx, &start);
 	    return ectx->tail;
 	}
-	
-	usleep(10);
-        gettimeofday(&cur, NULL);
-    } while ((timeout == PCILIB_TIMEOUT_INFINITE)||(((cur.tv_sec - start.tv_sec)*1000000 + (cur.tv_usec - start.tv_usec)) < timeout));
+
+	    // Engine may be starving while we are sleeping, so return all consumed buffers first
+	if (ectx->pending) dma_nwl_flush_returned(ctx, ectx);
+    } while (!dma_nwl_wait_progress(ctx, ectx, &start, timeout));
 
     return (size_t)-1;
 }
@@ -334,29 +408,28 @@ static int dma_nwl_is_overflown(nwl_dma_t *ctx, pcilib_nwl_engine_context_t *ect
 }
 */
 
+    /**
+     * Resets the descriptor of the current tail buffer. The engine is informed once ctx->return_batch buffers 
+     * are collected, before the reader goes asleep waiting for the new data, or when streaming is finished.
+     */
 static int dma_nwl_return_buffer(nwl_dma_t *ctx, pcilib_nwl_engine_context_t *ectx) {
-    uint32_t val;
-
     volatile unsigned char *ring = pcilib_kmem_get_ua(ctx->dmactx.pcilib, ectx->ring);
-    uint32_t ring_pa = pcilib_kmem_get_ba(ctx->dmactx.pcilib, ectx->ring);
     size_t bufsz = pcilib_kmem_get_block_size(ctx->dmactx.pcilib, ectx->pages, ectx->tail);
 
     ring += ectx->tail * PCILIB_NWL_DMA_DESCRIPTOR_SIZE;
 
-#ifdef NWL_GENERATE_DMA_IRQ    
-    NWL_RING_SET(ring, DMA_BD_BUFL_CTRL_OFFSET, bufsz | DMA_BD_INT_ERROR_MASK | DMA_BD_INT_COMP_MASK);
-#else /* NWL_GENERATE_DMA_IRQ */
-    NWL_RING_SET(ring, DMA_BD_BUFL_CTRL_OFFSET, bufsz);
-#endif /* NWL_GENERATE_DMA_IRQ */
-
+    NWL_RING_SET(ring, DMA_BD_BUFL_CTRL_OFFSET, NWL_RING_CTRL(ectx, bufsz));
     NWL_RING_SET(ring, DMA_BD_BUFL_STATUS_OFFSET, 0);
 
-    val = ring_pa + ectx->tail * PCILIB_NWL_DMA_DESCRIPTOR_SIZE;
-    nwl_write_register(val, ctx, ectx->base_addr, REG_SW_NEXT_BD);
-    
+    ectx->returned = ectx->tail;
+    ectx->pending++;
+
     ectx->tail++;
     if (ectx->tail == ectx->ring_size) ectx->tail = 0;
-    
+
+    if (ectx->pending >= ctx->return_batch)
+	return dma_nwl_flush_returned(ctx, ectx);
+
     return 0;
 }
 
@@ -5,11 +5,13 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <sys/resource.h>
 
 #include "pci.h"
 #include "pcilib.h"
 #include "error.h"
 #include "tools.h"
+#include "timing.h"
 #include "nwl_private.h"
 
 #include "nwl_defines.h"
@@ -46,6 +48,31 @@ int dma_nwl_start_loopback(nwl_dma_t *ctx,  pcilib_dma_direction_t direction, si
     return 0;
 }
 
+static void dma_nwl_report_stats(nwl_dma_t *ctx, struct rusage *ru_start, struct timeval *tv_start, size_t bytes) {
+    struct rusage ru_end;
+    struct timeval tv_end;
+    pcilib_timeout_t run_time, cpu_time;
+    nwl_stats_t *stats = &ctx->stats;
+    const char *modes[] = { "poll", "irq", "adaptive" };
+
+    getrusage(RUSAGE_SELF, &ru_end);
+    pcilib_gettime(&tv_end);
+
+    run_time = pcilib_timediff(tv_start, &tv_end);
+    cpu_time = pcilib_timediff(&ru_start->ru_utime, &ru_end.ru_utime) + pcilib_timediff(&ru_start->ru_stime, &ru_end.ru_stime);
+
+    pcilib_info("NWL wait mode: %s, waits: %zu, sleeps: %zu, interrupts: %zu, wait time: mean %.1lf us, max %lu us, CPU usage: %.1lf%%",
+	modes[ctx->wait_mode], stats->waits, stats->sleeps, stats->irqs,
+	stats->waits?(1. * stats->wait_time / stats->waits):0., stats->max_wait_time,
+	run_time?(100. * cpu_time / run_time):0.
+    );
+
+    pcilib_info("NWL engine accesses: %zu register writes (%.1lf per MiB, returned in batches of %zu buffers), %zu ioctls (%.1lf per MiB, page synchronization %s)",
+	stats->mmio_writes, bytes?(1024. * 1024. * stats->mmio_writes / bytes):0., ctx->return_batch,
+	stats->ioctls, bytes?(1024. * 1024. * stats->ioctls / bytes):0., ctx->sync_pages?"enabled":"disabled"
+    );
+}
+
 int dma_nwl_stop_loopback(nwl_dma_t *ctx) {
     uint32_t val = 0;
     
@@ -74,7 +101,8 @@ double dma_nwl_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
     size_t packet_size, blocks;    
 
     size_t us = 0;
-    struct timeval start, cur;
+    struct timeval start, cur, bench_start;
+    struct rusage ru_start;
 
     nwl_dma_t *ctx = (nwl_dma_t*)vctx;
 
@@ -135,6 +163,10 @@ double dma_nwl_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
 	//pcilib_write_register(ctx->dmactx.pcilib, NULL, "control", 0x3e1);
     }
 
+    memset(&ctx->stats, 0, sizeof(nwl_stats_t));
+    getrusage(RUSAGE_SELF, &ru_start);
+    pcilib_gettime(&bench_start);
+
 	// Benchmark
     for (iter = 0; iter < iterations; iter++) {
         memset(cmp, 0x13 + iter, size * sizeof(uint32_t));
@@ -147,7 +179,7 @@ double dma_nwl_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
 	    memcpy(buf, cmp, size * sizeof(uint32_t));
 
     	    if (direction&PCILIB_DMA_TO_DEVICE) {
-		gettimeofday(&start, NULL);
+		pcilib_gettime(&start);
 	    }
 	    
 	    err = pcilib_write_dma(ctx->dmactx.pcilib, writeid, addr, size * sizeof(uint32_t), buf, &bytes);
@@ -161,7 +193,7 @@ double dma_nwl_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
 		if (direction == PCILIB_DMA_TO_DEVICE) {
 		    dma_nwl_wait_completion(ctx, writeid, PCILIB_DMA_TIMEOUT);
 		}
-		gettimeofday(&cur, NULL);
+		pcilib_gettime(&cur);
 	        us += ((cur.tv_sec - start.tv_sec)*1000000 + (cur.tv_usec - start.tv_usec));    
 	    }
 	}
@@ -173,7 +205,7 @@ double dma_nwl_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
 	memset(buf, 0, size * sizeof(uint32_t));
 
         if (direction&PCILIB_DMA_FROM_DEVICE) {
-	    gettimeofday(&start, NULL);
+	    pcilib_gettime(&start);
 	}
 
 	for (i = 0, bytes = 0; i < blocks; i++) {
@@ -194,7 +226,7 @@ double dma_nwl_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
 	}
 
         if (direction&PCILIB_DMA_FROM_DEVICE) {
-	    gettimeofday(&cur, NULL);
+	    pcilib_gettime(&cur);
 	    us += ((cur.tv_sec - start.tv_sec)*1000000 + (cur.tv_usec - start.tv_usec));
 	}
 #ifdef NWL_BUG_EXTRA_DATA
@@ -232,6 +264,8 @@ double dma_nwl_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dm
 	pcilib_write_register(ctx->dmactx.pcilib, NULL, "control", 0x1e1);
     }
 
+    dma_nwl_report_stats(ctx, &ru_start, &bench_start, size * sizeof(uint32_t) * iter);
+
     if (error) {
 	pcilib_warning("%s at iteration %i, error: %i, bytes: %zu", error, iter, err, bytes);
     }
@@ -16,6 +16,10 @@ typedef struct pcilib_nwl_engine_context_s pcilib_nwl_engine_context_t;
 #define PCILIB_NWL_DMA_PAGES			256 // 1024
 
 #define PCILIB_NWL_REGISTER_TIMEOUT 10000	/**< us */
+#define PCILIB_NWL_POLL_DELAY 10		/**< us, delay between consecutive checks of DMA ring in polling mode */
+#define PCILIB_NWL_SPIN_TIME 50			/**< us, default time to spin on DMA ring before blocking on interrupt in adaptive mode */
+#define PCILIB_NWL_IRQ_WAIT_SLICE 10000		/**< us, maximal time to block on interrupt before re-checking the DMA ring */
+#define PCILIB_NWL_RETURN_BATCH 16		/**< default number of C2S buffers returned to the engine with a single register write */
 
 #include "datacpy.h"
 
@@ -41,8 +45,27 @@ struct pcilib_nwl_engine_context_s {
     int writting;			/**< indicates that we are in middle of writting packet */
     int reused;				/**< indicates that DMA was found intialized, buffers were reused, and no additional initialization is needed */
     int preserve;			/**< indicates that DMA should not be stopped during clean-up */
+    int irq;				/**< indicates that descriptors are configured to generate completion interrupts */
+    size_t returned;			/**< the last descriptor returned to the engine, but not yet reported with REG_SW_NEXT_BD */
+    size_t pending;			/**< number of returned descriptors not yet reported to the engine */
 };
 
+typedef enum {
+    NWL_WAIT_POLL = 0,			/**< check DMA ring with short sleeps in between (default) */
+    NWL_WAIT_IRQ,			/**< block on engine interrupt until the descriptor is completed */
+    NWL_WAIT_ADAPTIVE			/**< spin on DMA ring for a short time and block on engine interrupt afterwards */
+} nwl_wait_mode_t;
+
+typedef struct {
+    size_t waits;			/**< number of completed waits for DMA descriptors */
+    size_t sleeps;			/**< number of times the reader was put asleep (usleep or interrupt wait) */
+    size_t irqs;			/**< number of wake-ups caused by interrupts */
+    pcilib_timeout_t wait_time;		/**< total time spent waiting for descriptors, us */
+    pcilib_timeout_t max_wait_time;	/**< maximal time spent waiting for a single descriptor, us */
+    size_t mmio_writes;			/**< number of writes to REG_SW_NEXT_BD while streaming */
+    size_t ioctls;			/**< number of ioctl calls while streaming (page synchronization and interrupt waits) */
+} nwl_stats_t;
+
 typedef enum {
     NWL_MODIFICATION_DEFAULT,
     NWL_MODIFICATION_IPECAMERA
@@ -63,6 +86,12 @@ struct nwl_dma_s {
     int irq_started;			/**< indicates that IRQ subsystem is initialized (detecting which types should be preserverd) */    
     int loopback_started;		/**< indicates that benchmarking subsystem is initialized */
 
+    nwl_wait_mode_t wait_mode;		/**< how to wait for completion of DMA descriptors */
+    pcilib_timeout_t spin_time;		/**< time to spin before blocking in adaptive mode, us */
+    size_t return_batch;		/**< number of C2S buffers returned to the engine at once */
+    int sync_pages;			/**< indicates that pages are synchronized using the driver, required if mappings are bounce-buffered */
+    nwl_stats_t stats;			/**< statistics on descriptor waits and engine accesses, reported by benchmark */
+
 //    pcilib_dma_engine_t n_engines;
     pcilib_nwl_engine_context_t engines[PCILIB_MAX_DMA_ENGINES + 1];
 };
@@ -0,0 +1,820 @@
+#define _PCILIB_DMA_SOFT_C
+#define _BSD_SOURCE
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "pci.h"
+#include "pcilib.h"
+#include "error.h"
+#include "tools.h"
+#include "debug.h"
+#include "timing.h"
+
+#include "soft.h"
+#include "soft_private.h"
+
+/*
+ * The engine emulates C2S streaming of IPEDMA. The producer thread plays the role of the device, it writes
+ * the pages in the ring and publishes the bus address of the last written page in the status descriptor.
+ * The reader returns the processed pages by updating hw_last_read which emulates last_read register. The
+ * producer never writes the page referenced by hw_last_read, so one page is always kept free to distinguish
+ * completely full and empty rings.
+ *
+ * The S2C engine is a plain ring of pages filled by the host. The consumer thread drains the pushed pages
+ * with the configured rate. If the counter pattern is configured, the consumer expects the host to write the
+ * counter as well and reports the pages breaking it in dma_s2c_errors register, otherwise the data is not
+ * interpreted. Both engines share the configuration and the mutex.
+ */
+
+#define SOFTDMA_KMEM_SUBTYPE		0xF0		/**< keeps emulated buffers apart of the ones allocated by hardware engines */
+#define SOFTDMA_KMEM_SUBTYPE_S2C	0xF1		/**< pages of the emulated S2C engine */
+
+    /**
+     * The configuration of emulated engine may be preset using environmental variables. This is the only way
+     * to adjust it with pcitool if emulated device is used, since the software registers are not preserved
+     * between the runs then.
+     */
+static const char *dma_soft_env[][2] = {
+    { "PCILIB_SOFTDMA_TIMEOUT", "dma_timeout" },
+    { "PCILIB_SOFTDMA_PAGES", "dma_pages" },
+    { "PCILIB_SOFTDMA_PAGE_SIZE", "dma_page_size" },
+    { "PCILIB_SOFTDMA_RATE", "dma_rate" },
+    { "PCILIB_SOFTDMA_PACKET_PAGES", "dma_packet_pages" },
+    { "PCILIB_SOFTDMA_PATTERN", "dma_pattern" },
+    { "PCILIB_SOFTDMA_PATTERN_VALUE", "dma_pattern_value" },
+    { NULL, NULL }
+};
+
+static inline uint64_t dma_soft_ns(struct timespec *ts) {
+    return ts->tv_sec * 1000000000ull + ts->tv_nsec;
+}
+
+static void dma_soft_fill(soft_dma_t *ctx, uint32_t *page) {
+    size_t i, n = ctx->page_size / sizeof(uint32_t);
+
+    switch (ctx->pattern) {
+     case SOFTDMA_PATTERN_COUNTER:
+	for (i = 0; i < n; i++)
+	    page[i] = ctx->counter++;
+	break;
+     case SOFTDMA_PATTERN_FIXED:
+	for (i = 0; i < n; i++)
+	    page[i] = ctx->pattern_value;
+	break;
+     default:
+	;
+    }
+}
+
+static void *dma_soft_producer(void *arg) {
+    size_t next, pages = 0;
+    uint64_t start, ns_per_page = 0;
+    struct timespec ts;
+    soft_dma_t *ctx = (soft_dma_t*)arg;
+    volatile soft_dma_descriptor_t *desc = (soft_dma_descriptor_t*)pcilib_kmem_get_ua(ctx->dmactx.pcilib, ctx->desc);
+
+    if (ctx->rate) ns_per_page = 1000ull * ctx->page_size / ctx->rate;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    start = dma_soft_ns(&ts);
+
+    pthread_mutex_lock(&ctx->mutex);
+    while (ctx->run_flag) {
+	next = ctx->last_written + 1;
+	if (next == ctx->ring_size) next = 0;
+
+	    // Ring is full, waiting until the reader returns pages
+	if (next == ctx->hw_last_read) {
+	    pthread_cond_wait(&ctx->space_cond, &ctx->mutex);
+	    continue;
+	}
+	pthread_mutex_unlock(&ctx->mutex);
+
+	if (ns_per_page) {
+	    uint64_t deadline = start + (++pages) * ns_per_page;
+	    ts.tv_sec = deadline / 1000000000ull;
+	    ts.tv_nsec = deadline % 1000000000ull;
+	    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+	}
+
+	dma_soft_fill(ctx, (uint32_t*)pcilib_kmem_get_block_ua(ctx->dmactx.pcilib, ctx->pages, next));
+
+	pthread_mutex_lock(&ctx->mutex);
+	ctx->last_written = next;
+	desc->last_written_addr = pcilib_kmem_get_block_ba(ctx->dmactx.pcilib, ctx->pages, next);
+	pthread_cond_signal(&ctx->data_cond);
+    }
+
+    desc->empty_detected = 1;
+    pthread_cond_broadcast(&ctx->data_cond);
+    pthread_mutex_unlock(&ctx->mutex);
+
+    return NULL;
+}
+
+    /**
+     * Checks if the pushed data continues the counter pattern. The consumer thread is the only user of the
+     * counter, the counter is re-synchronized on the data after a mismatch.
+     */
+static int dma_soft_check(soft_dma_t *ctx, const uint32_t *page, size_t size) {
+    size_t i, n = size / sizeof(uint32_t);
+    soft_dma_s2c_t *s2c = &ctx->s2c;
+
+    for (i = 0; i < n; i++) {
+	if (page[i] != s2c->counter) {
+	    s2c->counter = page[n - 1] + 1;
+	    return PCILIB_ERROR_VERIFY;
+	}
+	s2c->counter++;
+    }
+
+    return 0;
+}
+
+static void *dma_soft_consumer(void *arg) {
+    uint64_t next = 0, ns_per_page = 0;
+    struct timespec ts;
+    soft_dma_t *ctx = (soft_dma_t*)arg;
+    soft_dma_s2c_t *s2c = &ctx->s2c;
+
+    if (ctx->rate) ns_per_page = 1000ull * ctx->page_size / ctx->rate;
+
+    pthread_mutex_lock(&ctx->mutex);
+    while (s2c->run_flag) {
+	    // The rate is only limited while there is data, the idle time is not compensated by bursts
+	if (!s2c->queued) {
+	    next = 0;
+	    pthread_cond_wait(&s2c->data_cond, &ctx->mutex);
+	    continue;
+	}
+	pthread_mutex_unlock(&ctx->mutex);
+
+	if (ns_per_page) {
+	    if (!next) {
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		next = dma_soft_ns(&ts);
+	    }
+	    next += ns_per_page;
+	    ts.tv_sec = next / 1000000000ull;
+	    ts.tv_nsec = next % 1000000000ull;
+	    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+	}
+
+	    // The host does not touch the pages between tail and head, so the page is checked without the lock
+	if ((ctx->pattern == SOFTDMA_PATTERN_COUNTER)&&(dma_soft_check(ctx, (uint32_t*)pcilib_kmem_get_block_ua(ctx->dmactx.pcilib, s2c->pages, s2c->tail), s2c->sizes[s2c->tail])))
+	    pcilib_write_register(ctx->dmactx.pcilib, "dmaconf", "dma_s2c_errors", ++s2c->errors);
+
+	pthread_mutex_lock(&ctx->mutex);
+	if (++s2c->tail == ctx->ring_size) s2c->tail = 0;
+	s2c->queued--;
+	s2c->consumed++;
+	pthread_cond_broadcast(&s2c->space_cond);
+    }
+    pthread_mutex_unlock(&ctx->mutex);
+
+    return NULL;
+}
+
+static void dma_soft_skip(soft_dma_t *ctx) {
+    pthread_mutex_lock(&ctx->mutex);
+    ctx->consumed += (ctx->last_written + ctx->ring_size - ctx->last_read) % ctx->ring_size;
+    ctx->last_read = ctx->last_written;
+    ctx->hw_last_read = ctx->last_written;
+    ctx->last_read_addr = pcilib_kmem_get_block_ba(ctx->dmactx.pcilib, ctx->pages, ctx->last_read);
+    pthread_cond_signal(&ctx->space_cond);
+    pthread_mutex_unlock(&ctx->mutex);
+}
+
+static int dma_soft_enable(soft_dma_t *ctx) {
+    int err;
+    volatile soft_dma_descriptor_t *desc = (soft_dma_descriptor_t*)pcilib_kmem_get_ua(ctx->dmactx.pcilib, ctx->desc);
+
+    if (ctx->enabled) return 0;
+
+    desc->empty_detected = 0;
+    ctx->run_flag = 1;
+
+    err = pthread_create(&ctx->producer, NULL, dma_soft_producer, ctx);
+    if (err) {
+	pcilib_error("Error (%i) starting the producer thread of emulated DMA engine", err);
+	return PCILIB_ERROR_FAILED;
+    }
+
+    ctx->enabled = 1;
+    return 0;
+}
+
+static void dma_soft_disable(soft_dma_t *ctx) {
+    if (!ctx->enabled) return;
+
+    pthread_mutex_lock(&ctx->mutex);
+    ctx->run_flag = 0;
+    pthread_cond_broadcast(&ctx->space_cond);
+    pthread_mutex_unlock(&ctx->mutex);
+
+    pthread_join(ctx->producer, NULL);
+    ctx->enabled = 0;
+}
+
+static int dma_soft_enable_s2c(soft_dma_t *ctx) {
+    int err;
+    soft_dma_s2c_t *s2c = &ctx->s2c;
+
+    if (s2c->enabled) return 0;
+
+    s2c->run_flag = 1;
+
+    err = pthread_create(&s2c->consumer, NULL, dma_soft_consumer, ctx);
+    if (err) {
+	pcilib_error("Error (%i) starting the consumer thread of emulated DMA engine", err);
+	return PCILIB_ERROR_FAILED;
+    }
+
+    s2c->enabled = 1;
+    return 0;
+}
+
+static void dma_soft_disable_s2c(soft_dma_t *ctx) {
+    soft_dma_s2c_t *s2c = &ctx->s2c;
+
+    if (!s2c->enabled) return;
+
+    pthread_mutex_lock(&ctx->mutex);
+    s2c->run_flag = 0;
+    pthread_cond_broadcast(&s2c->data_cond);
+    pthread_mutex_unlock(&ctx->mutex);
+
+    pthread_join(s2c->consumer, NULL);
+    s2c->enabled = 0;
+}
+
+pcilib_dma_context_t *dma_soft_init(pcilib_t *pcilib, const char *model, const void *arg) {
+    int i, err;
+    const char *env;
+    pthread_condattr_t cattr;
+    soft_dma_t *ctx = malloc(sizeof(soft_dma_t));
+
+    if (ctx) {
+	memset(ctx, 0, sizeof(soft_dma_t));
+	ctx->dmactx.pcilib = pcilib;
+
+	if (pcilib_find_register_bank_by_addr(pcilib, PCILIB_REGISTER_BANK_DMACONF) == PCILIB_REGISTER_BANK_INVALID) {
+	    free(ctx);
+	    pcilib_error("DMA Register Bank could not be found");
+	    return NULL;
+	}
+
+	for (i = 0; dma_soft_env[i][0]; i++) {
+	    env = getenv(dma_soft_env[i][0]);
+	    if ((!env)||(!*env)) continue;
+
+	    err = pcilib_write_register(pcilib, "dmaconf", dma_soft_env[i][1], strtoul(env, NULL, 0));
+	    if (err) {
+		free(ctx);
+		pcilib_error("Error (%i) setting %s from %s", err, dma_soft_env[i][1], dma_soft_env[i][0]);
+		return NULL;
+	    }
+	}
+
+	pthread_mutex_init(&ctx->mutex, NULL);
+
+	    // Timed waits are using the same monotonic clock as the rest of pcilib timing
+	pthread_condattr_init(&cattr);
+	pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+	pthread_cond_init(&ctx->data_cond, &cattr);
+	pthread_cond_init(&ctx->space_cond, &cattr);
+	pthread_cond_init(&ctx->s2c.data_cond, &cattr);
+	pthread_cond_init(&ctx->s2c.space_cond, &cattr);
+	pthread_condattr_destroy(&cattr);
+
+	if (!pcilib->emulated)
+	    pcilib_info("The DMA engine is emulated in software, no data is transferred from the device");
+    }
+
+    return (pcilib_dma_context_t*)ctx;
+}
+
+void  dma_soft_free(pcilib_dma_context_t *vctx) {
+    soft_dma_t *ctx = (soft_dma_t*)vctx;
+
+    if (ctx) {
+	dma_soft_stop(vctx, PCILIB_DMA_ENGINE_ALL, PCILIB_DMA_FLAGS_DEFAULT);
+
+	pthread_cond_destroy(&ctx->s2c.space_cond);
+	pthread_cond_destroy(&ctx->s2c.data_cond);
+	pthread_cond_destroy(&ctx->space_cond);
+	pthread_cond_destroy(&ctx->data_cond);
+	pthread_mutex_destroy(&ctx->mutex);
+
+	free(ctx);
+    }
+}
+
+    /**
+     * Reads the configuration from the registers. The configuration is shared by both engines and is only
+     * read if none of them is running.
+     */
+static int dma_soft_configure(soft_dma_t *ctx) {
+    pcilib_register_value_t value;
+
+    if (!pcilib_read_register(ctx->dmactx.pcilib, "dmaconf", "dma_timeout", &value))
+	ctx->dma_timeout = value;
+    else
+	ctx->dma_timeout = SOFTDMA_DMA_TIMEOUT;
+
+    if ((!pcilib_read_register(ctx->dmactx.pcilib, "dmaconf", "dma_page_size", &value))&&(value > 0)) {
+	if (value % SOFTDMA_PAGE_SIZE) {
+	    pcilib_error("Invalid DMA page size (%lu) is configured", value);
+	    return PCILIB_ERROR_INVALID_ARGUMENT;
+	}
+	ctx->page_size = value;
+    } else
+	ctx->page_size = SOFTDMA_PAGE_SIZE;
+
+    if ((!pcilib_read_register(ctx->dmactx.pcilib, "dmaconf", "dma_pages", &value))&&(value > 1))
+	ctx->ring_size = value;
+    else
+	ctx->ring_size = SOFTDMA_DMA_PAGES;
+
+    if (!pcilib_read_register(ctx->dmactx.pcilib, "dmaconf", "dma_rate", &value))
+	ctx->rate = value;
+    else
+	ctx->rate = 0;
+
+    if ((!pcilib_read_register(ctx->dmactx.pcilib, "dmaconf", "dma_packet_pages", &value))&&(value > 0))
+	ctx->packet_pages = value;
+    else
+	ctx->packet_pages = 1;
+
+    if (!pcilib_read_register(ctx->dmactx.pcilib, "dmaconf", "dma_pattern", &value))
+	ctx->pattern = (soft_dma_pattern_t)value;
+    else
+	ctx->pattern = SOFTDMA_PATTERN_COUNTER;
+
+    if (!pcilib_read_register(ctx->dmactx.pcilib, "dmaconf", "dma_pattern_value", &value))
+	ctx->pattern_value = value;
+    else
+	ctx->pattern_value = 0;
+
+    return 0;
+}
+
+static int dma_soft_start_s2c(soft_dma_t *ctx) {
+    int err;
+    soft_dma_s2c_t *s2c = &ctx->s2c;
+
+    if (s2c->pages) return 0;
+
+    s2c->sizes = (size_t*)malloc(ctx->ring_size * sizeof(size_t));
+    s2c->pages = pcilib_alloc_kernel_memory(ctx->dmactx.pcilib, PCILIB_KMEM_TYPE_PAGE, ctx->ring_size, ctx->page_size, 0, PCILIB_KMEM_USE(PCILIB_KMEM_USE_DMA_PAGES, SOFTDMA_KMEM_SUBTYPE_S2C), PCILIB_KMEM_FLAG_EXCLUSIVE);
+    if ((!s2c->pages)||(!s2c->sizes)) {
+	if (s2c->pages) pcilib_free_kernel_memory(ctx->dmactx.pcilib, s2c->pages, 0);
+	if (s2c->sizes) free(s2c->sizes);
+	s2c->pages = NULL;
+	s2c->sizes = NULL;
+	pcilib_error("Can't allocate required memory for emulated S2C engine (%lu pages of %lu bytes)", ctx->ring_size, ctx->page_size);
+	return PCILIB_ERROR_MEMORY;
+    }
+
+    s2c->head = 0;
+    s2c->tail = 0;
+    s2c->queued = 0;
+    s2c->consumed = 0;
+    s2c->counter = ctx->pattern_value;
+    s2c->errors = 0;
+    pcilib_write_register(ctx->dmactx.pcilib, "dmaconf", "dma_s2c_errors", 0);
+
+    pcilib_info("Emulated S2C engine: %lu pages of %lu bytes, rate: %lu MB/s", ctx->ring_size, ctx->page_size, ctx->rate);
+
+    err = dma_soft_enable_s2c(ctx);
+    if (err) {
+	pcilib_free_kernel_memory(ctx->dmactx.pcilib, s2c->pages, 0);
+	free(s2c->sizes);
+	s2c->pages = NULL;
+	s2c->sizes = NULL;
+	return err;
+    }
+
+    s2c->started = 1;
+
+    return 0;
+}
+
+static void dma_soft_stop_s2c(soft_dma_t *ctx) {
+    soft_dma_s2c_t *s2c = &ctx->s2c;
+
+    dma_soft_disable_s2c(ctx);
+
+    s2c->started = 0;
+
+    if (s2c->pages) {
+	pcilib_free_kernel_memory(ctx->dmactx.pcilib, s2c->pages, 0);
+	s2c->pages = NULL;
+    }
+
+    if (s2c->sizes) {
+	free(s2c->sizes);
+	s2c->sizes = NULL;
+    }
+}
+
+int dma_soft_start(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcilib_dma_flags_t flags) {
+    int err;
+
+    soft_dma_t *ctx = (soft_dma_t*)vctx;
+
+    pcilib_kmem_handle_t *desc = NULL;
+    pcilib_kmem_handle_t *pages = NULL;
+
+    if (dma == PCILIB_DMA_ENGINE_INVALID) return 0;
+    else if (dma > SOFTDMA_ENGINE_S2C) return PCILIB_ERROR_INVALID_BANK;
+
+    if ((dma == SOFTDMA_ENGINE_C2S)&&(ctx->pages)) return 0;
+    if ((dma == SOFTDMA_ENGINE_S2C)&&(ctx->s2c.pages)) return 0;
+
+    if ((!ctx->pages)&&(!ctx->s2c.pages)) {
+	err = dma_soft_configure(ctx);
+	if (err) return err;
+    }
+
+    if (dma == SOFTDMA_ENGINE_S2C)
+	return dma_soft_start_s2c(ctx);
+
+    desc = pcilib_alloc_kernel_memory(ctx->dmactx.pcilib, PCILIB_KMEM_TYPE_CONSISTENT, 1, SOFTDMA_DESCRIPTOR_SIZE, SOFTDMA_DESCRIPTOR_ALIGNMENT, PCILIB_KMEM_USE(PCILIB_KMEM_USE_DMA_RING, SOFTDMA_KMEM_SUBTYPE), PCILIB_KMEM_FLAG_EXCLUSIVE);
+    pages = pcilib_alloc_kernel_memory(ctx->dmactx.pcilib, PCILIB_KMEM_TYPE_PAGE, ctx->ring_size, ctx->page_size, 0, PCILIB_KMEM_USE(PCILIB_KMEM_USE_DMA_PAGES, SOFTDMA_KMEM_SUBTYPE), PCILIB_KMEM_FLAG_EXCLUSIVE);
+
+    if (!desc||!pages) {
+	if (pages) pcilib_free_kernel_memory(ctx->dmactx.pcilib, pages, 0);
+	if (desc) pcilib_free_kernel_memory(ctx->dmactx.pcilib, desc, 0);
+	pcilib_error("Can't allocate required memory for emulated DMA engine (%lu pages of %lu bytes + %lu byte descriptor)", ctx->ring_size, ctx->page_size, (unsigned long)SOFTDMA_DESCRIPTOR_SIZE);
+	return PCILIB_ERROR_MEMORY;
+    }
+
+    memset((void*)pcilib_kmem_get_ua(ctx->dmactx.pcilib, desc), 0, SOFTDMA_DESCRIPTOR_SIZE);
+
+    ctx->desc = desc;
+    ctx->pages = pages;
+
+    ctx->last_read = ctx->ring_size - 1;
+    ctx->last_read_addr = pcilib_kmem_get_block_ba(ctx->dmactx.pcilib, ctx->pages, ctx->last_read);
+    ctx->last_written = ctx->last_read;
+    ctx->hw_last_read = ctx->last_read;
+    ctx->consumed = 0;
+    ctx->counter = ctx->pattern_value;
+
+    pcilib_info("Emulated DMA engine: %lu pages of %lu bytes, rate: %lu MB/s, packet: %lu pages, pattern: %u", ctx->ring_size, ctx->page_size, ctx->rate, ctx->packet_pages, ctx->pattern);
+
+    err = dma_soft_enable(ctx);
+    if (err) {
+	dma_soft_stop(vctx, dma, flags);
+	return err;
+    }
+
+    ctx->started = 1;
+
+    return 0;
+}
+
+int dma_soft_stop(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcilib_dma_flags_t flags) {
+    soft_dma_t *ctx = (soft_dma_t*)vctx;
+
+    if ((dma != PCILIB_DMA_ENGINE_INVALID)&&(dma > SOFTDMA_ENGINE_S2C)) return PCILIB_ERROR_INVALID_BANK;
+
+    if ((dma == PCILIB_DMA_ENGINE_INVALID)||(dma == SOFTDMA_ENGINE_S2C))
+	dma_soft_stop_s2c(ctx);
+
+    if (dma == SOFTDMA_ENGINE_S2C) return 0;
+
+    dma_soft_disable(ctx);
+
+    ctx->started = 0;
+
+    if (ctx->desc) {
+	pcilib_free_kernel_memory(ctx->dmactx.pcilib, ctx->desc, 0);
+	ctx->desc = NULL;
+    }
+
+    if (ctx->pages) {
+	pcilib_free_kernel_memory(ctx->dmactx.pcilib, ctx->pages, 0);
+	ctx->pages = NULL;
+    }
+
+    return 0;
+}
+
+int dma_soft_get_status(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcilib_dma_engine_status_t *status, size_t n_buffers, pcilib_dma_buffer_status_t *buffers) {
+    size_t i, head, tail;
+    soft_dma_t *ctx = (soft_dma_t*)vctx;
+
+    if (!status) return -1;
+
+    memset(status, 0, sizeof(pcilib_dma_engine_status_t));
+
+    if (dma == SOFTDMA_ENGINE_S2C) {
+	if (!ctx->s2c.pages) return 0;
+
+	pthread_mutex_lock(&ctx->mutex);
+	head = ctx->s2c.head;
+	tail = ctx->s2c.tail;
+	status->written_buffers = ctx->s2c.queued;
+	pthread_mutex_unlock(&ctx->mutex);
+
+	status->started = ctx->s2c.started;
+	status->ring_size = ctx->ring_size;
+	status->buffer_size = ctx->page_size;
+	status->ring_head = head;
+	status->ring_tail = tail;
+	status->written_bytes = status->written_buffers * ctx->page_size;
+
+	if (n_buffers > ctx->ring_size) n_buffers = ctx->ring_size;
+
+	if (buffers)
+	    memset(buffers, 0, n_buffers * sizeof(pcilib_dma_buffer_status_t));
+
+	for (i = 0; i < status->written_buffers; i++, tail++) {
+	    if (tail == ctx->ring_size) tail = 0;
+	    if ((buffers)&&(tail < n_buffers)) {
+		buffers[tail].used = 1;
+		buffers[tail].size = ctx->page_size;
+		buffers[tail].first = 1;
+		buffers[tail].last = 1;
+	    }
+	}
+
+	return 0;
+    }
+
+    if (!ctx->pages) return 0;
+
+    pthread_mutex_lock(&ctx->mutex);
+    head = ctx->last_written;
+    tail = ctx->last_read;
+    pthread_mutex_unlock(&ctx->mutex);
+
+    status->started = ctx->started;
+    status->ring_size = ctx->ring_size;
+    status->buffer_size = ctx->page_size;
+    status->ring_head = head;
+    status->ring_tail = tail;
+
+    if (n_buffers > ctx->ring_size) n_buffers = ctx->ring_size;
+
+    if (buffers)
+	memset(buffers, 0, n_buffers * sizeof(pcilib_dma_buffer_status_t));
+
+    for (i = tail; i != head; ) {
+	if (++i == ctx->ring_size) i = 0;
+
+	status->written_buffers++;
+	status->written_bytes += ctx->page_size;
+
+	if ((buffers)&&(i < n_buffers)) {
+	    buffers[i].used = 1;
+	    buffers[i].size = ctx->page_size;
+	    buffers[i].first = 1;
+	    buffers[i].last = 1;
+	}
+    }
+
+	// We keep last_read in the ring_tail, so need to increase
+    if (status->ring_tail != status->ring_head) {
+	status->ring_tail++;
+	if (status->ring_tail == status->ring_size) status->ring_tail = 0;
+    }
+
+    return 0;
+}
+
+int dma_soft_push(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, void *buf, size_t *written) {
+    int err = 0;
+    size_t pos, block_size;
+    struct timeval deadline;
+    struct timespec ts;
+
+    soft_dma_t *ctx = (soft_dma_t*)vctx;
+    soft_dma_s2c_t *s2c = &ctx->s2c;
+
+    if (dma != SOFTDMA_ENGINE_S2C) return PCILIB_ERROR_INVALID_BANK;
+
+	// The DMA session has already started the engine
+    if ((flags&PCILIB_DMA_FLAG_PREPARED) == 0) {
+	err = dma_soft_start(vctx, dma, PCILIB_DMA_FLAGS_DEFAULT);
+	if (err) return err;
+    }
+
+    if (flags&PCILIB_DMA_FLAG_NOWAIT) timeout = PCILIB_TIMEOUT_IMMEDIATE;
+
+    if (timeout != PCILIB_TIMEOUT_INFINITE) {
+	pcilib_gettime(&deadline);
+	pcilib_add_timeout(&deadline, timeout);
+	ts.tv_sec = deadline.tv_sec;
+	ts.tv_nsec = deadline.tv_usec * 1000;
+    }
+
+    for (pos = 0; pos < size; pos += block_size) {
+	block_size = min2(size - pos, ctx->page_size);
+
+	pthread_mutex_lock(&ctx->mutex);
+	while ((s2c->queued == ctx->ring_size)&&(!err)) {
+	    if (timeout == PCILIB_TIMEOUT_INFINITE)
+		pthread_cond_wait(&s2c->space_cond, &ctx->mutex);
+	    else if ((timeout == PCILIB_TIMEOUT_IMMEDIATE)||(pthread_cond_timedwait(&s2c->space_cond, &ctx->mutex, &ts) == ETIMEDOUT))
+		err = PCILIB_ERROR_TIMEOUT;
+	}
+	pthread_mutex_unlock(&ctx->mutex);
+
+	if (err) {
+	    if (written) *written = pos;
+	    return err;
+	}
+
+	    // Only the host touches the pages between head and tail, so the data is copied without the lock
+	memcpy((void*)pcilib_kmem_get_block_ua(ctx->dmactx.pcilib, s2c->pages, s2c->head), buf + pos, block_size);
+	s2c->sizes[s2c->head] = block_size;
+
+	pthread_mutex_lock(&ctx->mutex);
+	if (++s2c->head == ctx->ring_size) s2c->head = 0;
+	s2c->queued++;
+	pthread_cond_signal(&s2c->data_cond);
+	pthread_mutex_unlock(&ctx->mutex);
+    }
+
+    if (written) *written = size;
+
+    if (flags&PCILIB_DMA_FLAG_WAIT) {
+	pthread_mutex_lock(&ctx->mutex);
+	while ((s2c->queued)&&(!err)) {
+	    if (timeout == PCILIB_TIMEOUT_INFINITE)
+		pthread_cond_wait(&s2c->space_cond, &ctx->mutex);
+	    else if ((timeout == PCILIB_TIMEOUT_IMMEDIATE)||(pthread_cond_timedwait(&s2c->space_cond, &ctx->mutex, &ts) == ETIMEDOUT))
+		err = PCILIB_ERROR_TIMEOUT;
+	}
+	pthread_mutex_unlock(&ctx->mutex);
+    }
+
+    return err;
+}
+
+int dma_soft_stream_read(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, pcilib_dma_callback_t cb, void *cbattr) {
+	// Only data which is already available is processed if waiting is not allowed
+    int err, ret = (flags&PCILIB_DMA_FLAG_NOWAIT)?PCILIB_STREAMING_CHECK:PCILIB_STREAMING_REQ_PACKET;
+
+    pcilib_timeout_t wait = 0;
+    struct timeval deadline;
+    struct timespec ts;
+
+    volatile soft_dma_descriptor_t *desc;
+    pcilib_dma_flags_t packet_flags;
+
+    size_t cur_read;
+    void *buf;
+
+    soft_dma_t *ctx = (soft_dma_t*)vctx;
+
+    if (dma != SOFTDMA_ENGINE_C2S) return PCILIB_ERROR_INVALID_BANK;
+
+	// The DMA session has already started the engine
+    if ((flags&PCILIB_DMA_FLAG_PREPARED) == 0) {
+	err = dma_soft_start(vctx, dma, PCILIB_DMA_FLAGS_DEFAULT);
+	if (err) return err;
+    }
+
+    desc = (soft_dma_descriptor_t*)pcilib_kmem_get_ua(ctx->dmactx.pcilib, ctx->desc);
+
+    do {
+	switch (ret&PCILIB_STREAMING_TIMEOUT_MASK) {
+	    case PCILIB_STREAMING_CONTINUE:
+		    // The producer is stopped and we can safely stop if there is no data in the buffers already
+		if (desc->empty_detected)
+		    wait = 0;
+		else
+		    wait = ctx->dma_timeout;
+	    break;
+	    case PCILIB_STREAMING_WAIT:
+		wait = (timeout > ctx->dma_timeout)?timeout:ctx->dma_timeout;
+	    break;
+	    case PCILIB_STREAMING_CHECK:
+		wait = 0;
+	    break;
+	}
+
+	pcilib_debug(DMA, "Waiting for data in %4zu - last_read: %4zu, last_written: %4zu", ctx->last_read + 1, ctx->last_read, ctx->last_written);
+
+	pthread_mutex_lock(&ctx->mutex);
+	if ((ctx->last_written == ctx->last_read)&&(wait)&&(!desc->empty_detected)) {
+	    if (wait == PCILIB_TIMEOUT_INFINITE) {
+		while ((ctx->last_written == ctx->last_read)&&(!desc->empty_detected))
+		    pthread_cond_wait(&ctx->data_cond, &ctx->mutex);
+	    } else {
+		pcilib_gettime(&deadline);
+		pcilib_add_timeout(&deadline, wait);
+		ts.tv_sec = deadline.tv_sec;
+		ts.tv_nsec = deadline.tv_usec * 1000;
+
+		while ((ctx->last_written == ctx->last_read)&&(!desc->empty_detected)) {
+		    if (pthread_cond_timedwait(&ctx->data_cond, &ctx->mutex, &ts) == ETIMEDOUT) break;
+		}
+	    }
+	}
+
+	    // Failing out if we exited on timeout
+	if (ctx->last_written == ctx->last_read) {
+	    pthread_mutex_unlock(&ctx->mutex);
+	    return (ret&PCILIB_STREAMING_FAIL)?PCILIB_ERROR_TIMEOUT:0;
+	}
+	pthread_mutex_unlock(&ctx->mutex);
+
+	    // Getting next page to read
+	cur_read = ctx->last_read + 1;
+	if (cur_read == ctx->ring_size) cur_read = 0;
+
+	pcilib_debug(DMA, "Got buffer          %4zu - last read: %4zu, last_written: %4zu", cur_read, ctx->last_read, ctx->last_written);
+
+	packet_flags = (((ctx->consumed + 1) % ctx->packet_pages) == 0)?PCILIB_DMA_FLAG_EOP:0;
+
+	buf = (void*)pcilib_kmem_get_block_ua(ctx->dmactx.pcilib, ctx->pages, cur_read);
+	ret = cb(cbattr, packet_flags, ctx->page_size, buf);
+	if (ret < 0) return -ret;
+
+	    // Return buffer into the DMA pool when processed
+	pthread_mutex_lock(&ctx->mutex);
+	ctx->consumed++;
+	ctx->hw_last_read = cur_read;
+	ctx->last_read = cur_read;
+	ctx->last_read_addr = pcilib_kmem_get_block_ba(ctx->dmactx.pcilib, ctx->pages, cur_read);
+	pthread_cond_signal(&ctx->space_cond);
+	pthread_mutex_unlock(&ctx->mutex);
+    } while (ret);
+
+    return 0;
+}
+
+double dma_soft_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dma, uintptr_t addr, size_t size, size_t iterations, pcilib_dma_direction_t direction) {
+    int err = 0;
+
+    soft_dma_t *ctx = (soft_dma_t*)vctx;
+
+    size_t iter;
+    size_t us = 0;
+    struct timeval start, cur;
+
+    void *buf;
+    size_t bytes, rbytes;
+
+    if ((direction == PCILIB_DMA_TO_DEVICE)||(direction == PCILIB_DMA_BIDIRECTIONAL)) return -1.;
+
+    if ((dma != PCILIB_DMA_ENGINE_INVALID)&&(dma > 0)) return -1.;
+
+    err = dma_soft_start(vctx, SOFTDMA_ENGINE_C2S, PCILIB_DMA_FLAGS_DEFAULT);
+    if (err) return -1.;
+
+    if (size%ctx->page_size) size = (1 + size / ctx->page_size) * ctx->page_size;
+
+    err = posix_memalign(&buf, 4096, size);
+    if ((err)||(!buf)) return -1.;
+
+	// Unlike hardware, the emulated device can be paused without loosing data. So we just drop everything written so far
+    dma_soft_disable(ctx);
+    dma_soft_skip(ctx);
+
+    for (iter = 0; iter <= iterations; iter++) {
+	pcilib_gettime(&start);
+
+	err = dma_soft_enable(ctx);
+	if (err) break;
+
+	for (bytes = 0; bytes < size; bytes += rbytes) {
+	    err = pcilib_read_dma_custom(ctx->dmactx.pcilib, 0, addr, size - bytes, PCILIB_DMA_FLAG_MULTIPACKET, ctx->dma_timeout, buf + bytes, &rbytes);
+	    if (err) {
+		pcilib_error("Can't read data from DMA (iteration: %zu, offset: %zu), error %i", iter, bytes, err);
+		break;
+	    }
+	}
+
+	pcilib_gettime(&cur);
+
+	dma_soft_disable(ctx);
+	if (err) break;
+
+	    // Heating up during the first iteration
+	if (iter)
+	    us += pcilib_timediff(&start, &cur);
+
+	pcilib_info("Iteration %-4zu latency: %lu", iter, pcilib_timediff(&start, &cur));
+
+	dma_soft_skip(ctx);
+    }
+
+    free(buf);
+
+    return err?-1:((1. * size * iterations * 1000000) / (1024. * 1024. * us));
+}
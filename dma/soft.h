@@ -0,0 +1,65 @@
+#ifndef _PCILIB_DMA_SOFT_H
+#define _PCILIB_DMA_SOFT_H
+
+#include <stdio.h>
+#include "pcilib.h"
+#include "version.h"
+
+#define SOFTDMA_PAGE_SIZE		4096l		/**< default page size */
+#define SOFTDMA_DMA_PAGES		512l		/**< default number of DMA pages in the ring buffer */
+#define SOFTDMA_DMA_TIMEOUT		100000l		/**< us, overrides PCILIB_DMA_TIMEOUT */
+
+pcilib_dma_context_t *dma_soft_init(pcilib_t *ctx, const char *model, const void *arg);
+void  dma_soft_free(pcilib_dma_context_t *vctx);
+
+int dma_soft_get_status(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, pcilib_dma_engine_status_t *status, size_t n_buffers, pcilib_dma_buffer_status_t *buffers);
+
+int dma_soft_start(pcilib_dma_context_t *ctx, pcilib_dma_engine_t dma, pcilib_dma_flags_t flags);
+int dma_soft_stop(pcilib_dma_context_t *ctx, pcilib_dma_engine_t dma, pcilib_dma_flags_t flags);
+
+int dma_soft_push(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, void *buf, size_t *written);
+int dma_soft_stream_read(pcilib_dma_context_t *vctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, pcilib_dma_callback_t cb, void *cbattr);
+double dma_soft_benchmark(pcilib_dma_context_t *vctx, pcilib_dma_engine_addr_t dma, uintptr_t addr, size_t size, size_t iterations, pcilib_dma_direction_t direction);
+
+#ifdef _PCILIB_EXPORT_C
+static const pcilib_dma_api_description_t soft_dma_api = {
+    PCILIB_VERSION,
+    dma_soft_init,
+    dma_soft_free,
+    dma_soft_get_status,
+    NULL,
+    NULL,
+    NULL,
+    dma_soft_start,
+    dma_soft_stop,
+    dma_soft_push,
+    dma_soft_stream_read,
+    dma_soft_benchmark
+};
+
+static const pcilib_dma_engine_description_t soft_dma_engines[] = {
+    { 0, PCILIB_DMA_TYPE_PACKET, PCILIB_DMA_FROM_DEVICE, 32, "dma", "Software emulated C2S engine" },
+    { 0, PCILIB_DMA_TYPE_PACKET, PCILIB_DMA_TO_DEVICE, 32, "dma", "Software emulated S2C engine" },
+    { 0 }
+};
+
+static const pcilib_register_bank_description_t soft_dma_banks[] = {
+    { PCILIB_REGISTER_BANK_DMACONF, PCILIB_REGISTER_PROTOCOL_SOFTWARE, PCILIB_BAR_NOBAR, 0, 0, 32, 0x1000, PCILIB_HOST_ENDIAN, PCILIB_HOST_ENDIAN, "0x%lx", "dmaconf", "DMA Configuration"},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, NULL, NULL }
+};
+
+static const pcilib_register_description_t soft_dma_registers[] = {
+    {0x0000, 	0, 	32, 	PCILIB_VERSION, 	0x00000000,	PCILIB_REGISTER_R   , PCILIB_REGISTER_STANDARD, PCILIB_REGISTER_BANK_DMACONF, "dma_version",	"Version of DMA engine"},
+    {0x0004, 	0, 	32, 	SOFTDMA_DMA_TIMEOUT, 	0x00000000,	PCILIB_REGISTER_RW  , PCILIB_REGISTER_STANDARD, PCILIB_REGISTER_BANK_DMACONF, "dma_timeout",	"Default DMA timeout"},
+    {0x0008, 	0, 	32, 	SOFTDMA_DMA_PAGES,	0x00000000,	PCILIB_REGISTER_RW  , PCILIB_REGISTER_STANDARD, PCILIB_REGISTER_BANK_DMACONF, "dma_pages",	"Number of buffers in DMA page ring"},
+    {0x000C, 	0, 	32, 	SOFTDMA_PAGE_SIZE,	0x00000000,	PCILIB_REGISTER_RW  , PCILIB_REGISTER_STANDARD, PCILIB_REGISTER_BANK_DMACONF, "dma_page_size",	"Size of a page in DMA page ring (multiple of 4K)"},
+    {0x0010, 	0, 	32, 	0,			0x00000000,	PCILIB_REGISTER_RW  , PCILIB_REGISTER_STANDARD, PCILIB_REGISTER_BANK_DMACONF, "dma_rate",	"Data rate of emulated device in MB/s (0 - as fast as possible)"},
+    {0x0014, 	0, 	32, 	1,			0x00000000,	PCILIB_REGISTER_RW  , PCILIB_REGISTER_STANDARD, PCILIB_REGISTER_BANK_DMACONF, "dma_packet_pages",	"Number of pages in the packet (EOP is reported on the last page)"},
+    {0x0018, 	0, 	32, 	1,			0x00000000,	PCILIB_REGISTER_RW  , PCILIB_REGISTER_STANDARD, PCILIB_REGISTER_BANK_DMACONF, "dma_pattern",	"Data pattern: 0 - do not touch pages, 1 - 32-bit counter, 2 - fixed pattern"},
+    {0x001C, 	0, 	32, 	0,			0x00000000,	PCILIB_REGISTER_RW  , PCILIB_REGISTER_STANDARD, PCILIB_REGISTER_BANK_DMACONF, "dma_pattern_value",	"Fixed pattern or the initial value of counter"},
+    {0x0020, 	0, 	32, 	0,			0x00000000,	PCILIB_REGISTER_RW  , PCILIB_REGISTER_STANDARD, PCILIB_REGISTER_BANK_DMACONF, "dma_s2c_errors",	"Number of S2C pages not continuing the counter pattern (only verified with counter pattern)"},
+    {0,		0,	0,	0,	0x00000000,	0,                                           0,                        0, NULL, 			NULL}
+};
+#endif /* _PCILIB_EXPORT_C */
+
+#endif /* _PCILIB_DMA_SOFT_H */
@@ -0,0 +1,89 @@
+#ifndef _PCILIB_DMA_SOFT_PRIVATE_H
+#define _PCILIB_DMA_SOFT_PRIVATE_H
+
+#include <pthread.h>
+
+#include "dma.h"
+#include "kmem.h"
+
+#define SOFTDMA_DESCRIPTOR_SIZE		128
+#define SOFTDMA_DESCRIPTOR_ALIGNMENT	64
+#define SOFTDMA_STOP_DELAY		1000		/**< us, time given to the producer to finish the page while benchmarking */
+
+#define SOFTDMA_ENGINE_C2S		0		/**< ID of the emulated C2S engine */
+#define SOFTDMA_ENGINE_S2C		1		/**< ID of the emulated S2C engine */
+
+typedef enum {
+    SOFTDMA_PATTERN_NONE = 0,				/**< Pages are not touched, only the DMA progress is emulated */
+    SOFTDMA_PATTERN_COUNTER = 1,			/**< Pages are filled with 32-bit counter continued across the pages */
+    SOFTDMA_PATTERN_FIXED = 2				/**< Pages are filled with the fixed 32-bit value */
+} soft_dma_pattern_t;
+
+    /**
+     * The status descriptor updated by the emulated device, mimics the layout used by IPEDMA in 64-bit mode
+     */
+typedef struct {
+    uint32_t reserved;
+    uint32_t empty_detected;				/**< Set when the producer is stopped and there is no more data coming */
+    uint64_t last_written_addr;				/**< Bus address of the last written page, 0 - nothing is written yet */
+} soft_dma_descriptor_t;
+
+    /**
+     * The emulated S2C engine, the consumer thread plays the role of the device and drains the pages pushed by the host
+     */
+typedef struct {
+    int started;					/**< indicates that DMA buffers are initialized and writting is allowed */
+    int enabled;					/**< indicates that the consumer thread is running */
+    int run_flag;					/**< cleared to stop the consumer thread */
+
+    pcilib_kmem_handle_t *pages;			/**< ring of DMA pages */
+
+    size_t head;					/**< Next page to be filled by the host */
+    size_t tail;					/**< Next page to be consumed by the device */
+    size_t queued;					/**< Number of pages pushed, but not consumed by the device yet */
+    size_t consumed;					/**< Number of pages consumed since the start of the engine */
+    size_t *sizes;					/**< Number of bytes pushed into each page of the ring */
+
+    uint32_t counter;					/**< Expected value of the counter pattern */
+    size_t errors;					/**< Number of pages not continuing the counter pattern */
+
+    pthread_t consumer;					/**< Consumer thread emulating the device */
+    pthread_cond_t data_cond;				/**< Signaled when a new page is pushed or the consumer should stop */
+    pthread_cond_t space_cond;				/**< Signaled when a page is consumed */
+} soft_dma_s2c_t;
+
+typedef struct soft_dma_s soft_dma_t;
+
+struct soft_dma_s {
+    pcilib_dma_context_t dmactx;
+
+    int started;					/**< indicates that DMA buffers are initialized and reading is allowed */
+    int enabled;					/**< indicates that the producer thread is running */
+    int run_flag;					/**< cleared to stop the producer thread */
+
+    size_t dma_timeout;					/**< DMA timeout, SOFTDMA_DMA_TIMEOUT is used by default */
+    size_t rate;					/**< Data rate in MB/s, 0 - unlimited */
+    size_t packet_pages;				/**< Number of pages in the packet */
+    soft_dma_pattern_t pattern;				/**< The pattern to fill pages with */
+    uint32_t pattern_value;				/**< Fixed pattern or initial value of the counter */
+    uint32_t counter;					/**< Current value of the counter pattern */
+
+    pcilib_kmem_handle_t *desc;				/**< in-memory status descriptor written by the producer upon progress */
+    pcilib_kmem_handle_t *pages;			/**< ring of DMA pages */
+
+    size_t ring_size, page_size;			/**< Number of pages in ring buffer and the size of a single DMA page */
+    size_t last_read;					/**< Last page processed by the reader */
+    uintptr_t last_read_addr;				/**< Bus address of the last page processed by the reader */
+    size_t last_written;				/**< Last page written by the producer */
+    size_t hw_last_read;				/**< Emulates the last_read register of the hardware, the producer does not overwrite this page */
+    size_t consumed;					/**< Number of pages read since the start of the engine (used to detect packet boundaries) */
+
+    pthread_t producer;					/**< Producer thread emulating the device */
+    pthread_mutex_t mutex;				/**< Protects the ring state of both engines */
+    pthread_cond_t data_cond;				/**< Signaled when a new page is written */
+    pthread_cond_t space_cond;				/**< Signaled when a page is returned or the producer should stop */
+
+    soft_dma_s2c_t s2c;					/**< The emulated S2C engine, shares configuration with the C2S engine */
+};
+
+#endif /* _PCILIB_DMA_SOFT_PRIVATE_H */
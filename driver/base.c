@@ -156,6 +156,12 @@ static int __devinit pcidriver_probe(struct pci_dev *pdev, const struct pci_devi
     atomic_set(&privdata->umem_count, 0);
 
 #ifdef PCIDRIVER_DUMMY_DEVICE
+    /* RAM-backed BAR0, allows to test the PIO access and the BAR caching modes */
+    privdata->dummy_bar = (void*)__get_free_pages(GFP_KERNEL | __GFP_ZERO, get_order(PCIDRIVER_DUMMY_BAR_SIZE));
+    if (!privdata->dummy_bar)
+        mod_info("Couldn't allocate memory for the emulated BAR0\n");
+    privdata->dummy_bar_cache = PCIDRIVER_MMAP_CACHE_WB;
+
     pcidriver_dummydata = privdata;
 #else /* PCIDRIVER_DUMMY_DEVICE */
     pci_set_drvdata(pdev, privdata);
@@ -201,6 +207,12 @@ probe_cdevadd_fail:
 probe_irq_probe_fail:
     pcidriver_irq_unmap_bars(privdata);
 #endif /* ! PCIDRIVER_DUMMY_DEVICE */
+#ifdef PCIDRIVER_DUMMY_DEVICE
+    if (privdata->dummy_bar) {
+        pcidriver_dummy_bar_set_cache(privdata, PCIDRIVER_MMAP_CACHE_WB);
+        free_pages((unsigned long)privdata->dummy_bar, get_order(PCIDRIVER_DUMMY_BAR_SIZE));
+    }
+#endif /* PCIDRIVER_DUMMY_DEVICE */
     kfree(privdata);
 probe_nomem:
     atomic_dec(&pcidriver_deviceCount);
@@ -251,6 +263,13 @@ static void __devexit pcidriver_remove(struct pci_dev *pdev)
     /* Removing the device from sysfs */
     device_destroy(pcidriver_class, privdata->devno);
 
+#ifdef PCIDRIVER_DUMMY_DEVICE
+    if (privdata->dummy_bar) {
+        pcidriver_dummy_bar_set_cache(privdata, PCIDRIVER_MMAP_CACHE_WB);
+        free_pages((unsigned long)privdata->dummy_bar, get_order(PCIDRIVER_DUMMY_BAR_SIZE));
+    }
+#endif /* PCIDRIVER_DUMMY_DEVICE */
+
     /* Releasing privdata */
     kfree(privdata);
 
@@ -31,6 +31,14 @@
 #endif
 
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3,13,0)
+    // hrtimer-based waits are introduced in 3.13, the timeout is rounded up to the jiffies otherwise
+# define wait_event_interruptible_hrtimeout(wq, condition, timeout) ({ \
+	long __ret = wait_event_interruptible_timeout(wq, condition, nsecs_to_jiffies(ktime_to_ns(timeout)) + 1); \
+	(__ret < 0)?__ret:((__ret)?0:-ETIME); \
+    })
+#endif
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,8,0)
 # define __devinit
 # define __devexit
@@ -31,5 +31,7 @@
 #define PCIE_IPECAMERA_DEVICE_ID 		0x6081
 #define PCIE_KAPTURE_DEVICE_ID 			0x6028
 
+/* Size of the RAM-backed BAR0 of the dummy device */
+#define PCIDRIVER_DUMMY_BAR_SIZE		0x100000
 
 #endif /* _PCIDRIVER_CONFIG_H */
@@ -21,6 +21,14 @@
 
 #include "base.h"
 
+#ifdef PCIDRIVER_DUMMY_DEVICE
+# if LINUX_VERSION_CODE >= KERNEL_VERSION(4,12,0)
+#  include <asm/set_memory.h>
+# else
+#  include <asm/cacheflush.h>
+# endif
+#endif /* PCIDRIVER_DUMMY_DEVICE */
+
 
 /**
  *
@@ -62,11 +70,104 @@ static int pcidriver_release(struct inode *inode, struct file *filp)
 
 /*************************************************************************/
 /* Internal driver functions */
-static int pcidriver_mmap_bar(pcidriver_privdata_t *privdata, struct vm_area_struct *vmap, int bar)
+
+/**
+ *
+ * Adjusts the page protection of the mapped BAR according to the requested caching mode.
+ *
+ */
+static int pcidriver_mmap_bar_prot(pcidriver_privdata_t *privdata, struct vm_area_struct *vmap, unsigned long bar_flags)
 {
+    switch (privdata->mmap_cache) {
+     case PCIDRIVER_MMAP_CACHE_DEFAULT:
+	/* IO regions are never cacheable */
+	if (bar_flags & IORESOURCE_IO)
+	    vmap->vm_page_prot = pgprot_noncached(vmap->vm_page_prot);
+
+	/* Otherwise, we keep the system defaults. Setting noncached disables MTRR
+	 * registers, and we want to use them. This can lead to caching problems if
+	 * and only if the System BIOS set something wrong. Check LDDv3, page 425.
+	 */
+	break;
+     case PCIDRIVER_MMAP_CACHE_UC:
+	vmap->vm_page_prot = pgprot_noncached(vmap->vm_page_prot);
+	break;
+     case PCIDRIVER_MMAP_CACHE_WC:
+	if (bar_flags & IORESOURCE_IO) {
+	    mod_info("Write-combining is not supported for IO regions\n");
+	    return -EINVAL;
+	}
+	vmap->vm_page_prot = pgprot_writecombine(vmap->vm_page_prot);
+	break;
+     case PCIDRIVER_MMAP_CACHE_WB:
+	/* Caching is only safe if reads have no side effects */
+	if ((bar_flags & IORESOURCE_IO)||(!(bar_flags & IORESOURCE_PREFETCH))) {
+	    mod_info("Write-back caching is only allowed for prefetchable memory regions\n");
+	    return -EINVAL;
+	}
+	/* vm_page_prot is cached by default for the RAM, for MMIO it is decided by PAT/MTRR */
+	break;
+     default:
+	return -EINVAL;
+    }
+
+    return 0;
+}
+
 #ifdef PCIDRIVER_DUMMY_DEVICE
-    return -ENXIO;
-#else /* PCIDRIVER_DUMMY_DEVICE */
+/**
+ *
+ * Changes the memory type of the RAM backing the dummy BAR0. With PAT, the memory type of RAM is
+ * tracked per page and remap_pfn_range() silently keeps it (write-back) if another caching is requested.
+ * The pages are switched to the requested mode instead, so the mappings with different caching modes
+ * should not coexist. The default mode is write-back.
+ *
+ */
+int pcidriver_dummy_bar_set_cache(pcidriver_privdata_t *privdata, int cache)
+{
+    int ret = 0;
+    unsigned long addr = (unsigned long)privdata->dummy_bar;
+    int pages = PCIDRIVER_DUMMY_BAR_SIZE >> PAGE_SHIFT;
+
+    if (cache == PCIDRIVER_MMAP_CACHE_DEFAULT)
+	cache = PCIDRIVER_MMAP_CACHE_WB;
+
+    if (privdata->dummy_bar_cache == cache)
+	return 0;
+
+#ifdef CONFIG_X86
+    /* The memory type can only be changed from write-back */
+    if (privdata->dummy_bar_cache != PCIDRIVER_MMAP_CACHE_WB) {
+	ret = set_memory_wb(addr, pages);
+	if (ret) goto fail;
+	privdata->dummy_bar_cache = PCIDRIVER_MMAP_CACHE_WB;
+    }
+
+    switch (cache) {
+     case PCIDRIVER_MMAP_CACHE_UC:
+	ret = set_memory_uc(addr, pages);
+	break;
+     case PCIDRIVER_MMAP_CACHE_WC:
+	ret = set_memory_wc(addr, pages);
+	break;
+    }
+#else /* CONFIG_X86 */
+    ret = -EINVAL;
+#endif /* CONFIG_X86 */
+
+    if (ret) goto fail;
+
+    privdata->dummy_bar_cache = cache;
+    return 0;
+
+fail:
+    mod_info("Failed to change caching mode of the emulated BAR0\n");
+    return ret;
+}
+#endif /* PCIDRIVER_DUMMY_DEVICE */
+
+static int pcidriver_mmap_bar(pcidriver_privdata_t *privdata, struct vm_area_struct *vmap, int bar)
+{
     int ret = 0;
     unsigned long bar_addr;
     unsigned long bar_length, vma_size;
@@ -74,11 +175,20 @@ static int pcidriver_mmap_bar(pcidriver_privdata_t *privdata, struct vm_area_str
 
     mod_info_dbg("Entering mmap_pci\n");
 
+#ifdef PCIDRIVER_DUMMY_DEVICE
+    /* Only BAR0 is emulated, it is backed by RAM */
+    if ((bar != 0)||(!privdata->dummy_bar))
+	return -ENXIO;
 
+    bar_addr = virt_to_phys(privdata->dummy_bar);
+    bar_length = PCIDRIVER_DUMMY_BAR_SIZE;
+    bar_flags = IORESOURCE_MEM | IORESOURCE_PREFETCH;
+#else /* PCIDRIVER_DUMMY_DEVICE */
     /* Get info of the BAR to be mapped */
     bar_addr = pci_resource_start(privdata->pdev, bar);
     bar_length = pci_resource_len(privdata->pdev, bar);
     bar_flags = pci_resource_flags(privdata->pdev, bar);
+#endif /* PCIDRIVER_DUMMY_DEVICE */
 
     /* Check sizes */
     vma_size = (vmap->vm_end - vmap->vm_start);
@@ -89,32 +199,19 @@ static int pcidriver_mmap_bar(pcidriver_privdata_t *privdata, struct vm_area_str
         return -EINVAL;
     }
 
-    if (bar_flags & IORESOURCE_IO) {
-        /* Unlikely case, we will mmap a IO region */
+    ret = pcidriver_mmap_bar_prot(privdata, vmap, bar_flags);
+    if (ret) return ret;
 
-        /* IO regions are never cacheable */
-        vmap->vm_page_prot = pgprot_noncached(vmap->vm_page_prot);
+#ifdef PCIDRIVER_DUMMY_DEVICE
+    ret = pcidriver_dummy_bar_set_cache(privdata, privdata->mmap_cache);
+    if (ret) return ret;
+#endif /* PCIDRIVER_DUMMY_DEVICE */
 
-        /* Map the BAR */
+    if (bar_flags & IORESOURCE_IO) {
+        /* Unlikely case, we will mmap a IO region */
         ret = io_remap_pfn_range(vmap, vmap->vm_start, (bar_addr >> PAGE_SHIFT), bar_length, vmap->vm_page_prot);
     } else {
         /* Normal case, mmap a memory region */
-
-        /* Ensure this VMA is non-cached, if it is not flaged as prefetchable.
-         * If it is prefetchable, caching is allowed and will give better performance.
-         * This should be set properly by the BIOS, but we want to be sure. */
-        /* adapted from drivers/char/mem.c, mmap function. */
-
-        /* Setting noncached disables MTRR registers, and we want to use them.
-         * So we take this code out. This can lead to caching problems if and only if
-         * the System BIOS set something wrong. Check LDDv3, page 425.
-         */
-
-//                if (!(bar_flags & IORESOURCE_PREFETCH))
-//			vmap->vm_page_prot = pgprot_noncached(vmap->vm_page_prot);
-
-
-        /* Map the BAR */
         ret = remap_pfn_range(vmap, vmap->vm_start, (bar_addr >> PAGE_SHIFT), bar_length, vmap->vm_page_prot);
     }
 
@@ -124,7 +221,6 @@ static int pcidriver_mmap_bar(pcidriver_privdata_t *privdata, struct vm_area_str
     }
 
     return 0;	/* success */
-#endif /* PCIDRIVER_DUMMY_DEVICE */
 }
 
 
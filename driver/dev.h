@@ -16,6 +16,11 @@ struct pcidriver_privdata_s {
     struct cdev cdev;				/* char device struct */
     int mmap_mode;				/* current mmap mode */
     int mmap_area;				/* current PCI mmap area */
+    int mmap_cache;				/* caching of the mmaped PCI area, PCIDRIVER_MMAP_CACHE_XXX */
+#ifdef PCIDRIVER_DUMMY_DEVICE
+    void *dummy_bar;				/* RAM backing the BAR0 of the dummy device */
+    int dummy_bar_cache;			/* caching currently set for the pages of dummy BAR0, PCIDRIVER_MMAP_CACHE_XXX */
+#endif /* PCIDRIVER_DUMMY_DEVICE */
 
 #ifdef ENABLE_IRQ
     int irq_enabled;				/* Non-zero if IRQ is enabled */
@@ -23,6 +28,7 @@ struct pcidriver_privdata_s {
 
     wait_queue_head_t irq_queues[ PCIDRIVER_INT_MAXSOURCES ];       /* One queue per interrupt source */
     atomic_t irq_outstanding[ PCIDRIVER_INT_MAXSOURCES ];           /* Outstanding interrupts per queue */
+    atomic64_t irq_timestamp[ PCIDRIVER_INT_MAXSOURCES ];           /* Time of the last interrupt per queue (ns, monotonic) */
     volatile unsigned int *bars_kmapped[6];		            /* PCI BARs mmapped in kernel space */
 #endif
 
@@ -48,5 +54,9 @@ void pcidriver_module_put(pcidriver_privdata_t *privdata);
 
 long pcidriver_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
 
+#ifdef PCIDRIVER_DUMMY_DEVICE
+int pcidriver_dummy_bar_set_cache(pcidriver_privdata_t *privdata, int cache);
+#endif /* PCIDRIVER_DUMMY_DEVICE */
+
 #endif /* _PCIDRIVER_DEV_H */
 
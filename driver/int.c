@@ -16,6 +16,7 @@
 #include <linux/cdev.h>
 #include <linux/wait.h>
 #include <linux/sched.h>
+#include <linux/ktime.h>
 //#include <stdbool.h>
 
 #include "base.h"
@@ -34,6 +35,7 @@ static bool pcidriver_irq_acknowledge(pcidriver_privdata_t *privdata)
 {
     int channel = 0;
 
+    atomic64_set(&(privdata->irq_timestamp[channel]), ktime_to_ns(ktime_get()));
     atomic_inc(&(privdata->irq_outstanding[channel]));
     wake_up_interruptible(&(privdata->irq_queues[channel]));
 
@@ -118,6 +120,7 @@ int pcidriver_probe_irq(pcidriver_privdata_t *privdata)
     for (i = 0; i < PCIDRIVER_INT_MAXSOURCES; i++) {
         init_waitqueue_head(&(privdata->irq_queues[i]));
         atomic_set(&(privdata->irq_outstanding[i]), 0);
+        atomic64_set(&(privdata->irq_timestamp[i]), 0);
     }
 
     /* Initialize the irq config */
@@ -28,6 +28,7 @@
 #include <linux/interrupt.h>
 #include <linux/wait.h>
 #include <linux/sched.h>
+#include <linux/hrtimer.h>
 #include <linux/iommu.h>
 
 #include "pcilib/version.h"
@@ -49,16 +50,28 @@
  *
  * Sets the mmap mode for following mmap() calls.
  *
- * @param arg Not a pointer, but either PCIDRIVER_MMAP_PCI or PCIDRIVER_MMAP_KMEM
+ * @param arg Not a pointer, but either PCIDRIVER_MMAP_PCI or PCIDRIVER_MMAP_KMEM. The caching
+ * of PCI BARs is optionally specified with PCIDRIVER_MMAP_CACHE_XXX << PCIDRIVER_MMAP_CACHE_SHIFT
  *
  */
 static int ioctl_mmap_mode(pcidriver_privdata_t *privdata, unsigned long arg)
 {
-    if ((arg != PCIDRIVER_MMAP_PCI) && (arg != PCIDRIVER_MMAP_KMEM) && (arg != PCIDRIVER_MMAP_AREA))
+    unsigned long mode = arg & PCIDRIVER_MMAP_MODE_MASK;
+    unsigned long cache = PCIDRIVER_MMAP_CACHE(arg);
+
+    if ((mode != PCIDRIVER_MMAP_PCI) && (mode != PCIDRIVER_MMAP_KMEM) && (mode != PCIDRIVER_MMAP_AREA))
+        return -EINVAL;
+
+    if (arg & ~(PCIDRIVER_MMAP_MODE_MASK | (0xF << PCIDRIVER_MMAP_CACHE_SHIFT)))
+        return -EINVAL;
+
+    /* caching is only configurable for the PCI BARs */
+    if ((cache > PCIDRIVER_MMAP_CACHE_WB) || ((cache != PCIDRIVER_MMAP_CACHE_DEFAULT) && (mode != PCIDRIVER_MMAP_PCI)))
         return -EINVAL;
 
     /* change the mode */
-    privdata->mmap_mode = arg;
+    privdata->mmap_mode = mode;
+    privdata->mmap_cache = cache;
 
     return 0;
 }
@@ -138,6 +151,14 @@ static int ioctl_pci_info(pcidriver_privdata_t *privdata, unsigned long arg)
 #ifdef PCIDRIVER_DUMMY_DEVICE
     READ_FROM_USER(pcilib_board_info_t, pci_info);
     memset(&pci_info, 0, sizeof(pci_info));
+
+    /* BAR0 is backed by RAM, so it is prefetchable */
+    if (privdata->dummy_bar) {
+        pci_info.bar_start[0] = virt_to_phys(privdata->dummy_bar);
+        pci_info.bar_length[0] = PCIDRIVER_DUMMY_BAR_SIZE;
+        pci_info.bar_flags[0] = IORESOURCE_MEM | IORESOURCE_PREFETCH;
+    }
+
     WRITE_TO_USER(pcilib_board_info_t, pci_info);
 #else /* PCIDRIVER_DUMMY_DEVICE */
     int bar;
@@ -335,7 +356,7 @@ static int ioctl_wait_interrupt(pcidriver_privdata_t *privdata, unsigned long ar
 {
 #ifdef ENABLE_IRQ
     int ret;
-    unsigned long timeout;
+    ktime_t timeout;
     unsigned int irq_source;
     unsigned long temp = 0;
 
@@ -346,27 +367,29 @@ static int ioctl_wait_interrupt(pcidriver_privdata_t *privdata, unsigned long ar
     if (irq_source >= PCIDRIVER_INT_MAXSOURCES)
         return -EFAULT;						/* User tried to overrun the IRQ_SOURCES array */
 
-    timeout = jiffies + (irq_handle.timeout * HZ / 1000000);
+    if ((irq_handle.timeout == (unsigned long)-1) || (irq_handle.timeout > KTIME_MAX / NSEC_PER_USEC))
+        timeout = ns_to_ktime(KTIME_MAX);			/* Infinite wait */
+    else
+        timeout = ns_to_ktime((u64)irq_handle.timeout * NSEC_PER_USEC);
 
-    /* Thanks to Joern for the correction and tips! */
-    /* done this way to avoid wrong behaviour (endless loop) of the compiler in AMD platforms */
-    do {
-        /* We wait here with an interruptible timeout. This will be interrupted
-                 * by int.c:check_acknowledge_channel() as soon as in interrupt for
-                 * the specified source arrives. */
-        wait_event_interruptible_timeout( (privdata->irq_queues[irq_source]), (atomic_read(&(privdata->irq_outstanding[irq_source])) > 0), (10*HZ/1000) );
+    /* We wait here with an exact hrtimer-based timeout. This will be interrupted
+     * by int.c:pcidriver_irq_acknowledge() as soon as an interrupt for the specified
+     * source arrives. If interrupted by a signal, we report the interrupts received
+     * so far (if any) as in the case of timeout. Zero timeout only checks the queue. */
+    if (irq_handle.timeout)
+        wait_event_interruptible_hrtimeout( (privdata->irq_queues[irq_source]), (atomic_read(&(privdata->irq_outstanding[irq_source])) > 0), timeout );
 
-        if (atomic_add_negative( -1, &(privdata->irq_outstanding[irq_source])) )
-            atomic_inc( &(privdata->irq_outstanding[irq_source]) );
-        else
-            temp = 1;
-    } while ((!temp)&&(jiffies < timeout));
+    if (atomic_add_negative( -1, &(privdata->irq_outstanding[irq_source])) )
+        atomic_inc( &(privdata->irq_outstanding[irq_source]) );
+    else
+        temp = 1;
 
     if ((temp)&&(irq_handle.count)) {
         while (!atomic_add_negative( -1, &(privdata->irq_outstanding[irq_source]))) temp++;
         atomic_inc( &(privdata->irq_outstanding[irq_source]) );
     }
 
+    irq_handle.timestamp = temp?atomic64_read(&(privdata->irq_timestamp[irq_source])):0;
     irq_handle.count = temp;
 
     WRITE_TO_USER(interrupt_wait_t, irq_handle);
@@ -3,7 +3,7 @@
 
 #include <linux/ioctl.h>
 
-#define PCIDRIVER_INTERFACE_VERSION     2                               /**< Driver API version, only the pcilib with the same driver interface version is allowed */
+#define PCIDRIVER_INTERFACE_VERSION     3                               /**< Driver API version, only the pcilib with the same driver interface version is allowed */
 
 /* Possible values for ioctl commands */
 
@@ -19,6 +19,15 @@
 #define PCIDRIVER_MMAP_PCI		0
 #define PCIDRIVER_MMAP_KMEM 		1
 #define PCIDRIVER_MMAP_AREA		2
+#define PCIDRIVER_MMAP_MODE_MASK	0xFF
+
+/* Caching of the mmaped PCI BARs, passed in the bits 8-11 of mmap mode */
+#define PCIDRIVER_MMAP_CACHE_SHIFT	8
+#define PCIDRIVER_MMAP_CACHE_DEFAULT	0	/* As configured by MTRR/PAT for the BAR */
+#define PCIDRIVER_MMAP_CACHE_UC		1	/* Uncached */
+#define PCIDRIVER_MMAP_CACHE_WC		2	/* Write-combining, only for memory BARs */
+#define PCIDRIVER_MMAP_CACHE_WB		3	/* Write-back, only for prefetchable BARs */
+#define PCIDRIVER_MMAP_CACHE(mode)	(((mode) >> PCIDRIVER_MMAP_CACHE_SHIFT) & 0xF)
 
 /* Direction of a DMA operation */
 #define PCIDRIVER_DMA_BIDIRECTIONAL	0
@@ -125,6 +134,7 @@ typedef struct {
     unsigned long count;
     unsigned long timeout;	// microseconds
     unsigned int source;
+    unsigned long long timestamp; // nanoseconds, CLOCK_MONOTONIC time of the last received interrupt
 } interrupt_wait_t;
 
 typedef struct {
@@ -71,8 +71,10 @@ static SYSFS_SET_FUNCTION(pcidriver_store_mmap_mode)
 
     /* Set the mmap-mode if it is either PCIDRIVER_MMAP_PCI or PCIDRIVER_MMAP_KMEM */
     if (sscanf(buf, "%d", &mode) == 1 &&
-            (mode == PCIDRIVER_MMAP_PCI || mode == PCIDRIVER_MMAP_KMEM))
+            (mode == PCIDRIVER_MMAP_PCI || mode == PCIDRIVER_MMAP_KMEM)) {
         privdata->mmap_mode = mode;
+        privdata->mmap_cache = PCIDRIVER_MMAP_CACHE_DEFAULT;
+    }
 
     return strlen(buf);
 }
@@ -0,0 +1,471 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "pci.h"
+#include "error.h"
+#include "timing.h"
+#include "aggregate.h"
+
+/*
+ * The queue is a ring of fixed size blocks. The readers reserve the blocks at the tail under the mutex,
+ * so the order of blocks in the ring defines the order of the merged stream. The data is copied into the
+ * reserved block without holding the mutex and the block is marked ready afterwards. The streaming thread
+ * delivers the blocks from the head of the ring as soon as they are ready.
+ */
+
+#define PCILIB_AGGREGATE_QUEUE_SIZE	1024		/**< default number of blocks in the queue */
+#define PCILIB_AGGREGATE_BLOCK_SIZE	65536		/**< default size of the queue blocks */
+
+typedef struct {
+    pcilib_aggregate_t *agg;			/**< aggregate stream */
+    size_t id;					/**< index of the source */
+    pcilib_t *ctx;				/**< pcilib context */
+    pcilib_dma_engine_t dma;			/**< DMA engine */
+
+    pthread_t thread;				/**< reader thread */
+    int running;				/**< indicates that the reader thread is running */
+    int error;					/**< error terminating the reader */
+
+    size_t seqnum;				/**< sequence number of the next block of the source */
+    size_t queued;				/**< number of blocks of the source in the queue */
+    size_t max_queued;				/**< maximal number of blocks of the source in the queue */
+    size_t blocks;				/**< number of delivered blocks */
+    size_t bytes;				/**< number of delivered bytes */
+    size_t dropped_blocks;			/**< number of dropped blocks */
+    size_t dropped_bytes;			/**< number of dropped bytes */
+    size_t stalls;				/**< number of waits for the free space in the queue */
+    pcilib_time_t stall_time;			/**< total time of waits for the free space in the queue (ns) */
+} pcilib_aggregate_source_t;
+
+typedef struct {
+    pcilib_aggregate_block_t block;		/**< block description */
+    pcilib_aggregate_source_t *source;		/**< source of the block */
+    int ready;					/**< indicates that the data is copied */
+} pcilib_aggregate_slot_t;
+
+struct pcilib_aggregate_s {
+    pcilib_aggregate_flags_t flags;		/**< flags */
+    size_t queue_size;				/**< number of blocks in the queue */
+    size_t block_size;				/**< size of the blocks */
+
+    size_t num_sources;				/**< number of sources */
+    pcilib_aggregate_source_t **sources;	/**< sources */
+
+    void *buffer;				/**< memory of the queue blocks */
+    pcilib_aggregate_slot_t *slots;		/**< queue */
+    size_t head;				/**< next block to deliver */
+    size_t tail;				/**< next block to reserve */
+    size_t queued;				/**< number of reserved blocks */
+    size_t max_queued;				/**< maximal number of reserved blocks */
+    size_t seqnum;				/**< sequence number of the next block */
+
+    int streaming;				/**< indicates that pcilib_aggregate_stream() is running */
+    int run_flag;				/**< cleared to stop the readers and the streaming */
+    size_t running;				/**< number of running readers */
+    pcilib_time_t start;			/**< start of the streaming */
+    pcilib_time_t end;				/**< end of the streaming, 0 while streaming */
+
+    pthread_mutex_t mutex;			/**< protects the queue, the statistics, and the flags */
+    pthread_cond_t data_cond;			/**< signaled when the block is ready or reader is terminated */
+    pthread_cond_t space_cond;			/**< signaled when the block is released */
+};
+
+static inline void pcilib_aggregate_deadline(struct timespec *ts, pcilib_time_t deadline) {
+    ts->tv_sec = deadline / 1000000000ull;
+    ts->tv_nsec = deadline % 1000000000ull;
+}
+
+pcilib_aggregate_t *pcilib_aggregate_create(size_t queue_size, size_t block_size, pcilib_aggregate_flags_t flags) {
+    pthread_condattr_t cattr;
+    pcilib_aggregate_t *agg;
+
+    if (!queue_size) queue_size = PCILIB_AGGREGATE_QUEUE_SIZE;
+    if (!block_size) block_size = PCILIB_AGGREGATE_BLOCK_SIZE;
+
+    agg = (pcilib_aggregate_t*)malloc(sizeof(pcilib_aggregate_t));
+    if (!agg) {
+	pcilib_error("Error allocating memory for aggregate stream");
+	return NULL;
+    }
+
+    memset(agg, 0, sizeof(pcilib_aggregate_t));
+    agg->flags = flags;
+    agg->queue_size = queue_size;
+    agg->block_size = block_size;
+
+    agg->slots = (pcilib_aggregate_slot_t*)calloc(queue_size, sizeof(pcilib_aggregate_slot_t));
+    if ((!agg->slots)||(posix_memalign(&agg->buffer, pcilib_get_page_mask() + 1, queue_size * block_size))) {
+	pcilib_error("Error allocating %zu blocks of %zu bytes for the queue of aggregate stream", queue_size, block_size);
+	if (agg->slots) free(agg->slots);
+	free(agg);
+	return NULL;
+    }
+
+    pthread_mutex_init(&agg->mutex, NULL);
+
+	// Timed waits are using the same monotonic clock as pcilib_time_ns()
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&agg->data_cond, &cattr);
+    pthread_cond_init(&agg->space_cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
+    return agg;
+}
+
+void pcilib_aggregate_destroy(pcilib_aggregate_t *agg) {
+    size_t i;
+
+    if (!agg) return;
+
+    if (agg->streaming) {
+	pcilib_error("The aggregate stream is destroyed while streaming");
+	return;
+    }
+
+    for (i = 0; i < agg->num_sources; i++)
+	free(agg->sources[i]);
+
+    if (agg->sources) free(agg->sources);
+
+    pthread_cond_destroy(&agg->space_cond);
+    pthread_cond_destroy(&agg->data_cond);
+    pthread_mutex_destroy(&agg->mutex);
+
+    free(agg->buffer);
+    free(agg->slots);
+    free(agg);
+}
+
+int pcilib_aggregate_add_source(pcilib_aggregate_t *agg, pcilib_t *ctx, pcilib_dma_engine_t dma, size_t *source) {
+    pcilib_aggregate_source_t *src, **sources;
+    const pcilib_dma_description_t *info = pcilib_get_dma_description(ctx);
+
+    if ((!info)||(dma == PCILIB_DMA_ENGINE_INVALID)||(dma >= ctx->num_engines)) {
+	pcilib_error("Invalid DMA engine (%lu) is specified", dma);
+	return PCILIB_ERROR_INVALID_ARGUMENT;
+    }
+
+    if ((info->engines[dma].direction&PCILIB_DMA_FROM_DEVICE) == 0) {
+	pcilib_error("The DMA engine (%lu) is not able to read data", dma);
+	return PCILIB_ERROR_NOTSUPPORTED;
+    }
+
+    if (agg->streaming) {
+	pcilib_error("The sources can't be added to the aggregate stream while streaming");
+	return PCILIB_ERROR_BUSY;
+    }
+
+    sources = (pcilib_aggregate_source_t**)realloc(agg->sources, (agg->num_sources + 1) * sizeof(pcilib_aggregate_source_t*));
+    if (!sources) return PCILIB_ERROR_MEMORY;
+    agg->sources = sources;
+
+    src = (pcilib_aggregate_source_t*)malloc(sizeof(pcilib_aggregate_source_t));
+    if (!src) return PCILIB_ERROR_MEMORY;
+
+    memset(src, 0, sizeof(pcilib_aggregate_source_t));
+    src->agg = agg;
+    src->id = agg->num_sources;
+    src->ctx = ctx;
+    src->dma = dma;
+
+    agg->sources[agg->num_sources++] = src;
+
+    if (source) *source = src->id;
+
+    return 0;
+}
+
+    // Reserves the block at the tail of the queue, returns NULL if the block is dropped or streaming is stopped
+static pcilib_aggregate_slot_t *pcilib_aggregate_reserve(pcilib_aggregate_source_t *src, pcilib_dma_flags_t flags, size_t size) {
+    pcilib_time_t stall_start = 0;
+    pcilib_aggregate_slot_t *slot;
+    pcilib_aggregate_t *agg = src->agg;
+
+    pthread_mutex_lock(&agg->mutex);
+    if ((agg->flags&PCILIB_AGGREGATE_FLAG_DROP) == 0) {
+	while ((agg->queued == agg->queue_size)&&(agg->run_flag)) {
+	    if (!stall_start) {
+		stall_start = pcilib_time_ns();
+		src->stalls++;
+	    }
+	    pthread_cond_wait(&agg->space_cond, &agg->mutex);
+	}
+	if (stall_start) src->stall_time += pcilib_time_ns() - stall_start;
+    }
+
+    if (!agg->run_flag) {
+	pthread_mutex_unlock(&agg->mutex);
+	return NULL;
+    }
+
+    if (agg->queued == agg->queue_size) {
+	src->seqnum++;
+	src->dropped_blocks++;
+	src->dropped_bytes += size;
+	pthread_mutex_unlock(&agg->mutex);
+	return NULL;
+    }
+
+    slot = agg->slots + agg->tail;
+    slot->source = src;
+    slot->ready = 0;
+    slot->block.source = src->id;
+    slot->block.seqnum = agg->seqnum++;
+    slot->block.source_seqnum = src->seqnum++;
+    slot->block.timestamp = pcilib_time_ns();
+    slot->block.flags = flags;
+    slot->block.size = size;
+    slot->block.data = agg->buffer + agg->tail * agg->block_size;
+
+    if (++agg->tail == agg->queue_size) agg->tail = 0;
+    if (++agg->queued > agg->max_queued) agg->max_queued = agg->queued;
+    if (++src->queued > src->max_queued) src->max_queued = src->queued;
+    pthread_mutex_unlock(&agg->mutex);
+
+    return slot;
+}
+
+static int pcilib_aggregate_dma_callback(void *arg, pcilib_dma_flags_t flags, size_t bufsize, void *buf) {
+    size_t pos, size;
+    pcilib_aggregate_slot_t *slot;
+    pcilib_aggregate_source_t *src = (pcilib_aggregate_source_t*)arg;
+    pcilib_aggregate_t *agg = src->agg;
+
+    for (pos = 0; pos < bufsize; pos += size) {
+	size = bufsize - pos;
+	if (size > agg->block_size) size = agg->block_size;
+
+	slot = pcilib_aggregate_reserve(src, ((pos + size) < bufsize)?(flags&~PCILIB_DMA_FLAG_EOP):flags, size);
+	if (!slot) continue;
+
+	memcpy(slot->block.data, buf + pos, size);
+
+	pthread_mutex_lock(&agg->mutex);
+	slot->ready = 1;
+	pthread_cond_signal(&agg->data_cond);
+	pthread_mutex_unlock(&agg->mutex);
+    }
+
+    return __atomic_load_n(&agg->run_flag, __ATOMIC_ACQUIRE)?PCILIB_STREAMING_CONTINUE:PCILIB_STREAMING_STOP;
+}
+
+static void *pcilib_aggregate_reader(void *arg) {
+    int err;
+    pcilib_dma_session_t *session;
+    pcilib_aggregate_source_t *src = (pcilib_aggregate_source_t*)arg;
+    pcilib_aggregate_t *agg = src->agg;
+
+	// The session should be closed by the thread which has opened it
+    session = pcilib_open_dma_session(src->ctx, src->dma, PCILIB_DMA_FROM_DEVICE, PCILIB_DMA_FLAGS_DEFAULT);
+    if (session) {
+	do {
+		// Returns after PCILIB_DMA_TIMEOUT if no data is coming, so the run flag is re-checked regularly
+	    err = pcilib_session_stream_dma(session, 0, 0, PCILIB_DMA_FLAGS_DEFAULT, PCILIB_DMA_TIMEOUT, pcilib_aggregate_dma_callback, src);
+	    if (err == PCILIB_ERROR_TIMEOUT) err = 0;
+	} while ((!err)&&(__atomic_load_n(&agg->run_flag, __ATOMIC_ACQUIRE)));
+
+	pcilib_close_dma_session(session);
+    } else {
+	err = PCILIB_ERROR_FAILED;
+    }
+
+    if (err) pcilib_error("Error (%i) reading DMA engine %lu of aggregate source %zu", err, src->dma, src->id);
+
+    pthread_mutex_lock(&agg->mutex);
+    src->error = err;
+    agg->running--;
+    pthread_cond_broadcast(&agg->data_cond);
+    pthread_mutex_unlock(&agg->mutex);
+
+    return NULL;
+}
+
+static void pcilib_aggregate_reset(pcilib_aggregate_t *agg) {
+    size_t i;
+    pcilib_aggregate_source_t *src;
+
+    agg->head = 0;
+    agg->tail = 0;
+    agg->queued = 0;
+    agg->max_queued = 0;
+    agg->seqnum = 0;
+
+    for (i = 0; i < agg->num_sources; i++) {
+	src = agg->sources[i];
+	src->error = 0;
+	src->seqnum = 0;
+	src->queued = 0;
+	src->max_queued = 0;
+	src->blocks = 0;
+	src->bytes = 0;
+	src->dropped_blocks = 0;
+	src->dropped_bytes = 0;
+	src->stalls = 0;
+	src->stall_time = 0;
+    }
+}
+
+int pcilib_aggregate_stream(pcilib_aggregate_t *agg, pcilib_timeout_t duration, pcilib_timeout_t timeout, pcilib_aggregate_callback_t cb, void *user) {
+    int err = 0, ret;
+    size_t i, delivered = 0;
+    pcilib_time_t stop_time = 0, idle_time = 0, deadline;
+    struct timespec ts;
+    pcilib_aggregate_slot_t *slot;
+    pcilib_aggregate_source_t *src;
+
+    if (!agg->num_sources) {
+	pcilib_error("No sources are added to the aggregate stream");
+	return PCILIB_ERROR_INVALID_REQUEST;
+    }
+
+    pthread_mutex_lock(&agg->mutex);
+    if (agg->streaming) {
+	pthread_mutex_unlock(&agg->mutex);
+	pcilib_error("The aggregate stream is already streaming");
+	return PCILIB_ERROR_BUSY;
+    }
+
+    pcilib_aggregate_reset(agg);
+    agg->streaming = 1;
+    agg->run_flag = 1;
+    agg->running = 0;
+    agg->start = pcilib_time_ns();
+    agg->end = 0;
+
+    for (i = 0; i < agg->num_sources; i++) {
+	src = agg->sources[i];
+	src->running = !pthread_create(&src->thread, NULL, pcilib_aggregate_reader, src);
+	if (!src->running) {
+	    pcilib_error("Error starting the reader thread of aggregate source %zu", i);
+	    err = PCILIB_ERROR_FAILED;
+	    break;
+	}
+	agg->running++;
+    }
+
+    if (duration != PCILIB_TIMEOUT_INFINITE) stop_time = agg->start + 1000ull * duration;
+    if (timeout != PCILIB_TIMEOUT_INFINITE) idle_time = agg->start + 1000ull * timeout;
+
+    while (!err) {
+	    // Waiting until the block at the head of the queue is ready
+	while ((agg->run_flag)&&((!agg->queued)||(!agg->slots[agg->head].ready))) {
+	    if ((!agg->running)&&(!agg->queued)) break;
+
+	    deadline = idle_time;
+	    if ((stop_time)&&((!deadline)||(stop_time < deadline))) deadline = stop_time;
+
+	    if (deadline) {
+		pcilib_aggregate_deadline(&ts, deadline);
+		if (pthread_cond_timedwait(&agg->data_cond, &agg->mutex, &ts) == ETIMEDOUT) break;
+	    } else {
+		pthread_cond_wait(&agg->data_cond, &agg->mutex);
+	    }
+	}
+
+	if ((!agg->run_flag)||(!agg->queued)||(!agg->slots[agg->head].ready)) break;
+
+	slot = agg->slots + agg->head;
+	pthread_mutex_unlock(&agg->mutex);
+
+	ret = cb(&slot->block, user);
+
+	pthread_mutex_lock(&agg->mutex);
+	src = slot->source;
+	src->blocks++;
+	src->bytes += slot->block.size;
+	src->queued--;
+	agg->queued--;
+	if (++agg->head == agg->queue_size) agg->head = 0;
+	pthread_cond_signal(&agg->space_cond);
+
+	delivered++;
+	if (ret < 0) err = -ret;
+	if (ret <= 0) break;
+
+	    // The queue may be never empty if the data is coming faster than processed
+	deadline = pcilib_time_ns();
+	if ((stop_time)&&(deadline >= stop_time)) break;
+	if (idle_time) idle_time = deadline + 1000ull * timeout;
+    }
+
+    agg->run_flag = 0;
+    agg->end = pcilib_time_ns();
+    pthread_cond_broadcast(&agg->space_cond);
+    pthread_mutex_unlock(&agg->mutex);
+
+    for (i = 0; i < agg->num_sources; i++) {
+	src = agg->sources[i];
+	if (!src->running) continue;
+
+	pthread_join(src->thread, NULL);
+	src->running = 0;
+
+	    // Reporting the reader failure if the data is not coming at all
+	if ((!err)&&(!delivered)) err = src->error;
+    }
+
+    pthread_mutex_lock(&agg->mutex);
+    agg->streaming = 0;
+    pthread_mutex_unlock(&agg->mutex);
+
+    if ((!err)&&(!delivered)) err = PCILIB_ERROR_TIMEOUT;
+
+    return err;
+}
+
+void pcilib_aggregate_stop(pcilib_aggregate_t *agg) {
+    pthread_mutex_lock(&agg->mutex);
+    agg->run_flag = 0;
+    pthread_cond_broadcast(&agg->data_cond);
+    pthread_cond_broadcast(&agg->space_cond);
+    pthread_mutex_unlock(&agg->mutex);
+}
+
+int pcilib_aggregate_get_stats(pcilib_aggregate_t *agg, size_t source, pcilib_aggregate_stats_t *stats) {
+    size_t i;
+    pcilib_time_t end, stall_time = 0;
+    pcilib_aggregate_source_t *src;
+
+    if ((source != PCILIB_AGGREGATE_ALL)&&(source >= agg->num_sources)) {
+	pcilib_error("Invalid aggregate source (%zu) is specified", source);
+	return PCILIB_ERROR_INVALID_ARGUMENT;
+    }
+
+    memset(stats, 0, sizeof(pcilib_aggregate_stats_t));
+
+    pthread_mutex_lock(&agg->mutex);
+    for (i = 0; i < agg->num_sources; i++) {
+	if ((source != PCILIB_AGGREGATE_ALL)&&(source != i)) continue;
+
+	src = agg->sources[i];
+	stats->blocks += src->blocks;
+	stats->bytes += src->bytes;
+	stats->dropped_blocks += src->dropped_blocks;
+	stats->dropped_bytes += src->dropped_bytes;
+	stats->stalls += src->stalls;
+	stall_time += src->stall_time;
+	if (src->max_queued > stats->max_queued) stats->max_queued = src->max_queued;
+	if (!stats->error) stats->error = src->error;
+    }
+
+    if (source == PCILIB_AGGREGATE_ALL) stats->max_queued = agg->max_queued;
+
+    if (agg->start) {
+	end = agg->end?agg->end:pcilib_time_ns();
+	stats->run_time = (end - agg->start) / 1000;
+    }
+    pthread_mutex_unlock(&agg->mutex);
+
+    stats->stall_time = stall_time / 1000;
+    if (stats->run_time) stats->throughput = 1. * stats->bytes / stats->run_time;
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file aggregate.h
+ * @brief Merging DMA streams of multiple devices into a single stream
+ *
+ * @details The aggregate stream reads the DMA engines of several devices (or several engines of the same
+ * device) and delivers all data to a single callback. Each source is read by a dedicated thread using
+ * a DMA session (see pcilib_open_dma_session()). The readers copy the data into a shared queue of fixed
+ * size blocks and the blocks are passed to the callback by the streaming thread in the order they were
+ * read. Each block is tagged with the index of its source and with the sequence numbers in the merged
+ * stream and in the stream of the source.
+ *
+ * If the callback is slower than the sources, the queue fills up. By default, the readers wait until a
+ * space is freed in the queue, so the back pressure is propagated to the DMA engines. Alternatively, the
+ * readers may drop the data to keep the DMA engines running (#PCILIB_AGGREGATE_FLAG_DROP). In this case,
+ * the dropped blocks are indicated by gaps in the sequence numbers of the source. The number of delivered
+ * and dropped blocks, as well as the time the readers have waited for the queue, are tracked per source.
+ */
+
+#ifndef _PCILIB_AGGREGATE_H
+#define _PCILIB_AGGREGATE_H
+
+#include <pcilib.h>
+#include <pcilib/timing.h>
+
+#define PCILIB_AGGREGATE_ALL ((size_t)-1)	/**< Requests statistics summed over all sources */
+
+typedef struct pcilib_aggregate_s pcilib_aggregate_t;
+
+typedef enum {
+    PCILIB_AGGREGATE_FLAGS_DEFAULT = 0,
+    PCILIB_AGGREGATE_FLAG_DROP = 1		/**< Drop the data if the queue is full instead of stalling the readers */
+} pcilib_aggregate_flags_t;
+
+typedef struct {
+    size_t source;				/**< Index of the source as returned by pcilib_aggregate_add_source() */
+    size_t seqnum;				/**< Position of the block in the merged stream */
+    size_t source_seqnum;			/**< Position of the block in the stream of the source, the dropped blocks are counted as well */
+    pcilib_time_t timestamp;			/**< Time the block was read from DMA engine (monotonic clock, see pcilib_time_ns()) */
+    pcilib_dma_flags_t flags;			/**< #PCILIB_DMA_FLAG_EOP is set on the last block of DMA packet */
+    size_t size;				/**< Size of the data in bytes */
+    void *data;					/**< The data, only valid until the callback returns */
+} pcilib_aggregate_block_t;
+
+/**
+ * Callback function called for each block of the merged stream
+ * @param[in] block	- the block description and data
+ * @param[in,out] user	- user-specific data provided in pcilib_aggregate_stream() call
+ * @return		- #PCILIB_STREAMING_STOP to stop streaming, a negative error code to stop with error, any positive value to continue
+ */
+typedef int (*pcilib_aggregate_callback_t)(const pcilib_aggregate_block_t *block, void *user);
+
+typedef struct {
+    size_t blocks;				/**< Number of blocks passed to the callback */
+    size_t bytes;				/**< Number of bytes passed to the callback */
+    size_t dropped_blocks;			/**< Number of blocks dropped because the queue was full */
+    size_t dropped_bytes;			/**< Number of bytes dropped because the queue was full */
+    size_t stalls;				/**< Number of times the readers were waiting for a free space in the queue */
+    pcilib_timeout_t stall_time;		/**< Total time the readers were waiting for a free space in the queue in microseconds */
+    size_t max_queued;				/**< Maximal number of blocks waiting in the queue */
+    pcilib_timeout_t run_time;			/**< Duration of the streaming in microseconds */
+    double throughput;				/**< Delivered data rate in MB/s */
+    int error;					/**< Error terminating the reader, the first error if statistics is summed over all sources */
+} pcilib_aggregate_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates the aggregate stream
+ * @param[in] queue_size - number of blocks in the queue, 0 - default
+ * @param[in] block_size - size of queue blocks in bytes, larger DMA buffers are split into several blocks, 0 - default
+ * @param[in] flags	- flags controlling the behavior if the queue is full
+ * @return		- aggregate stream or NULL on error
+ */
+pcilib_aggregate_t *pcilib_aggregate_create(size_t queue_size, size_t block_size, pcilib_aggregate_flags_t flags);
+
+/**
+ * Stops the streaming if necessary and releases the aggregate stream. The pcilib contexts of sources
+ * are not closed and the DMA engines are not stopped.
+ * @param[in,out] agg	- aggregate stream
+ */
+void pcilib_aggregate_destroy(pcilib_aggregate_t *agg);
+
+/**
+ * Adds the DMA engine to the aggregate stream. The sources can't be added while streaming. The engine
+ * is locked by the reader while streaming, so it should not be read by other means. The pcilib context
+ * may be shared between several sources reading different DMA engines.
+ * @param[in,out] agg	- aggregate stream
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] dma	- ID of DMA engine, the ID should first be resolved using pcilib_find_dma_by_addr()
+ * @param[out] source	- if not NULL, the index of the new source is returned here
+ * @return		- error code or 0 on success
+ */
+int pcilib_aggregate_add_source(pcilib_aggregate_t *agg, pcilib_t *ctx, pcilib_dma_engine_t dma, size_t *source);
+
+/**
+ * Starts the readers and passes the merged stream to the callback until the callback requests to stop,
+ * the duration is expired, the streaming is stopped with pcilib_aggregate_stop(), or all readers are
+ * terminated. The DMA engines are started when the readers are started, but are not stopped afterwards.
+ * The blocks still waiting in the queue upon termination are discarded. The statistics is reset.
+ * @param[in,out] agg	- aggregate stream
+ * @param[in] duration	- stop after the specified number of microseconds, #PCILIB_TIMEOUT_INFINITE - unlimited
+ * @param[in] timeout	- stop if no data is received from all sources within the specified number of microseconds, #PCILIB_TIMEOUT_INFINITE is supported
+ * @param[in] cb	- callback function to call for each block
+ * @param[in,out] user	- passed to the callback function
+ * @return		- error code or 0 on success, #PCILIB_ERROR_TIMEOUT if no data is received at all
+ */
+int pcilib_aggregate_stream(pcilib_aggregate_t *agg, pcilib_timeout_t duration, pcilib_timeout_t timeout, pcilib_aggregate_callback_t cb, void *user);
+
+/**
+ * Requests termination of pcilib_aggregate_stream(). The function is thread-safe, but should not be
+ * called from the signal handlers. The streaming thread returns immediately, the readers are terminated
+ * within the DMA timeout.
+ * @param[in,out] agg	- aggregate stream
+ */
+void pcilib_aggregate_stop(pcilib_aggregate_t *agg);
+
+/**
+ * Returns the statistics of the source or all sources. The function is thread-safe and can be called while streaming.
+ * @param[in,out] agg	- aggregate stream
+ * @param[in] source	- index of the source or #PCILIB_AGGREGATE_ALL
+ * @param[out] stats	- the statistics is returned here
+ * @return		- error code or 0 on success
+ */
+int pcilib_aggregate_get_stats(pcilib_aggregate_t *agg, size_t source, pcilib_aggregate_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PCILIB_AGGREGATE_H */
@@ -0,0 +1,260 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+#include "pci.h"
+#include "error.h"
+#include "autotrigger.h"
+
+struct pcilib_autotrigger_s {
+    pcilib_t *ctx;				/**< pcilib context */
+
+    pcilib_autotrigger_callback_t callback;	/**< Trigger callback */
+    void *user;					/**< User argument of the callback */
+
+    pcilib_timeout_t interval;			/**< Trigger period in microseconds */
+    size_t max_triggers;			/**< Maximal number of triggers, 0 - unlimited */
+    pcilib_timeout_t duration;			/**< Maximal run time in microseconds, 0 - unlimited */
+
+    int timer_fd;				/**< Periodic timer */
+    int stop_fd;				/**< Event used to interrupt the generator thread */
+    pthread_t thread;				/**< Generator thread */
+    int started;				/**< Indicates that the generator thread is spawned and should be joined */
+
+    struct timespec start;			/**< Time of the first trigger (monotonic clock) */
+    struct timespec end;			/**< Time the generator is finished (monotonic clock) */
+    int finished;				/**< Indicates that the generator thread is finished */
+
+    size_t triggers;				/**< Number of generated triggers */
+    size_t failed;				/**< Number of failed triggers */
+    size_t missed;				/**< Number of skipped periods */
+    uint64_t latency_sum;			/**< Sum of trigger latencies in nanoseconds */
+    uint64_t latency_max;			/**< Maximal trigger latency in nanoseconds */
+
+    pthread_mutex_t mutex;			/**< Protects statistics and finished flag */
+    pthread_cond_t cond;			/**< Signaled when generator is finished */
+};
+
+static inline uint64_t pcilib_autotrigger_ns(struct timespec *ts) {
+    return ts->tv_sec * 1000000000ull + ts->tv_nsec;
+}
+
+static void *pcilib_autotrigger_thread(void *arg) {
+    int err;
+    ssize_t ret;
+    uint64_t expirations, periods = 0;
+    uint64_t start, deadline, latency;
+    struct timespec now;
+    struct pollfd fds[2];
+
+    pcilib_autotrigger_t *at = (pcilib_autotrigger_t*)arg;
+
+    start = pcilib_autotrigger_ns(&at->start);
+
+    fds[0].fd = at->timer_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = at->stop_fd;
+    fds[1].events = POLLIN;
+
+    while (1) {
+	fds[0].revents = 0;
+	fds[1].revents = 0;
+
+	if (poll(fds, 2, -1) < 0) {
+	    if (errno == EINTR) continue;
+	    pcilib_error("Error (%i) waiting for the trigger timer", errno);
+	    break;
+	}
+
+	if (fds[1].revents) break;
+	if (!fds[0].revents) continue;
+
+	ret = read(at->timer_fd, &expirations, sizeof(expirations));
+	if ((ret != sizeof(expirations))||(!expirations)) continue;
+
+	deadline = start + (periods + expirations - 1) * at->interval * 1000;
+	if ((at->duration)&&((deadline - start) >= at->duration * 1000)) break;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	latency = pcilib_autotrigger_ns(&now) - deadline;
+	periods += expirations;
+
+	err = at->callback(at->user);
+
+	pthread_mutex_lock(&at->mutex);
+	at->triggers++;
+	if (err) at->failed++;
+	at->missed += expirations - 1;
+	at->latency_sum += latency;
+	if (latency > at->latency_max) at->latency_max = latency;
+	pthread_mutex_unlock(&at->mutex);
+
+	if ((at->max_triggers)&&(at->triggers == at->max_triggers)) break;
+    }
+
+    pthread_mutex_lock(&at->mutex);
+    clock_gettime(CLOCK_MONOTONIC, &at->end);
+    at->finished = 1;
+    pthread_cond_broadcast(&at->cond);
+    pthread_mutex_unlock(&at->mutex);
+
+    return NULL;
+}
+
+pcilib_autotrigger_t *pcilib_autotrigger_start(pcilib_t *ctx, pcilib_timeout_t interval, size_t max_triggers, pcilib_timeout_t duration, pcilib_autotrigger_callback_t callback, void *user) {
+    int err;
+    pcilib_autotrigger_t *at;
+    struct itimerspec timer;
+    pthread_attr_t attr;
+    pthread_condattr_t cattr;
+    struct sched_param sched;
+
+    if ((!interval)||(!callback)) {
+	pcilib_error("The trigger interval and callback should be specified");
+	return NULL;
+    }
+
+    at = (pcilib_autotrigger_t*)malloc(sizeof(pcilib_autotrigger_t));
+    if (!at) {
+	pcilib_error("Error allocating memory for the trigger generator");
+	return NULL;
+    }
+
+    memset(at, 0, sizeof(pcilib_autotrigger_t));
+    at->ctx = ctx;
+    at->callback = callback;
+    at->user = user;
+    at->interval = interval;
+    at->max_triggers = max_triggers;
+    at->duration = duration;
+
+    at->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    at->stop_fd = eventfd(0, EFD_CLOEXEC);
+    if ((at->timer_fd < 0)||(at->stop_fd < 0)) {
+	pcilib_error("Error (%i) creating the trigger timer", errno);
+	if (at->timer_fd >= 0) close(at->timer_fd);
+	if (at->stop_fd >= 0) close(at->stop_fd);
+	free(at);
+	return NULL;
+    }
+
+    pthread_mutex_init(&at->mutex, NULL);
+
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&at->cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
+    clock_gettime(CLOCK_MONOTONIC, &at->start);
+
+    timer.it_value = at->start;
+    timer.it_interval.tv_sec = interval / 1000000;
+    timer.it_interval.tv_nsec = 1000 * (interval % 1000000);
+
+    if (timerfd_settime(at->timer_fd, TFD_TIMER_ABSTIME, &timer, NULL)) {
+	pcilib_error("Error (%i) programming the trigger timer", errno);
+	pcilib_autotrigger_stop(at, NULL);
+	return NULL;
+    }
+
+	// We don't really care if RT priority is imposible
+    pthread_attr_init(&attr);
+    if (!pthread_attr_setschedpolicy(&attr, SCHED_FIFO)) {
+	sched.sched_priority = sched_get_priority_min(SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &sched);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    }
+
+    err = pthread_create(&at->thread, &attr, pcilib_autotrigger_thread, at);
+    if (err) err = pthread_create(&at->thread, NULL, pcilib_autotrigger_thread, at);
+    pthread_attr_destroy(&attr);
+
+    if (err) {
+	pcilib_error("Error (%i) spawning the trigger thread", err);
+	at->finished = 1;
+	pcilib_autotrigger_stop(at, NULL);
+	return NULL;
+    }
+
+    at->started = 1;
+
+    return at;
+}
+
+int pcilib_autotrigger_wait(pcilib_autotrigger_t *at, pcilib_timeout_t timeout) {
+    int err = 0;
+    struct timespec deadline;
+
+    if ((timeout != PCILIB_TIMEOUT_IMMEDIATE)&&(timeout != PCILIB_TIMEOUT_INFINITE)) {
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout / 1000000;
+	deadline.tv_nsec += 1000 * (timeout % 1000000);
+	if (deadline.tv_nsec >= 1000000000) {
+	    deadline.tv_sec++;
+	    deadline.tv_nsec -= 1000000000;
+	}
+    }
+
+    pthread_mutex_lock(&at->mutex);
+    while ((!at->finished)&&(!err)) {
+	if (timeout == PCILIB_TIMEOUT_IMMEDIATE) err = ETIMEDOUT;
+	else if (timeout == PCILIB_TIMEOUT_INFINITE) pthread_cond_wait(&at->cond, &at->mutex);
+	else err = pthread_cond_timedwait(&at->cond, &at->mutex, &deadline);
+    }
+    pthread_mutex_unlock(&at->mutex);
+
+    return err?PCILIB_ERROR_TIMEOUT:0;
+}
+
+void pcilib_autotrigger_get_stats(pcilib_autotrigger_t *at, pcilib_autotrigger_stats_t *stats) {
+    uint64_t run_time;
+    struct timespec now;
+
+    pthread_mutex_lock(&at->mutex);
+
+    if (at->finished) now = at->end;
+    else clock_gettime(CLOCK_MONOTONIC, &now);
+
+    run_time = pcilib_autotrigger_ns(&now) - pcilib_autotrigger_ns(&at->start);
+
+    memset(stats, 0, sizeof(pcilib_autotrigger_stats_t));
+    stats->triggers = at->triggers;
+    stats->failed = at->failed;
+    stats->missed = at->missed;
+    stats->run_time = run_time / 1000;
+    if (run_time) stats->rate = 1000000000. * at->triggers / run_time;
+    if (at->triggers) stats->mean_latency = at->latency_sum / 1000. / at->triggers;
+    stats->max_latency = at->latency_max / 1000.;
+
+    pthread_mutex_unlock(&at->mutex);
+}
+
+void pcilib_autotrigger_stop(pcilib_autotrigger_t *at, pcilib_autotrigger_stats_t *stats) {
+    uint64_t val = 1;
+
+    if (at->started) {
+	if (write(at->stop_fd, &val, sizeof(val)) != sizeof(val))
+	    pcilib_error("Error (%i) stopping the trigger thread", errno);
+	pthread_join(at->thread, NULL);
+    }
+
+    if (stats) pcilib_autotrigger_get_stats(at, stats);
+
+    close(at->stop_fd);
+    close(at->timer_fd);
+
+    pthread_cond_destroy(&at->cond);
+    pthread_mutex_destroy(&at->mutex);
+
+    free(at);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file autotrigger.h
+ * @brief Software generator of periodic triggers
+ *
+ * @details The generator runs a thread which executes the supplied callback on the absolute deadlines
+ * computed from the configured interval. The deadlines are tracked by a periodic timerfd on the monotonic
+ * clock, so the trigger period is not affected by the time spent in the callback or by the adjustments
+ * of the system clock. If the callback takes longer than a period, a single trigger is fired for all
+ * expired deadlines and the skipped periods are reported as missed.
+ *
+ * The generator is used to emulate autotriggering for the event engines without hardware support (see
+ * pcilib_configure_autotrigger()). Any callback may be used instead of pcilib_trigger(), i.e. to measure
+ * the achievable trigger rates and jitter without hardware.
+ */
+
+#ifndef _PCILIB_AUTOTRIGGER_H
+#define _PCILIB_AUTOTRIGGER_H
+
+#include <pcilib.h>
+
+typedef struct pcilib_autotrigger_s pcilib_autotrigger_t;
+
+/**
+ * Generates a single trigger
+ * @param[in] user	- user-supplied argument of pcilib_autotrigger_start()
+ * @return		- error code or 0 on success, errors are counted as failed triggers
+ */
+typedef int (*pcilib_autotrigger_callback_t)(void *user);
+
+typedef struct {
+    size_t triggers;				/**< Number of generated triggers (including failed) */
+    size_t failed;				/**< Number of triggers reported as failed by the callback */
+    size_t missed;				/**< Number of skipped trigger periods due to missed deadlines */
+    pcilib_timeout_t run_time;			/**< Time since the start of the generator in microseconds */
+    double rate;				/**< Achieved trigger rate (triggers per second) */
+    double mean_latency;			/**< Average delay between the deadline and the trigger in microseconds */
+    double max_latency;				/**< Maximal delay between the deadline and the trigger in microseconds */
+} pcilib_autotrigger_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Starts the trigger generator. The first trigger is fired immediately.
+ * @param[in] ctx	- pcilib context
+ * @param[in] interval	- trigger period in microseconds
+ * @param[in] max_triggers - stop after the specified number of triggers, 0 - unlimited
+ * @param[in] duration	- stop after the specified number of microseconds, 0 - unlimited
+ * @param[in] callback	- function generating the trigger
+ * @param[in] user	- user argument passed to the callback
+ * @return		- generator handle or NULL on error
+ */
+pcilib_autotrigger_t *pcilib_autotrigger_start(pcilib_t *ctx, pcilib_timeout_t interval, size_t max_triggers, pcilib_timeout_t duration, pcilib_autotrigger_callback_t callback, void *user);
+
+/**
+ * Waits until the generator is finished due to the limits on number of triggers or duration
+ * @param[in,out] at	- generator handle
+ * @param[in] timeout	- timeout, special values #PCILIB_TIMEOUT_IMMEDIATE and #PCILIB_TIMEOUT_INFINITE are supported
+ * @return		- 0 if generator is finished or #PCILIB_ERROR_TIMEOUT
+ */
+int pcilib_autotrigger_wait(pcilib_autotrigger_t *at, pcilib_timeout_t timeout);
+
+/**
+ * Returns the current statistics of the generator
+ * @param[in,out] at	- generator handle
+ * @param[out] stats	- the statistics is returned here
+ */
+void pcilib_autotrigger_get_stats(pcilib_autotrigger_t *at, pcilib_autotrigger_stats_t *stats);
+
+/**
+ * Stops the generator and releases the associated resources
+ * @param[in,out] at	- generator handle
+ * @param[out] stats	- if not NULL, the final statistics is returned here
+ */
+void pcilib_autotrigger_stop(pcilib_autotrigger_t *at, pcilib_autotrigger_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PCILIB_AUTOTRIGGER_H */
@@ -56,6 +56,7 @@ int pcilib_init_register_banks(pcilib_t *ctx) {
 	bank_ctx->bank = ctx->banks + ctx->num_banks_init;
 	bank_ctx->api = bapi;
 	bank_ctx->xml = ctx->xml.bank_nodes[ctx->num_banks_init];
+	bank_ctx->attrs = ctx->xml.bank_attrs[ctx->num_banks_init];
 	ctx->bank_ctx[ctx->num_banks_init] = bank_ctx;
     }
 
@@ -314,7 +315,7 @@ uintptr_t pcilib_resolve_register_address(pcilib_t *ctx, pcilib_address_resoluti
 int pcilib_get_register_bank_attr_by_id(pcilib_t *ctx, pcilib_register_bank_t bank, const char *attr, pcilib_value_t *val) {
     assert(bank < ctx->num_banks);
 
-    return pcilib_get_xml_attr(ctx, ctx->bank_ctx[bank]->xml, attr, val);
+    return pcilib_get_xml_attr_from_table(ctx, ctx->bank_ctx[bank]->attrs, attr, val);
 }
 
 int pcilib_get_register_bank_attr(pcilib_t *ctx, const char *bankname, const char *attr, pcilib_value_t *val) {
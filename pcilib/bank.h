@@ -108,6 +108,7 @@ struct pcilib_register_bank_context_s {
     const pcilib_register_bank_description_t *bank;				/**< Corresponding bank description */
     const pcilib_register_protocol_api_description_t *api;			/**< API functions */
     pcilib_xml_node_t *xml;							/**< Additional XML properties */
+    pcilib_xml_attrs_t *attrs;							/**< Parsed XML attributes (owned by XML context) */
 };
 
 #ifdef __cplusplus
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #define _BSD_SOURCE
 #define _DEFAULT_SOURCE
 #define _POSIX_C_SOURCE 200809L
@@ -76,42 +77,122 @@ int pcilib_detect_address(pcilib_t *ctx, pcilib_bar_t *bar, uintptr_t *addr, siz
     return 0;
 }
 
+    /**
+     * Maps the BAR with the specified caching mode, the global lock should be held
+     * @return MAP_FAILED on error
+     */
+static void *pcilib_mmap_bar(pcilib_t *ctx, pcilib_bar_t bar, pcilib_bar_cache_t mode) {
+    int ret;
+    const pcilib_board_info_t *board_info = &ctx->board_info;
+
+    ret = ioctl( ctx->handle, PCIDRIVER_IOC_MMAP_MODE, PCIDRIVER_MMAP_PCI|(mode<<PCIDRIVER_MMAP_CACHE_SHIFT) );
+    if (ret) {
+	if (mode == PCILIB_BAR_CACHE_DEFAULT)
+	    pcilib_error("PCIDRIVER_IOC_MMAP_MODE ioctl have failed", bar);
+	return MAP_FAILED;
+    }
+
+    ret = ioctl( ctx->handle, PCIDRIVER_IOC_MMAP_AREA, PCIDRIVER_BAR0 + bar );
+    if (ret) {
+	pcilib_error("PCIDRIVER_IOC_MMAP_AREA ioctl have failed for bank %i", bar);
+	return MAP_FAILED;
+    }
+
+#ifdef PCILIB_FILE_IO
+    file_io_handle = open("/root/data", O_RDWR);
+    return mmap( 0, board_info->bar_length[bar], PROT_WRITE | PROT_READ, MAP_SHARED, ctx->file_io_handle, 0 );
+#else
+    return mmap( 0, board_info->bar_length[bar], PROT_WRITE | PROT_READ, MAP_SHARED, ctx->handle, 0 );
+#endif
+}
+
+int pcilib_set_bar_cache(pcilib_t *ctx, pcilib_bar_t bar, pcilib_bar_cache_t mode) {
+    int err;
+    void *res;
+    const pcilib_board_info_t *board_info;
+
+    if ((bar < 0)||(bar >= PCILIB_MAX_BARS)) {
+	pcilib_error("Invalid BAR (%i) is specified", bar);
+	return PCILIB_ERROR_INVALID_ARGUMENT;
+    }
+
+    if ((mode < PCILIB_BAR_CACHE_DEFAULT)||(mode > PCILIB_BAR_CACHE_WB)) {
+	pcilib_error("Invalid caching mode (%i) is specified for BAR %i", mode, bar);
+	return PCILIB_ERROR_INVALID_ARGUMENT;
+    }
+
+    if ((ctx->bar_space[bar])&&(ctx->bar_cache[bar] == mode))
+	return 0;
+
+    board_info = pcilib_get_board_info(ctx);
+    if (!board_info) return PCILIB_ERROR_NOTAVAILABLE;
+
+    if ((mode == PCILIB_BAR_CACHE_WB)&&(!(board_info->bar_flags[bar]&IORESOURCE_PREFETCH))) {
+	pcilib_error("Write-back caching is only allowed for prefetchable BARs and BAR %i is not prefetchable", bar);
+	return PCILIB_ERROR_NOTSUPPORTED;
+    }
+
+    if (!ctx->bar_space[bar]) {
+	ctx->bar_cache[bar] = mode;
+	return 0;
+    }
+
+	// The register banks are mapped by pcilib_open(), the BAR is re-mapped at the same address to keep the resolved pointers valid
+    err = pcilib_lock_global(ctx);
+    if (err) {
+	pcilib_error("Error (%i) acquiring mmap lock", err);
+	return err;
+    }
+
+    res = pcilib_mmap_bar(ctx, bar, mode);
+
+    pcilib_unlock_global(ctx);
+
+    if ((!res)||(res == MAP_FAILED)) {
+	pcilib_error("The driver does not support the requested caching mode (%i) for BAR %i", mode, bar);
+	return PCILIB_ERROR_NOTSUPPORTED;
+    }
+
+    if (mremap(res, board_info->bar_length[bar], board_info->bar_length[bar], MREMAP_MAYMOVE|MREMAP_FIXED, ctx->bar_space[bar]) == MAP_FAILED) {
+	munmap(res, board_info->bar_length[bar]);
+	pcilib_error("Failed to re-map BAR %i with the requested caching mode (%i)", bar, mode);
+	return PCILIB_ERROR_FAILED;
+    }
+
+    ctx->bar_cache[bar] = mode;
+
+    return 0;
+}
+
 void *pcilib_map_bar(pcilib_t *ctx, pcilib_bar_t bar) {
     void *res;
-    int err, ret; 
+    int err;
 
     const pcilib_board_info_t *board_info = pcilib_get_board_info(ctx);
     if (!board_info) return NULL;
 
     if (ctx->bar_space[bar]) return ctx->bar_space[bar];
 
+    if (ctx->emulated) {
+	pcilib_error("PCI BARs are not available with emulated device");
+	return NULL;
+    }
+
     err = pcilib_lock_global(ctx);
     if (err) {
 	pcilib_error("Error (%i) acquiring mmap lock", err);
 	return NULL;
     }
 
-    ret = ioctl( ctx->handle, PCIDRIVER_IOC_MMAP_MODE, PCIDRIVER_MMAP_PCI );
-    if (ret) {
-	pcilib_unlock_global(ctx);
-	pcilib_error("PCIDRIVER_IOC_MMAP_MODE ioctl have failed", bar);
-	return NULL;
-    }
+    res = pcilib_mmap_bar(ctx, bar, ctx->bar_cache[bar]);
 
-    ret = ioctl( ctx->handle, PCIDRIVER_IOC_MMAP_AREA, PCIDRIVER_BAR0 + bar );
-    if (ret) {
-	pcilib_unlock_global(ctx);
-	pcilib_error("PCIDRIVER_IOC_MMAP_AREA ioctl have failed for bank %i", bar);
-	return NULL;
+	// The driver may reject the mode in the ioctl or, depending on the BAR type, only in mmap
+    if ((res == MAP_FAILED)&&(ctx->bar_cache[bar] != PCILIB_BAR_CACHE_DEFAULT)) {
+	pcilib_warning("The driver does not support the requested caching mode (%i) for BAR %i, using default", ctx->bar_cache[bar], bar);
+	ctx->bar_cache[bar] = PCILIB_BAR_CACHE_DEFAULT;
+	res = pcilib_mmap_bar(ctx, bar, PCILIB_BAR_CACHE_DEFAULT);
     }
 
-#ifdef PCILIB_FILE_IO
-    file_io_handle = open("/root/data", O_RDWR);
-    res = mmap( 0, board_info->bar_length[bar], PROT_WRITE | PROT_READ, MAP_SHARED, ctx->file_io_handle, 0 );
-#else
-    res = mmap( 0, board_info->bar_length[bar], PROT_WRITE | PROT_READ, MAP_SHARED, ctx->handle, 0 );
-#endif
-
     pcilib_unlock_global(ctx);
 
     if ((!res)||(res == MAP_FAILED)) {
@@ -9,6 +9,13 @@ typedef struct {
     void *virt_addr;
 } pcilib_bar_info_t;
 
+typedef enum {
+    PCILIB_BAR_CACHE_DEFAULT = 0,			/**< Caching is decided by the kernel (normally, as configured by MTRR/PAT) */
+    PCILIB_BAR_CACHE_UC = 1,				/**< Uncached, every access goes to the device */
+    PCILIB_BAR_CACHE_WC = 2,				/**< Write-combining, the writes are buffered and sent in bursts */
+    PCILIB_BAR_CACHE_WB = 3				/**< Write-back, only for prefetchable BARs without side effects on read */
+} pcilib_bar_cache_t;
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,6 +43,22 @@ pcilib_bar_t pcilib_detect_bar(pcilib_t *ctx, uintptr_t addr, size_t size);
  */
 void *pcilib_map_bar(pcilib_t *ctx, pcilib_bar_t bar);
 
+/**
+ * Selects the caching mode used to map the specified BAR. Write-combining considerably speeds up
+ * the bulk PIO writes (i.e. pcilib_write()) and write-back mapping speeds up the reads from the
+ * prefetchable BARs. The registers with side effects should only be accessed using uncached or
+ * default mappings. If the BAR is not mapped yet, the mode is applied when it is mapped and, if the
+ * driver rejects it, the default mode is used and a warning is printed. The already mapped BARs (i.e.
+ * the BARs with register banks are mapped by pcilib_open()) are re-mapped at the same virtual address,
+ * so the pointers obtained before stay valid. In this case, the error is returned if the driver rejects
+ * the mode and the BAR is left mapped with the previous mode.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] bar	- the PCI BAR number (numbered from 0)
+ * @param[in] mode	- caching mode
+ * @return		- error code or 0 on success
+ */
+int pcilib_set_bar_cache(pcilib_t *ctx, pcilib_bar_t bar, pcilib_bar_cache_t mode);
+
 /**
  * Unmaps the specified bar from the address space of the process. Actually, it will only unmap the BAR if it is 
  * not used by DMA or Event egines. So, it is fine to include the calls to pcilib_map_bar() / pcilib_unmap_bar() 
@@ -12,11 +12,19 @@
 #include <sched.h>
 #include <arpa/inet.h>
 #include <sys/time.h>
+#include <pthread.h>
 
 #include "pci.h"
 #include "tools.h"
 #include "error.h"
 
+
+static pthread_once_t pcilib_cpu_once = PTHREAD_ONCE_INIT;
+static pcilib_cpu_info_t pcilib_cpu_info = {0};
+
+static const char *pcilib_cpu_feature_names[] = { "sse2", "ssse3", "sse4.1", "avx", "avx2", "avx512f", "avx512bw", "erms", "fsrm", "invariant_tsc", NULL };
+
+#if defined(__x86_64__)||defined(__i386__)
 static void pcilib_run_cpuid(uint32_t eax, uint32_t ecx, uint32_t* abcd) {
     uint32_t ebx = 0, edx;
 # if defined( __i386__ ) && defined ( __PIC__ )
@@ -29,32 +37,31 @@ static void pcilib_run_cpuid(uint32_t eax, uint32_t ecx, uint32_t* abcd) {
     abcd[0] = eax; abcd[1] = ebx; abcd[2] = ecx; abcd[3] = edx;
 }
 
-static int pcilib_check_xcr0_ymm() {
+static uint32_t pcilib_get_xcr0() {
     uint32_t xcr0;
     __asm__ ("xgetbv" : "=a" (xcr0) : "c" (0) : "%edx" );
-    return ((xcr0 & 6) == 6); /* checking if xmm and ymm state are enabled in XCR0 */
+    return xcr0;
 }
 
-static int pcilib_check_4th_gen_intel_core_features() {
+static int pcilib_check_4th_gen_intel_core_features(uint32_t features) {
     uint32_t abcd[4];
-    uint32_t fma_movbe_osxsave_mask = ((1 << 12) | (1 << 22) | (1 << 27));
-    uint32_t avx2_bmi12_mask = (1 << 5) | (1 << 3) | (1 << 8);
+    uint32_t fma_movbe_mask = ((1 << 12) | (1 << 22));
+    uint32_t bmi12_mask = (1 << 3) | (1 << 8);
+
+	/* AVX2 implies OSXSAVE and ymm state enabled in XCR0 */
+    if (!(features&PCILIB_CPU_FEATURE_AVX2))
+	return 0;
 
     /* CPUID.(EAX=01H, ECX=0H):ECX.FMA[bit 12]==1   && 
-       CPUID.(EAX=01H, ECX=0H):ECX.MOVBE[bit 22]==1 && 
-       CPUID.(EAX=01H, ECX=0H):ECX.OSXSAVE[bit 27]==1 */
+       CPUID.(EAX=01H, ECX=0H):ECX.MOVBE[bit 22]==1 */
     pcilib_run_cpuid( 1, 0, abcd );
-    if ( (abcd[2] & fma_movbe_osxsave_mask) != fma_movbe_osxsave_mask ) 
+    if ( (abcd[2] & fma_movbe_mask) != fma_movbe_mask ) 
         return 0;
 
-    if ( ! pcilib_check_xcr0_ymm() )
-        return 0;
-
-    /*  CPUID.(EAX=07H, ECX=0H):EBX.AVX2[bit 5]==1  &&
-        CPUID.(EAX=07H, ECX=0H):EBX.BMI1[bit 3]==1  &&
+    /*  CPUID.(EAX=07H, ECX=0H):EBX.BMI1[bit 3]==1  &&
         CPUID.(EAX=07H, ECX=0H):EBX.BMI2[bit 8]==1  */
     pcilib_run_cpuid( 7, 0, abcd );
-    if ( (abcd[1] & avx2_bmi12_mask) != avx2_bmi12_mask ) 
+    if ( (abcd[1] & bmi12_mask) != bmi12_mask ) 
         return 0;
 
     /* CPUID.(EAX=80000001H):ECX.LZCNT[bit 5]==1 */
@@ -65,19 +72,109 @@ static int pcilib_check_4th_gen_intel_core_features() {
     return 1;
 }
 
-static int pcilib_detect_cpu_gen() {
-    if (pcilib_check_4th_gen_intel_core_features())
-	return 4;
-    return 0;
+void pcilib_detect_cpu_info(pcilib_cpu_info_t *info) {
+    int i;
+    long llc;
+    uint32_t abcd[4];
+    uint32_t max_leaf, max_ext_leaf, xcr0 = 0;
+
+    memset(info, 0, sizeof(pcilib_cpu_info_t));
+
+    pcilib_run_cpuid(0, 0, abcd);
+    max_leaf = abcd[0];
+    memcpy(info->vendor, abcd + 1, 4);
+    memcpy(info->vendor + 4, abcd + 3, 4);
+    memcpy(info->vendor + 8, abcd + 2, 4);
+
+    if (max_leaf >= 1) {
+	pcilib_run_cpuid(1, 0, abcd);
+	if (abcd[3]&(1 << 26)) info->features |= PCILIB_CPU_FEATURE_SSE2;
+	if (abcd[2]&(1 << 9)) info->features |= PCILIB_CPU_FEATURE_SSSE3;
+	if (abcd[2]&(1 << 19)) info->features |= PCILIB_CPU_FEATURE_SSE41;
+
+	    /* AVX needs OSXSAVE[bit 27] and xmm/ymm state enabled by OS in XCR0 */
+	if (abcd[2]&(1 << 27)) xcr0 = pcilib_get_xcr0();
+	if ((abcd[2]&(1 << 28))&&((xcr0&6) == 6)) info->features |= PCILIB_CPU_FEATURE_AVX;
+    }
+
+    if (max_leaf >= 7) {
+	pcilib_run_cpuid(7, 0, abcd);
+	if ((info->features&PCILIB_CPU_FEATURE_AVX)&&(abcd[1]&(1 << 5))) info->features |= PCILIB_CPU_FEATURE_AVX2;
+
+	    /* AVX-512 additionally needs opmask and zmm state enabled in XCR0 */
+	if (((xcr0&0xE6) == 0xE6)&&(abcd[1]&(1 << 16))) {
+	    info->features |= PCILIB_CPU_FEATURE_AVX512F;
+	    if (abcd[1]&(1 << 30)) info->features |= PCILIB_CPU_FEATURE_AVX512BW;
+	}
+
+	if (abcd[1]&(1 << 9)) info->features |= PCILIB_CPU_FEATURE_ERMS;
+	if (abcd[3]&(1 << 4)) info->features |= PCILIB_CPU_FEATURE_FSRM;
+    }
+
+    pcilib_run_cpuid(0x80000000, 0, abcd);
+    max_ext_leaf = abcd[0];
+
+    if (max_ext_leaf >= 0x80000004) {
+	for (i = 0; i < 3; i++) {
+	    pcilib_run_cpuid(0x80000002 + i, 0, abcd);
+	    memcpy(info->model + 16 * i, abcd, 16);
+	}
+    }
+
+	/* CPUID.(EAX=80000007H):EDX.InvariantTSC[bit 8]==1 */
+    if (max_ext_leaf >= 0x80000007) {
+	pcilib_run_cpuid(0x80000007, 0, abcd);
+	if (abcd[3]&(1 << 8)) info->features |= PCILIB_CPU_FEATURE_INVARIANT_TSC;
+    }
+
+    if (pcilib_check_4th_gen_intel_core_features(info->features))
+	info->gen = 4;
+
+    llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (llc <= 0) llc = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (llc > 0) info->llc_size = llc;
+}
+#else /* x86 */
+void pcilib_detect_cpu_info(pcilib_cpu_info_t *info) {
+    memset(info, 0, sizeof(pcilib_cpu_info_t));
+}
+#endif /* x86 */
+
+static void pcilib_init_cpu_info() {
+    pcilib_detect_cpu_info(&pcilib_cpu_info);
+}
+
+const pcilib_cpu_info_t *pcilib_get_cpu_info() {
+    pthread_once(&pcilib_cpu_once, pcilib_init_cpu_info);
+    return &pcilib_cpu_info;
+}
+
+int pcilib_check_cpu_features(uint32_t features) {
+    return ((pcilib_get_cpu_info()->features&features) == features);
 }
 
 int pcilib_get_cpu_gen() {
-    int gen = -1;
+    return pcilib_get_cpu_info()->gen;
+}
 
-    if (gen < 0 )
-        gen = pcilib_detect_cpu_gen();
+int pcilib_check_cpu_invariant_tsc() {
+    return pcilib_check_cpu_features(PCILIB_CPU_FEATURE_INVARIANT_TSC);
+}
+
+char *pcilib_format_cpu_features(char *buf, size_t size) {
+    int i;
+    size_t pos = 0;
+    uint32_t features = pcilib_get_cpu_info()->features;
+
+    if (!size) return buf;
+
+    buf[0] = 0;
+    for (i = 0; (pcilib_cpu_feature_names[i])&&(pos < size); i++) {
+	if (features&(1 << i))
+	    pos += snprintf(buf + pos, size - pos, "%s%s", pos?" ":"", pcilib_cpu_feature_names[i]);
+    }
 
-    return gen;
+    return buf;
 }
 
 int pcilib_get_page_mask() {
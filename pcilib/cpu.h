@@ -1,6 +1,30 @@
 #ifndef _PCILIB_CPU_H
 #define _PCILIB_CPU_H
 
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    PCILIB_CPU_FEATURE_SSE2 = 0x0001,			/**< SSE2, non-temporal stores (movntdq) are available */
+    PCILIB_CPU_FEATURE_SSSE3 = 0x0002,			/**< SSSE3, byte shuffles (pshufb) are available */
+    PCILIB_CPU_FEATURE_SSE41 = 0x0004,			/**< SSE4.1, streaming loads (movntdqa) from write-combined memory are available */
+    PCILIB_CPU_FEATURE_AVX = 0x0008,			/**< AVX is supported by CPU and enabled by OS */
+    PCILIB_CPU_FEATURE_AVX2 = 0x0010,			/**< AVX2 is supported by CPU and enabled by OS */
+    PCILIB_CPU_FEATURE_AVX512F = 0x0020,		/**< AVX-512 Foundation is supported by CPU and enabled by OS */
+    PCILIB_CPU_FEATURE_AVX512BW = 0x0040,		/**< AVX-512 Byte and Word instructions */
+    PCILIB_CPU_FEATURE_ERMS = 0x0080,			/**< Enhanced REP MOVSB/STOSB */
+    PCILIB_CPU_FEATURE_FSRM = 0x0100,			/**< Fast short REP MOVSB */
+    PCILIB_CPU_FEATURE_INVARIANT_TSC = 0x0200		/**< TSC is running at constant rate in all P-, C-, and T-states */
+} pcilib_cpu_feature_t;
+
+typedef struct {
+    uint32_t features;					/**< Mask of available features, see pcilib_cpu_feature_t */
+    int gen;						/**< Generation of Intel Core architecture (4 if Haswell features are available), 0 otherwise */
+    char vendor[13];					/**< CPU vendor string */
+    char model[49];					/**< CPU brand string */
+    size_t llc_size;					/**< Size of the last level cache in bytes, 0 if unknown */
+} pcilib_cpu_info_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -18,12 +42,47 @@ int pcilib_get_page_mask();
 int pcilib_get_cpu_count();
 
 /**
- * Returns the generation of Intel Core architecture 
- * Processors up to Intel Core gen4 are recognized. 
+ * Detects CPU features. This runs a number of `cpuid` and `xgetbv` instructions on each call,
+ * the cached information returned by pcilib_get_cpu_info() should be used normally.
+ * @param[out] info	- CPU information
+ */
+void pcilib_detect_cpu_info(pcilib_cpu_info_t *info);
+
+/**
+ * Returns CPU information. The detection is performed only once per process.
+ * @return	- CPU information
+ */
+const pcilib_cpu_info_t *pcilib_get_cpu_info();
+
+/**
+ * Checks if all specified CPU features are available (using cached information)
+ * @param[in] features	- mask of pcilib_cpu_feature_t flags
+ * @return	- 1 if all features are available, 0 otherwise
+ */
+int pcilib_check_cpu_features(uint32_t features);
+
+/**
+ * Returns the generation of Intel Core architecture
+ * Processors up to Intel Core gen4 are recognized.
  * @return 	- Generation of Intel Core architecture (1 to 4) or 0 for non-Intel and Intel pre-Core architectures
  */
 int pcilib_get_cpu_gen();
 
+/**
+ * Checks if CPU provides the invariant time stamp counter which is running at the constant rate in all
+ * ACPI P-, C-, and T-states.
+ * @return	- 1 if invariant TSC is available, 0 otherwise
+ */
+int pcilib_check_cpu_invariant_tsc();
+
+/**
+ * Formats the list of available CPU features as space-separated string
+ * @param[out] buf	- the buffer
+ * @param[in] size	- size of the buffer
+ * @return	- \p buf
+ */
+char *pcilib_format_cpu_features(char *buf, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
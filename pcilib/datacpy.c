@@ -55,7 +55,7 @@ void *pcilib_datacpy64(void * dst, void const * src, size_t n, pcilib_endianess_
 
     if (swap) {
         while (n > 0) {
-            *plDst = ntohl(*plSrc);
+            *plDst = __builtin_bswap64(*plSrc);
             ++plSrc;
             ++plDst;
             --n;
@@ -10,6 +10,7 @@
 #include <sys/mman.h>
 #include <arpa/inet.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <assert.h>
 
@@ -211,20 +212,75 @@ static int pcilib_dma_read_callback(void *arg, pcilib_dma_flags_t flags, size_t
     return PCILIB_STREAMING_REQ_FRAGMENT;
 }
 
+typedef struct {
+    const struct iovec *iov;
+    int iovcnt;
+    int cur;					/**< the iovec currently filled */
+    size_t offset;				/**< the offset within the current iovec */
+
+    size_t size;
+    size_t pos;
+
+    pcilib_dma_flags_t flags;
+} pcilib_dma_readv_callback_context_t;
+
+static int pcilib_dma_readv_callback(void *arg, pcilib_dma_flags_t flags, size_t bufsize, void *buf) {
+    size_t len;
+    pcilib_dma_readv_callback_context_t *ctx = (pcilib_dma_readv_callback_context_t*)arg;
+
+    if (ctx->pos + bufsize > ctx->size) {
+	if ((ctx->flags&PCILIB_DMA_FLAG_IGNORE_ERRORS) == 0)
+	    pcilib_error("Buffer size (%li) is not large enough for DMA packet, at least %li bytes is required", ctx->size, ctx->pos + bufsize); 
+	return -PCILIB_ERROR_TOOBIG;
+    }
+
+    ctx->pos += bufsize;
+
+    while (bufsize > 0) {
+	len = ctx->iov[ctx->cur].iov_len - ctx->offset;
+	if (len > bufsize) len = bufsize;
+
+	pcilib_pagecpy(ctx->iov[ctx->cur].iov_base + ctx->offset, buf, len);
+
+	buf += len;
+	bufsize -= len;
+	ctx->offset += len;
+
+	    // skipping also the empty iovecs
+	while ((ctx->cur < ctx->iovcnt)&&(ctx->offset == ctx->iov[ctx->cur].iov_len)) {
+	    ctx->cur++;
+	    ctx->offset = 0;
+	}
+    }
+
+    if (flags & PCILIB_DMA_FLAG_EOP) {
+	if ((ctx->pos < ctx->size)&&(ctx->flags&PCILIB_DMA_FLAG_MULTIPACKET)) {
+	    if (ctx->flags&PCILIB_DMA_FLAG_WAIT) return PCILIB_STREAMING_WAIT;
+	    else return PCILIB_STREAMING_CONTINUE;
+	}
+	return PCILIB_STREAMING_STOP;
+    }
+    
+    return PCILIB_STREAMING_REQ_FRAGMENT;
+}
+
 static int pcilib_dma_skip_callback(void *arg, pcilib_dma_flags_t flags, size_t bufsize, void *buf) {
     struct timeval *tv = (struct timeval*)arg;
-    struct timeval cur;
     
-    if (tv) {
-	gettimeofday(&cur, NULL);
-	if ((cur.tv_sec > tv->tv_sec)||((cur.tv_sec == tv->tv_sec)&&(cur.tv_usec > tv->tv_usec))) return PCILIB_STREAMING_STOP;
-    }
+    if ((tv)&&(pcilib_check_deadline(tv, 0))) return PCILIB_STREAMING_STOP;
     
     return PCILIB_STREAMING_REQ_PACKET;
 }
 
-int pcilib_stream_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, pcilib_dma_callback_t cb, void *cbattr) {
-    int err;
+struct pcilib_dma_session_s {
+    pcilib_t *ctx;				/**< pcilib context */
+    pcilib_dma_engine_t dma;			/**< ID of DMA engine */
+    pcilib_dma_direction_t direction;		/**< Directions the session is opened for */
+    const pcilib_dma_api_description_t *api;	/**< Cached DMA API */
+    pcilib_dma_context_t *dma_ctx;		/**< Cached DMA context */
+};
+
+static int pcilib_check_dma_stream(pcilib_t *ctx, pcilib_dma_engine_t dma, const pcilib_dma_description_t **dma_info) {
     const pcilib_dma_description_t *info =  pcilib_get_dma_description(ctx);
     if (!info) {
 	pcilib_error("DMA is not supported by the device");
@@ -252,17 +308,36 @@ int pcilib_stream_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, si
 	return PCILIB_ERROR_NOTSUPPORTED;
     }
 
+    *dma_info = info;
+
+    return 0;
+}
+
+static int pcilib_lock_dma_stream(pcilib_t *ctx, pcilib_dma_engine_t dma) {
+    int err;
+
     err = pcilib_try_lock(ctx->dma_rlock[dma]);
     if (err) {
 	if ((err == PCILIB_ERROR_BUSY)||(err == PCILIB_ERROR_TIMEOUT))
 	    pcilib_error("DMA engine (%i) is busy", dma);
 	else
 	    pcilib_error("Error (%i) locking DMA engine (%i)", err, dma);
-
-	return err;
     }
 
-    err = info->api->stream(ctx->dma_ctx, dma, addr, size, flags, timeout, cb, cbattr);
+    return err;
+}
+
+int pcilib_stream_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, pcilib_dma_callback_t cb, void *cbattr) {
+    int err;
+    const pcilib_dma_description_t *info;
+
+    err = pcilib_check_dma_stream(ctx, dma, &info);
+    if (err) return err;
+
+    err = pcilib_lock_dma_stream(ctx, dma);
+    if (err) return err;
+
+    err = info->api->stream(ctx->dma_ctx, dma, addr, size, flags&~PCILIB_DMA_FLAG_PREPARED, timeout, cb, cbattr);
 
     pcilib_unlock(ctx->dma_rlock[dma]);
 
@@ -281,6 +356,29 @@ int pcilib_read_dma_custom(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t add
     return err;
 }
 
+int pcilib_readv_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, const struct iovec *iov, int iovcnt, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, size_t *read_bytes) {
+    int i, err;
+    pcilib_dma_readv_callback_context_t opts = {
+	iov, iovcnt, 0, 0, 0, 0, flags
+    };
+
+    if (read_bytes) *read_bytes = 0;
+
+    if ((iovcnt < 0)||((iovcnt)&&(!iov))) {
+	pcilib_error("Invalid vector of DMA buffers is specified");
+	return PCILIB_ERROR_INVALID_ARGUMENT;
+    }
+
+    for (i = 0; i < iovcnt; i++)
+	opts.size += iov[i].iov_len;
+
+    while ((opts.cur < iovcnt)&&(!iov[opts.cur].iov_len)) opts.cur++;
+
+    err = pcilib_stream_dma(ctx, dma, addr, opts.size, flags, timeout, pcilib_dma_readv_callback, &opts);
+    if (read_bytes) *read_bytes = opts.pos;
+    return err;
+}
+
 int pcilib_read_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, void *buf, size_t *read_bytes) {
     int err; 
 
@@ -296,28 +394,22 @@ int pcilib_read_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, size
 
 int pcilib_skip_dma(pcilib_t *ctx, pcilib_dma_engine_t dma) {
     int err;
-    struct timeval tv, cur;
+    struct timeval tv;
 
-    gettimeofday(&tv, NULL);
-    tv.tv_usec += PCILIB_DMA_SKIP_TIMEOUT;
-    tv.tv_sec += tv.tv_usec / 1000000;
-    tv.tv_usec += tv.tv_usec % 1000000;
+    pcilib_calc_deadline(&tv, PCILIB_DMA_SKIP_TIMEOUT);
     
     do {
 	    // IMMEDIATE timeout is not working properly, so default is set
 	err = pcilib_stream_dma(ctx, dma, 0, 0, PCILIB_DMA_FLAGS_DEFAULT, PCILIB_DMA_TIMEOUT, pcilib_dma_skip_callback, &tv);
-	gettimeofday(&cur, NULL);
-    } while ((!err)&&((cur.tv_sec < tv.tv_sec)||((cur.tv_sec == tv.tv_sec)&&(cur.tv_usec < tv.tv_usec))));
+    } while ((!err)&&(!pcilib_check_deadline(&tv, 0)));
 
-    if ((cur.tv_sec > tv.tv_sec)||((cur.tv_sec == tv.tv_sec)&&(cur.tv_usec > tv.tv_usec))) return PCILIB_ERROR_TIMEOUT;
+    if (pcilib_check_deadline(&tv, 0)) return PCILIB_ERROR_TIMEOUT;
     
     return 0;
 }
 
 
-int pcilib_push_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, void *buf, size_t *written) {
-    int err;
-
+static int pcilib_check_dma_push(pcilib_t *ctx, pcilib_dma_engine_t dma, const pcilib_dma_description_t **dma_info) {
     const pcilib_dma_description_t *info =  pcilib_get_dma_description(ctx);
     if (!info) {
 	pcilib_error("DMA is not supported by the device");
@@ -345,28 +437,189 @@ int pcilib_push_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, size
 	return PCILIB_ERROR_NOTSUPPORTED;
     }
 
+    *dma_info = info;
+
+    return 0;
+}
+
+static int pcilib_lock_dma_push(pcilib_t *ctx, pcilib_dma_engine_t dma) {
+    int err;
+
     err = pcilib_try_lock(ctx->dma_wlock[dma]);
     if (err) {
 	if (err == PCILIB_ERROR_BUSY) 
 	    pcilib_error("DMA engine (%i) is busy", dma);
 	else
 	    pcilib_error("Error (%i) locking DMA engine (%i)", err, dma);
-
-	return err;
     }
 
-    err = info->api->push(ctx->dma_ctx, dma, addr, size, flags, timeout, buf, written);
+    return err;
+}
+
+int pcilib_push_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, void *buf, size_t *written) {
+    int err;
+    const pcilib_dma_description_t *info;
+
+    err = pcilib_check_dma_push(ctx, dma, &info);
+    if (err) return err;
+
+    err = pcilib_lock_dma_push(ctx, dma);
+    if (err) return err;
+
+    err = info->api->push(ctx->dma_ctx, dma, addr, size, flags&~PCILIB_DMA_FLAG_PREPARED, timeout, buf, written);
 
     pcilib_unlock(ctx->dma_wlock[dma]);
 
     return err;
 }
 
+int pcilib_writev_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, const struct iovec *iov, int iovcnt, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, size_t *written_bytes) {
+    int i, last, err;
+    size_t written = 0, ret;
+    pcilib_dma_flags_t iov_flags;
+    const pcilib_dma_description_t *info;
+
+    if (written_bytes) *written_bytes = 0;
+
+    if ((iovcnt < 0)||((iovcnt)&&(!iov))) {
+	pcilib_error("Invalid vector of DMA buffers is specified");
+	return PCILIB_ERROR_INVALID_ARGUMENT;
+    }
+
+    err = pcilib_check_dma_push(ctx, dma, &info);
+    if (err) return err;
+
+    for (last = iovcnt - 1; (last > 0)&&(!iov[last].iov_len); last--);
+
+    err = pcilib_lock_dma_push(ctx, dma);
+    if (err) return err;
+
+	// The end of packet and waiting for completion are only requested with the last buffer
+    for (i = 0; i <= last; i++) {
+	if ((!iov[i].iov_len)&&(i != last)) continue;
+
+	iov_flags = (i == last)?flags:(flags&~(PCILIB_DMA_FLAG_EOP|PCILIB_DMA_FLAG_WAIT));
+	iov_flags &= ~PCILIB_DMA_FLAG_PREPARED;
+
+	ret = 0;
+	err = info->api->push(ctx->dma_ctx, dma, addr, iov[i].iov_len, iov_flags, timeout, iov[i].iov_base, &ret);
+	written += ret;
+	if (err) break;
+    }
+
+    pcilib_unlock(ctx->dma_wlock[dma]);
+
+    if (written_bytes) *written_bytes = written;
+
+    return err;
+}
 
 int pcilib_write_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, void *buf, size_t *written_bytes) {
     return pcilib_push_dma(ctx, dma, addr, size, PCILIB_DMA_FLAG_EOP|PCILIB_DMA_FLAG_WAIT, PCILIB_DMA_TIMEOUT, buf, written_bytes);
 }
 
+pcilib_dma_session_t *pcilib_open_dma_session(pcilib_t *ctx, pcilib_dma_engine_t dma, pcilib_dma_direction_t direction, pcilib_dma_flags_t flags) {
+    int err;
+    const pcilib_dma_description_t *info;
+    pcilib_dma_session_t *session;
+
+    if ((direction&PCILIB_DMA_BIDIRECTIONAL) == 0) {
+	pcilib_error("The direction of DMA session is not specified");
+	return NULL;
+    }
+
+    if (direction&PCILIB_DMA_FROM_DEVICE) {
+	err = pcilib_check_dma_stream(ctx, dma, &info);
+	if (err) return NULL;
+    }
+
+    if (direction&PCILIB_DMA_TO_DEVICE) {
+	err = pcilib_check_dma_push(ctx, dma, &info);
+	if (err) return NULL;
+    }
+
+    session = (pcilib_dma_session_t*)malloc(sizeof(pcilib_dma_session_t));
+    if (!session) {
+	pcilib_error("Error allocating memory for DMA session");
+	return NULL;
+    }
+
+    session->ctx = ctx;
+    session->dma = dma;
+    session->direction = direction;
+    session->api = info->api;
+    session->dma_ctx = ctx->dma_ctx;
+
+    if (direction&PCILIB_DMA_FROM_DEVICE) {
+	err = pcilib_lock_dma_stream(ctx, dma);
+	if (err) {
+	    free(session);
+	    return NULL;
+	}
+    }
+
+    if (direction&PCILIB_DMA_TO_DEVICE) {
+	err = pcilib_lock_dma_push(ctx, dma);
+	if (err) {
+	    if (direction&PCILIB_DMA_FROM_DEVICE)
+		pcilib_unlock(ctx->dma_rlock[dma]);
+	    free(session);
+	    return NULL;
+	}
+    }
+
+	// The engine is started once and all buffers are allocated here, the DMA implementations only check it later
+    err = pcilib_start_dma(ctx, dma, flags);
+    if (err) {
+	pcilib_error("Error (%i) starting DMA engine (%i)", err, dma);
+	pcilib_close_dma_session(session);
+	return NULL;
+    }
+
+    return session;
+}
+
+void pcilib_close_dma_session(pcilib_dma_session_t *session) {
+    if (!session) return;
+
+    if (session->direction&PCILIB_DMA_FROM_DEVICE)
+	pcilib_unlock(session->ctx->dma_rlock[session->dma]);
+    if (session->direction&PCILIB_DMA_TO_DEVICE)
+	pcilib_unlock(session->ctx->dma_wlock[session->dma]);
+
+    free(session);
+}
+
+int pcilib_session_stream_dma(pcilib_dma_session_t *session, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, pcilib_dma_callback_t cb, void *cbattr) {
+    if ((session->direction&PCILIB_DMA_FROM_DEVICE) == 0) {
+	pcilib_error("The DMA session is not opened for reading");
+	return PCILIB_ERROR_INVALID_REQUEST;
+    }
+
+    return session->api->stream(session->dma_ctx, session->dma, addr, size, flags|PCILIB_DMA_FLAG_PREPARED, timeout, cb, cbattr);
+}
+
+int pcilib_session_read_dma(pcilib_dma_session_t *session, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, void *buf, size_t *read_bytes) {
+    int err;
+
+    pcilib_dma_read_callback_context_t opts = {
+	size, buf, 0, flags
+    };
+
+    err = pcilib_session_stream_dma(session, addr, size, flags, timeout, pcilib_dma_read_callback, &opts);
+    if (read_bytes) *read_bytes = opts.pos;
+    return err;
+}
+
+int pcilib_session_push_dma(pcilib_dma_session_t *session, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, void *buf, size_t *written) {
+    if ((session->direction&PCILIB_DMA_TO_DEVICE) == 0) {
+	pcilib_error("The DMA session is not opened for writting");
+	return PCILIB_ERROR_INVALID_REQUEST;
+    }
+
+    return session->api->push(session->dma_ctx, session->dma, addr, size, flags|PCILIB_DMA_FLAG_PREPARED, timeout, buf, written);
+}
+
 double pcilib_benchmark_dma(pcilib_t *ctx, pcilib_dma_engine_addr_t dma, uintptr_t addr, size_t size, size_t iterations, pcilib_dma_direction_t direction) {
     const pcilib_dma_description_t *info =  pcilib_get_dma_description(ctx);
     if (!info) {
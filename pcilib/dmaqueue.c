@@ -0,0 +1,503 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "pci.h"
+#include "error.h"
+#include "timing.h"
+#include "pagecpy.h"
+#include "dmaqueue.h"
+
+/*
+ * The queue entries are preallocated. The submitted entries are appended to the submission list under
+ * the mutex. The progress thread moves them to the private lists of the channels (one per DMA engine and
+ * direction) and serves the heads of all channels in turn without holding the mutex. Upon completion, the
+ * result is copied to the completion ring and the entry is returned to the free list. The number of
+ * in-flight requests plus the number of unreaped completions is limited by the depth of the queue, so the
+ * completion ring never overflows.
+ */
+
+#define PCILIB_DMA_QUEUE_DEPTH		64		/**< default depth of the queue */
+#define PCILIB_DMA_QUEUE_BATCH		64		/**< maximal number of DMA pages read from the engine before switching to the next one */
+#define PCILIB_DMA_QUEUE_MIN_SLEEP	10		/**< us, initial delay between polls after the last progress */
+#define PCILIB_DMA_QUEUE_MAX_SLEEP	1000		/**< us, maximal delay between polls */
+
+typedef struct pcilib_dma_queue_entry_s pcilib_dma_queue_entry_t;
+
+struct pcilib_dma_queue_entry_s {
+    pcilib_dma_request_t req;			/**< request */
+    size_t pos;					/**< number of bytes transferred so far */
+    size_t packets;				/**< number of complete packets read */
+    size_t packet_end;				/**< number of bytes up to the end of the last complete packet */
+    int done;					/**< indicates that the read is finished */
+    int started;				/**< indicates that the engine has started serving the request */
+    pcilib_time_t deadline;			/**< time when the request times out, 0 - never */
+    pcilib_dma_queue_entry_t *next;		/**< next entry in the list */
+};
+
+typedef struct {
+    pcilib_dma_engine_t dma;			/**< DMA engine */
+    pcilib_dma_direction_t direction;		/**< direction */
+    pcilib_dma_session_t *session;		/**< DMA session, opened on the first request */
+    size_t pages;				/**< number of pages read in the current poll */
+    pcilib_dma_queue_entry_t *head;		/**< request currently served */
+    pcilib_dma_queue_entry_t *tail;		/**< last request */
+} pcilib_dma_queue_channel_t;
+
+struct pcilib_dma_queue_s {
+    pcilib_t *ctx;				/**< pcilib context */
+    size_t depth;				/**< depth of the queue */
+
+    pcilib_dma_queue_entry_t *entries;		/**< preallocated entries */
+    pcilib_dma_queue_entry_t *free;		/**< list of free entries */
+    pcilib_dma_queue_entry_t *sq_head;		/**< first request not yet picked by the progress thread */
+    pcilib_dma_queue_entry_t *sq_tail;		/**< last request not yet picked by the progress thread */
+    size_t inflight;				/**< number of submitted, but not completed requests */
+
+    pcilib_dma_completion_t *cq;		/**< ring of completions */
+    size_t cq_head;				/**< first unreaped completion */
+    size_t cq_count;				/**< number of unreaped completions */
+    int cq_fd;					/**< eventfd signaled while completions are waiting */
+
+    size_t num_channels;			/**< number of channels */
+    pcilib_dma_queue_channel_t *channels;	/**< channels, two per DMA engine */
+    size_t pending;				/**< number of requests in the channels, only accessed by the progress thread */
+
+    pthread_t thread;				/**< progress thread */
+    int run_flag;				/**< cleared to stop the progress thread */
+
+    pcilib_dma_queue_stats_t stats;		/**< statistics */
+
+    pthread_mutex_t mutex;			/**< protects the lists, the completions, and the statistics */
+    pthread_cond_t work_cond;			/**< signaled when new requests are submitted or the thread should stop */
+    pthread_cond_t cq_cond;			/**< signaled when a request is completed */
+};
+
+static inline void pcilib_dma_queue_deadline(struct timespec *ts, pcilib_time_t deadline) {
+    ts->tv_sec = deadline / 1000000000ull;
+    ts->tv_nsec = deadline % 1000000000ull;
+}
+
+static void pcilib_dma_queue_complete(pcilib_dma_queue_t *q, pcilib_dma_queue_channel_t *ch, int err) {
+    uint64_t val = 1;
+    pcilib_dma_completion_t *c;
+    pcilib_dma_queue_entry_t *entry = ch->head;
+
+    ch->head = entry->next;
+    if (!ch->head) ch->tail = NULL;
+    q->pending--;
+
+    pthread_mutex_lock(&q->mutex);
+    c = q->cq + (q->cq_head + q->cq_count) % q->depth;
+    c->user = entry->req.user;
+    c->error = err;
+    c->bytes = entry->pos;
+    c->dma = entry->req.dma;
+    c->direction = entry->req.direction;
+
+    if ((!q->cq_count++)&&(write(q->cq_fd, &val, sizeof(val)) != sizeof(val)))
+	pcilib_error("Error (%i) signaling the completion of DMA request", errno);
+
+    q->stats.completed++;
+    if (err) q->stats.failed++;
+    if (entry->req.direction == PCILIB_DMA_FROM_DEVICE) q->stats.bytes_read += entry->pos;
+    else q->stats.bytes_written += entry->pos;
+
+    entry->next = q->free;
+    q->free = entry;
+    q->inflight--;
+
+    pthread_cond_signal(&q->cq_cond);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+static int pcilib_dma_queue_read_callback(void *arg, pcilib_dma_flags_t flags, size_t bufsize, void *buf) {
+    pcilib_dma_queue_channel_t *ch = (pcilib_dma_queue_channel_t*)arg;
+    pcilib_dma_queue_entry_t *entry = ch->head;
+
+	// The page is kept in the engine, if the packet is not complete the request fails like pcilib_read_dma_custom()
+    if (entry->pos + bufsize > entry->req.size) {
+	if (((entry->req.flags&PCILIB_DMA_FLAG_MULTIPACKET) == 0)||(!entry->packets)||(entry->pos != entry->packet_end)) {
+	    if ((entry->req.flags&PCILIB_DMA_FLAG_IGNORE_ERRORS) == 0)
+		pcilib_error("Buffer size (%li) is not large enough for DMA packet, at least %li bytes is required", entry->req.size, entry->pos + bufsize);
+	}
+	return -PCILIB_ERROR_TOOBIG;
+    }
+
+    pcilib_pagecpy(entry->req.buf + entry->pos, buf, bufsize);
+    entry->pos += bufsize;
+
+    if (flags&PCILIB_DMA_FLAG_EOP) {
+	entry->packets++;
+	entry->packet_end = entry->pos;
+
+	if (((entry->req.flags&PCILIB_DMA_FLAG_MULTIPACKET) == 0)||(entry->pos == entry->req.size)) {
+	    entry->done = 1;
+	    return PCILIB_STREAMING_STOP;
+	}
+    }
+
+	// Giving other engines a chance if the data is coming faster than we can copy it
+    if (++ch->pages >= PCILIB_DMA_QUEUE_BATCH) return PCILIB_STREAMING_STOP;
+
+    return PCILIB_STREAMING_CHECK;
+}
+
+    /**
+     * Serves the request at the head of the channel
+     * @return 1 if any progress is made and 0 otherwise
+     */
+static int pcilib_dma_queue_process(pcilib_dma_queue_t *q, pcilib_dma_queue_channel_t *ch, pcilib_time_t now) {
+    int err;
+    size_t written = 0;
+    pcilib_dma_queue_entry_t *entry = ch->head;
+    pcilib_dma_request_t *req = &entry->req;
+
+    if (!ch->session) {
+	ch->session = pcilib_open_dma_session(q->ctx, ch->dma, ch->direction, PCILIB_DMA_FLAGS_DEFAULT);
+	if (!ch->session) {
+	    pcilib_dma_queue_complete(q, ch, PCILIB_ERROR_FAILED);
+	    return 1;
+	}
+    }
+
+    if (!entry->started) {
+	entry->started = 1;
+	if (req->timeout != PCILIB_TIMEOUT_INFINITE) entry->deadline = now + 1000ull * req->timeout;
+    }
+
+    if (ch->direction == PCILIB_DMA_FROM_DEVICE) {
+	ch->pages = 0;
+	err = pcilib_session_stream_dma(ch->session, req->addr, req->size - entry->pos, req->flags|PCILIB_DMA_FLAG_NOWAIT, PCILIB_TIMEOUT_IMMEDIATE, pcilib_dma_queue_read_callback, ch);
+
+	    // The next packet does not fit, but the already received packets are returned
+	if ((err == PCILIB_ERROR_TOOBIG)&&(req->flags&PCILIB_DMA_FLAG_MULTIPACKET)&&(entry->packets)&&(entry->pos == entry->packet_end))
+	    entry->done = 1;
+	else if (err) {
+	    pcilib_dma_queue_complete(q, ch, err);
+	    return 1;
+	}
+
+	if (entry->done) {
+	    pcilib_dma_queue_complete(q, ch, 0);
+	    return 1;
+	}
+
+	if (ch->pages) return 1;
+    } else {
+	err = pcilib_session_push_dma(ch->session, req->addr, req->size - entry->pos, (req->flags&PCILIB_DMA_FLAG_EOP)|PCILIB_DMA_FLAG_NOWAIT, PCILIB_TIMEOUT_IMMEDIATE, req->buf + entry->pos, &written);
+	entry->pos += written;
+
+	    // Timeout only indicates that the engine has no free buffers at the moment
+	if ((err)&&(err != PCILIB_ERROR_TIMEOUT)) {
+	    pcilib_dma_queue_complete(q, ch, err);
+	    return 1;
+	}
+
+	if (entry->pos == req->size) {
+	    pcilib_dma_queue_complete(q, ch, 0);
+	    return 1;
+	}
+
+	if (written) return 1;
+    }
+
+    if ((entry->deadline)&&(pcilib_time_ns() >= entry->deadline)) {
+	if ((req->flags&PCILIB_DMA_FLAG_MULTIPACKET)&&(entry->packets)&&(entry->pos == entry->packet_end))
+	    pcilib_dma_queue_complete(q, ch, 0);
+	else
+	    pcilib_dma_queue_complete(q, ch, PCILIB_ERROR_TIMEOUT);
+	return 1;
+    }
+
+    return 0;
+}
+
+static void *pcilib_dma_queue_thread(void *arg) {
+    size_t i;
+    int progress;
+    struct timespec ts;
+    pcilib_time_t now;
+    pcilib_timeout_t delay = PCILIB_DMA_QUEUE_MIN_SLEEP;
+    pcilib_dma_queue_entry_t *entry;
+    pcilib_dma_queue_channel_t *ch;
+    pcilib_dma_queue_t *q = (pcilib_dma_queue_t*)arg;
+
+    pthread_mutex_lock(&q->mutex);
+    while (q->run_flag) {
+	    // New requests reset the back-off
+	if (q->sq_head) {
+	    while (q->sq_head) {
+		entry = q->sq_head;
+		q->sq_head = entry->next;
+		entry->next = NULL;
+
+		ch = q->channels + 2 * entry->req.dma + ((entry->req.direction == PCILIB_DMA_TO_DEVICE)?1:0);
+		if (ch->tail) ch->tail->next = entry;
+		else ch->head = entry;
+		ch->tail = entry;
+		q->pending++;
+	    }
+	    q->sq_tail = NULL;
+
+	    delay = PCILIB_DMA_QUEUE_MIN_SLEEP;
+	}
+
+	if (!q->pending) {
+	    pthread_cond_wait(&q->work_cond, &q->mutex);
+	    continue;
+	}
+
+	q->stats.polls++;
+	pthread_mutex_unlock(&q->mutex);
+
+	progress = 0;
+	now = pcilib_time_ns();
+	for (i = 0; i < q->num_channels; i++) {
+	    if (q->channels[i].head)
+		progress += pcilib_dma_queue_process(q, q->channels + i, now);
+	}
+
+	now = pcilib_time_ns();
+	pthread_mutex_lock(&q->mutex);
+
+	if (progress) {
+	    delay = PCILIB_DMA_QUEUE_MIN_SLEEP;
+	    continue;
+	}
+
+	    // The engines are not polled continuously to leave the CPU to the application while the data is not ready
+	if ((!q->sq_head)&&(q->run_flag)) {
+	    q->stats.sleeps++;
+	    pcilib_dma_queue_deadline(&ts, now + 1000ull * delay);
+	    pthread_cond_timedwait(&q->work_cond, &q->mutex, &ts);
+	}
+
+	if (delay < PCILIB_DMA_QUEUE_MAX_SLEEP) {
+	    delay *= 2;
+	    if (delay > PCILIB_DMA_QUEUE_MAX_SLEEP) delay = PCILIB_DMA_QUEUE_MAX_SLEEP;
+	}
+    }
+    pthread_mutex_unlock(&q->mutex);
+
+	// The sessions should be closed by the thread which has opened them
+    for (i = 0; i < q->num_channels; i++) {
+	if (q->channels[i].session)
+	    pcilib_close_dma_session(q->channels[i].session);
+    }
+
+    return NULL;
+}
+
+pcilib_dma_queue_t *pcilib_dma_queue_create(pcilib_t *ctx, size_t depth) {
+    int err;
+    size_t i;
+    pthread_condattr_t cattr;
+    pcilib_dma_queue_t *q;
+
+    if (!depth) depth = PCILIB_DMA_QUEUE_DEPTH;
+
+    q = (pcilib_dma_queue_t*)malloc(sizeof(pcilib_dma_queue_t));
+    if (!q) {
+	pcilib_error("Error allocating memory for DMA queue");
+	return NULL;
+    }
+
+    memset(q, 0, sizeof(pcilib_dma_queue_t));
+    q->ctx = ctx;
+    q->depth = depth;
+    q->num_channels = 2 * ctx->num_engines;
+
+    q->entries = (pcilib_dma_queue_entry_t*)calloc(depth, sizeof(pcilib_dma_queue_entry_t));
+    q->cq = (pcilib_dma_completion_t*)calloc(depth, sizeof(pcilib_dma_completion_t));
+    q->channels = (pcilib_dma_queue_channel_t*)calloc(q->num_channels?q->num_channels:1, sizeof(pcilib_dma_queue_channel_t));
+    if ((!q->entries)||(!q->cq)||(!q->channels)) {
+	pcilib_error("Error allocating memory for DMA queue of depth %zu", depth);
+	if (q->channels) free(q->channels);
+	if (q->cq) free(q->cq);
+	if (q->entries) free(q->entries);
+	free(q);
+	return NULL;
+    }
+
+    for (i = 0; i < depth; i++) {
+	q->entries[i].next = q->free;
+	q->free = q->entries + i;
+    }
+
+    for (i = 0; i < q->num_channels; i++) {
+	q->channels[i].dma = i / 2;
+	q->channels[i].direction = (i % 2)?PCILIB_DMA_TO_DEVICE:PCILIB_DMA_FROM_DEVICE;
+    }
+
+    q->cq_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+    if (q->cq_fd < 0) {
+	pcilib_error("Error (%i) creating eventfd for DMA queue", errno);
+	free(q->channels);
+	free(q->cq);
+	free(q->entries);
+	free(q);
+	return NULL;
+    }
+
+    pthread_mutex_init(&q->mutex, NULL);
+
+	// Timed waits are using the same monotonic clock as pcilib_time_ns()
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->work_cond, &cattr);
+    pthread_cond_init(&q->cq_cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
+    q->run_flag = 1;
+
+    err = pthread_create(&q->thread, NULL, pcilib_dma_queue_thread, q);
+    if (err) {
+	pcilib_error("Error (%i) starting the progress thread of DMA queue", err);
+	q->run_flag = 0;
+	pcilib_dma_queue_destroy(q);
+	return NULL;
+    }
+
+    return q;
+}
+
+void pcilib_dma_queue_destroy(pcilib_dma_queue_t *q) {
+    if (!q) return;
+
+    if (q->run_flag) {
+	pthread_mutex_lock(&q->mutex);
+	q->run_flag = 0;
+	pthread_cond_signal(&q->work_cond);
+	pthread_mutex_unlock(&q->mutex);
+
+	pthread_join(q->thread, NULL);
+    }
+
+    close(q->cq_fd);
+
+    pthread_cond_destroy(&q->cq_cond);
+    pthread_cond_destroy(&q->work_cond);
+    pthread_mutex_destroy(&q->mutex);
+
+    free(q->channels);
+    free(q->cq);
+    free(q->entries);
+    free(q);
+}
+
+static int pcilib_dma_queue_check(pcilib_dma_queue_t *q, const pcilib_dma_request_t *req) {
+    if ((req->dma == PCILIB_DMA_ENGINE_INVALID)||((2 * (size_t)req->dma) >= q->num_channels)) {
+	pcilib_error("Invalid DMA engine (%i) is specified in DMA request", req->dma);
+	return PCILIB_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (((req->direction != PCILIB_DMA_FROM_DEVICE)&&(req->direction != PCILIB_DMA_TO_DEVICE))||((q->ctx->engines[req->dma].direction&req->direction) == 0)) {
+	pcilib_error("The direction of DMA request is not supported by DMA engine (%i)", req->dma);
+	return PCILIB_ERROR_INVALID_ARGUMENT;
+    }
+
+    if ((!req->size)||(!req->buf)) {
+	pcilib_error("The buffer is not specified in DMA request");
+	return PCILIB_ERROR_INVALID_ARGUMENT;
+    }
+
+    return 0;
+}
+
+int pcilib_dma_queue_submit(pcilib_dma_queue_t *q, const pcilib_dma_request_t *requests, size_t n, size_t *submitted) {
+    int err = 0;
+    size_t i;
+    pcilib_dma_queue_entry_t *entry;
+
+    pthread_mutex_lock(&q->mutex);
+    for (i = 0; i < n; i++) {
+	err = pcilib_dma_queue_check(q, requests + i);
+	if (err) break;
+
+	if ((q->inflight + q->cq_count) >= q->depth) {
+	    err = PCILIB_ERROR_BUSY;
+	    break;
+	}
+
+	entry = q->free;
+	q->free = entry->next;
+
+	memset(entry, 0, sizeof(pcilib_dma_queue_entry_t));
+	entry->req = requests[i];
+
+	if (q->sq_tail) q->sq_tail->next = entry;
+	else q->sq_head = entry;
+	q->sq_tail = entry;
+
+	q->inflight++;
+	q->stats.submitted++;
+    }
+
+    if (i) pthread_cond_signal(&q->work_cond);
+    pthread_mutex_unlock(&q->mutex);
+
+    if (submitted) *submitted = i;
+
+    return err;
+}
+
+int pcilib_dma_queue_reap(pcilib_dma_queue_t *q, pcilib_dma_completion_t *completions, size_t max, size_t min, pcilib_timeout_t timeout, size_t *reaped) {
+    size_t i, n;
+    uint64_t val;
+    struct timespec ts;
+
+    if (min > max) min = max;
+
+    pthread_mutex_lock(&q->mutex);
+
+	// Not waiting for completions of requests which are not submitted
+    if ((q->cq_count < min)&&(timeout != PCILIB_TIMEOUT_IMMEDIATE)) {
+	if (timeout == PCILIB_TIMEOUT_INFINITE) {
+	    while ((q->cq_count < min)&&(q->inflight))
+		pthread_cond_wait(&q->cq_cond, &q->mutex);
+	} else {
+	    pcilib_dma_queue_deadline(&ts, pcilib_time_ns() + 1000ull * timeout);
+	    while ((q->cq_count < min)&&(q->inflight)) {
+		if (pthread_cond_timedwait(&q->cq_cond, &q->mutex, &ts) == ETIMEDOUT) break;
+	    }
+	}
+    }
+
+    n = (q->cq_count < max)?q->cq_count:max;
+    for (i = 0; i < n; i++)
+	completions[i] = q->cq[(q->cq_head + i) % q->depth];
+
+    q->cq_head = (q->cq_head + n) % q->depth;
+    q->cq_count -= n;
+
+	// The eventfd counter is reset by reading
+    if ((n)&&(!q->cq_count)&&(read(q->cq_fd, &val, sizeof(val)) != sizeof(val)))
+	pcilib_error("Error (%i) clearing the completion event of DMA queue", errno);
+
+    pthread_mutex_unlock(&q->mutex);
+
+    if (reaped) *reaped = n;
+
+    return (n < min)?PCILIB_ERROR_TIMEOUT:0;
+}
+
+int pcilib_dma_queue_get_fd(pcilib_dma_queue_t *q) {
+    return q->cq_fd;
+}
+
+int pcilib_dma_queue_get_stats(pcilib_dma_queue_t *q, pcilib_dma_queue_stats_t *stats) {
+    pthread_mutex_lock(&q->mutex);
+    *stats = q->stats;
+    pthread_mutex_unlock(&q->mutex);
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file dmaqueue.h
+ * @brief Asynchronous submission and completion queue for DMA transfers
+ *
+ * @details The DMA queue allows a single application thread to keep several DMA engines and both
+ * transfer directions busy. The read and write requests for any engine of the device are submitted to the
+ * queue and the caller gets back immediately. The requests are served by the progress thread of the queue
+ * and the results are posted to the completion queue, where they can be reaped in any convenient moment.
+ * The file descriptor returned by pcilib_dma_queue_get_fd() becomes readable while there are completions
+ * waiting, so the queue can be integrated in poll/select based event loops.
+ *
+ * The progress thread opens a DMA session for each engine and direction on the first request and keeps
+ * it open until the queue is destroyed. The engines are polled with #PCILIB_DMA_FLAG_NOWAIT, so a single
+ * thread serves all of them. The requests to the same engine and direction are executed in the order of
+ * submission, the requests to different engines are processed concurrently. If no progress is made, the
+ * thread sleeps between the polls with exponentially growing intervals. It sleeps without polling while
+ * there are no pending requests.
+ */
+
+#ifndef _PCILIB_DMAQUEUE_H
+#define _PCILIB_DMAQUEUE_H
+
+#include <pcilib.h>
+
+typedef struct pcilib_dma_queue_s pcilib_dma_queue_t;
+
+typedef struct {
+    pcilib_dma_engine_t dma;			/**< ID of DMA engine, the ID should first be resolved using pcilib_find_dma_by_addr() */
+    pcilib_dma_direction_t direction;		/**< #PCILIB_DMA_FROM_DEVICE to read or #PCILIB_DMA_TO_DEVICE to write */
+    pcilib_dma_flags_t flags;			/**< #PCILIB_DMA_FLAG_MULTIPACKET and #PCILIB_DMA_FLAG_IGNORE_ERRORS for reads, #PCILIB_DMA_FLAG_EOP for writes */
+    uintptr_t addr;				/**< Address passed to the DMA engine (used by some engines only) */
+    size_t size;				/**< Size of the buffer in bytes */
+    void *buf;					/**< Buffer to read into or to write from, should stay valid until the request is completed */
+    pcilib_timeout_t timeout;			/**< Fail if the request is not completed within the specified number of microseconds after the engine has started serving it, #PCILIB_TIMEOUT_INFINITE is supported */
+    void *user;					/**< Returned unchanged in the completion */
+} pcilib_dma_request_t;
+
+typedef struct {
+    void *user;					/**< The value specified in the request */
+    int error;					/**< Error code or 0 on success, #PCILIB_ERROR_TIMEOUT if the request has timed out */
+    size_t bytes;				/**< Number of bytes read or written, may be non-zero also on error */
+    pcilib_dma_engine_t dma;			/**< ID of DMA engine */
+    pcilib_dma_direction_t direction;		/**< Direction of the transfer */
+} pcilib_dma_completion_t;
+
+typedef struct {
+    size_t submitted;				/**< Number of submitted requests */
+    size_t completed;				/**< Number of completed requests, including the failed ones */
+    size_t failed;				/**< Number of requests completed with error */
+    size_t bytes_read;				/**< Number of bytes read from the device */
+    size_t bytes_written;			/**< Number of bytes written to the device */
+    size_t polls;				/**< Number of times the progress thread has polled the engines */
+    size_t sleeps;				/**< Number of times the progress thread has slept because no progress was made */
+} pcilib_dma_queue_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates the DMA queue and starts its progress thread
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] depth	- maximal number of requests submitted, but not reaped yet, 0 - default
+ * @return		- DMA queue or NULL on error
+ */
+pcilib_dma_queue_t *pcilib_dma_queue_create(pcilib_t *ctx, size_t depth);
+
+/**
+ * Stops the progress thread, closes the DMA sessions, and releases the queue. The requests which are not
+ * completed yet are cancelled and the completions which are not reaped yet are discarded. The DMA engines
+ * are not stopped.
+ * @param[in,out] queue	- DMA queue
+ */
+void pcilib_dma_queue_destroy(pcilib_dma_queue_t *queue);
+
+/**
+ * Submits the requests to the queue. The function never blocks. If the number of submitted, but not yet
+ * reaped requests reaches the queue depth, only part of the requests is submitted and #PCILIB_ERROR_BUSY
+ * is returned. The requests are validated before submission and #PCILIB_ERROR_INVALID_ARGUMENT is returned
+ * for the first invalid request. The errors occurring during the transfers are reported in completions.
+ *
+ * The read request is completed after the end of DMA packet is received, or, if #PCILIB_DMA_FLAG_MULTIPACKET
+ * is specified, once the buffer is full, the next packet does not fit in the buffer, or the timeout has
+ * expired with at least one packet received. The write request is completed once all data is passed to
+ * the DMA engine, the end of packet is signaled after the last byte if #PCILIB_DMA_FLAG_EOP is specified.
+ * @param[in,out] queue	- DMA queue
+ * @param[in] requests	- array of requests, the descriptions are copied and the array can be reused afterwards
+ * @param[in] n		- number of requests
+ * @param[out] submitted - if not NULL, the number of submitted requests is returned here
+ * @return		- error code or 0 on success
+ */
+int pcilib_dma_queue_submit(pcilib_dma_queue_t *queue, const pcilib_dma_request_t *requests, size_t n, size_t *submitted);
+
+/**
+ * Gets completions from the queue. The completions are returned in the order they have occured.
+ * @param[in,out] queue	- DMA queue
+ * @param[out] completions - array to return completions
+ * @param[in] max	- size of the array
+ * @param[in] min	- wait until at least the specified number of completions is available, 0 - return immediately
+ * @param[in] timeout	- maximal time to wait for completions in microseconds, #PCILIB_TIMEOUT_INFINITE is supported
+ * @param[out] reaped	- number of returned completions
+ * @return		- error code or 0 on success, #PCILIB_ERROR_TIMEOUT if less than `min` completions are returned
+ */
+int pcilib_dma_queue_reap(pcilib_dma_queue_t *queue, pcilib_dma_completion_t *completions, size_t max, size_t min, pcilib_timeout_t timeout, size_t *reaped);
+
+/**
+ * Returns the file descriptor which is readable while there are completions waiting in the queue. The
+ * descriptor should only be polled, it is owned by the queue and is cleared by pcilib_dma_queue_reap().
+ * @param[in,out] queue	- DMA queue
+ * @return		- file descriptor
+ */
+int pcilib_dma_queue_get_fd(pcilib_dma_queue_t *queue);
+
+/**
+ * Returns the statistics of the queue. The function is thread-safe and can be called at any moment.
+ * @param[in,out] queue	- DMA queue
+ * @param[out] stats	- the statistics is returned here
+ * @return		- error code or 0 on success
+ */
+int pcilib_dma_queue_get_stats(pcilib_dma_queue_t *queue, pcilib_dma_queue_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PCILIB_DMAQUEUE_H */
@@ -1,4 +1,4 @@
-#define _POSIX_C_SOURCE 199309L
+#define _POSIX_C_SOURCE 200112L
 #include <stdio.h>
 #include <string.h>
 #include <strings.h>
@@ -13,11 +13,13 @@
 #include <errno.h>
 #include <assert.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "pci.h"
 
 #include "tools.h"
 #include "error.h"
+#include "preproc.h"
 
 /* Newer versions of glibc guard timespec with a different definition guard, compliant to linux/time.h
  * We need to check for both definition guards to prevent accidental redifinitions of struct timespec
@@ -133,12 +135,40 @@ int pcilib_configure_autostop(pcilib_t *ctx, size_t max_events, pcilib_timeout_t
 }
 
 int pcilib_configure_autotrigger(pcilib_t *ctx, pcilib_timeout_t interval, pcilib_event_t event, size_t trigger_size, void *trigger_data) {
-	/* To support hardware without autotriggering, we need to provide in event.c a code 
-	to generate multiple triggers in a thread (available in cli). The function should 
-	be re-enabled afterwards: just set parameters and let implementation decide if it 
-	can make triggering in hardware or will use our emulation */
-	
-    return PCILIB_ERROR_NOTSUPPORTED;
+    const pcilib_event_api_description_t *api;
+    const pcilib_model_description_t *model_info = pcilib_get_model_description(ctx);
+
+    api = model_info->api;
+    if (!api) {
+	pcilib_error("Event API is not supported by the selected model");
+	return PCILIB_ERROR_NOTSUPPORTED;
+    }
+
+	/* Implementation may handle triggering in hardware, otherwise it is emulated in software on pcilib_start */
+    ctx->event_ctx->params.autotrigger.interval = interval;
+    ctx->event_ctx->params.autotrigger.event = event;
+    ctx->event_ctx->params.autotrigger.trigger_size = trigger_size;
+    ctx->event_ctx->params.autotrigger.trigger_data = trigger_data;
+
+    return 0;
+}
+
+static int pcilib_autotrigger_callback(void *user) {
+    pcilib_t *ctx = (pcilib_t*)user;
+    pcilib_autotrigger_parameters_t *params = &ctx->event_ctx->params.autotrigger;
+
+    return pcilib_trigger(ctx, params->event, params->trigger_size, params->trigger_data);
+}
+
+static void pcilib_stop_autotrigger(pcilib_t *ctx) {
+    pcilib_autotrigger_stats_t stats;
+
+    if (!ctx->autotrigger) return;
+
+    pcilib_autotrigger_stop(ctx->autotrigger, &stats);
+    ctx->autotrigger = NULL;
+
+    pcilib_info("Autotrigger: %zu triggers (%zu failed) at %.1lf Hz, %zu missed deadlines, latency mean %.1lf us, max %.1lf us", stats.triggers, stats.failed, stats.rate, stats.missed, stats.mean_latency, stats.max_latency);
 }
 
 int pcilib_configure_preprocessing_threads(pcilib_t *ctx, size_t max_threads) {
@@ -156,8 +186,256 @@ int pcilib_configure_preprocessing_threads(pcilib_t *ctx, size_t max_threads) {
     return 0;
 }
 
+#define PCILIB_EVENT_PREPROC_READ_TIMEOUT	100000		/**< Timeout (us) after which the reader thread checks if it should stop */
+
+typedef struct {
+    int err;					/**< Error getting the raw data of the event, reported to the consumer */
+    pcilib_event_id_t event_id;			/**< Event id assigned by the engine */
+    pcilib_event_info_t info;			/**< Event info reported by the engine */
+    void *raw;					/**< Copy of the raw event data */
+    size_t raw_size;				/**< Size of the raw event data */
+    size_t raw_alloc;				/**< Allocated size of the raw data buffer */
+} pcilib_event_preproc_entry_t;
+
+struct pcilib_event_preproc_s {
+    pcilib_t *ctx;				/**< pcilib context */
+    pcilib_preproc_t *pool;			/**< Pool of the decoding threads */
+    size_t num_entries;				/**< Twice the pool queue, so the entry is not reused until the event is released */
+    pcilib_event_preproc_entry_t *entries;	/**< Raw events, the event is stored in entry `pool_event_id % num_entries` */
+    pcilib_event_id_t next_id;			/**< Id which will be assigned by the pool to the next pushed event */
+    pthread_t reader;				/**< Thread reading the events from the engine */
+    int started;				/**< Indicates that the reader thread is spawned and should be joined */
+    int run_flag;				/**< Cleared to stop the reader thread */
+    int err;					/**< Error which has terminated the reader thread */
+};
+
+typedef struct pcilib_event_preproc_s pcilib_event_preproc_t;
+
+static int pcilib_event_preproc_push(pcilib_event_id_t event_id, const pcilib_event_info_t *info, void *user) {
+    int err;
+    void *buf, *raw = NULL;
+    size_t size = 0;
+    pcilib_event_preproc_t *ep = (pcilib_event_preproc_t*)user;
+    pcilib_t *ctx = ep->ctx;
+    const pcilib_event_api_description_t *api = pcilib_get_model_description(ctx)->api;
+    pcilib_event_preproc_entry_t *entry = ep->entries + (ep->next_id % ep->num_entries);
+
+    if (!__atomic_load_n(&ep->run_flag, __ATOMIC_ACQUIRE))
+	return PCILIB_STREAMING_STOP;
+
+    entry->event_id = event_id;
+    entry->raw_size = 0;
+    if (info) memcpy(&entry->info, info, sizeof(pcilib_event_info_t));
+    else memset(&entry->info, 0, sizeof(pcilib_event_info_t));
+
+	// The raw data is copied, so the engine is only accessed from the reader thread
+    entry->err = api->get_data(ctx->event_ctx, event_id, PCILIB_EVENT_RAW_DATA, 0, NULL, &size, &raw);
+    if (!entry->err) {
+	if (size > entry->raw_alloc) {
+	    buf = realloc(entry->raw, size);
+	    if (buf) {
+		entry->raw = buf;
+		entry->raw_alloc = size;
+	    } else {
+		pcilib_error("Error allocating %zu bytes for raw event data", size);
+		entry->err = PCILIB_ERROR_MEMORY;
+	    }
+	}
+
+	if (!entry->err) {
+	    memcpy(entry->raw, raw, size);
+	    entry->raw_size = size;
+	}
+
+	if (api->return_data) {
+	    err = api->return_data(ctx->event_ctx, event_id, PCILIB_EVENT_RAW_DATA, raw);
+	    if ((err)&&(!entry->err)) entry->err = err;
+	}
+    }
+
+    do {
+	err = pcilib_preproc_push(ep->pool, entry, sizeof(pcilib_event_preproc_entry_t), PCILIB_EVENT_PREPROC_READ_TIMEOUT, NULL);
+    } while ((err == PCILIB_ERROR_TIMEOUT)&&(__atomic_load_n(&ep->run_flag, __ATOMIC_ACQUIRE)));
+
+    if (err == PCILIB_ERROR_TIMEOUT) return PCILIB_STREAMING_STOP;
+    if (err) return -err;
+
+    ep->next_id++;
+
+    return PCILIB_STREAMING_CONTINUE;
+}
+
+static int pcilib_event_preproc_decode(void *user, pcilib_event_id_t event_id, const void *raw, size_t raw_size, void *buf, size_t *size) {
+    pcilib_event_preproc_t *ep = (pcilib_event_preproc_t*)user;
+    const pcilib_event_preproc_entry_t *entry = (const pcilib_event_preproc_entry_t*)raw;
+    const pcilib_event_api_description_t *api = pcilib_get_model_description(ep->ctx)->api;
+
+    if (entry->err) return entry->err;
+
+    return api->preprocess(ep->ctx->event_ctx, entry->event_id, entry->raw, entry->raw_size, buf, size);
+}
+
+static void *pcilib_event_preproc_thread(void *arg) {
+    int err = 0, ret;
+    pcilib_event_id_t event_id;
+    pcilib_event_info_t info;
+    pcilib_event_preproc_t *ep = (pcilib_event_preproc_t*)arg;
+    pcilib_t *ctx = ep->ctx;
+    const pcilib_event_api_description_t *api = pcilib_get_model_description(ctx)->api;
+
+    if (api->stream) {
+	err = api->stream(ctx->event_ctx, pcilib_event_preproc_push, ep);
+    } else {
+	while (__atomic_load_n(&ep->run_flag, __ATOMIC_ACQUIRE)) {
+	    err = api->next_event(ctx->event_ctx, PCILIB_EVENT_PREPROC_READ_TIMEOUT, &event_id, sizeof(pcilib_event_info_t), &info);
+	    if (err == PCILIB_ERROR_TIMEOUT) {
+		err = 0;
+		continue;
+	    }
+	    if (err) break;
+
+	    ret = pcilib_event_preproc_push(event_id, &info, ep);
+	    if (ret < 0) err = -ret;
+	    if (ret != PCILIB_STREAMING_CONTINUE) break;
+	}
+    }
+
+	// Errors caused by stopping the engine are not reported
+    if (__atomic_load_n(&ep->run_flag, __ATOMIC_ACQUIRE)) ep->err = err;
+
+    pcilib_preproc_finish(ep->pool);
+
+    return NULL;
+}
+
+static void pcilib_event_preproc_free(pcilib_t *ctx) {
+    size_t i;
+    pcilib_event_preproc_t *ep = ctx->event_preproc;
+
+    if (!ep) return;
+
+    __atomic_store_n(&ep->run_flag, 0, __ATOMIC_RELEASE);
+    if (ep->started) pthread_join(ep->reader, NULL);
+
+    if (ep->pool) pcilib_preproc_free(ep->pool);
+
+    if (ep->entries) {
+	for (i = 0; i < ep->num_entries; i++) {
+	    if (ep->entries[i].raw) free(ep->entries[i].raw);
+	}
+	free(ep->entries);
+    }
+
+    free(ep);
+    ctx->event_preproc = NULL;
+}
+
+static int pcilib_event_preproc_start(pcilib_t *ctx) {
+    int err;
+    size_t max_threads, queue_size;
+    pcilib_event_preproc_t *ep;
+
+    max_threads = ctx->event_ctx->params.parallel.max_threads;
+    if (!max_threads) max_threads = pcilib_get_cpu_count();
+
+    queue_size = PCILIB_PREPROC_DEFAULT_QUEUE_SIZE;
+    if (queue_size < max_threads) queue_size = max_threads;
+
+    ep = (pcilib_event_preproc_t*)malloc(sizeof(pcilib_event_preproc_t));
+    if (!ep) {
+	pcilib_error("Error allocating memory for the event preprocessing");
+	return PCILIB_ERROR_MEMORY;
+    }
+
+    memset(ep, 0, sizeof(pcilib_event_preproc_t));
+    ep->ctx = ctx;
+    ep->num_entries = 2 * queue_size;
+    ep->next_id = 1;
+    ep->run_flag = 1;
+    ctx->event_preproc = ep;
+
+    ep->entries = (pcilib_event_preproc_entry_t*)calloc(ep->num_entries, sizeof(pcilib_event_preproc_entry_t));
+    if (!ep->entries) {
+	pcilib_event_preproc_free(ctx);
+	pcilib_error("Error allocating memory for the event preprocessing");
+	return PCILIB_ERROR_MEMORY;
+    }
+
+    ep->pool = pcilib_preproc_create(ctx, max_threads, queue_size, 0, pcilib_event_preproc_decode, ep);
+    if (!ep->pool) {
+	pcilib_event_preproc_free(ctx);
+	return PCILIB_ERROR_FAILED;
+    }
+
+    err = pthread_create(&ep->reader, NULL, pcilib_event_preproc_thread, ep);
+    if (err) {
+	pcilib_event_preproc_free(ctx);
+	pcilib_error("Error (%i) starting event reader thread", err);
+	return PCILIB_ERROR_FAILED;
+    }
+    ep->started = 1;
+
+    return 0;
+}
+
+static int pcilib_event_preproc_get_data(pcilib_t *ctx, pcilib_event_id_t event_id, pcilib_event_data_type_t data_type, size_t arg_size, size_t *size, void **data) {
+    size_t res_size;
+
+    if ((data_type != PCILIB_EVENT_DATA)||(arg_size)) {
+	pcilib_error("Only the default event data is available if events are preprocessed in parallel");
+	return PCILIB_ERROR_NOTSUPPORTED;
+    }
+
+    return pcilib_preproc_get_data(ctx->event_preproc->pool, event_id, PCILIB_TIMEOUT_INFINITE, data, size?size:&res_size);
+}
+
+static int pcilib_event_preproc_copy_data(pcilib_t *ctx, pcilib_event_id_t event_id, pcilib_event_data_type_t data_type, size_t arg_size, size_t size, void *buf, size_t *ret_size) {
+    int err;
+    void *res;
+    size_t res_size;
+
+    err = pcilib_event_preproc_get_data(ctx, event_id, data_type, arg_size, &res_size, &res);
+    if (err) return err;
+
+    if (res_size > size) {
+	pcilib_preproc_return(ctx->event_preproc->pool, event_id);
+	pcilib_error("The supplied buffer does not have enough space to hold the event data. Buffer size is %zu, but %zu is required", size, res_size);
+	return PCILIB_ERROR_TOOBIG;
+    }
+
+    memcpy(buf, res, res_size);
+    if (ret_size) *ret_size = res_size;
+
+	// The copied event is not returned by the caller
+    return pcilib_preproc_return(ctx->event_preproc->pool, event_id);
+}
+
+static int pcilib_event_preproc_stream(pcilib_t *ctx, pcilib_event_callback_t callback, void *user) {
+    int err, ret;
+    pcilib_event_id_t event_id;
+    pcilib_event_preproc_t *ep = ctx->event_preproc;
+
+    while (1) {
+	err = pcilib_preproc_get_next(ep->pool, PCILIB_TIMEOUT_INFINITE, &event_id);
+	if (err) break;
+
+	ret = callback(event_id, &ep->entries[event_id % ep->num_entries].info, user);
+
+	    // The data is only valid within the callback, the event is released unless the callback did it already
+	pcilib_preproc_return(ep->pool, event_id);
+
+	if (ret < 0) return -ret;
+	if (ret == PCILIB_STREAMING_STOP) return 0;
+    }
+
+    if (err == PCILIB_ERROR_NOTAVAILABLE) return ep->err;
+
+    return err;
+}
+
 int pcilib_start(pcilib_t *ctx, pcilib_event_t event_mask, pcilib_event_flags_t flags) {
     int err;
+    int preproc = 0;
     pcilib_register_value_t max_threads;
 
     const pcilib_event_api_description_t *api;
@@ -175,8 +453,38 @@ int pcilib_start(pcilib_t *ctx, pcilib_event_t event_mask, pcilib_event_flags_t
 	if (err) pcilib_warning("Error (%i) configuring number of preprocessing threads", err);
     }
 
-    if (api->start) 
-	return api->start(ctx->event_ctx, event_mask, flags);
+	// If the engine can decode events in parallel, the preprocessing is handled by pcilib
+    if ((flags&PCILIB_EVENT_FLAG_PREPROCESS)&&(api->preprocess)&&(ctx->event_ctx->params.parallel.max_threads != 1)&&(!ctx->event_preproc)) {
+	flags &= ~PCILIB_EVENT_FLAG_PREPROCESS;
+	preproc = 1;
+    }
+
+    if (api->start) {
+	err = api->start(ctx->event_ctx, event_mask, flags);
+	if (err) return err;
+    }
+
+    if ((ctx->event_ctx->params.autotrigger.interval)&&(!ctx->autotrigger)) {
+	if (!api->trigger) {
+	    pcilib_error("Self triggering is not supported by the selected model");
+	    if (api->stop) api->stop(ctx->event_ctx, PCILIB_EVENT_FLAGS_DEFAULT);
+	    return PCILIB_ERROR_NOTSUPPORTED;
+	}
+
+	ctx->autotrigger = pcilib_autotrigger_start(ctx, ctx->event_ctx->params.autotrigger.interval, 0, 0, pcilib_autotrigger_callback, ctx);
+	if (!ctx->autotrigger) {
+	    if (api->stop) api->stop(ctx->event_ctx, PCILIB_EVENT_FLAGS_DEFAULT);
+	    return PCILIB_ERROR_FAILED;
+	}
+    }
+
+    if (preproc) {
+	err = pcilib_event_preproc_start(ctx);
+	if (err) {
+	    pcilib_stop(ctx, PCILIB_EVENT_FLAGS_DEFAULT);
+	    return err;
+	}
+    }
 
     return 0;
 }
@@ -191,6 +499,19 @@ int pcilib_stop(pcilib_t *ctx, pcilib_event_flags_t flags) {
 	return PCILIB_ERROR_NOTSUPPORTED;
     }
 
+    pcilib_stop_autotrigger(ctx);
+
+    if (ctx->event_preproc) {
+	__atomic_store_n(&ctx->event_preproc->run_flag, 0, __ATOMIC_RELEASE);
+
+	    // The already decoded events are still available until the full stop
+	if ((flags&PCILIB_EVENT_FLAG_STOP_ONLY)==0) {
+		// The engine is stopped first to interrupt the reader waiting for the next event
+	    if (api->stop) api->stop(ctx->event_ctx, PCILIB_EVENT_FLAG_STOP_ONLY);
+	    pcilib_event_preproc_free(ctx);
+	}
+    }
+
     if (api->stop) 
 	return api->stop(ctx->event_ctx, flags);
 
@@ -207,6 +528,9 @@ int pcilib_stream(pcilib_t *ctx, pcilib_event_callback_t callback, void *user) {
 	return PCILIB_ERROR_NOTSUPPORTED;
     }
 
+    if (ctx->event_preproc)
+	return pcilib_event_preproc_stream(ctx, callback, user);
+
     if (api->stream)
 	return api->stream(ctx->event_ctx, callback, user);
 
@@ -231,6 +555,8 @@ static int pcilib_return_event_callback(pcilib_event_id_t event_id, pcilib_event
 */
 
 int pcilib_get_next_event(pcilib_t *ctx, pcilib_timeout_t timeout, pcilib_event_id_t *evid, size_t info_size, pcilib_event_info_t *info) {
+    int err;
+    pcilib_event_id_t event_id;
     const pcilib_event_api_description_t *api;
 //    pcilib_return_event_callback_context_t user;
     const pcilib_model_description_t *model_info = pcilib_get_model_description(ctx);
@@ -241,6 +567,17 @@ int pcilib_get_next_event(pcilib_t *ctx, pcilib_timeout_t timeout, pcilib_event_
 	return PCILIB_ERROR_NOTSUPPORTED;
     }
 
+    if (ctx->event_preproc) {
+	err = pcilib_preproc_get_next(ctx->event_preproc->pool, timeout, &event_id);
+	if (err == PCILIB_ERROR_NOTAVAILABLE) return ctx->event_preproc->err?ctx->event_preproc->err:err;
+	if (err) return err;
+
+	if (evid) *evid = event_id;
+	if (info) memcpy(info, &ctx->event_preproc->entries[event_id % ctx->event_preproc->num_entries].info, (info_size < sizeof(pcilib_event_info_t))?info_size:sizeof(pcilib_event_info_t));
+
+	return 0;
+    }
+
     if (api->next_event) 
 	return api->next_event(ctx->event_ctx, timeout, evid, info_size, info);
 
@@ -289,6 +626,15 @@ void *pcilib_get_data_with_argument(pcilib_t *ctx, pcilib_event_id_t event_id, p
 	return NULL;
     }
 
+    if (ctx->event_preproc) {
+	err = pcilib_event_preproc_get_data(ctx, event_id, data_type, arg_size, size, &res);
+	if (err) {
+	    if (size) *size = (size_t)err;
+	    return NULL;
+	}
+	return res;
+    }
+
     if (api->get_data) {
 	err = api->get_data(ctx->event_ctx, event_id, data_type, arg_size, arg, size, &res);
 	if (err) {
@@ -312,6 +658,9 @@ int pcilib_copy_data_with_argument(pcilib_t *ctx, pcilib_event_id_t event_id, pc
 	return PCILIB_ERROR_NOTSUPPORTED;
     }
 
+    if (ctx->event_preproc)
+	return pcilib_event_preproc_copy_data(ctx, event_id, data_type, arg_size, size, buf, retsize);
+
     if (api->get_data) {
 	err = api->get_data(ctx->event_ctx, event_id, data_type, arg_size, arg, &size, &res);
 	if (err) return err;
@@ -337,6 +686,15 @@ void *pcilib_get_data(pcilib_t *ctx, pcilib_event_id_t event_id, pcilib_event_da
 	return NULL;
     }
 
+    if (ctx->event_preproc) {
+	err = pcilib_event_preproc_get_data(ctx, event_id, data_type, 0, size, &res);
+	if (err) {
+	    if (size) *size = (size_t)err;
+	    return NULL;
+	}
+	return res;
+    }
+
     if (api->get_data) {
 	err = api->get_data(ctx->event_ctx, event_id, data_type, 0, NULL, size, &res);
 	if (err) {
@@ -360,6 +718,9 @@ int pcilib_copy_data(pcilib_t *ctx, pcilib_event_id_t event_id, pcilib_event_dat
 	return PCILIB_ERROR_NOTSUPPORTED;
     }
 
+    if (ctx->event_preproc)
+	return pcilib_event_preproc_copy_data(ctx, event_id, data_type, 0, size, buf, ret_size);
+
     if (api->get_data) {
 	err = api->get_data(ctx->event_ctx, event_id, data_type, 0, NULL, &size, &res);
 	if (err) return err;
@@ -381,6 +742,9 @@ int pcilib_return_data(pcilib_t *ctx, pcilib_event_id_t event_id, pcilib_event_d
 	return PCILIB_ERROR_NOTSUPPORTED;
     }
 
+    if (ctx->event_preproc)
+	return pcilib_preproc_return(ctx->event_preproc->pool, event_id);
+
     if (api->return_data) 
 	return api->return_data(ctx->event_ctx, event_id, data_type, data);
 
@@ -412,18 +776,20 @@ static int pcilib_grab_callback(pcilib_event_t event, pcilib_event_id_t event_id
     
     if (*(user->data)) {
 	if ((user->size)&&(*(user->size) < size)) {
-	    pcilib_error("The supplied buffer does not have enough space to hold the event data. Buffer size is %z, but %z is required", user->size, size);
+	    pcilib_error("The supplied buffer does not have enough space to hold the event data. Buffer size is %zu, but %zu is required", *(user->size), size);
+	    pcilib_return_data(user->ctx, event_id, PCILIB_EVENT_DATA, data);
 	    return -PCILIB_ERROR_MEMORY;
 	}
 
-	*(user->size) = size;
+	if (user->size) *(user->size) = size;
     } else {
 	*(user->data) = malloc(size);
 	if (!*(user->data)) {
-	    pcilib_error("Memory allocation (%i bytes) for event data is failed");
+	    pcilib_error("Memory allocation (%zu bytes) for event data is failed", size);
+	    pcilib_return_data(user->ctx, event_id, PCILIB_EVENT_DATA, data);
 	    return -PCILIB_ERROR_MEMORY;
 	}
-	if (*(user->size)) *(user->size) = size;
+	if (user->size) *(user->size) = size;
 	allocated = 1;
     }
     
@@ -442,12 +808,10 @@ static int pcilib_grab_callback(pcilib_event_t event, pcilib_event_id_t event_id
     return PCILIB_STREAMING_CONTINUE;
 }
 
-int pcilib_grab(pcilib_t *ctx, pcilib_event_t event_mask, size_t *size, void **data, pcilib_timeout_t timeout) {
+    // Starts the engine, triggers if requested, and waits for the next event. The engine is stopped on error.
+static int pcilib_grab_next_event(pcilib_t *ctx, pcilib_event_t event_mask, pcilib_timeout_t timeout, pcilib_event_id_t *eid) {
     int err;
-    pcilib_event_id_t eid;
-    
-    pcilib_grab_callback_user_data_t user = {ctx, size, data};
-    
+
     err = pcilib_start(ctx, event_mask, PCILIB_EVENT_FLAGS_DEFAULT);
     if (!err) {
 	if (timeout == PCILIB_TIMEOUT_IMMEDIATE) {
@@ -455,10 +819,167 @@ int pcilib_grab(pcilib_t *ctx, pcilib_event_t event_mask, size_t *size, void **d
 	     timeout = PCILIB_EVENT_TIMEOUT;
 	}
     }
-    if (!err) {
-	err = pcilib_get_next_event(ctx, timeout, &eid, 0, NULL);
-	if (!err) pcilib_grab_callback(event_mask, eid, &user);
+    if (!err) err = pcilib_get_next_event(ctx, timeout, eid, 0, NULL);
+    if (err) pcilib_stop(ctx, PCILIB_EVENT_FLAGS_DEFAULT);
+
+    return err;
+}
+
+int pcilib_grab(pcilib_t *ctx, pcilib_event_t event_mask, size_t *size, void **data, pcilib_timeout_t timeout) {
+    int err;
+    pcilib_event_id_t eid;
+    
+    pcilib_grab_callback_user_data_t user = {ctx, size, data};
+    
+    err = pcilib_grab_next_event(ctx, event_mask, timeout, &eid);
+    if (err) return err;
+
+    err = pcilib_grab_callback(event_mask, eid, &user);
+    if (err < 0) err = -err;
+    else err = 0;
+
+    pcilib_stop(ctx, PCILIB_EVENT_FLAGS_DEFAULT);
+    return err;
+}
+
+int pcilib_grab_borrow(pcilib_t *ctx, pcilib_event_t event_mask, size_t *size, void **data, pcilib_timeout_t timeout) {
+    int err;
+    void *res;
+    size_t res_size;
+    pcilib_event_id_t eid;
+
+    if (ctx->grab_data) {
+	pcilib_error("The data of the previously grabbed event is not released yet");
+	return PCILIB_ERROR_BUSY;
     }
+
+    err = pcilib_grab_next_event(ctx, event_mask, timeout, &eid);
+    if (err) return err;
+
+    res = pcilib_get_data(ctx, eid, PCILIB_EVENT_DATA, &res_size);
+    if (!res) {
+	pcilib_stop(ctx, PCILIB_EVENT_FLAGS_DEFAULT);
+	pcilib_error("Error getting event data");
+	return (int)res_size;
+    }
+
+    ctx->grab_event_id = eid;
+    ctx->grab_data = res;
+
+    if (size) *size = res_size;
+    *data = res;
+
+    return 0;
+}
+
+int pcilib_grab_release(pcilib_t *ctx, void *data) {
+    int err;
+
+    if ((!ctx->grab_data)||(ctx->grab_data != data)) {
+	pcilib_error("The released buffer is not obtained with pcilib_grab_borrow()");
+	return PCILIB_ERROR_INVALID_ARGUMENT;
+    }
+
+    err = pcilib_return_data(ctx, ctx->grab_event_id, PCILIB_EVENT_DATA, data);
+    ctx->grab_data = NULL;
+
     pcilib_stop(ctx, PCILIB_EVENT_FLAGS_DEFAULT);
+
     return err;
 }
+
+struct pcilib_grab_pool_s {
+    size_t n;							/**< Number of buffers in the pool */
+    size_t size;						/**< Size of each buffer */
+    void **buffers;						/**< Buffers */
+    int *used;							/**< Flags indicating that the buffer is handed out to the caller */
+};
+
+pcilib_grab_pool_t *pcilib_alloc_grab_pool(pcilib_t *ctx, size_t n, size_t size) {
+    size_t i;
+    pcilib_grab_pool_t *pool;
+
+    if ((!n)||(!size)) {
+	pcilib_error("Invalid number (%zu) or size (%zu) of buffers is requested for grab pool", n, size);
+	return NULL;
+    }
+
+    pool = (pcilib_grab_pool_t*)malloc(sizeof(pcilib_grab_pool_t) + n * (sizeof(void*) + sizeof(int)));
+    if (!pool) {
+	pcilib_error("Memory allocation for grab pool is failed");
+	return NULL;
+    }
+
+    memset(pool, 0, sizeof(pcilib_grab_pool_t) + n * (sizeof(void*) + sizeof(int)));
+    pool->n = n;
+    pool->size = size;
+    pool->buffers = (void**)(pool + 1);
+    pool->used = (int*)(pool->buffers + n);
+
+    for (i = 0; i < n; i++) {
+	if (posix_memalign(&pool->buffers[i], 4096, size)) {
+	    pcilib_error("Memory allocation (%zu bytes) for grab pool is failed", size);
+	    pcilib_free_grab_pool(ctx, pool);
+	    return NULL;
+	}
+    }
+
+    return pool;
+}
+
+void pcilib_free_grab_pool(pcilib_t *ctx, pcilib_grab_pool_t *pool) {
+    size_t i;
+
+    if (!pool) return;
+
+    for (i = 0; i < pool->n; i++) {
+	if (pool->buffers[i]) free(pool->buffers[i]);
+    }
+
+    free(pool);
+}
+
+int pcilib_grab_pooled(pcilib_t *ctx, pcilib_grab_pool_t *pool, pcilib_event_t event_mask, size_t *size, void **data, pcilib_timeout_t timeout) {
+    int err;
+    size_t i;
+    size_t res_size;
+    pcilib_event_id_t eid;
+
+    for (i = 0; i < pool->n; i++) {
+	if (!pool->used[i]) break;
+    }
+
+    if (i == pool->n) {
+	pcilib_error("All buffers of the grab pool are in use");
+	return PCILIB_ERROR_BUSY;
+    }
+
+    err = pcilib_grab_next_event(ctx, event_mask, timeout, &eid);
+    if (err) return err;
+
+	// The engine may decode the data directly into the pool buffer
+    err = pcilib_copy_data(ctx, eid, PCILIB_EVENT_DATA, pool->size, pool->buffers[i], &res_size);
+    pcilib_stop(ctx, PCILIB_EVENT_FLAGS_DEFAULT);
+    if (err) return err;
+
+    pool->used[i] = 1;
+
+    if (size) *size = res_size;
+    *data = pool->buffers[i];
+
+    return 0;
+}
+
+int pcilib_release_pooled(pcilib_t *ctx, pcilib_grab_pool_t *pool, void *data) {
+    size_t i;
+
+    for (i = 0; i < pool->n; i++) {
+	if (pool->buffers[i] == data) {
+	    pool->used[i] = 0;
+	    return 0;
+	}
+    }
+
+    pcilib_error("The released buffer does not belong to the grab pool");
+    return PCILIB_ERROR_INVALID_ARGUMENT;
+}
@@ -21,10 +21,22 @@ typedef struct {
     size_t max_threads;
 } pcilib_parallel_parameters_t;
 
+/*
+ * If the engine is able to trigger in hardware, it should clear the interval
+ * in the start() call. Otherwise, the triggers are generated in software.
+ */
+typedef struct {
+    pcilib_timeout_t interval;
+    pcilib_event_t event;
+    size_t trigger_size;
+    void *trigger_data;
+} pcilib_autotrigger_parameters_t;
+
 typedef struct {
     pcilib_autostop_parameters_t autostop;
     pcilib_rawdata_parameters_t rawdata;
     pcilib_parallel_parameters_t parallel;
+    pcilib_autotrigger_parameters_t autotrigger;
 } pcilib_event_parameters_t;
 
 struct pcilib_event_context_s {
@@ -55,6 +67,17 @@ typedef struct {
  * Still, the get_data function is not obliged to return the data in the
  * passed buf, but a reference to the staticaly allocated memory may be 
  * returned instead. The copy can be managed by the envelope function.
+ *
+ * preprocess: Optional. Decodes the raw event data (as returned by get_data
+ * for PCILIB_EVENT_RAW_DATA) into PCILIB_EVENT_DATA. If provided, pcilib
+ * runs a pool of pcilib_event_parameters_t::parallel.max_threads decoding
+ * workers when the engine is started with PCILIB_EVENT_FLAG_PREPROCESS and
+ * more than a single thread is allowed. The engine is then driven by a
+ * single pcilib reader thread which copies the raw data out of the engine,
+ * and the decoded events are served from the pool (see preproc.h). The
+ * callback is executed in parallel and should not call the other functions
+ * of the engine. If the buffer is too small, PCILIB_ERROR_TOOBIG should be
+ * returned along with the required size.
  */
 
 typedef struct {
@@ -76,6 +99,8 @@ typedef struct {
 
     int (*get_data)(pcilib_context_t *ctx, pcilib_event_id_t event_id, pcilib_event_data_type_t data_type, size_t arg_size, void *arg, size_t *size, void **data);
     int (*return_data)(pcilib_context_t *ctx, pcilib_event_id_t event_id, pcilib_event_data_type_t data_type, void *data);
+
+    int (*preprocess)(pcilib_context_t *ctx, pcilib_event_id_t event_id, const void *raw, size_t raw_size, void *buf, size_t *size);
 } pcilib_event_api_description_t;
 
 #ifdef __cplusplus
@@ -87,7 +112,8 @@ int pcilib_init_event_engine(pcilib_t *ctx);
 /*
  * Configures maximal number of preprocessing threads. Actual amount of threads 
  * may be bigger. For instance, additionaly a real-time reader thread will be 
- * executed for most of hardware
+ * executed for most of hardware. If the engine provides preprocess callback,
+ * the events are decoded by the pcilib preprocessing pool (see preproc.h).
  */
 int pcilib_configure_preprocessing_threads(pcilib_t *ctx, size_t max_threads);
 
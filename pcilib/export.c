@@ -37,6 +37,7 @@ const pcilib_register_bank_description_t pcilib_property_register_bank =
 
 #include "dma/nwl.h"
 #include "dma/ipe.h"
+#include "dma/soft.h"
 
 
 const pcilib_dma_description_t pcilib_ipedma = 
@@ -49,6 +50,7 @@ const pcilib_dma_description_t pcilib_dma[] = {
     { &ipe_dma_api, ipe_dma_banks, ipe_dma_registers, ipe_dma_engines, NULL, NULL, "ipedma", "DMA engine developed by M. Caselle" },
     { &nwl_dma_api, nwl_dma_banks, nwl_dma_registers, NULL, NULL, NULL, "nwldma", "North West Logic DMA Engine" },
     { &nwl_dma_api, nwl_dma_banks, nwl_dma_registers, NULL, "ipecamera", NULL, "nwldma-ipe", "North West Logic DMA Engine" },
+    { &soft_dma_api, soft_dma_banks, soft_dma_registers, soft_dma_engines, NULL, NULL, "softdma", "Software emulated DMA engine" },
     { 0 }
 };
 
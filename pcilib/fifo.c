@@ -23,34 +23,198 @@
 #include "plugin.h"
 #include "bar.h"
 
-int pcilib_read_fifo(pcilib_t *ctx, pcilib_bar_t bar, uintptr_t addr, uint8_t fifo_size, size_t n, void *buf) {
-    int i;
-    void *data;
+#include "fifo.h"
+
+struct pcilib_fifo_s {
+    pcilib_t *ctx;				/**< pcilib context */
+    volatile void *data;			/**< Resolved virtual address of FIFO register */
+    uint8_t access;				/**< FIFO word size in bytes */
+
+    volatile void *status;			/**< Resolved virtual address of the status register, NULL if not used */
+    uint32_t status_mask;			/**< Mask applied to the status register */
+    uint32_t status_value;			/**< Masked value of the status register indicating empty (reading) or full (writing) FIFO */
+    int status_shift;				/**< Position of the first bit of fill level in the status register */
+    pcilib_fifo_flags_t flags;			/**< Interpretation of the status register */
+};
+
+pcilib_fifo_t *pcilib_open_fifo_address(pcilib_t *ctx, volatile void *addr, uint8_t access) {
+    pcilib_fifo_t *fifo;
+
+    switch (access) {
+     case 1: case 2: case 4: case 8:
+	break;
+     default:
+	pcilib_error("Unsupported FIFO word size (%u bytes)", access);
+	return NULL;
+    }
+
+    if ((uintptr_t)addr % access) {
+	pcilib_error("FIFO address (%p) is not aligned to the word size (%u bytes)", addr, access);
+	return NULL;
+    }
+
+    fifo = (pcilib_fifo_t*)malloc(sizeof(pcilib_fifo_t));
+    if (!fifo) {
+	pcilib_error("Error allocating memory for FIFO handle");
+	return NULL;
+    }
+
+    memset(fifo, 0, sizeof(pcilib_fifo_t));
+    fifo->ctx = ctx;
+    fifo->data = addr;
+    fifo->access = access;
+
+    return fifo;
+}
+
+pcilib_fifo_t *pcilib_open_fifo(pcilib_t *ctx, pcilib_bar_t bar, uintptr_t addr, uint8_t access) {
+    int err;
+    char *data;
+
+    err = pcilib_detect_address(ctx, &bar, &addr, access);
+    if (err) return NULL;
 
-    pcilib_detect_address(ctx, &bar, &addr, fifo_size);
+	// The mapping is kept in the context, so it is valid until pcilib_close() 
     data = pcilib_map_bar(ctx, bar);
+    if (!data) return NULL;
 
-    for (i = 0; i < n; i++) {
-	pcilib_memcpy(buf + i * fifo_size, data + addr, fifo_size, 1);
+    return pcilib_open_fifo_address(ctx, data + addr, access);
+}
+
+void pcilib_close_fifo(pcilib_fifo_t *fifo) {
+    free(fifo);
+}
+
+int pcilib_set_fifo_status(pcilib_fifo_t *fifo, pcilib_bar_t bar, uintptr_t addr, uint32_t mask, uint32_t value, pcilib_fifo_flags_t flags) {
+    int err;
+    char *status;
+
+    if (bar == PCILIB_BAR_INVALID) {
+	fifo->status = NULL;
+	return 0;
+    }
+
+    if (!mask) {
+	pcilib_error("The mask of FIFO status register should be specified");
+	return PCILIB_ERROR_INVALID_ARGUMENT;
     }
 
-    pcilib_unmap_bar(ctx, bar, data);
+    err = pcilib_detect_address(fifo->ctx, &bar, &addr, sizeof(uint32_t));
+    if (err) return err;
+
+    status = pcilib_map_bar(fifo->ctx, bar);
+    if (!status) return PCILIB_ERROR_FAILED;
+
+    status += addr;
+
+    fifo->status = status;
+    fifo->status_mask = mask;
+    fifo->status_value = value&mask;
+    fifo->status_shift = __builtin_ctz(mask);
+    fifo->flags = flags;
 
     return 0;
 }
 
-int pcilib_write_fifo(pcilib_t *ctx, pcilib_bar_t bar, uintptr_t addr, uint8_t fifo_size, size_t n, void *buf) {
-    int i;
-    void *data;
+    /**
+     * Returns the number of words which can be transferred without checking the status register again
+     */
+static inline size_t pcilib_fifo_available(pcilib_fifo_t *fifo, size_t n) {
+    uint32_t status;
+    size_t avail;
 
-    pcilib_detect_address(ctx, &bar, &addr, fifo_size);
-    data = pcilib_map_bar(ctx, bar);
+    if (!fifo->status) return n;
 
-    for (i = 0; i < n; i++) {
-	pcilib_memcpy(data + addr, buf + i * fifo_size, fifo_size, 1);
+    status = (*(volatile uint32_t*)fifo->status)&fifo->status_mask;
+    if (fifo->flags&PCILIB_FIFO_FLAG_STATUS_LEVEL) {
+	avail = status >> fifo->status_shift;
+	return (avail < n)?avail:n;
     }
 
-    pcilib_unmap_bar(ctx, bar, data);
+    return (status == fifo->status_value)?0:1;
+}
+
+#define PCILIB_FIFO_READ_LOOP(type, fifo, n, buf) do { \
+    volatile type *src = (volatile type*)(fifo)->data; \
+    type *dst = (type*)(buf); \
+    size_t i; \
+    for (i = 0; i < (n); i++) dst[i] = *src; \
+} while (0)
+
+#define PCILIB_FIFO_WRITE_LOOP(type, fifo, n, buf) do { \
+    volatile type *dst = (volatile type*)(fifo)->data; \
+    const type *src = (const type*)(buf); \
+    size_t i; \
+    for (i = 0; i < (n); i++) { \
+	if ((i % (64 / sizeof(type))) == 0) __builtin_prefetch(src + i + 64 / sizeof(type)); \
+	*dst = src[i]; \
+    } \
+} while (0)
+
+int pcilib_read_fifo_burst(pcilib_fifo_t *fifo, size_t n, void *buf, size_t *rdsize) {
+    size_t pos = 0, avail;
+
+    while (pos < n) {
+	avail = pcilib_fifo_available(fifo, n - pos);
+	if (!avail) break;
+
+	switch (fifo->access) {
+	 case 1: PCILIB_FIFO_READ_LOOP(uint8_t, fifo, avail, buf + pos); break;
+	 case 2: PCILIB_FIFO_READ_LOOP(uint16_t, fifo, avail, buf + 2 * pos); break;
+	 case 4: PCILIB_FIFO_READ_LOOP(uint32_t, fifo, avail, buf + 4 * pos); break;
+	 case 8: PCILIB_FIFO_READ_LOOP(uint64_t, fifo, avail, buf + 8 * pos); break;
+	}
+
+	pos += avail;
+    }
+
+    if (rdsize) *rdsize = pos;
+
+    return 0;
+}
+
+int pcilib_write_fifo_burst(pcilib_fifo_t *fifo, size_t n, const void *buf, size_t *wrsize) {
+    size_t pos = 0, avail;
+
+    while (pos < n) {
+	avail = pcilib_fifo_available(fifo, n - pos);
+	if (!avail) break;
+
+	switch (fifo->access) {
+	 case 1: PCILIB_FIFO_WRITE_LOOP(uint8_t, fifo, avail, buf + pos); break;
+	 case 2: PCILIB_FIFO_WRITE_LOOP(uint16_t, fifo, avail, buf + 2 * pos); break;
+	 case 4: PCILIB_FIFO_WRITE_LOOP(uint32_t, fifo, avail, buf + 4 * pos); break;
+	 case 8: PCILIB_FIFO_WRITE_LOOP(uint64_t, fifo, avail, buf + 8 * pos); break;
+	}
+
+	pos += avail;
+    }
+
+    if (wrsize) *wrsize = pos;
+
+    return 0;
+}
+
+int pcilib_read_fifo(pcilib_t *ctx, pcilib_bar_t bar, uintptr_t addr, uint8_t fifo_size, size_t n, void *buf) {
+    pcilib_fifo_t *fifo;
+
+    fifo = pcilib_open_fifo(ctx, bar, addr, fifo_size);
+    if (!fifo) return PCILIB_ERROR_FAILED;
+
+    pcilib_read_fifo_burst(fifo, n, buf, NULL);
+    pcilib_close_fifo(fifo);
+
+    return 0;
+}
+
+int pcilib_write_fifo(pcilib_t *ctx, pcilib_bar_t bar, uintptr_t addr, uint8_t fifo_size, size_t n, void *buf) {
+    pcilib_fifo_t *fifo;
+
+    fifo = pcilib_open_fifo(ctx, bar, addr, fifo_size);
+    if (!fifo) return PCILIB_ERROR_FAILED;
+
+    pcilib_write_fifo_burst(fifo, n, buf, NULL);
+    pcilib_close_fifo(fifo);
 
     return 0;
 }
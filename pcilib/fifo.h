@@ -1,4 +1,24 @@
 #ifndef _PCILIB_FIFO_H
 #define _PCILIB_FIFO_H
 
+#include <pcilib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Prepares the handle to access FIFO register at the already resolved virtual address (i.e. register in the 
+ * mapped register bank). The handle should be destroyed with pcilib_close_fifo().
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] addr	- virtual address of FIFO register
+ * @param[in] access	- FIFO word size in bytes (1, 2, 4, or 8)
+ * @return		- FIFO handle or NULL on error
+ */
+pcilib_fifo_t *pcilib_open_fifo_address(pcilib_t *ctx, volatile void *addr, uint8_t access);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* _PCILIB_FIFO_H */
@@ -18,15 +18,22 @@
 #include "error.h"
 
 int pcilib_wait_irq(pcilib_t *ctx, pcilib_irq_hw_source_t source, pcilib_timeout_t timeout, size_t *count) {
+    return pcilib_wait_irq_timestamp(ctx, source, timeout, count, NULL);
+}
+
+int pcilib_wait_irq_timestamp(pcilib_t *ctx, pcilib_irq_hw_source_t source, pcilib_timeout_t timeout, size_t *count, uint64_t *timestamp) {
     int err;
     
     interrupt_wait_t arg = { 0 };
     
     arg.source = source;
-    arg.timeout = timeout;
+    arg.timeout = (timeout == PCILIB_TIMEOUT_INFINITE)?(unsigned long)-1:timeout;
 
     if (count) arg.count = 1;
 
+	// No interrupts are generated by emulated device
+    if (ctx->emulated) return PCILIB_ERROR_NOTSUPPORTED;
+
     err = ioctl(ctx->handle, PCIDRIVER_IOC_WAITI, &arg);
     if (err) {
 	pcilib_error("PCIDRIVER_IOC_WAITI ioctl have failed");
@@ -36,12 +43,15 @@ int pcilib_wait_irq(pcilib_t *ctx, pcilib_irq_hw_source_t source, pcilib_timeout
     if (!arg.count) return PCILIB_ERROR_TIMEOUT;
 
     if (count) *count = arg.count;
+    if (timestamp) *timestamp = arg.timestamp;
     
     return 0;
 }
 
 int pcilib_clear_irq(pcilib_t *ctx, pcilib_irq_hw_source_t source) {
     int err;
+
+    if (ctx->emulated) return 0;
     
     err = ioctl(ctx->handle, PCIDRIVER_IOC_CLEAR_IOQ, source);
     if (err) {
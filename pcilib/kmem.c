@@ -1,3 +1,6 @@
+#define _BSD_SOURCE
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <string.h>
 #include <strings.h>
@@ -19,6 +22,9 @@
 
 int pcilib_clean_kernel_memory(pcilib_t *ctx, pcilib_kmem_use_t use, pcilib_kmem_flags_t flags) {
     kmem_handle_t kh = {0};
+
+    if (ctx->emulated) return 0;
+
     kh.use = use;
     kh.flags = flags|PCILIB_KMEM_FLAG_MASS;
 
@@ -30,6 +36,8 @@ static int pcilib_free_kernel_buffer(pcilib_t *ctx, pcilib_kmem_list_t *kbuf, si
     kmem_handle_t kh = {0};
 
     if (kbuf->buf.blocks[i].ua) munmap((void*)kbuf->buf.blocks[i].ua, kbuf->buf.blocks[i].size + kbuf->buf.blocks[i].alignment_offset);
+    if (ctx->emulated) return 0;
+
     kh.handle_id = kbuf->buf.blocks[i].handle_id;
     kh.pa = kbuf->buf.blocks[i].pa;
     kh.flags = flags;
@@ -58,6 +66,68 @@ static void pcilib_cancel_kernel_memory(pcilib_t *ctx, pcilib_kmem_list_t *kbuf,
     pcilib_free_kernel_memory(ctx, kbuf, flags);
 }
 
+static pcilib_kmem_handle_t *pcilib_link_kernel_memory(pcilib_t *ctx, pcilib_kmem_list_t *kbuf, pcilib_kmem_type_t type, size_t nmemb, pcilib_kmem_use_t use, pcilib_kmem_reuse_state_t reused) {
+    if (nmemb == 1) {
+	memcpy(&kbuf->buf.addr, &kbuf->buf.blocks[0], sizeof(pcilib_kmem_addr_t));
+    }
+
+    kbuf->buf.type = type;
+    kbuf->buf.use = use;
+    kbuf->buf.reused = reused;
+
+    kbuf->prev = NULL;
+    kbuf->next = ctx->kmem_list;
+    if (ctx->kmem_list) ctx->kmem_list->prev = kbuf;
+    ctx->kmem_list = kbuf;
+
+    return (pcilib_kmem_handle_t*)kbuf;
+}
+
+/*
+ * With emulated device the buffers are just anonymous memory mappings, the bus and physical
+ * addresses are set to the virtual ones. Nothing is shared with other processes and re-used.
+ */
+static int pcilib_alloc_emulated_memory(pcilib_t *ctx, pcilib_kmem_list_t *kbuf, pcilib_kmem_type_t type, size_t nmemb, size_t size, size_t alignment) {
+    size_t i, offset;
+    void *addr;
+
+    if ((type&PCILIB_KMEM_TYPE_MASK) == PCILIB_KMEM_TYPE_REGION) {
+	pcilib_error("Reserved memory regions are not available with emulated device");
+	return PCILIB_ERROR_NOTSUPPORTED;
+    }
+
+    if (!size) size = PCILIB_KMEM_PAGE_SIZE;
+
+	// mmap returns page-aligned memory
+    if (((type&PCILIB_KMEM_TYPE_MASK) == PCILIB_KMEM_TYPE_PAGE)||(alignment <= PCILIB_KMEM_PAGE_SIZE))
+	alignment = 0;
+
+    for (i = 0; i < nmemb; i++) {
+	addr = mmap(0, size + alignment, PROT_WRITE | PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ((!addr)||(addr == MAP_FAILED)) {
+	    pcilib_error("Failed to allocate %zu bytes of emulated kernel memory (block: %zu)", size, i);
+	    return PCILIB_ERROR_MEMORY;
+	}
+
+	    // Trimming the mapping, so it is exactly aligned and munmap in pcilib_free_kernel_buffer releases everything
+	if (alignment) {
+	    offset = ((uintptr_t)addr % alignment)?(alignment - (uintptr_t)addr % alignment):0;
+	    if (offset) munmap(addr, offset);
+	    if (alignment - offset) munmap(addr + offset + size, alignment - offset);
+	    addr += offset;
+	}
+
+	kbuf->buf.blocks[i].handle_id = -1;
+	kbuf->buf.blocks[i].ua = addr;
+	kbuf->buf.blocks[i].pa = (uintptr_t)addr;
+	kbuf->buf.blocks[i].ba = (uintptr_t)addr;
+	kbuf->buf.blocks[i].size = size;
+	kbuf->buf.n_blocks = i + 1;
+    }
+
+    return 0;
+}
+
 pcilib_kmem_handle_t *pcilib_alloc_kernel_memory(pcilib_t *ctx, pcilib_kmem_type_t type, size_t nmemb, size_t size, size_t alignment, pcilib_kmem_use_t use, pcilib_kmem_flags_t flags) {
     int err = 0;
     char error[256];
@@ -80,6 +150,16 @@ pcilib_kmem_handle_t *pcilib_alloc_kernel_memory(pcilib_t *ctx, pcilib_kmem_type
     
     memset(kbuf, 0, sizeof(pcilib_kmem_list_t) + nmemb * sizeof(pcilib_kmem_addr_t));
 
+    if (ctx->emulated) {
+	err = pcilib_alloc_emulated_memory(ctx, kbuf, type, nmemb, size, alignment);
+	if (err) {
+	    pcilib_free_kernel_memory(ctx, kbuf, flags);
+	    return NULL;
+	}
+
+	return pcilib_link_kernel_memory(ctx, kbuf, type, nmemb, use, PCILIB_KMEM_REUSE_ALLOCATED);
+    }
+
     err = pcilib_lock_global(ctx);
     if (err) {
 	pcilib_error("Error (%i) acquiring mmap lock", err);
@@ -278,20 +358,7 @@ pcilib_kmem_handle_t *pcilib_alloc_kernel_memory(pcilib_t *ctx, pcilib_kmem_type
 	return NULL;
     }
     
-    if (nmemb == 1) {
-	memcpy(&kbuf->buf.addr, &kbuf->buf.blocks[0], sizeof(pcilib_kmem_addr_t));
-    }
-
-    kbuf->buf.type = type;
-    kbuf->buf.use = use;
-    kbuf->buf.reused = reused|(persistent?PCILIB_KMEM_REUSE_PERSISTENT:0)|(hardware?PCILIB_KMEM_REUSE_HARDWARE:0);
-
-    kbuf->prev = NULL;
-    kbuf->next = ctx->kmem_list;
-    if (ctx->kmem_list) ctx->kmem_list->prev = kbuf;
-    ctx->kmem_list = kbuf;
-
-    return (pcilib_kmem_handle_t*)kbuf;
+    return pcilib_link_kernel_memory(ctx, kbuf, type, nmemb, use, reused|(persistent?PCILIB_KMEM_REUSE_PERSISTENT:0)|(hardware?PCILIB_KMEM_REUSE_HARDWARE:0));
 }
 
 void pcilib_free_kernel_memory(pcilib_t *ctx, pcilib_kmem_handle_t *k, pcilib_kmem_flags_t flags) {
@@ -339,6 +406,8 @@ int pcilib_kmem_sync_block(pcilib_t *ctx, pcilib_kmem_handle_t *k, pcilib_kmem_s
     kmem_sync_t ks;
     pcilib_kmem_list_t *kbuf = (pcilib_kmem_list_t*)k;
 
+    if (ctx->emulated) return 0;
+
     switch (kbuf->buf.type) {
       case PCILIB_KMEM_TYPE_DMA_S2C_PAGE:
       case PCILIB_KMEM_TYPE_DMA_C2S_PAGE:
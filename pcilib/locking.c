@@ -77,6 +77,9 @@ void pcilib_free_locking(pcilib_t *ctx) {
 
 int pcilib_lock_global(pcilib_t *ctx) {
     int err;
+
+	/* nothing to protect, the emulated kernel memory is not shared between processes */
+    if (ctx->emulated) return 0;
     
     /* we flock() on the board's device file to make sure to not have two initialization in the same time (possible long time to init) */
     if ((err = flock(ctx->handle, LOCK_EX))==-1) {
@@ -88,6 +91,8 @@ int pcilib_lock_global(pcilib_t *ctx) {
 }
 
 void pcilib_unlock_global(pcilib_t *ctx) {
+    if (ctx->emulated) return;
+
     if (flock(ctx->handle, LOCK_UN) == -1)
 	pcilib_warning("Could not correctly remove lock from the device file");
 }
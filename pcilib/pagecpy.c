@@ -145,8 +145,8 @@ void pcilib_memcpy4k_avx(void *dst, const void *src, size_t size) {
 }
 
 void pcilib_pagecpy(void *dst, const void *src, size_t size) {
-    int gen = pcilib_get_cpu_gen();
-    if ((gen > 3)&&((size%4096)==0)&&(((uintptr_t)dst%32)==0)&&(((uintptr_t)src%32)==0)) {
+	// CPU features are detected only once, this is just a load from the cached description
+    if ((pcilib_check_cpu_features(PCILIB_CPU_FEATURE_AVX))&&((size%4096)==0)&&(((uintptr_t)dst%32)==0)&&(((uintptr_t)src%32)==0)) {
 	pcilib_memcpy4k_avx(dst, src, size);
     } else
 	memcpy(dst, src, size);
@@ -111,8 +111,13 @@ pcilib_t *pcilib_open(const char *device, const char *model) {
 	memset(ctx, 0, sizeof(pcilib_t));
 	ctx->pci_cfg_space_fd = -1;
 	
-	ctx->handle = open(device, O_RDWR);
-	if (ctx->handle < 0) {
+	if ((device)&&(!strcasecmp(device, PCILIB_DEVICE_EMULATED))) {
+	    ctx->handle = -1;
+	    ctx->emulated = 1;
+	} else
+	    ctx->handle = open(device, O_RDWR);
+
+	if ((ctx->handle < 0)&&(!ctx->emulated)) {
 	    pcilib_error("Error opening device (%s)", device);
 	    free(ctx);
 	    return NULL;
@@ -244,7 +249,10 @@ pcilib_t *pcilib_open(const char *device, const char *model) {
 const pcilib_driver_version_t *pcilib_get_driver_version(pcilib_t *ctx) {
     int ret;
     
-    if (!ctx->driver_version.version) {
+    if ((!ctx->driver_version.version)&&(ctx->emulated)) {
+	ctx->driver_version.version = PCILIB_VERSION;
+	ctx->driver_version.interface = PCIDRIVER_INTERFACE_VERSION;
+    } else if (!ctx->driver_version.version) {
 	ret = ioctl( ctx->handle, PCIDRIVER_IOC_VERSION, &ctx->driver_version );
 	if (ret) {
 	    pcilib_error("PCIDRIVER_IOC_DRIVER_VERSION ioctl have failed");
@@ -272,7 +280,11 @@ const pcilib_driver_version_t *pcilib_get_driver_version(pcilib_t *ctx) {
 const pcilib_board_info_t *pcilib_get_board_info(pcilib_t *ctx) {
     int ret;
     
-    if (!ctx->board_info_ready) {
+    if ((!ctx->board_info_ready)&&(ctx->emulated)) {
+	    // No BARs and zero ids, the XML models are not detected automatically
+	memset(&ctx->board_info, 0, sizeof(pcilib_board_info_t));
+	ctx->board_info_ready = 1;
+    } else if (!ctx->board_info_ready) {
 	ret = ioctl( ctx->handle, PCIDRIVER_IOC_PCI_INFO, &ctx->board_info );
 	if (ret) {
 	    pcilib_error("PCIDRIVER_IOC_PCI_INFO ioctl have failed");
@@ -300,6 +312,8 @@ void pcilib_close(pcilib_t *ctx) {
 	const pcilib_event_api_description_t *eapi = model_info->api;
 	const pcilib_dma_api_description_t *dapi = ctx->dma.api;
 	
+        if (ctx->autotrigger) pcilib_autotrigger_stop(ctx->autotrigger, NULL);
+        if (ctx->event_preproc) pcilib_stop(ctx, PCILIB_EVENT_FLAGS_DEFAULT);
         if ((eapi)&&(eapi->free)) eapi->free(ctx->event_ctx);
         if ((dapi)&&(dapi->free)) dapi->free(ctx->dma_ctx);
 
@@ -373,6 +387,9 @@ static int pcilib_update_pci_configuration_space(pcilib_t *ctx) {
     int err;
     int size;
 
+    if (ctx->emulated)
+	return PCILIB_ERROR_NOTSUPPORTED;
+
     if (ctx->pci_cfg_space_fd < 0) {
 	char fname[128];
 
@@ -455,6 +472,8 @@ const pcilib_pcie_link_info_t *pcilib_get_pcie_link_info(pcilib_t *ctx) {
     int err;
     const uint32_t *cap;
 
+    if (ctx->emulated) return NULL;
+
     err = pcilib_update_pci_configuration_space(ctx);
     if (err) {
 	pcilib_error("Error (%i) updating PCI configuration space", err);
@@ -477,7 +496,11 @@ const pcilib_pcie_link_info_t *pcilib_get_pcie_link_info(pcilib_t *ctx) {
 }
 
 int pcilib_get_device_state(pcilib_t *ctx, pcilib_device_state_t *state) {
-    int ret = ioctl( ctx->handle, PCIDRIVER_IOC_DEVICE_STATE, state);
+    int ret;
+
+    if (ctx->emulated) return PCILIB_ERROR_NOTSUPPORTED;
+
+    ret = ioctl( ctx->handle, PCIDRIVER_IOC_DEVICE_STATE, state);
     if (ret < 0) {
 	pcilib_error("PCIDRIVER_IOC_DEVICE_STATE ioctl have failed");
 	return PCILIB_ERROR_FAILED;
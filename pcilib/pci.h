@@ -14,6 +14,9 @@
 #define PCILIB_MAX_REGISTER_RANGES 32		/**< maximum number of register ranges to allocate space for */
 #define PCILIB_MAX_REGISTER_PROTOCOLS 32	/**< maximum number of register protocols to support */
 #define PCILIB_MAX_DMA_ENGINES 32		/**< maximum number of supported DMA engines */
+#define PCILIB_REGISTER_WAIT_SPIN_TIME 50	/**< us, default time to re-read register continuously in pcilib_wait_register() */
+#define PCILIB_REGISTER_WAIT_MIN_SLEEP 10	/**< us, default initial delay between register polls after spinning */
+#define PCILIB_REGISTER_WAIT_MAX_SLEEP 1000	/**< us, default maximal delay between register polls */
 
 #include <uthash.h>
 
@@ -29,12 +32,14 @@
 #include "irq.h"
 #include "dma.h"
 #include "event.h"
+#include "autotrigger.h"
 #include "model.h"
 #include "export.h"
 #include "locking.h"
 #include "xml.h"
 #include "py.h"
 #include "view.h"
+#include "property.h"
 #include "memcpy.h"
 
 typedef struct {
@@ -46,6 +51,7 @@ typedef struct {
 
 struct pcilib_s {
     int handle;										/**< file handle of device */
+    int emulated;									/**< Indicates that no hardware is attached and kernel memory is emulated in user space */
 
     pcilib_driver_version_t driver_version;						/**< Version reported by the driver */
 
@@ -54,6 +60,7 @@ struct pcilib_s {
     pcilib_board_info_t board_info;							/**< The mandatory information about board as defined by PCI specification */
     pcilib_pcie_link_info_t link_info;							/**< Infomation about PCIe connection */
     char *bar_space[PCILIB_MAX_BARS];							/**< Pointers to the mapped BARs in virtual address space */
+    pcilib_bar_cache_t bar_cache[PCILIB_MAX_BARS];					/**< Caching mode requested for BAR mappings */
     pcilib_bar_info_t bar_info[PCILIB_MAX_BARS + 1];					/**< NULL terminated list of PCI bar descriptions */
 
     int pci_cfg_space_fd;								/**< File descriptor linking to PCI configuration space in sysfs */
@@ -88,6 +95,10 @@ struct pcilib_s {
     pcilib_register_bank_context_t *bank_ctx[PCILIB_MAX_REGISTER_BANKS];		/**< Contexts for registers banks if required by register protocol */
     pcilib_dma_context_t *dma_ctx;							/**< DMA context */
     pcilib_context_t *event_ctx;							/**< Implmentation context */
+    pcilib_autotrigger_t *autotrigger;							/**< Software trigger generator emulating autotrigger */
+    pcilib_event_id_t grab_event_id;							/**< Event borrowed with pcilib_grab_borrow() */
+    void *grab_data;									/**< Data of the borrowed event, NULL if nothing is borrowed */
+    struct pcilib_event_preproc_s *event_preproc;					/**< Preprocessing pool decoding events of the engine, NULL if engine decodes events on request */
 
     size_t num_views, alloc_views;							/**< Number of configured and allocated  views*/
     size_t num_units, alloc_units;							/**< Number of configured and allocated  units*/
@@ -97,6 +108,8 @@ struct pcilib_s {
     pcilib_unit_context_t *unit_hash;                                                   /**< Hash of units */
     pcilib_view_context_t *view_hash;                                                   /**< Hash of views */
     pcilib_register_context_t *reg_hash;                                                /**< Hash of registers */
+    pcilib_property_node_t property_root;						/**< Root of the property tree */
+    pcilib_property_node_t *property_hash;						/**< Hash of property tree nodes by path */
 
     pcilib_lock_t *dma_rlock[PCILIB_MAX_DMA_ENGINES];					/**< Per-engine locks to serialize streaming and read operations */
     pcilib_lock_t *dma_wlock[PCILIB_MAX_DMA_ENGINES];					/**< Per-engine locks to serialize write operations */
@@ -2,12 +2,17 @@
 #define _PCILIB_H
 
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdarg.h>
 
 typedef struct pcilib_s pcilib_t;
 typedef struct pcilib_event_context_s pcilib_context_t;
+typedef struct pcilib_register_snapshot_s pcilib_register_snapshot_t;
+typedef struct pcilib_fifo_s pcilib_fifo_t;
+typedef struct pcilib_dma_session_s pcilib_dma_session_t;
+typedef struct pcilib_grab_pool_s pcilib_grab_pool_t;
 
 typedef uint32_t pcilib_version_t;
 
@@ -26,6 +31,7 @@ typedef uint64_t pcilib_timeout_t;		/**< In microseconds */
 typedef unsigned int pcilib_irq_hw_source_t;
 typedef uint32_t pcilib_irq_source_t;
 typedef struct _xmlNode pcilib_xml_node_t;
+typedef struct pcilib_xml_attrs_s pcilib_xml_attrs_t;
 
 typedef enum {
     PCILIB_LOG_DEBUG = 0,			/**< Debug messages will be always printed as they should be filtered based on setting of corresponding environmental variable */
@@ -82,6 +88,22 @@ typedef enum {
     PCILIB_DMA_BIDIRECTIONAL = 3
 } pcilib_dma_direction_t;
 
+typedef enum {
+    PCILIB_FIFO_FLAGS_DEFAULT = 0,
+    PCILIB_FIFO_FLAG_STATUS_LEVEL = 1			/**< the masked status register holds the number of words available for reading (writing) instead of empty (full) flag */
+} pcilib_fifo_flags_t;
+
+typedef enum {
+    PCILIB_REGISTER_SPACE_FLAGS_DEFAULT = 0,
+    PCILIB_REGISTER_SPACE_FLAG_WORDWISE = 1,	/**< access registers one by one using the protocol API even if the bank is mapped in the process memory */
+    PCILIB_REGISTER_SPACE_FLAG_VERIFY = 2	/**< read back the written registers and return PCILIB_ERROR_VERIFY if they differ */
+} pcilib_register_space_flags_t;
+
+typedef enum {
+    PCILIB_REGISTER_WAIT_FLAGS_DEFAULT = 0,
+    PCILIB_REGISTER_WAIT_FLAG_NOIRQ = 1		/**< keep polling even if an interrupt is associated with the register in the model */
+} pcilib_register_wait_flags_t;
+
 typedef enum {
     PCILIB_DMA_FLAGS_DEFAULT = 0,
     PCILIB_DMA_FLAG_EOP = 1,			/**< last buffer of the packet */
@@ -89,7 +111,9 @@ typedef enum {
     PCILIB_DMA_FLAG_MULTIPACKET = 4,		/**< read multiple packets */
     PCILIB_DMA_FLAG_PERSISTENT = 8,		/**< do not stop DMA engine on application termination / permanently close DMA engine on dma_stop */
     PCILIB_DMA_FLAG_IGNORE_ERRORS = 16,		/**< do not crash on errors, but return appropriate error codes */
-    PCILIB_DMA_FLAG_STOP = 32			/**< indicates that we actually calling pcilib_dma_start to stop persistent DMA engine */
+    PCILIB_DMA_FLAG_STOP = 32,			/**< indicates that we actually calling pcilib_dma_start to stop persistent DMA engine */
+    PCILIB_DMA_FLAG_PREPARED = 64,		/**< internal, set by DMA sessions to indicate that engine is started and locked and DMA implementation may skip the start-up checks */
+    PCILIB_DMA_FLAG_NOWAIT = 128		/**< do not wait for data (read) or free buffers (write), only process what is immediately available, the DMA timeout is ignored */
 } pcilib_dma_flags_t;
 
 typedef enum {
@@ -169,6 +193,39 @@ typedef struct {
     const char *unit;                           /**< Returned unit (if any) */
 } pcilib_property_info_t;
 
+typedef struct {
+    pcilib_register_info_t info;                /**< Information about the current register */
+
+        // This is a private part
+    pcilib_register_t pos;                      /**< Next register to check */
+    uint8_t bank_addr;                          /**< Address of the requested bank or of the bank of the last listed register */
+    const char *bank_name;                      /**< Name of the corresponding bank */
+    int filter;                                 /**< Indicates if only the registers of the requested bank are listed */
+} pcilib_register_iterator_t;
+
+typedef struct {
+    pcilib_property_info_t info;                /**< Information about the current property or directory */
+
+        // This is a private part
+    const void *dir;                            /**< Listed directory */
+    const void *next;                           /**< Next node to check */
+    int pass;                                   /**< Properties are listed during the first pass, pure directories during the second */
+} pcilib_property_iterator_t;
+
+typedef struct {
+    pcilib_timeout_t spin_time;			/**< Time (us) to re-read the register continuously before backing off */
+    pcilib_timeout_t min_sleep;			/**< Delay (us) between polls after spinning, doubled after each poll */
+    pcilib_timeout_t max_sleep;			/**< Maximal delay (us) between polls, also limits the interrupt waits */
+    pcilib_register_wait_flags_t flags;		/**< Flags modifying the waiting strategy */
+} pcilib_register_wait_policy_t;
+
+typedef struct {
+    size_t polls;				/**< Number of register reads */
+    size_t sleeps;				/**< Number of delays between polls (including interrupt waits) */
+    size_t irqs;				/**< Number of received interrupts */
+    pcilib_timeout_t wait_time;			/**< Time (us) until the condition was satisfied or the timeout expired */
+} pcilib_register_wait_stats_t;
+
 typedef struct {
     pcilib_event_t type;
     uint64_t seqnum;				/**< we will add seqnum_overflow if required */
@@ -202,6 +259,7 @@ typedef struct {
 #define PCILIB_IRQ_TYPE_ALL 		0
 #define PCILIB_IRQ_SOURCE_DEFAULT	0
 #define PCILIB_MODEL_DETECT		NULL
+#define PCILIB_DEVICE_EMULATED		"emulated"
 
 /**
  * Callback function called when pcilib wants to log a new message
@@ -245,6 +303,14 @@ typedef int (*pcilib_event_callback_t)(pcilib_event_id_t event_id, const pcilib_
  */
 typedef int (*pcilib_event_rawdata_callback_t)(pcilib_event_id_t event_id, const pcilib_event_info_t *info, pcilib_event_flags_t flags, size_t size, void *data, void *user);
 
+/**
+ * Callback function checking the register value while waiting in pcilib_wait_register_custom()
+ * @param[in,out] arg	- User-specific data provided in pcilib_wait_register_custom() call
+ * @param[in] value	- the current register value
+ * @return		- non-zero if the waiting is finished
+ */
+typedef int (*pcilib_register_predicate_t)(void *arg, pcilib_register_value_t value);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -279,7 +345,10 @@ int pcilib_set_logger(pcilib_log_priority_t min_prio, pcilib_logger_t logger, vo
  * Initializes pcilib context, detects model configuration, and populates model-specific registers.
  * Event and DMA engines will not be started automatically, but calls to pcilib_start() / pcilib_start_dma()
  * are provided for this purpose. In the end, the context should be cleaned using pcilib_stop().
- * @param[in] device	- path to the device file [/dev/fpga0]
+ * If #PCILIB_DEVICE_EMULATED is passed instead of the device file, the context is created without hardware.
+ * The kernel memory is emulated in the user space and BARs are not available. This is intended for benchmarking
+ * software stack with emulated DMA engines, i.e. "softdma".
+ * @param[in] device	- path to the device file [/dev/fpga0] or #PCILIB_DEVICE_EMULATED
  * @param[in] model	- specifies the model of hardware, autodetected if NULL is passed
  * @return 		- initialized context or NULL in the case of error
  */
@@ -374,6 +443,58 @@ int pcilib_read_fifo(pcilib_t *ctx, pcilib_bar_t bar, uintptr_t addr, uint8_t ac
  */ 
 int pcilib_write_fifo(pcilib_t *ctx, pcilib_bar_t bar, uintptr_t addr, uint8_t access, size_t n, void *buf);
 
+/**
+ * Prepares the handle for burst access to FIFO. The BAR is mapped and the address is resolved only once, so 
+ * the handle should be preferred over pcilib_read_fifo() / pcilib_write_fifo() if FIFO is accessed repeatedly.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] bar	- the BAR with FIFO, use PCILIB_BAR_DETECT to detect bar by the specified physical address
+ * @param[in] addr	- absolute physical address of FIFO or the offset in the specified bar
+ * @param[in] access	- the size of FIFO word in bytes, the single access of this width is performed per word
+ * @return		- FIFO handle or NULL on error
+ */
+pcilib_fifo_t *pcilib_open_fifo(pcilib_t *ctx, pcilib_bar_t bar, uintptr_t addr, uint8_t access);
+
+/**
+ * Destroys FIFO handle
+ * @param[in] fifo	- FIFO handle
+ */
+void pcilib_close_fifo(pcilib_fifo_t *fifo);
+
+/**
+ * Configures the 32-bit status register which is checked to stop the burst early if FIFO is empty (while reading) 
+ * or full (while writing). By default, the status is checked before each word and the transfer is stopped once 
+ * `(status & mask) == value`. If #PCILIB_FIFO_FLAG_STATUS_LEVEL is specified, the masked status is treated
+ * as the number of words which can be transferred and the status is only re-read after they are transferred.
+ * @param[in,out] fifo	- FIFO handle
+ * @param[in] bar	- the BAR with status register, PCILIB_BAR_INVALID disables status checking
+ * @param[in] addr	- absolute physical address of status register or the offset in the specified bar
+ * @param[in] mask	- the bits of status register indicating FIFO state
+ * @param[in] value	- the masked value indicating empty (full) FIFO, ignored in the level mode
+ * @param[in] flags	- specifies how status register is interpreted
+ * @return		- error code or 0 on success
+ */
+int pcilib_set_fifo_status(pcilib_fifo_t *fifo, pcilib_bar_t bar, uintptr_t addr, uint32_t mask, uint32_t value, pcilib_fifo_flags_t flags);
+
+/**
+ * Reads up to \a n words from FIFO. The reading is stopped early if the status register reports that FIFO is empty.
+ * @param[in,out] fifo	- FIFO handle
+ * @param[in] n		- number of words to read
+ * @param[out] buf	- the buffer of at least `n * access` bytes
+ * @param[out] rdsize	- if not NULL, the number of actually read words is returned here
+ * @return		- error code or 0 on success
+ */
+int pcilib_read_fifo_burst(pcilib_fifo_t *fifo, size_t n, void *buf, size_t *rdsize);
+
+/**
+ * Writes up to \a n words to FIFO. The writting is stopped early if the status register reports that FIFO is full.
+ * @param[in,out] fifo	- FIFO handle
+ * @param[in] n		- number of words to write
+ * @param[in] buf	- the buffer of at least `n * access` bytes
+ * @param[out] wrsize	- if not NULL, the number of actually written words is returned here
+ * @return		- error code or 0 on success
+ */
+int pcilib_write_fifo_burst(pcilib_fifo_t *fifo, size_t n, const void *buf, size_t *wrsize);
+
 /** public_api_pci
  * @}
  */
@@ -404,6 +525,25 @@ pcilib_register_info_t *pcilib_get_register_list(pcilib_t *ctx, const char *bank
  */
 pcilib_register_info_t *pcilib_get_register_info(pcilib_t *ctx, const char *bank, const char *reg, pcilib_list_flags_t flags);
 
+/**
+ * Prepares iterator to list the registers one by one without allocating memory for the complete list.
+ * @param[in,out] ctx	- pcilib context
+ * @param[out] iter	- iterator, may be allocated on the stack
+ * @param[in] bank	- if set, only register within the specified bank will be returned
+ * @param[in] flags	- currently ignored
+ * @return 		- error code or 0 on success
+ */
+int pcilib_init_register_iterator(pcilib_t *ctx, pcilib_register_iterator_t *iter, const char *bank, pcilib_list_flags_t flags);
+
+/**
+ * Returns the information about the next register. The returned structure is stored in the iterator and
+ * is overwritten by the next call. The model should not be modified while iterating.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in,out] iter	- iterator initialized with pcilib_init_register_iterator()
+ * @return 		- information about the register or NULL if all registers are listed
+ */
+const pcilib_register_info_t *pcilib_get_next_register(pcilib_t *ctx, pcilib_register_iterator_t *iter);
+
 /**
  * Cleans up the memory occupied by register list returned from the pcilib_get_register_list() and pcilib_get_register_info() calls
  * @param[in,out] ctx	- pcilib context
@@ -475,6 +615,35 @@ int pcilib_read_register_space(pcilib_t *ctx, const char *bank, pcilib_register_
  */
 int pcilib_write_register_space(pcilib_t *ctx, const char *bank, pcilib_register_addr_t addr, size_t n, const pcilib_register_value_t *buf);
 
+/**
+ * Reads one or multiple sequential registers from the specified register bank. If the bank is mapped in the process 
+ * memory as a contiguous block of 32-bit words, the whole span is copied at once instead of reading registers one by one 
+ * through the protocol API. This is also done by pcilib_read_register_space() unless PCILIB_REGISTER_SPACE_FLAG_WORDWISE 
+ * flag is specified.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] bank	- the bank to read (should be specified, no autodetection)
+ * @param[in] addr	- the register address within the bank in bytes
+ * @param[in] n		- number of registers to read
+ * @param[in] flags	- pcilib_register_space_flags_t flags
+ * @param[out] buf	- the buffer of `n * register_size` bytes long where the data will be stored
+ * @return		- error code or 0 on success
+ */
+int pcilib_read_register_space_custom(pcilib_t *ctx, const char *bank, pcilib_register_addr_t addr, size_t n, pcilib_register_space_flags_t flags, pcilib_register_value_t *buf);
+
+/**
+ * Writes one or multiple sequential registers from the specified register bank. The block transfers are used
+ * as described for pcilib_read_register_space_custom(). If PCILIB_REGISTER_SPACE_FLAG_VERIFY is specified, 
+ * the registers are read back and PCILIB_ERROR_VERIFY is returned if the written and read values differ.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] bank	- the bank to write (should be specified, no autodetection)
+ * @param[in] addr	- the register address within the bank in bytes
+ * @param[in] n		- number of registers to write
+ * @param[in] flags	- pcilib_register_space_flags_t flags
+ * @param[in] buf	- the buffer of `n * register_size` bytes long with the data
+ * @return		- error code or 0 on success
+ */
+int pcilib_write_register_space_custom(pcilib_t *ctx, const char *bank, pcilib_register_addr_t addr, size_t n, pcilib_register_space_flags_t flags, const pcilib_register_value_t *buf);
+
 /**
  * Reads the specified register.
  * @param[in,out] ctx	- pcilib context
@@ -504,6 +673,30 @@ int pcilib_write_register_by_id(pcilib_t *ctx, pcilib_register_t reg, pcilib_reg
  */ 
 int pcilib_read_register(pcilib_t *ctx, const char *bank, const char *regname, pcilib_register_value_t *value);
 
+/**
+ * Reads multiple values from the register marked as FIFO in the model (`type="fifo"`). The register is read 
+ * \a n times. If register is mapped in the process memory, the burst FIFO access is used. Otherwise, the 
+ * register is read \a n times using the register protocol.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] reg	- register id
+ * @param[in] n		- number of values to read
+ * @param[out] buf	- the buffer for \a n values
+ * @return		- error code or 0 on success
+ */ 
+int pcilib_read_register_fifo_by_id(pcilib_t *ctx, pcilib_register_t reg, size_t n, pcilib_register_value_t *buf);
+
+/**
+ * Reads multiple values from the FIFO register. 
+ * Equivalent to the pcilib_read_register_fifo_by_id(), but first resolves register id using the specified bank and name.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] bank	- should specify the bank name if register with the same name may occur in multiple banks, NULL otherwise
+ * @param[in] regname	- the name of the register
+ * @param[in] n		- number of values to read
+ * @param[out] buf	- the buffer for \a n values
+ * @return		- error code or 0 on success
+ */ 
+int pcilib_read_register_fifo(pcilib_t *ctx, const char *bank, const char *regname, size_t n, pcilib_register_value_t *buf);
+
 /**
  * Writes to the specified register.
  * Equivalent to the pcilib_write_register_by_id(), but first resolves register id using the specified bank and name.
@@ -515,6 +708,28 @@ int pcilib_read_register(pcilib_t *ctx, const char *bank, const char *regname, p
  */ 
 int pcilib_write_register(pcilib_t *ctx, const char *bank, const char *regname, pcilib_register_value_t value);
 
+/**
+ * Writes multiple values to the register marked as FIFO in the model (`type="fifo"`). 
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] reg	- register id
+ * @param[in] n		- number of values to write
+ * @param[in] buf	- the buffer with \a n values
+ * @return		- error code or 0 on success
+ */ 
+int pcilib_write_register_fifo_by_id(pcilib_t *ctx, pcilib_register_t reg, size_t n, const pcilib_register_value_t *buf);
+
+/**
+ * Writes multiple values to the FIFO register.
+ * Equivalent to the pcilib_write_register_fifo_by_id(), but first resolves register id using the specified bank and name.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] bank	- should specify the bank name if register with the same name may occur in multiple banks, NULL otherwise
+ * @param[in] regname	- the name of the register
+ * @param[in] n		- number of values to write
+ * @param[in] buf	- the buffer with \a n values
+ * @return		- error code or 0 on success
+ */ 
+int pcilib_write_register_fifo(pcilib_t *ctx, const char *bank, const char *regname, size_t n, const pcilib_register_value_t *buf);
+
 
 /**
  * Reads a view of the specified register. The views allow to convert values to standard units
@@ -567,6 +782,87 @@ int pcilib_read_register_view(pcilib_t *ctx, const char *bank, const char *regna
  */ 
 int pcilib_write_register_view(pcilib_t *ctx, const char *bank, const char *regname, const char *view, const pcilib_value_t *value);
 
+/**
+ * Waits until the specified bits of register are set to the expected value, i.e. (value & mask) == expected. 
+ * The register is continuously re-read for a short while and, then, polled with increasing delays. If the model
+ * associates an interrupt with the register (`irq` attribute), the interrupt is awaited instead of sleeping. 
+ * The default policy is used, see pcilib_wait_register_custom() for details.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] reg	- register id
+ * @param[in] mask	- the bits to check
+ * @param[in] expected	- the expected value of the masked bits
+ * @param[in] timeout	- timeout in microseconds, PCILIB_TIMEOUT_IMMEDIATE only checks the current value
+ * @param[out] value	- if not NULL, the last read register value is returned here
+ * @param[out] polls	- if not NULL, the number of register reads is returned here
+ * @return		- error code or 0 on success, PCILIB_ERROR_TIMEOUT if condition is not satisfied in time
+ */
+int pcilib_wait_register_by_id(pcilib_t *ctx, pcilib_register_t reg, pcilib_register_value_t mask, pcilib_register_value_t expected, pcilib_timeout_t timeout, pcilib_register_value_t *value, size_t *polls);
+
+/**
+ * Waits until the specified bits of register are set to the expected value.
+ * Equivalent to the pcilib_wait_register_by_id(), but first resolves register id using the specified bank and name.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] bank	- should specify the bank name if register with the same name may occur in multiple banks, NULL otherwise
+ * @param[in] regname	- the name of the register
+ * @param[in] mask	- the bits to check
+ * @param[in] expected	- the expected value of the masked bits
+ * @param[in] timeout	- timeout in microseconds, PCILIB_TIMEOUT_IMMEDIATE only checks the current value
+ * @param[out] value	- if not NULL, the last read register value is returned here
+ * @param[out] polls	- if not NULL, the number of register reads is returned here
+ * @return		- error code or 0 on success, PCILIB_ERROR_TIMEOUT if condition is not satisfied in time
+ */
+int pcilib_wait_register(pcilib_t *ctx, const char *bank, const char *regname, pcilib_register_value_t mask, pcilib_register_value_t expected, pcilib_timeout_t timeout, pcilib_register_value_t *value, size_t *polls);
+
+/**
+ * Waits until the predicate holds for the register value. The register is re-read without delays during 
+ * the first \a spin_time microseconds of the policy. Afterwards, the delay between polls starts from \a min_sleep 
+ * and is doubled after each poll up to \a max_sleep. If the model associates an interrupt with the register 
+ * (`irq` attribute) and PCILIB_REGISTER_WAIT_FLAG_NOIRQ is not set, the interrupt is awaited for up to the same
+ * delay instead. The register is always re-read after the interrupt, so the interrupt should be enabled by 
+ * caller, but the spurious and lost interrupts are not harmful. 
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] reg	- register id
+ * @param[in] predicate	- the condition to wait for
+ * @param[in,out] arg	- the argument passed to the predicate
+ * @param[in] policy	- waiting policy, NULL selects the default (50 us spinning, then delays from 10 us to 1 ms)
+ * @param[in] timeout	- timeout in microseconds, PCILIB_TIMEOUT_IMMEDIATE only checks the current value
+ * @param[out] value	- if not NULL, the last read register value is returned here
+ * @param[out] stats	- if not NULL, the number of polls, delays, and interrupts is returned here
+ * @return		- error code or 0 on success, PCILIB_ERROR_TIMEOUT if condition is not satisfied in time
+ */
+int pcilib_wait_register_custom(pcilib_t *ctx, pcilib_register_t reg, pcilib_register_predicate_t predicate, void *arg, const pcilib_register_wait_policy_t *policy, pcilib_timeout_t timeout, pcilib_register_value_t *value, pcilib_register_wait_stats_t *stats);
+
+/**
+ * Prepares a snapshot of the specified set of registers. The registers are sorted by bank and address,
+ * the overlapping words are merged, and the contiguous words are grouped in runs. Each run of memory-mapped
+ * registers is then read with a single block access by pcilib_read_register_snapshot(). FIFO registers
+ * are not accepted since reading them pops the data.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] n		- number of registers in the snapshot
+ * @param[in] regs	- list of register ids
+ * @return		- snapshot handle or NULL on error
+ */
+pcilib_register_snapshot_t *pcilib_create_register_snapshot(pcilib_t *ctx, size_t n, const pcilib_register_t *regs);
+
+/**
+ * Reads all registers of the snapshot. The values are returned in the order the registers were
+ * specified in pcilib_create_register_snapshot(). The locks of all involved register banks are held
+ * for the whole snapshot and are always obtained in the order of bank ids.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] snapshot	- snapshot handle
+ * @param[out] timestamp - if not NULL, the time the snapshot was started is returned here
+ * @param[out] values	- the register values are returned here (the array should have space for all registers of the snapshot)
+ * @return		- error code or 0 on success
+ */
+int pcilib_read_register_snapshot(pcilib_t *ctx, pcilib_register_snapshot_t *snapshot, struct timeval *timestamp, pcilib_register_value_t *values);
+
+/**
+ * Releases the snapshot and the associated resources
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] snapshot	- snapshot handle
+ */
+void pcilib_free_register_snapshot(pcilib_t *ctx, pcilib_register_snapshot_t *snapshot);
+
 /** public_api_register
  * @}
  */
@@ -593,6 +889,28 @@ pcilib_property_info_t *pcilib_get_property_list(pcilib_t *ctx, const char *bran
  */
 void pcilib_free_property_info(pcilib_t *ctx, pcilib_property_info_t *info);
 
+/**
+ * Prepares iterator to list the properties and directories under the specified path one by one. The
+ * properties are listed first, the pure directories afterwards. Nothing is allocated, the entries are
+ * taken from the property tree maintained by pcilib as the views are added.
+ * @param[in,out] ctx	- pcilib context
+ * @param[out] iter	- iterator, may be allocated on the stack
+ * @param[in] branch	- path or NULL to list the top-level properties
+ * @param[in] flags	- not used at the moment
+ * @return 		- error code or 0 on success, #PCILIB_ERROR_NOTFOUND if the path does not exist
+ */
+int pcilib_init_property_iterator(pcilib_t *ctx, pcilib_property_iterator_t *iter, const char *branch, pcilib_list_flags_t flags);
+
+/**
+ * Returns the information about the next property or directory. The returned structure is stored in the
+ * iterator and is overwritten by the next call. The strings are owned by pcilib and are valid until the 
+ * model is modified.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in,out] iter	- iterator initialized with pcilib_init_property_iterator()
+ * @return 		- information about the property or NULL if all entries are listed
+ */
+const pcilib_property_info_t *pcilib_get_next_property(pcilib_t *ctx, pcilib_property_iterator_t *iter);
+
 /**
  * Extracts additional information about the specified register. 
  * Equivalent to the pcilib_get_register_attr_by_id(), but first resolves register id using the specified bank and name.
@@ -791,6 +1109,24 @@ int pcilib_read_dma_custom(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t add
  */
 int pcilib_read_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, void *buf, size_t *rdsize);
 
+/**
+ * Reads data from DMA into the vector of buffers. The data is scattered over buffers page by page directly from 
+ * DMA pages, so the caller does not need to assemble a contiguous buffer first. The total size of all buffers is 
+ * handled exactly as the buffer size in pcilib_read_dma_custom(), please check it for detailed explanation when
+ * reading is stopped. The function is process- and thread-safe.
+ *
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] dma	- ID of DMA engine, the ID should first be resolved using pcilib_find_dma_by_addr()
+ * @param[in] addr	- instructs DMA to start reading at the specified address (not supported by existing DMA engines)
+ * @param[in] iov	- the vector of buffers to store the data, the buffers are filled in order
+ * @param[in] iovcnt	- number of buffers in the vector
+ * @param[in] flags	- #PCILIB_DMA_FLAG_MULTIPACKET and #PCILIB_DMA_FLAG_WAIT are supported, see pcilib_read_dma_custom()
+ * @param[in] timeout	- specifies number of microseconds to wait before reporting timeout, special values #PCILIB_TIMEOUT_IMMEDIATE and #PCILIB_TIMEOUT_INFINITE are supported.
+ * @param[out] rdsize	- number of bytes which were actually read. The correct value will be reported in both case if function has finished successfully or if error has happened.
+ * @return 		- error code or 0 on success. In both cases some data may be returned in the buffers, check `rdsize`.
+ */
+int pcilib_readv_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, const struct iovec *iov, int iovcnt, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, size_t *rdsize);
+
 /**
  * Pushes new data to the DMA engine. The actual behavior is implementation dependent. The successful exit does not mean
  * what all data have reached hardware, but only guarantees that it is stored in DMA buffers and the hardware is instructed
@@ -837,6 +1173,83 @@ int pcilib_push_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, size
  */
 int pcilib_write_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, size_t size, void *buf, size_t *wrsize);
 
+/**
+ * Pushes the vector of buffers to the DMA engine, i.e. the header and payload can be send without copying 
+ * them in a single buffer first. The buffers are pushed in order while the engine is locked, the #PCILIB_DMA_FLAG_EOP and 
+ * #PCILIB_DMA_FLAG_WAIT flags are only applied to the last buffer. Otherwise, the behavior is the same as of pcilib_push_dma().
+ *
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] dma	- ID of DMA engine, the ID should first be resolved using pcilib_find_dma_by_addr()
+ * @param[in] addr	- instructs DMA to start writting at the specified address (not supported by existing DMA engines)
+ * @param[in] iov	- the vector of buffers with the data
+ * @param[in] iovcnt	- number of buffers in the vector
+ * @param[in] flags	- Various flags controlling the function behavior, see pcilib_push_dma()
+ * @param[in] timeout	- specifies number of microseconds to wait before reporting timeout, special values #PCILIB_TIMEOUT_IMMEDIATE and #PCILIB_TIMEOUT_INFINITE are supported.
+ * @param[out] wrsize	- number of bytes which were actually written. The correct value will be reported in both case if function has finished successfully or if error has happened.
+ * @return 		- error code or 0 on success. In both cases some data may be written to the DMA, check `wrsize`.
+ */
+int pcilib_writev_dma(pcilib_t *ctx, pcilib_dma_engine_t dma, uintptr_t addr, const struct iovec *iov, int iovcnt, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, size_t *wrsize);
+
+/**
+ * Opens the DMA session. The session keeps the DMA engine started and locked until it is closed, so
+ * the subsequent reads and writes skip the validation, locking, and engine start-up checks performed
+ * on each call by pcilib_stream_dma() and pcilib_push_dma(). This reduces the latency of short and 
+ * frequent transfers. Other threads and processes will get #PCILIB_ERROR_BUSY while the session is
+ * open. The session is not thread-safe and should be closed by the thread which has opened it. The
+ * DMA engine should not be stopped while the session is open.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] dma	- ID of DMA engine, the ID should first be resolved using pcilib_find_dma_by_addr()
+ * @param[in] direction	- specifies if session is used for reading, writting, or both
+ * @param[in] flags	- the flags passed to pcilib_start_dma()
+ * @return		- the session or NULL in the case of error
+ */
+pcilib_dma_session_t *pcilib_open_dma_session(pcilib_t *ctx, pcilib_dma_engine_t dma, pcilib_dma_direction_t direction, pcilib_dma_flags_t flags);
+
+/**
+ * Closes the DMA session and unlocks the DMA engine. The engine is not stopped, use pcilib_stop_dma() if necessary.
+ * @param[in,out] session - the DMA session
+ */
+void pcilib_close_dma_session(pcilib_dma_session_t *session);
+
+/**
+ * Reads data from DMA engine using the session, see pcilib_stream_dma() for details.
+ * @param[in,out] session - the DMA session opened for reading
+ * @param[in] addr	- instructs DMA to start reading at the specified address (not supported by existing DMA engines)
+ * @param[in] size	- specifies how many bytes should be read (0 - unlimited, until callback will request to stop)
+ * @param[in] flags	- Various flags controlling the function behavior, see pcilib_stream_dma()
+ * @param[in] timeout	- specifies number of microseconds to wait before reporting timeout
+ * @param[in] cb	- callback function to call on each buffer
+ * @param[in,out] cbattr - context to pass to the callback function
+ * @return 		- error code or 0 on success
+ */
+int pcilib_session_stream_dma(pcilib_dma_session_t *session, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, pcilib_dma_callback_t cb, void *cbattr);
+
+/**
+ * Reads data from DMA engine into the buffer using the session, see pcilib_read_dma_custom() for details.
+ * @param[in,out] session - the DMA session opened for reading
+ * @param[in] addr	- instructs DMA to start reading at the specified address (not supported by existing DMA engines)
+ * @param[in] size	- specifies the size of the buffer
+ * @param[in] flags	- #PCILIB_DMA_FLAG_MULTIPACKET and #PCILIB_DMA_FLAG_WAIT are supported, see pcilib_read_dma_custom()
+ * @param[in] timeout	- specifies number of microseconds to wait before reporting timeout
+ * @param[out] buf	- the buffer to store the data
+ * @param[out] rdsize	- number of bytes which were actually read
+ * @return 		- error code or 0 on success. In both cases some data may be read, check `rdsize`.
+ */
+int pcilib_session_read_dma(pcilib_dma_session_t *session, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, void *buf, size_t *rdsize);
+
+/**
+ * Pushes the data to DMA engine using the session, see pcilib_push_dma() for details.
+ * @param[in,out] session - the DMA session opened for writting
+ * @param[in] addr	- instructs DMA to start writting at the specified address (not supported by existing DMA engines)
+ * @param[in] size	- specifies how many bytes should be written
+ * @param[in] flags	- Various flags controlling the function behavior, see pcilib_push_dma()
+ * @param[in] timeout	- specifies number of microseconds to wait before reporting timeout
+ * @param[in] buf	- the buffer with the data
+ * @param[out] wrsize	- number of bytes which were actually written
+ * @return 		- error code or 0 on success. In both cases some data may be written to the DMA, check `wrsize`.
+ */
+int pcilib_session_push_dma(pcilib_dma_session_t *session, uintptr_t addr, size_t size, pcilib_dma_flags_t flags, pcilib_timeout_t timeout, void *buf, size_t *wrsize);
+
 /**
  * Benchmarks the DMA implementation. The reported performance may be significantly affected by several environmental variables.
  *  - PCILIB_BENCHMARK_HARDWARE	 - if set will not copy the data out, but immediately drop as it lended in DMA buffers. This allows to remove influence of memcpy performance.
@@ -869,6 +1282,19 @@ double pcilib_benchmark_dma(pcilib_t *ctx, pcilib_dma_engine_addr_t dma, uintptr
 int pcilib_enable_irq(pcilib_t *ctx, pcilib_irq_type_t irq_type, pcilib_dma_flags_t flags);
 int pcilib_disable_irq(pcilib_t *ctx, pcilib_dma_flags_t flags);
 int pcilib_wait_irq(pcilib_t *ctx, pcilib_irq_hw_source_t source, pcilib_timeout_t timeout, size_t *count);
+
+/**
+ * Waits for the interrupt and returns the time it was received by the driver. The driver waits once with 
+ * the exact (sub-jiffy) timeout. The zero timeout only checks if interrupts are already pending.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] source	- the hardware IRQ source
+ * @param[in] timeout	- specifies number of microseconds to wait before reporting timeout, #PCILIB_TIMEOUT_INFINITE is supported.
+ * @param[out] count	- if specified, all pending interrupts are consumed and their number is returned, otherwise a single interrupt is consumed
+ * @param[out] timestamp - if specified, the time of the last consumed interrupt is returned in nanoseconds. The 
+ *			monotonic clock is used, the values are comparable with pcilib_time_ns().
+ * @return		- error code or 0 on success, PCILIB_ERROR_TIMEOUT if no interrupts have arrived
+ */
+int pcilib_wait_irq_timestamp(pcilib_t *ctx, pcilib_irq_hw_source_t source, pcilib_timeout_t timeout, size_t *count, uint64_t *timestamp);
 int pcilib_acknowledge_irq(pcilib_t *ctx, pcilib_irq_type_t irq_type, pcilib_irq_source_t irq_source);
 int pcilib_clear_irq(pcilib_t *ctx, pcilib_irq_hw_source_t source);
 
@@ -1101,6 +1527,66 @@ pcilib_event_data_type_t pcilib_find_event_data_type(pcilib_t *ctx, pcilib_event
  */
 int pcilib_grab(pcilib_t *ctx, pcilib_event_t event, size_t *size, void **data, pcilib_timeout_t timeout);
 
+/**
+ * Grabs the event like pcilib_grab(), but instead of copying the default data into the user buffer,
+ * returns a pointer to the data kept by the event engine. The engine is left running and the buffer
+ * remains valid until pcilib_grab_release() is called. Only a single event can be borrowed at a time.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] event	- the event to trigger and/or event mask to grab
+ * @param[out] size	- the size of the event data is returned in this parameter (may be NULL)
+ * @param[out] data	- the pointer to the event data is returned in this parameter
+ * @param[in] timeout	- either is equal to #PCILIB_TIMEOUT_IMMEDIATE for immediate software trigger or specifies number of microseconds to wait for event triggered by hardware
+ * @return 		- error code or 0 on success, #PCILIB_ERROR_BUSY if the previously borrowed event is not released yet
+ */
+int pcilib_grab_borrow(pcilib_t *ctx, pcilib_event_t event, size_t *size, void **data, pcilib_timeout_t timeout);
+
+/**
+ * Returns the data obtained with pcilib_grab_borrow() to the event engine and stops the grabbing.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] data	- the pointer returned by pcilib_grab_borrow()
+ * @return 		- error code or 0 on success, #PCILIB_ERROR_OVERWRITTEN if the data was overwritten while borrowed
+ */
+int pcilib_grab_release(pcilib_t *ctx, void *data);
+
+/**
+ * Allocates a pool of page-aligned buffers which are reused by pcilib_grab_pooled() calls.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in] n		- number of buffers
+ * @param[in] size	- size of each buffer, should be big enough to hold the default data of the event
+ * @return 		- the pool or NULL on error
+ */
+pcilib_grab_pool_t *pcilib_alloc_grab_pool(pcilib_t *ctx, size_t n, size_t size);
+
+/**
+ * Destroys the grab pool. All buffers obtained from the pool are invalidated.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in,out] pool	- the pool
+ */
+void pcilib_free_grab_pool(pcilib_t *ctx, pcilib_grab_pool_t *pool);
+
+/**
+ * Grabs the event like pcilib_grab(), but copies the default data into the free buffer of the pool. The
+ * event engine may decode the data directly into the buffer. The buffer is owned by the caller until
+ * it is returned with pcilib_release_pooled().
+ * @param[in,out] ctx	- pcilib context
+ * @param[in,out] pool	- the pool to take the buffer from
+ * @param[in] event	- the event to trigger and/or event mask to grab
+ * @param[out] size	- the amount of data written into the buffer is returned in this parameter (may be NULL)
+ * @param[out] data	- the pointer to the buffer is returned in this parameter
+ * @param[in] timeout	- either is equal to #PCILIB_TIMEOUT_IMMEDIATE for immediate software trigger or specifies number of microseconds to wait for event triggered by hardware
+ * @return 		- error code or 0 on success, #PCILIB_ERROR_BUSY if all buffers are in use, #PCILIB_ERROR_TOOBIG if the data does not fit the buffer
+ */
+int pcilib_grab_pooled(pcilib_t *ctx, pcilib_grab_pool_t *pool, pcilib_event_t event, size_t *size, void **data, pcilib_timeout_t timeout);
+
+/**
+ * Returns the buffer obtained with pcilib_grab_pooled() back to the pool.
+ * @param[in,out] ctx	- pcilib context
+ * @param[in,out] pool	- the pool
+ * @param[in] data	- the buffer
+ * @return 		- error code or 0 on success
+ */
+int pcilib_release_pooled(pcilib_t *ctx, pcilib_grab_pool_t *pool, void *data);
+
 /**
  * Copies the data of the specified type associated with the specified event into the provided buffer. May return #PCILIB_ERROR_OVERWRITTEN
  * if the data was overwritten during the call.
@@ -0,0 +1,380 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "pci.h"
+#include "cpu.h"
+#include "error.h"
+#include "preproc.h"
+
+typedef enum {
+    PCILIB_PREPROC_SLOT_FREE = 0,		/**< Slot is not used */
+    PCILIB_PREPROC_SLOT_PENDING,		/**< Raw data is queued, but not picked by a worker yet */
+    PCILIB_PREPROC_SLOT_PROCESSING,		/**< Raw data is decoded by a worker */
+    PCILIB_PREPROC_SLOT_READY			/**< Decoding is finished (possibly with error) */
+} pcilib_preproc_slot_state_t;
+
+typedef struct {
+    pcilib_event_id_t event_id;			/**< Event occupying the slot */
+    pcilib_preproc_slot_state_t state;		/**< State of the slot */
+    int err;					/**< Error reported by the decoding callback */
+    const void *raw;				/**< Raw event data */
+    size_t raw_size;				/**< Size of the raw event data */
+    void *buf;					/**< Buffer with decoded data */
+    size_t buf_size;				/**< Allocated size of the buffer */
+    size_t size;				/**< Size of the decoded data */
+} pcilib_preproc_slot_t;
+
+struct pcilib_preproc_s {
+    pcilib_t *ctx;				/**< pcilib context */
+
+    pcilib_preproc_callback_t process;		/**< Decoding callback */
+    void *user;					/**< User argument of the decoding callback */
+
+    size_t num_threads;				/**< Number of worker threads */
+    size_t started_threads;			/**< Number of successfully started worker threads */
+    pthread_t *threads;				/**< Worker threads */
+
+    size_t queue_size;				/**< Number of slots */
+    size_t buf_size;				/**< Size of the decoded data buffer in each slot */
+    pcilib_preproc_slot_t *slots;		/**< Event slots, the event is stored in slot `event_id % queue_size` */
+
+    pcilib_event_id_t next_push;		/**< Id which will be assigned to the next pushed event */
+    pcilib_event_id_t next_process;		/**< Next event to be picked by a worker */
+    pcilib_event_id_t next_deliver;		/**< Next event to be delivered by pcilib_preproc_get_next() */
+
+    int run_flag;				/**< Cleared to stop workers */
+    int finished;				/**< Set when no more events will be pushed */
+
+    pthread_mutex_t mutex;			/**< Protects all members above */
+    pthread_cond_t pending_cond;		/**< Signaled when new raw data is pushed */
+    pthread_cond_t ready_cond;			/**< Signaled when event is decoded */
+    pthread_cond_t free_cond;			/**< Signaled when slot is released */
+};
+
+
+static void *pcilib_preproc_thread(void *arg) {
+    int err;
+    void *buf;
+    size_t size;
+    pcilib_event_id_t event_id;
+    pcilib_preproc_slot_t *slot;
+    pcilib_preproc_t *pp = (pcilib_preproc_t*)arg;
+
+    pthread_mutex_lock(&pp->mutex);
+    while (pp->run_flag) {
+	if (pp->next_process == pp->next_push) {
+	    pthread_cond_wait(&pp->pending_cond, &pp->mutex);
+	    continue;
+	}
+
+	event_id = pp->next_process++;
+	slot = pp->slots + (event_id % pp->queue_size);
+	slot->state = PCILIB_PREPROC_SLOT_PROCESSING;
+	pthread_mutex_unlock(&pp->mutex);
+
+	size = slot->buf_size;
+	err = pp->process(pp->user, event_id, slot->raw, slot->raw_size, slot->buf, &size);
+
+	    // The slot is owned by the worker until it is ready, so the buffer can be safely enlarged
+	if ((err == PCILIB_ERROR_TOOBIG)&&(size > slot->buf_size)) {
+	    buf = realloc(slot->buf, size);
+	    if (buf) {
+		slot->buf = buf;
+		slot->buf_size = size;
+		err = pp->process(pp->user, event_id, slot->raw, slot->raw_size, slot->buf, &size);
+	    } else {
+		pcilib_error("Error allocating %zu bytes for decoded event data", size);
+		err = PCILIB_ERROR_MEMORY;
+	    }
+	}
+
+	pthread_mutex_lock(&pp->mutex);
+	slot->err = err;
+	slot->size = size;
+	slot->state = PCILIB_PREPROC_SLOT_READY;
+	pthread_cond_broadcast(&pp->ready_cond);
+    }
+    pthread_mutex_unlock(&pp->mutex);
+
+    return NULL;
+}
+
+static int pcilib_preproc_wait(pcilib_preproc_t *pp, pthread_cond_t *cond, pcilib_timeout_t timeout, struct timespec *deadline) {
+    int err;
+
+    if (!pp->run_flag)
+	return PCILIB_ERROR_INVALID_STATE;
+
+    if (timeout == PCILIB_TIMEOUT_IMMEDIATE)
+	return PCILIB_ERROR_TIMEOUT;
+
+    if (timeout == PCILIB_TIMEOUT_INFINITE) {
+	pthread_cond_wait(cond, &pp->mutex);
+	return 0;
+    }
+
+    if (!deadline->tv_sec) {
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	deadline->tv_sec += timeout / 1000000;
+	deadline->tv_nsec += 1000 * (timeout % 1000000);
+	if (deadline->tv_nsec >= 1000000000) {
+	    deadline->tv_sec++;
+	    deadline->tv_nsec -= 1000000000;
+	}
+    }
+
+    err = pthread_cond_timedwait(cond, &pp->mutex, deadline);
+    if (err == ETIMEDOUT) return PCILIB_ERROR_TIMEOUT;
+
+    return 0;
+}
+
+pcilib_preproc_t *pcilib_preproc_create(pcilib_t *ctx, size_t max_threads, size_t queue_size, size_t buf_size, pcilib_preproc_callback_t process, void *user) {
+    int err;
+    size_t i;
+    pcilib_preproc_t *pp;
+    pthread_condattr_t cattr;
+
+    if (!process) {
+	pcilib_error("The decoding callback is not specified");
+	return NULL;
+    }
+
+    if (!max_threads) max_threads = pcilib_get_cpu_count();
+    if (!max_threads) max_threads = 1;
+    if (!queue_size) queue_size = PCILIB_PREPROC_DEFAULT_QUEUE_SIZE;
+    if (queue_size < max_threads) queue_size = max_threads;
+
+    pp = (pcilib_preproc_t*)malloc(sizeof(pcilib_preproc_t));
+    if (!pp) {
+	pcilib_error("Error allocating memory for the preprocessing pool");
+	return NULL;
+    }
+
+    memset(pp, 0, sizeof(pcilib_preproc_t));
+
+    pp->ctx = ctx;
+    pp->process = process;
+    pp->user = user;
+    pp->num_threads = max_threads;
+    pp->queue_size = queue_size;
+    pp->buf_size = buf_size;
+    pp->next_push = 1;
+    pp->next_process = 1;
+    pp->next_deliver = 1;
+    pp->run_flag = 1;
+
+    pthread_mutex_init(&pp->mutex, NULL);
+
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pp->pending_cond, &cattr);
+    pthread_cond_init(&pp->ready_cond, &cattr);
+    pthread_cond_init(&pp->free_cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
+    pp->slots = (pcilib_preproc_slot_t*)calloc(queue_size, sizeof(pcilib_preproc_slot_t));
+    pp->threads = (pthread_t*)malloc(max_threads * sizeof(pthread_t));
+    if ((!pp->slots)||(!pp->threads)) {
+	pcilib_error("Error allocating memory for the preprocessing pool");
+	pcilib_preproc_free(pp);
+	return NULL;
+    }
+
+    if (buf_size) {
+	for (i = 0; i < queue_size; i++) {
+	    pp->slots[i].buf = malloc(buf_size);
+	    if (!pp->slots[i].buf) {
+		pcilib_error("Error allocating %zu bytes for decoded event data", buf_size);
+		pcilib_preproc_free(pp);
+		return NULL;
+	    }
+	    pp->slots[i].buf_size = buf_size;
+	}
+    }
+
+    for (i = 0; i < max_threads; i++) {
+	err = pthread_create(pp->threads + i, NULL, pcilib_preproc_thread, pp);
+	if (err) {
+	    pcilib_error("Error (%i) starting preprocessing thread", err);
+	    pcilib_preproc_free(pp);
+	    return NULL;
+	}
+	pp->started_threads++;
+    }
+
+    return pp;
+}
+
+void pcilib_preproc_free(pcilib_preproc_t *pp) {
+    size_t i;
+
+    pthread_mutex_lock(&pp->mutex);
+    pp->run_flag = 0;
+    pthread_cond_broadcast(&pp->pending_cond);
+    pthread_cond_broadcast(&pp->ready_cond);
+    pthread_cond_broadcast(&pp->free_cond);
+    pthread_mutex_unlock(&pp->mutex);
+
+    for (i = 0; i < pp->started_threads; i++)
+	pthread_join(pp->threads[i], NULL);
+
+    if (pp->slots) {
+	for (i = 0; i < pp->queue_size; i++) {
+	    if (pp->slots[i].buf) free(pp->slots[i].buf);
+	}
+	free(pp->slots);
+    }
+
+    if (pp->threads) free(pp->threads);
+
+    pthread_cond_destroy(&pp->free_cond);
+    pthread_cond_destroy(&pp->ready_cond);
+    pthread_cond_destroy(&pp->pending_cond);
+    pthread_mutex_destroy(&pp->mutex);
+
+    free(pp);
+}
+
+void pcilib_preproc_finish(pcilib_preproc_t *pp) {
+    pthread_mutex_lock(&pp->mutex);
+    pp->finished = 1;
+    pthread_cond_broadcast(&pp->ready_cond);
+    pthread_mutex_unlock(&pp->mutex);
+}
+
+size_t pcilib_preproc_get_threads(pcilib_preproc_t *pp) {
+    return pp->num_threads;
+}
+
+int pcilib_preproc_push(pcilib_preproc_t *pp, const void *raw, size_t raw_size, pcilib_timeout_t timeout, pcilib_event_id_t *event_id) {
+    int err = 0;
+    pcilib_preproc_slot_t *slot;
+    struct timespec deadline = {0};
+
+    pthread_mutex_lock(&pp->mutex);
+
+    if (pp->finished) {
+	pthread_mutex_unlock(&pp->mutex);
+	pcilib_error("The preprocessing pool is already finished");
+	return PCILIB_ERROR_INVALID_STATE;
+    }
+
+    slot = pp->slots + (pp->next_push % pp->queue_size);
+    while (slot->state != PCILIB_PREPROC_SLOT_FREE) {
+	err = pcilib_preproc_wait(pp, &pp->free_cond, timeout, &deadline);
+	if (err) break;
+    }
+
+    if (!err) {
+	slot->event_id = pp->next_push++;
+	slot->state = PCILIB_PREPROC_SLOT_PENDING;
+	slot->err = 0;
+	slot->raw = raw;
+	slot->raw_size = raw_size;
+	slot->size = 0;
+
+	if (event_id) *event_id = slot->event_id;
+
+	pthread_cond_signal(&pp->pending_cond);
+    }
+
+    pthread_mutex_unlock(&pp->mutex);
+
+    return err;
+}
+
+int pcilib_preproc_get_next(pcilib_preproc_t *pp, pcilib_timeout_t timeout, pcilib_event_id_t *event_id) {
+    int err = 0;
+    struct timespec deadline = {0};
+    pcilib_preproc_slot_t *slot;
+
+    pthread_mutex_lock(&pp->mutex);
+
+    while (1) {
+	if (pp->next_deliver < pp->next_push) {
+	    slot = pp->slots + (pp->next_deliver % pp->queue_size);
+
+		// The event was already accessed and returned by id
+	    if ((slot->event_id != pp->next_deliver)||(slot->state == PCILIB_PREPROC_SLOT_FREE)) {
+		pp->next_deliver++;
+		continue;
+	    }
+
+	    if (slot->state == PCILIB_PREPROC_SLOT_READY)
+		break;
+	} else if (pp->finished) {
+	    err = PCILIB_ERROR_NOTAVAILABLE;
+	    break;
+	}
+
+	err = pcilib_preproc_wait(pp, &pp->ready_cond, timeout, &deadline);
+	if (err) break;
+    }
+
+    if (!err) *event_id = pp->next_deliver++;
+
+    pthread_mutex_unlock(&pp->mutex);
+
+    return err;
+}
+
+int pcilib_preproc_get_data(pcilib_preproc_t *pp, pcilib_event_id_t event_id, pcilib_timeout_t timeout, void **data, size_t *size) {
+    int err = 0;
+    pcilib_preproc_slot_t *slot = pp->slots + (event_id % pp->queue_size);
+    struct timespec deadline = {0};
+
+    pthread_mutex_lock(&pp->mutex);
+
+    while (1) {
+	if (event_id < pp->next_push) {
+	    if ((slot->event_id != event_id)||(slot->state == PCILIB_PREPROC_SLOT_FREE)) {
+		err = PCILIB_ERROR_OVERWRITTEN;
+		break;
+	    }
+	    if (slot->state == PCILIB_PREPROC_SLOT_READY) {
+		err = slot->err;
+		break;
+	    }
+	}
+
+	err = pcilib_preproc_wait(pp, &pp->ready_cond, timeout, &deadline);
+	if (err) break;
+    }
+
+    if (!err) {
+	*data = slot->buf;
+	*size = slot->size;
+    }
+
+    pthread_mutex_unlock(&pp->mutex);
+
+    return err;
+}
+
+int pcilib_preproc_return(pcilib_preproc_t *pp, pcilib_event_id_t event_id) {
+    int err = 0;
+    pcilib_preproc_slot_t *slot = pp->slots + (event_id % pp->queue_size);
+
+    pthread_mutex_lock(&pp->mutex);
+
+    if ((event_id >= pp->next_push)||(slot->event_id != event_id)||(slot->state == PCILIB_PREPROC_SLOT_FREE)) {
+	err = PCILIB_ERROR_OVERWRITTEN;
+    } else if (slot->state != PCILIB_PREPROC_SLOT_READY) {
+	err = PCILIB_ERROR_BUSY;
+    } else {
+	slot->state = PCILIB_PREPROC_SLOT_FREE;
+	pthread_cond_broadcast(&pp->free_cond);
+    }
+
+    pthread_mutex_unlock(&pp->mutex);
+
+    return err;
+}
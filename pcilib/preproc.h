@@ -0,0 +1,130 @@
+/**
+ * @file preproc.h
+ * @brief Pool of threads preprocessing raw event data for the event engines
+ *
+ * @details The event engines are normally reading raw data from DMA in a real-time thread and decoding
+ * it into the events when the consumer requests the data with pcilib_get_data(). To decode multiple events
+ * in parallel and ahead of the consumer, the engine may push the raw chunks into the preprocessing pool.
+ * The pool runs the configured number of worker threads which decode the chunks into the pre-allocated
+ * per-event buffers using the engine-supplied callback. The queue is bounded: pcilib_preproc_push() blocks
+ * until a slot is released by the consumer. The events are delivered in the order they were pushed
+ * regardless of the order the workers complete the decoding.
+ *
+ * Typical usage in the engine:
+ *  - start: pcilib_preproc_create() with the number of threads from pcilib_event_parameters_t::parallel
+ *  - reader thread: pcilib_preproc_push() for each complete raw event
+ *  - next_event: pcilib_preproc_get_next()
+ *  - get_data: pcilib_preproc_get_data()
+ *  - return_data: pcilib_preproc_return()
+ *  - stop: pcilib_preproc_free()
+ *
+ * Alternatively, the engine may only provide the preprocess callback (see event.h). Then pcilib runs the pool
+ * itself: a reader thread copies the raw events out of the engine and pushes them into the pool, while
+ * pcilib_stream(), pcilib_get_next_event(), pcilib_get_data(), and pcilib_return_data() are served from the pool.
+ */
+
+#ifndef _PCILIB_PREPROC_H
+#define _PCILIB_PREPROC_H
+
+#include <pcilib.h>
+
+#define PCILIB_PREPROC_DEFAULT_QUEUE_SIZE	64		/**< Default number of events in flight */
+
+typedef struct pcilib_preproc_s pcilib_preproc_t;
+
+/**
+ * Decodes a single raw event. The callback is executed in parallel in the worker threads.
+ * @param[in] user	- user-supplied argument of pcilib_preproc_create()
+ * @param[in] event_id	- event id assigned to the event by pcilib_preproc_push()
+ * @param[in] raw	- raw event data
+ * @param[in] raw_size	- size of the raw event data in bytes
+ * @param[out] buf	- buffer to store the decoded data
+ * @param[in,out] size	- size of the buffer on input, size of the decoded data on output
+ * @return		- error code or 0 on success, the error is reported to the consumer by pcilib_preproc_get_data().
+ *			  If the buffer is too small, the callback may return #PCILIB_ERROR_TOOBIG with the required
+ *			  size, the buffer is then enlarged and the callback is executed again.
+ */
+typedef int (*pcilib_preproc_callback_t)(void *user, pcilib_event_id_t event_id, const void *raw, size_t raw_size, void *buf, size_t *size);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates the preprocessing pool and starts the worker threads
+ * @param[in] ctx	- pcilib context
+ * @param[in] max_threads - number of worker threads, 0 - one thread per CPU core
+ * @param[in] queue_size - maximal number of events which are queued, processed, or held by consumer
+ * @param[in] buf_size	- size of the buffer for the decoded data of a single event
+ * @param[in] process	- callback decoding the raw data
+ * @param[in] user	- user argument passed to the callback
+ * @return		- preprocessing pool or NULL on error
+ */
+pcilib_preproc_t *pcilib_preproc_create(pcilib_t *ctx, size_t max_threads, size_t queue_size, size_t buf_size, pcilib_preproc_callback_t process, void *user);
+
+/**
+ * Stops the worker threads and releases the pool. The pending events are dropped.
+ * @param[in,out] pp	- preprocessing pool
+ */
+void pcilib_preproc_free(pcilib_preproc_t *pp);
+
+/**
+ * Indicates that no more events will be pushed. Once all pushed events are delivered,
+ * pcilib_preproc_get_next() returns #PCILIB_ERROR_NOTAVAILABLE instead of waiting.
+ * @param[in,out] pp	- preprocessing pool
+ */
+void pcilib_preproc_finish(pcilib_preproc_t *pp);
+
+/**
+ * Returns the number of worker threads
+ * @param[in] pp	- preprocessing pool
+ * @return		- number of worker threads
+ */
+size_t pcilib_preproc_get_threads(pcilib_preproc_t *pp);
+
+/**
+ * Queues the raw event for decoding. The raw data should stay valid until the event is returned by
+ * pcilib_preproc_return(). Blocks until a queue slot is available or the timeout is expired.
+ * @param[in,out] pp	- preprocessing pool
+ * @param[in] raw	- raw event data
+ * @param[in] raw_size	- size of the raw event data in bytes
+ * @param[in] timeout	- timeout waiting for free slot, special values #PCILIB_TIMEOUT_IMMEDIATE and #PCILIB_TIMEOUT_INFINITE are supported
+ * @param[out] event_id	- if not NULL, the sequential id assigned to the event is returned here (starting from 1)
+ * @return		- error code or 0 on success
+ */
+int pcilib_preproc_push(pcilib_preproc_t *pp, const void *raw, size_t raw_size, pcilib_timeout_t timeout, pcilib_event_id_t *event_id);
+
+/**
+ * Waits until the next event in order is decoded
+ * @param[in,out] pp	- preprocessing pool
+ * @param[in] timeout	- timeout, special values #PCILIB_TIMEOUT_IMMEDIATE and #PCILIB_TIMEOUT_INFINITE are supported
+ * @param[out] event_id	- id of the event
+ * @return		- error code or 0 on success, #PCILIB_ERROR_NOTAVAILABLE if the pool is finished and all events are delivered
+ */
+int pcilib_preproc_get_next(pcilib_preproc_t *pp, pcilib_timeout_t timeout, pcilib_event_id_t *event_id);
+
+/**
+ * Waits until the specified event is decoded and returns the decoded data. The data stays valid until
+ * pcilib_preproc_return() is called.
+ * @param[in,out] pp	- preprocessing pool
+ * @param[in] event_id	- id of the event
+ * @param[in] timeout	- timeout, special values #PCILIB_TIMEOUT_IMMEDIATE and #PCILIB_TIMEOUT_INFINITE are supported
+ * @param[out] data	- pointer to the decoded data is returned here
+ * @param[out] size	- size of the decoded data is returned here
+ * @return		- error code or 0 on success, #PCILIB_ERROR_OVERWRITTEN if the event is already returned
+ */
+int pcilib_preproc_get_data(pcilib_preproc_t *pp, pcilib_event_id_t event_id, pcilib_timeout_t timeout, void **data, size_t *size);
+
+/**
+ * Releases the event slot
+ * @param[in,out] pp	- preprocessing pool
+ * @param[in] event_id	- id of the event
+ * @return		- error code or 0 on success
+ */
+int pcilib_preproc_return(pcilib_preproc_t *pp, pcilib_event_id_t event_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PCILIB_PREPROC_H */
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <strings.h>
 #include <stdlib.h>
+#include <ctype.h>
 
 #include <views/register.h>
 
@@ -124,120 +125,209 @@ int pcilib_add_properties_from_registers(pcilib_t *ctx, size_t n, const pcilib_r
     return 0;
 }
 
-pcilib_property_info_t *pcilib_get_property_list(pcilib_t *ctx, const char *branch, pcilib_list_flags_t flags) {
-    int err = 0;
+static void pcilib_property_key(char *key, const char *path, size_t len) {
+    size_t i;
 
-    size_t pos = 0;
-    size_t name_offset = 0;
-    pcilib_view_context_t *view_ctx, *view_tmp;
-    pcilib_property_info_t *info = (pcilib_property_info_t*)malloc((ctx->num_views + 1) * sizeof(pcilib_property_info_t));
+    for (i = 0; i < len; i++)
+        key[i] = tolower((unsigned char)path[i]);
+    key[len] = 0;
+}
 
-    struct dir_hash_s {
-        char *name;
-        UT_hash_handle hh;
-    } *dir_hash = NULL, *dir, *dir_tmp;
+static pcilib_property_node_t *pcilib_find_property_node(pcilib_t *ctx, const char *path) {
+    size_t len;
+    pcilib_property_node_t *node;
 
-    if (branch) {
-        name_offset = strlen(branch);
-        if (branch[name_offset - 1] != '/') name_offset++;
-    }
+    if (!path) return &ctx->property_root;
 
-        // Find all folders
-    HASH_ITER(hh, ctx->view_hash, view_ctx, view_tmp) {
-        const pcilib_view_description_t *v = ctx->views[view_ctx->view];
-        const char *subname = v->name + name_offset;
-        const char *suffix;
-
-        if (!(v->flags&PCILIB_VIEW_FLAG_PROPERTY)) continue;
-        if ((branch)&&(strncasecmp(branch, v->name, strlen(branch)))) continue;
-
-        suffix = strchr(subname, '/');
-        if (suffix) {
-            char *name = strndup(v->name, suffix - v->name);
-            if (!name) {
-                err = PCILIB_ERROR_MEMORY;
-                break;
-            }
+    len = strlen(path);
+    while ((len > 0)&&(path[len - 1] == '/')) len--;
+    if (!len) return &ctx->property_root;
 
-            HASH_FIND_STR(dir_hash, name + name_offset, dir);
-            if (dir) {
-                free(name);
-                continue;
-            }
+    char key[len + 1];
+    pcilib_property_key(key, path, len);
 
-            dir = (struct dir_hash_s*)malloc(sizeof(struct dir_hash_s));
-            if (!dir) {
-                err = PCILIB_ERROR_MEMORY;
-                break;
-            }
+    HASH_FIND(hh, ctx->property_hash, key, len, node);
+    return node;
+}
 
-            dir->name = name;
+int pcilib_add_properties_to_tree(pcilib_t *ctx, pcilib_view_t start, size_t n) {
+    size_t i;
 
-            HASH_ADD_KEYPTR(hh, dir_hash, dir->name + name_offset, strlen(dir->name + name_offset), dir);
-        }
-    }
+    for (i = start; i < (start + n); i++) {
+        size_t len;
+        const char *pos, *end;
+        const char *name = ctx->views[i]->name;
+        pcilib_property_node_t *node, *parent = &ctx->property_root;
+
+        if (!(ctx->views[i]->flags&PCILIB_VIEW_FLAG_PROPERTY)) continue;
+
+        char key[strlen(name) + 1];
+        pcilib_property_key(key, name, strlen(name));
+
+            // Directories are created for each component of the path
+        for (pos = name; *pos; pos = end) {
+            while (*pos == '/') pos++;
+            if (!*pos) break;
+
+            end = strchr(pos, '/');
+            if (!end) end = pos + strlen(pos);
+            len = end - name;
+
+            HASH_FIND(hh, ctx->property_hash, key, len, node);
+            if (!node) {
+                node = (pcilib_property_node_t*)malloc(sizeof(pcilib_property_node_t));
+                if (!node) return PCILIB_ERROR_MEMORY;
 
-    HASH_ITER(hh, ctx->view_hash, view_ctx, view_tmp) {
-        const pcilib_view_description_t *v = ctx->views[view_ctx->view];
-        const char *subname = v->name + name_offset;
+                memset(node, 0, sizeof(pcilib_property_node_t));
 
-        if (!(v->flags&PCILIB_VIEW_FLAG_PROPERTY)) continue;
-        if ((branch)&&(strncasecmp(branch, v->name, strlen(branch)))) continue;
+                node->path = strndup(name, len);
+                node->key = strndup(key, len);
+                if ((!node->path)||(!node->key)) {
+                    if (node->path) free(node->path);
+                    if (node->key) free(node->key);
+                    free(node);
+                    return PCILIB_ERROR_MEMORY;
+                }
 
-        if (!strchr(subname, '/')) {
-            pcilib_view_context_t *found_view;
+                node->name = node->path + (pos - name);
+                node->view = PCILIB_VIEW_INVALID;
+                node->parent = parent;
 
-            char *path = strdup(v->name);
-            if (!path) {
-                err = PCILIB_ERROR_MEMORY;
-                break;
+                if (parent->last) parent->last->next = node;
+                else parent->first = node;
+                parent->last = node;
+
+                HASH_ADD_KEYPTR(hh, ctx->property_hash, node->key, len, node);
             }
-            char *name = strrchr(v->name, '/');
-            if (name) name++;
-            else name = path;
-
-            HASH_FIND_STR(dir_hash, name, found_view);
-
-            info[pos++] = (pcilib_property_info_t) {
-                .name = name,
-                .path = path,
-                .description = v->description,
-                .type = v->type,
-                .mode = v->mode,
-                .unit = v->unit,
-                .flags = (found_view?PCILIB_LIST_FLAG_CHILDS:0)
-            };
-
-            if (found_view) HASH_DEL(dir_hash, found_view);
+
+            parent = node;
         }
+
+        if (parent != &ctx->property_root)
+            parent->view = i;
     }
 
-    HASH_ITER(hh, dir_hash, dir, dir_tmp) {
-        char *name = strrchr(dir->name, '/');
-        if (name) name++;
-        else name = dir->name;
+    return 0;
+}
+
+void pcilib_clean_property_tree(pcilib_t *ctx, pcilib_view_t start) {
+    int err;
+    pcilib_property_node_t *node, *tmp;
+
+    HASH_ITER(hh, ctx->property_hash, node, tmp) {
+        HASH_DEL(ctx->property_hash, node);
+        free(node->key);
+        free(node->path);
+        free(node);
+    }
+
+    memset(&ctx->property_root, 0, sizeof(pcilib_property_node_t));
+    ctx->property_root.view = PCILIB_VIEW_INVALID;
+
+    if (start) {
+        err = pcilib_add_properties_to_tree(ctx, 0, start);
+        if (err) pcilib_error("Error (%i) rebuilding the property tree", err);
+    }
+}
 
-        info[pos++] = (pcilib_property_info_t) {
-            .name = name,
-            .path = dir->name,
+static void pcilib_fill_property_info(pcilib_t *ctx, const pcilib_property_node_t *node, pcilib_property_info_t *info) {
+    const pcilib_view_description_t *v;
+
+    if (node->view == PCILIB_VIEW_INVALID) {
+        *info = (pcilib_property_info_t) {
+            .name = node->name,
+            .path = node->path,
             .type = PCILIB_TYPE_INVALID,
             .flags = PCILIB_LIST_FLAG_CHILDS
         };
+        return;
+    }
+
+    v = ctx->views[node->view];
+
+    *info = (pcilib_property_info_t) {
+        .name = node->name,
+        .path = node->path,
+        .description = v->description,
+        .type = v->type,
+        .mode = v->mode,
+        .unit = v->unit,
+        .flags = (node->first?PCILIB_LIST_FLAG_CHILDS:0)
+    };
+}
+
+int pcilib_init_property_iterator(pcilib_t *ctx, pcilib_property_iterator_t *iter, const char *branch, pcilib_list_flags_t flags) {
+    pcilib_property_node_t *dir;
+
+    memset(iter, 0, sizeof(pcilib_property_iterator_t));
+
+    dir = pcilib_find_property_node(ctx, branch);
+    if (!dir) return PCILIB_ERROR_NOTFOUND;
+
+    iter->dir = dir;
+    iter->next = dir->first;
+
+    return 0;
+}
+
+const pcilib_property_info_t *pcilib_get_next_property(pcilib_t *ctx, pcilib_property_iterator_t *iter) {
+    const pcilib_property_node_t *node;
+
+    if (!iter->dir) return NULL;
+
+        // Properties first, then the pure directories
+    while (iter->pass < 2) {
+        for (node = iter->next; node; node = node->next) {
+            if ((node->view != PCILIB_VIEW_INVALID) == (iter->pass == 0)) break;
+        }
+
+        if (node) {
+            iter->next = node->next;
+            pcilib_fill_property_info(ctx, node, &iter->info);
+            return &iter->info;
+        }
+
+        iter->pass++;
+        iter->next = ((const pcilib_property_node_t*)iter->dir)->first;
     }
 
-    HASH_ITER(hh, dir_hash, dir, dir_tmp) {
-	HASH_DEL(dir_hash, dir);
-	free(dir);
+    return NULL;
+}
+
+pcilib_property_info_t *pcilib_get_property_list(pcilib_t *ctx, const char *branch, pcilib_list_flags_t flags) {
+    int err;
+    size_t n = 0;
+    pcilib_property_info_t *info;
+    pcilib_property_iterator_t iter;
+    const pcilib_property_info_t *cur;
+    const pcilib_property_node_t *node;
+
+    err = pcilib_init_property_iterator(ctx, &iter, branch, flags);
+    if ((err)&&(err != PCILIB_ERROR_NOTFOUND)) return NULL;
+
+    if (!err) {
+        for (node = ((const pcilib_property_node_t*)iter.dir)->first; node; node = node->next)
+            n++;
     }
-    HASH_CLEAR(hh, dir_hash);
 
-    memset(&info[pos], 0, sizeof(pcilib_property_info_t));
+    info = (pcilib_property_info_t*)malloc((n + 1) * sizeof(pcilib_property_info_t));
+    if (!info) return NULL;
+
+    for (n = 0; (cur = pcilib_get_next_property(ctx, &iter)); n++) {
+        char *path = strdup(cur->path);
+        if (!path) {
+            memset(&info[n], 0, sizeof(pcilib_property_info_t));
+            pcilib_free_property_info(ctx, info);
+            return NULL;
+        }
 
-    if (err) {
-        pcilib_free_property_info(ctx, info);
-        return NULL;
+        info[n] = *cur;
+        info[n].path = path;
+        info[n].name = path + (cur->name - cur->path);
     }
 
+    memset(&info[n], 0, sizeof(pcilib_property_info_t));
+
     return info;
 }
 
@@ -266,7 +356,5 @@ int pcilib_get_property_attr(pcilib_t *ctx, const char *prop, const char *attr,
         return PCILIB_ERROR_NOTFOUND;
     }
 
-    if (!view_ctx->xml) return PCILIB_ERROR_NOTFOUND;
-
-    return pcilib_get_xml_attr(ctx, view_ctx->xml, attr, val);
+    return pcilib_get_xml_attr_from_table(ctx, view_ctx->attrs, attr, val);
 }
@@ -1,9 +1,44 @@
 #ifndef _PCILIB_PROPERTY_H
 #define _PCILIB_PROPERTY_H
 
+#include <uthash.h>
+#include <pcilib.h>
+
+typedef struct pcilib_property_node_s pcilib_property_node_t;
+
+struct pcilib_property_node_s {
+    char *path;						/**< Full path of the property or directory */
+    char *key;						/**< Lower-cased path used as hash key, the paths are matched case-insensitively */
+    const char *name;					/**< The last component of the path */
+    pcilib_view_t view;					/**< Property view or PCILIB_VIEW_INVALID for pure directories */
+    pcilib_property_node_t *parent;			/**< Parent directory */
+    pcilib_property_node_t *first, *last;		/**< Child nodes in the order of creation */
+    pcilib_property_node_t *next;			/**< Next node in the parent directory */
+    UT_hash_handle hh;					/**< Hash of nodes by full path */
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
+
+/**
+ * This is an internal function used to add the property views into the tree of property directories.
+ * It is automatically called from pcilib_add_views and should not be called by the users. 
+ * @param[in,out] ctx 	- pcilib context
+ * @param[in] start 	- the first view to consider
+ * @param[in] n 	- number of views to consider
+ * @return 		- error or 0 on success
+ */
+int pcilib_add_properties_to_tree(pcilib_t *ctx, pcilib_view_t start, size_t n);
+
+/**
+ * This is an internal function used to clean the property tree. All nodes are removed and the tree is rebuilt 
+ * using the views preceeding \a start. It is called from pcilib_clean_views and should not be called by the users.
+ * @param[in,out] ctx 	- pcilib context
+ * @param[in] start 	- the first removed view
+ */
+void pcilib_clean_property_tree(pcilib_t *ctx, pcilib_view_t start);
+
 /**
  * This is an internal function used to add property views for all model registers. It is automatically
  * called from pcilib_add_registers and should not be called by the users. On error no new views are 
@@ -21,6 +21,7 @@
 #include "error.h"
 #include "property.h"
 #include "views/enum.h"
+#include "fifo.h"
 
 int pcilib_add_registers(pcilib_t *ctx, pcilib_model_modification_flags_t flags, size_t n, const pcilib_register_description_t *registers, pcilib_register_t *ids) {
 	// DS: Overrride existing registers 
@@ -49,22 +50,23 @@ int pcilib_add_registers(pcilib_t *ctx, pcilib_model_modification_flags_t flags,
 	ctx->registers = regs;
 	ctx->model_info.registers = regs;
 
-	reg_ctx = (pcilib_register_context_t*)realloc(ctx->registers, size * sizeof(pcilib_register_context_t));
-	if (!reg_ctx) return PCILIB_ERROR_MEMORY;
-	
-	memset(reg_ctx + ctx->alloc_reg, 0, (size - ctx->alloc_reg) * sizeof(pcilib_register_context_t));
-
-	if (ctx->register_ctx != reg_ctx) {
-	        // We need to recreate cache if context is moved...
-	    HASH_CLEAR(hh, ctx->reg_hash);
-	    for (i = 0; i < ctx->num_reg; i++) {
-                pcilib_register_context_t *cur = &ctx->register_ctx[ctx->num_reg + i];
-                HASH_ADD_KEYPTR(hh, ctx->reg_hash, cur->name, strlen(cur->name), cur);
-	    }
+	    // The hash is referencing the contexts and should be cleared before they are moved...
+	HASH_CLEAR(hh, ctx->reg_hash);
+
+	reg_ctx = (pcilib_register_context_t*)realloc(ctx->register_ctx, size * sizeof(pcilib_register_context_t));
+	if (reg_ctx) {
+	    memset(reg_ctx + ctx->alloc_reg, 0, (size - ctx->alloc_reg) * sizeof(pcilib_register_context_t));
+
+	    ctx->register_ctx = reg_ctx;
+	    ctx->alloc_reg = size;
 	}
 
-	ctx->register_ctx = reg_ctx;
-	ctx->alloc_reg = size;
+	for (i = 0; i < ctx->num_reg; i++) {
+            pcilib_register_context_t *cur = &ctx->register_ctx[i];
+            HASH_ADD_KEYPTR(hh, ctx->reg_hash, cur->name, strlen(cur->name), cur);
+	}
+
+	if (!reg_ctx) return PCILIB_ERROR_MEMORY;
     }
 
     banks = (pcilib_register_bank_t*)alloca(n * sizeof(pcilib_register_bank_t));
@@ -145,6 +147,8 @@ void pcilib_clean_registers(pcilib_t *ctx, pcilib_register_t start) {
     for (reg = start; reg < ctx->num_reg; reg++) {
 	if (ctx->register_ctx[reg].views)
 	    free(ctx->register_ctx[reg].views);
+	if (ctx->register_ctx[reg].attrs)
+	    pcilib_free_xml_attrs(ctx, ctx->register_ctx[reg].attrs);
     }
 
     if (ctx->registers)
@@ -156,11 +160,68 @@ void pcilib_clean_registers(pcilib_t *ctx, pcilib_register_t start) {
     ctx->num_reg = start;
 }
 
-static int pcilib_read_register_space_internal(pcilib_t *ctx, pcilib_register_bank_t bank, pcilib_register_addr_t addr, size_t n, pcilib_register_size_t offset, pcilib_register_size_t bits, pcilib_register_value_t *buf) {
-    int err;
+    /**
+     * Resolves the virtual address of the registers if they are mapped in the process memory as a contiguous
+     * block of 32- or 64-bit words. Otherwise, NULL is returned and the registers should be accessed one by 
+     * one using the protocol API.
+     */
+static void *pcilib_resolve_register_block(pcilib_t *ctx, pcilib_register_bank_t bank, pcilib_address_resolution_flags_t flags, pcilib_register_addr_t addr, size_t n) {
+    uintptr_t va, va_last;
+    pcilib_register_bank_context_t *bctx = ctx->bank_ctx[bank];
+    const pcilib_register_bank_description_t *b = bctx->bank;
+
+    int access = b->access / 8;
+
+    if ((n < 2)||(!bctx->api->resolve)) return NULL;
+    if ((b->protocol == PCILIB_REGISTER_PROTOCOL_PROPERTY)||((access != 4)&&(access != 8))) return NULL;
+
+    va = bctx->api->resolve(ctx, bctx, flags, addr);
+    if ((!va)||(va == PCILIB_ADDRESS_INVALID)) return NULL;
+
+    va_last = bctx->api->resolve(ctx, bctx, flags, addr + (n - 1) * access);
+    if (va_last != (va + (n - 1) * access)) return NULL;
+
+    return (void*)va;
+}
+
+static int pcilib_check_register_block_swap(pcilib_endianess_t endianess) {
+    if (!endianess) return 0;
+    return (endianess == PCILIB_BIG_ENDIAN)?(ntohs(1)!=1):(ntohs(1)==1);
+}
+
+    // The words are zero-extended to pcilib_register_value_t as by the protocol API
+static void pcilib_read_register_block(pcilib_register_value_t *buf, const void *block, int access, size_t n, pcilib_endianess_t endianess) {
+    size_t i;
+    const uint32_t *src = (const uint32_t*)block;
+
+    if (access == sizeof(pcilib_register_value_t)) {
+	pcilib_datacpy64(buf, block, n, endianess);
+    } else if (pcilib_check_register_block_swap(endianess)) {
+	for (i = 0; i < n; i++) buf[i] = ntohl(src[i]);
+    } else {
+	for (i = 0; i < n; i++) buf[i] = src[i];
+    }
+}
+
+static void pcilib_write_register_block(void *block, const pcilib_register_value_t *buf, int access, size_t n, pcilib_endianess_t endianess) {
+    size_t i;
+    uint32_t *dst = (uint32_t*)block;
+
+    if (access == sizeof(pcilib_register_value_t)) {
+	pcilib_datacpy64(block, buf, n, endianess);
+    } else if (pcilib_check_register_block_swap(endianess)) {
+	for (i = 0; i < n; i++) dst[i] = htonl((uint32_t)buf[i]);
+    } else {
+	for (i = 0; i < n; i++) dst[i] = (uint32_t)buf[i];
+    }
+}
+
+static int pcilib_read_register_space_internal(pcilib_t *ctx, pcilib_register_bank_t bank, pcilib_register_addr_t addr, size_t n, pcilib_register_size_t offset, pcilib_register_size_t bits, pcilib_register_space_flags_t flags, pcilib_register_value_t *buf) {
+    int err = 0;
 
     size_t i;
     size_t space_size;
+    void *block = NULL;
 
     pcilib_register_bank_context_t *bctx = ctx->bank_ctx[bank];
     const pcilib_register_protocol_api_description_t *bapi = bctx->api;
@@ -186,9 +247,17 @@ static int pcilib_read_register_space_internal(pcilib_t *ctx, pcilib_register_ba
 	return PCILIB_ERROR_OUTOFRANGE;
     }
 
-    for (i = 0; i < n; i++) {
-	err = bapi->read(ctx, bctx, addr + i * access, buf + i);
-	if (err) break;
+    if ((flags&PCILIB_REGISTER_SPACE_FLAG_WORDWISE) == 0)
+	block = pcilib_resolve_register_block(ctx, bank, PCILIB_ADDRESS_RESOLUTION_FLAG_READ_ONLY, addr, n);
+
+    if (block) {
+	    // Memory-mapped bank, the whole span is copied at once
+	pcilib_read_register_block(buf, block, access, n, b->raw_endianess);
+    } else {
+	for (i = 0; i < n; i++) {
+	    err = bapi->read(ctx, bctx, addr + i * access, buf + i);
+	    if (err) break;
+	}
     }
     
     if ((bits > 0)&&(!err)) {
@@ -210,7 +279,18 @@ int pcilib_read_register_space(pcilib_t *ctx, const char *bank, pcilib_register_
 	return PCILIB_ERROR_INVALID_BANK;
     }
     
-    return pcilib_read_register_space_internal(ctx, bank_id, addr, n, 0, 0, buf);
+    return pcilib_read_register_space_internal(ctx, bank_id, addr, n, 0, 0, PCILIB_REGISTER_SPACE_FLAGS_DEFAULT, buf);
+}
+
+int pcilib_read_register_space_custom(pcilib_t *ctx, const char *bank, pcilib_register_addr_t addr, size_t n, pcilib_register_space_flags_t flags, pcilib_register_value_t *buf) {
+    pcilib_register_bank_t bank_id = pcilib_find_register_bank(ctx, bank);
+    if (bank_id == PCILIB_REGISTER_BANK_INVALID) {
+	if (bank) pcilib_error("Invalid register bank is specified (%s)", bank);
+	else pcilib_error("Register bank should be specified");
+	return PCILIB_ERROR_INVALID_BANK;
+    }
+
+    return pcilib_read_register_space_internal(ctx, bank_id, addr, n, 0, 0, flags, buf);
 }
 
 int pcilib_read_register_by_id(pcilib_t *ctx, pcilib_register_t reg, pcilib_register_value_t *value) {
@@ -234,7 +314,7 @@ int pcilib_read_register_by_id(pcilib_t *ctx, pcilib_register_t reg, pcilib_regi
     bits = r->bits % b->access; 
 
     pcilib_register_value_t buf[n + 1];
-    err = pcilib_read_register_space_internal(ctx, bank, r->addr, n, r->offset, bits, buf);
+    err = pcilib_read_register_space_internal(ctx, bank, r->addr, n, r->offset, bits, PCILIB_REGISTER_SPACE_FLAGS_DEFAULT, buf);
 
     if ((b->endianess == PCILIB_BIG_ENDIAN)||((b->endianess == PCILIB_HOST_ENDIAN)&&(ntohs(1) == 1))) {
 	pcilib_error("Big-endian byte order support is not implemented");
@@ -265,12 +345,554 @@ int pcilib_read_register(pcilib_t *ctx, const char *bank, const char *regname, p
     return pcilib_read_register_by_id(ctx, reg, value);
 }
 
+typedef struct {
+    pcilib_register_value_t mask;		/**< Checked bits */
+    pcilib_register_value_t expected;		/**< Expected value of the checked bits */
+} pcilib_register_wait_condition_t;
+
+static const pcilib_register_wait_policy_t pcilib_register_wait_default_policy = {
+    PCILIB_REGISTER_WAIT_SPIN_TIME,
+    PCILIB_REGISTER_WAIT_MIN_SLEEP,
+    PCILIB_REGISTER_WAIT_MAX_SLEEP,
+    PCILIB_REGISTER_WAIT_FLAGS_DEFAULT
+};
+
+static int pcilib_register_wait_mask_predicate(void *arg, pcilib_register_value_t value) {
+    pcilib_register_wait_condition_t *cond = (pcilib_register_wait_condition_t*)arg;
+    return ((value & cond->mask) == cond->expected);
+}
+
+static int pcilib_get_register_irq(pcilib_t *ctx, pcilib_register_t reg, pcilib_irq_hw_source_t *source) {
+    int err;
+    pcilib_value_t val = {0};
+
+    err = pcilib_get_register_attr_by_id(ctx, reg, "irq", &val);
+    if (err) return err;
+
+    err = pcilib_convert_value_type(ctx, &val, PCILIB_TYPE_LONG);
+    if ((!err)&&(val.ival < 0)) err = PCILIB_ERROR_INVALID_DATA;
+    if (!err) *source = val.ival;
+
+    pcilib_clean_value(ctx, &val);
+
+    return err;
+}
+
+int pcilib_wait_register_custom(pcilib_t *ctx, pcilib_register_t reg, pcilib_register_predicate_t predicate, void *arg, const pcilib_register_wait_policy_t *policy, pcilib_timeout_t timeout, pcilib_register_value_t *value, pcilib_register_wait_stats_t *stats) {
+    int err;
+    int irq = 0;
+    size_t count;
+    pcilib_irq_hw_source_t irq_source = 0;
+    pcilib_register_value_t val = 0;
+    pcilib_register_wait_stats_t st = {0};
+    pcilib_time_t start, now;
+    pcilib_timeout_t elapsed, delay, slice;
+
+    if (reg >= ctx->num_reg) return PCILIB_ERROR_INVALID_ARGUMENT;
+    if (!policy) policy = &pcilib_register_wait_default_policy;
+
+    if ((policy->flags&PCILIB_REGISTER_WAIT_FLAG_NOIRQ) == 0) {
+	err = pcilib_get_register_irq(ctx, reg, &irq_source);
+	if (!err) irq = 1;
+	else if (err != PCILIB_ERROR_NOTFOUND) pcilib_warning("Invalid interrupt is associated with register %s, falling back to polling", ctx->registers[reg].name);
+    }
+
+    delay = policy->min_sleep;
+    start = pcilib_time_ns();
+
+    while (1) {
+	st.polls++;
+	err = pcilib_read_register_by_id(ctx, reg, &val);
+	if (err) break;
+
+	if (predicate(arg, val)) break;
+
+	now = pcilib_time_ns();
+	elapsed = (now - start) / 1000;
+	if ((timeout != PCILIB_TIMEOUT_INFINITE)&&(elapsed >= timeout)) {
+	    err = PCILIB_ERROR_TIMEOUT;
+	    break;
+	}
+
+	if (elapsed < policy->spin_time) continue;
+
+	slice = delay;
+	if ((timeout != PCILIB_TIMEOUT_INFINITE)&&((timeout - elapsed) < slice)) slice = timeout - elapsed;
+
+	st.sleeps++;
+	if (irq) {
+	    err = pcilib_wait_irq(ctx, irq_source, slice, &count);
+	    if (!err) {
+		st.irqs += count;
+	    } else if (err != PCILIB_ERROR_TIMEOUT) {
+		pcilib_warning("Interrupt wait is failed (error %i), falling back to polling", err);
+		irq = 0;
+	    }
+	} else if (slice) {
+	    pcilib_sleep_until_ns(now + slice * 1000);
+	}
+
+	if (delay < policy->max_sleep) {
+	    delay = delay?(2 * delay):1;
+	    if (delay > policy->max_sleep) delay = policy->max_sleep;
+	}
+    }
+
+    st.wait_time = (pcilib_time_ns() - start) / 1000;
+
+    if (value) *value = val;
+    if (stats) *stats = st;
+
+    return err;
+}
+
+int pcilib_wait_register_by_id(pcilib_t *ctx, pcilib_register_t reg, pcilib_register_value_t mask, pcilib_register_value_t expected, pcilib_timeout_t timeout, pcilib_register_value_t *value, size_t *polls) {
+    int err;
+    pcilib_register_wait_stats_t stats = {0};
+    pcilib_register_wait_condition_t cond = { mask, expected & mask };
+
+    err = pcilib_wait_register_custom(ctx, reg, pcilib_register_wait_mask_predicate, &cond, NULL, timeout, value, &stats);
+    if (polls) *polls = stats.polls;
+
+    return err;
+}
+
+int pcilib_wait_register(pcilib_t *ctx, const char *bank, const char *regname, pcilib_register_value_t mask, pcilib_register_value_t expected, pcilib_timeout_t timeout, pcilib_register_value_t *value, size_t *polls) {
+    pcilib_register_t reg;
+
+    reg = pcilib_find_register(ctx, bank, regname);
+    if (reg == PCILIB_REGISTER_INVALID) {
+	pcilib_error("Register (%s) is not found", regname);
+	return PCILIB_ERROR_NOTFOUND;
+    }
+
+    return pcilib_wait_register_by_id(ctx, reg, mask, expected, timeout, value, polls);
+}
+
+static int pcilib_prepare_register_fifo(pcilib_t *ctx, pcilib_register_t reg, pcilib_register_mode_t mode, pcilib_register_bank_t *bank) {
+    const pcilib_register_description_t *r;
+    const pcilib_register_bank_description_t *b;
+    const pcilib_model_description_t *model_info = pcilib_get_model_description(ctx);
+
+    r = model_info->registers + reg;
+
+    if (r->type != PCILIB_REGISTER_FIFO) {
+	pcilib_error("Register (%s) is not a FIFO", r->name);
+	return PCILIB_ERROR_INVALID_REQUEST;
+    }
+
+    if ((r->mode&mode) != mode) {
+	pcilib_error("Register (%s) does not support %s", r->name, (mode&PCILIB_REGISTER_R)?"reading":"writting");
+	return PCILIB_ERROR_NOTPERMITED;
+    }
+
+    *bank = pcilib_find_register_bank_by_addr(ctx, r->bank);
+    if (*bank == PCILIB_REGISTER_BANK_INVALID) return PCILIB_ERROR_INVALID_BANK;
+
+    b = model_info->banks + *bank;
+    if ((r->offset + r->bits) > b->access) {
+	pcilib_error("FIFO register (%s) spanning multiple words of the register bank is not supported", r->name);
+	return PCILIB_ERROR_NOTSUPPORTED;
+    }
+
+    return 0;
+}
+
+    /**
+     * Opens the FIFO handle if the register bank is mapped in the process memory and no byte-swapping is required.
+     * Otherwise, NULL is returned and the register should be accessed using the protocol API.
+     */
+static pcilib_fifo_t *pcilib_open_register_fifo(pcilib_t *ctx, pcilib_register_bank_t bank, pcilib_address_resolution_flags_t flags, pcilib_register_addr_t addr) {
+    uintptr_t va;
+    pcilib_register_bank_context_t *bctx = ctx->bank_ctx[bank];
+    const pcilib_register_bank_description_t *b = bctx->bank;
 
-static int pcilib_write_register_space_internal(pcilib_t *ctx, pcilib_register_bank_t bank, pcilib_register_addr_t addr, size_t n, pcilib_register_size_t offset, pcilib_register_size_t bits, pcilib_register_value_t rwmask, const pcilib_register_value_t *buf) {
+    if (!bctx->api->resolve) return NULL;
+    if ((b->raw_endianess != PCILIB_HOST_ENDIAN)&&((b->raw_endianess != PCILIB_LITTLE_ENDIAN)||(ntohs(1) == 1))) return NULL;
+
+    va = bctx->api->resolve(ctx, bctx, flags, addr);
+    if (va == PCILIB_ADDRESS_INVALID) return NULL;
+
+    return pcilib_open_fifo_address(ctx, (void*)va, b->access / 8);
+}
+
+int pcilib_read_register_fifo_by_id(pcilib_t *ctx, pcilib_register_t reg, size_t n, pcilib_register_value_t *buf) {
     int err;
+    size_t i, rdsize = 0;
+    pcilib_fifo_t *fifo;
+    pcilib_register_bank_t bank;
+    pcilib_register_bank_context_t *bctx;
+    const pcilib_register_description_t *r;
+    const pcilib_model_description_t *model_info = pcilib_get_model_description(ctx);
+
+    err = pcilib_prepare_register_fifo(ctx, reg, PCILIB_REGISTER_R, &bank);
+    if (err) return err;
+
+    r = model_info->registers + reg;
+    bctx = ctx->bank_ctx[bank];
+
+    fifo = pcilib_open_register_fifo(ctx, bank, PCILIB_ADDRESS_RESOLUTION_FLAG_READ_ONLY, r->addr);
+    if (fifo) {
+	    // FIFO words are packed at the beginning of buffer and, then, expanded in-place starting from the end
+	err = pcilib_read_fifo_burst(fifo, n, buf, &rdsize);
+	pcilib_close_fifo(fifo);
+	if ((!err)&&(rdsize < n)) err = PCILIB_ERROR_TIMEOUT;
+	if (err) return err;
+
+	switch (bctx->bank->access) {
+	 case 8:
+	    for (i = n; i > 0; i--) buf[i - 1] = ((uint8_t*)buf)[i - 1];
+	    break;
+	 case 16:
+	    for (i = n; i > 0; i--) buf[i - 1] = ((uint16_t*)buf)[i - 1];
+	    break;
+	 case 32:
+	    for (i = n; i > 0; i--) buf[i - 1] = ((uint32_t*)buf)[i - 1];
+	    break;
+	}
+    } else {
+	if (!bctx->api->read) {
+	    pcilib_error("Used register protocol does not define a way to read register value");
+	    return PCILIB_ERROR_NOTSUPPORTED;
+	}
+
+	for (i = 0; i < n; i++) {
+	    err = bctx->api->read(ctx, bctx, r->addr, buf + i);
+	    if (err) return err;
+	}
+    }
+
+    if ((r->offset)||(r->bits < 8 * sizeof(pcilib_register_value_t))) {
+	for (i = 0; i < n; i++)
+	    buf[i] = (buf[i] >> r->offset)&BIT_MASK(r->bits);
+    }
+
+    return 0;
+}
+
+int pcilib_read_register_fifo(pcilib_t *ctx, const char *bank, const char *regname, size_t n, pcilib_register_value_t *buf) {
+    int reg;
+
+    reg = pcilib_find_register(ctx, bank, regname);
+    if (reg == PCILIB_REGISTER_INVALID) {
+	pcilib_error("Register (%s) is not found", regname);
+	return PCILIB_ERROR_NOTFOUND;
+    }
+
+    return pcilib_read_register_fifo_by_id(ctx, reg, n, buf);
+}
+
+typedef struct {
+    pcilib_register_bank_t bank;		/**< Register bank */
+    pcilib_register_addr_t addr;		/**< Address of the word in the bank */
+} pcilib_register_snapshot_word_t;
+
+typedef struct {
+    pcilib_register_bank_t bank;		/**< Register bank */
+    pcilib_register_addr_t addr;		/**< Address of the first word of the run */
+    size_t n;					/**< Number of words in the run */
+    size_t pos;					/**< Position of the first word in the word buffer */
+    char *ptr;					/**< Mapped address of the run or NULL if it should be read through the protocol API */
+} pcilib_register_snapshot_run_t;
+
+typedef struct {
+    size_t pos;					/**< Position of the first register word in the word buffer */
+    size_t n;					/**< Number of full words */
+    pcilib_register_size_t offset;		/**< Offset of the bits in the last partial word */
+    pcilib_register_size_t bits;		/**< Number of bits in the last partial word */
+    pcilib_register_size_t access;		/**< Word size in bits */
+} pcilib_register_snapshot_item_t;
+
+struct pcilib_register_snapshot_s {
+    size_t num_regs;				/**< Number of registers in the snapshot */
+    size_t num_runs;				/**< Number of contiguous runs */
+    size_t num_words;				/**< Number of distinct words to read */
+    size_t num_locks;				/**< Number of locked register banks */
+    pcilib_register_snapshot_item_t *items;	/**< Description of registers */
+    pcilib_register_snapshot_run_t *runs;	/**< Runs sorted by bank and address */
+    pcilib_register_value_t *words;		/**< Buffer holding the words of the current snapshot */
+    void *raw;					/**< Buffer for the block reads */
+    pcilib_lock_t **locks;			/**< Locks of the involved banks in the order of bank ids */
+};
+
+static int pcilib_register_snapshot_word_cmp(const void *a, const void *b) {
+    const pcilib_register_snapshot_word_t *wa = a, *wb = b;
+
+    if (wa->bank != wb->bank) return (wa->bank < wb->bank)?-1:1;
+    if (wa->addr != wb->addr) return (wa->addr < wb->addr)?-1:1;
+    return 0;
+}
+
+pcilib_register_snapshot_t *pcilib_create_register_snapshot(pcilib_t *ctx, size_t n, const pcilib_register_t *regs) {
+    size_t i, j, k;
+    size_t num_words, raw_size;
+    pcilib_register_snapshot_t *snapshot;
+    pcilib_register_snapshot_word_t *words;
+    const pcilib_model_description_t *model_info = pcilib_get_model_description(ctx);
+
+    if (!n) {
+	pcilib_error("No registers are specified for the snapshot");
+	return NULL;
+    }
+
+	// Checking registers and counting the number of required words
+    for (i = 0, num_words = 0; i < n; i++) {
+	size_t space_size;
+	pcilib_register_bank_t bank;
+	const pcilib_register_description_t *r;
+	const pcilib_register_bank_description_t *b;
+
+	if (regs[i] >= ctx->num_reg) {
+	    pcilib_error("Invalid register (%u) is specified for the snapshot", regs[i]);
+	    return NULL;
+	}
+
+	r = model_info->registers + regs[i];
+	if (r->type == PCILIB_REGISTER_FIFO) {
+	    pcilib_error("FIFO register (%s) can't be included in the snapshot as reading it pops the data", r->name);
+	    return NULL;
+	}
+
+	bank = pcilib_find_register_bank_by_addr(ctx, r->bank);
+	if (bank == PCILIB_REGISTER_BANK_INVALID) {
+	    pcilib_error("Register (%s) belongs to the invalid register bank", r->name);
+	    return NULL;
+	}
+
+	b = model_info->banks + bank;
+	if ((b->endianess == PCILIB_BIG_ENDIAN)||((b->endianess == PCILIB_HOST_ENDIAN)&&(ntohs(1) == 1))) {
+	    pcilib_error("Big-endian byte order support is not implemented");
+	    return NULL;
+	}
+
+	if (!ctx->bank_ctx[bank]->api->read) {
+	    pcilib_error("Register protocol of bank (%s) does not define a way to read register value", b->name);
+	    return NULL;
+	}
+
+	if (b->protocol == PCILIB_REGISTER_PROTOCOL_PROPERTY) space_size = ctx->num_views * (b->access / 8);
+	else space_size = b->size;
+
+	k = r->bits / b->access + ((r->bits % b->access)?1:0);
+	if ((r->addr + k * (b->access / 8)) > space_size) {
+	    pcilib_error("Register (%s) is out of register space of bank (%s)", r->name, b->name);
+	    return NULL;
+	}
+
+	num_words += k;
+    }
+
+    words = (pcilib_register_snapshot_word_t*)malloc(num_words * sizeof(pcilib_register_snapshot_word_t));
+    snapshot = (pcilib_register_snapshot_t*)malloc(sizeof(pcilib_register_snapshot_t));
+    if ((!words)||(!snapshot)) {
+	if (words) free(words);
+	if (snapshot) free(snapshot);
+	pcilib_error("Error allocating memory for the register snapshot");
+	return NULL;
+    }
+
+    memset(snapshot, 0, sizeof(pcilib_register_snapshot_t));
+    snapshot->num_regs = n;
+
+    for (i = 0, num_words = 0; i < n; i++) {
+	const pcilib_register_description_t *r = model_info->registers + regs[i];
+	pcilib_register_bank_t bank = pcilib_find_register_bank_by_addr(ctx, r->bank);
+	const pcilib_register_bank_description_t *b = model_info->banks + bank;
+
+	k = r->bits / b->access + ((r->bits % b->access)?1:0);
+	for (j = 0; j < k; j++, num_words++) {
+	    words[num_words].bank = bank;
+	    words[num_words].addr = r->addr + j * (b->access / 8);
+	}
+    }
+
+	// Sorting and merging overlapping words
+    qsort(words, num_words, sizeof(pcilib_register_snapshot_word_t), pcilib_register_snapshot_word_cmp);
+    for (i = 1, j = 1; i < num_words; i++) {
+	if (pcilib_register_snapshot_word_cmp(words + i, words + j - 1))
+	    words[j++] = words[i];
+    }
+    num_words = j;
+
+    snapshot->num_words = num_words;
+    snapshot->items = (pcilib_register_snapshot_item_t*)malloc(n * sizeof(pcilib_register_snapshot_item_t));
+    snapshot->runs = (pcilib_register_snapshot_run_t*)malloc(num_words * sizeof(pcilib_register_snapshot_run_t));
+    snapshot->words = (pcilib_register_value_t*)malloc(num_words * sizeof(pcilib_register_value_t));
+    snapshot->locks = (pcilib_lock_t**)calloc(num_words, sizeof(pcilib_lock_t*));
+    if ((!snapshot->items)||(!snapshot->runs)||(!snapshot->words)||(!snapshot->locks)) {
+	free(words);
+	pcilib_free_register_snapshot(ctx, snapshot);
+	pcilib_error("Error allocating memory for the register snapshot");
+	return NULL;
+    }
+
+	// Grouping contiguous words in runs
+    for (i = 0, raw_size = 0; i < num_words; i++) {
+	pcilib_register_snapshot_run_t *run;
+	const pcilib_register_bank_description_t *b = model_info->banks + words[i].bank;
+
+	if (snapshot->num_runs) {
+	    run = snapshot->runs + snapshot->num_runs - 1;
+	    if ((run->bank == words[i].bank)&&(words[i].addr == (run->addr + run->n * (b->access / 8)))) {
+		run->n++;
+		if ((run->ptr)&&((run->n * (b->access / 8)) > raw_size)) raw_size = run->n * (b->access / 8);
+		continue;
+	    }
+	}
+
+	if ((!snapshot->num_runs)||(snapshot->runs[snapshot->num_runs - 1].bank != words[i].bank)) {
+		// Words are sorted by bank, so the locks are obtained and later acquired in a fixed order
+	    snapshot->locks[snapshot->num_locks] = pcilib_get_lock(ctx, PCILIB_LOCK_FLAGS_DEFAULT, "regbank/%s", b->name);
+	    if (!snapshot->locks[snapshot->num_locks]) {
+		free(words);
+		pcilib_free_register_snapshot(ctx, snapshot);
+		pcilib_error("Failed to initialize a lock to protect bank %s during the snapshot", b->name);
+		return NULL;
+	    }
+	    snapshot->num_locks++;
+	}
+
+	run = snapshot->runs + (snapshot->num_runs++);
+	run->bank = words[i].bank;
+	run->addr = words[i].addr;
+	run->n = 1;
+	run->pos = i;
+	run->ptr = NULL;
+
+	if (b->protocol == PCILIB_REGISTER_PROTOCOL_DEFAULT) {
+	    uintptr_t addr = pcilib_resolve_bank_address_by_id(ctx, PCILIB_ADDRESS_RESOLUTION_FLAG_READ_ONLY, run->bank);
+	    if ((addr)&&(addr != PCILIB_ADDRESS_INVALID)) {
+		run->ptr = (char*)addr + run->addr;
+		if ((b->access / 8) > raw_size) raw_size = b->access / 8;
+	    }
+	}
+    }
+
+    if (raw_size) {
+	snapshot->raw = malloc(raw_size);
+	if (!snapshot->raw) {
+	    free(words);
+	    pcilib_free_register_snapshot(ctx, snapshot);
+	    pcilib_error("Error allocating memory for the register snapshot");
+	    return NULL;
+	}
+    }
+
+	// Locating words of each register
+    for (i = 0; i < n; i++) {
+	pcilib_register_snapshot_word_t key, *word;
+	pcilib_register_snapshot_item_t *item = snapshot->items + i;
+	const pcilib_register_description_t *r = model_info->registers + regs[i];
+	const pcilib_register_bank_description_t *b;
+
+	key.bank = pcilib_find_register_bank_by_addr(ctx, r->bank);
+	key.addr = r->addr;
+	b = model_info->banks + key.bank;
+
+	word = bsearch(&key, words, num_words, sizeof(pcilib_register_snapshot_word_t), pcilib_register_snapshot_word_cmp);
+	assert(word);
+
+	item->pos = word - words;
+	item->n = r->bits / b->access;
+	item->bits = r->bits % b->access;
+	item->offset = r->offset;
+	item->access = b->access;
+    }
+
+    free(words);
+
+    return snapshot;
+}
+
+void pcilib_free_register_snapshot(pcilib_t *ctx, pcilib_register_snapshot_t *snapshot) {
+    size_t i;
+
+    if (snapshot->locks) {
+	for (i = 0; i < snapshot->num_locks; i++)
+	    pcilib_return_lock(ctx, PCILIB_LOCK_FLAGS_DEFAULT, snapshot->locks[i]);
+	free(snapshot->locks);
+    }
+
+    if (snapshot->raw) free(snapshot->raw);
+    if (snapshot->words) free(snapshot->words);
+    if (snapshot->runs) free(snapshot->runs);
+    if (snapshot->items) free(snapshot->items);
+    free(snapshot);
+}
+
+int pcilib_read_register_snapshot(pcilib_t *ctx, pcilib_register_snapshot_t *snapshot, struct timeval *timestamp, pcilib_register_value_t *values) {
+    int err = 0;
+    size_t i, j;
+
+    for (i = 0; i < snapshot->num_locks; i++) {
+	err = pcilib_lock(snapshot->locks[i]);
+	if (err) {
+	    pcilib_error("Error (%i) obtaining lock %s for the register snapshot", err, pcilib_lock_get_name(snapshot->locks[i]));
+	    while (i > 0) pcilib_unlock(snapshot->locks[--i]);
+	    return err;
+	}
+    }
+
+    if (timestamp) gettimeofday(timestamp, NULL);
+
+    for (i = 0; (!err)&&(i < snapshot->num_runs); i++) {
+	pcilib_register_snapshot_run_t *run = snapshot->runs + i;
+	pcilib_register_bank_context_t *bctx = ctx->bank_ctx[run->bank];
+	const pcilib_register_bank_description_t *b = bctx->bank;
+	pcilib_register_value_t *buf = snapshot->words + run->pos;
+
+	int access = b->access / 8;
+
+	if (run->ptr) {
+	    pcilib_datacpy(snapshot->raw, run->ptr, access, run->n, b->raw_endianess);
+	    switch (access) {
+	     case 1:
+		for (j = 0; j < run->n; j++) buf[j] = ((uint8_t*)snapshot->raw)[j];
+		break;
+	     case 2:
+		for (j = 0; j < run->n; j++) buf[j] = ((uint16_t*)snapshot->raw)[j];
+		break;
+	     case 4:
+		for (j = 0; j < run->n; j++) buf[j] = ((uint32_t*)snapshot->raw)[j];
+		break;
+	     default:
+		memcpy(buf, snapshot->raw, run->n * sizeof(pcilib_register_value_t));
+	    }
+	} else {
+	    for (j = 0; (!err)&&(j < run->n); j++)
+		err = bctx->api->read(ctx, bctx, run->addr + j * access, buf + j);
+	}
+    }
+
+    for (i = snapshot->num_locks; i > 0; i--)
+	pcilib_unlock(snapshot->locks[i - 1]);
+
+    if (err) return err;
+
+    for (i = 0; i < snapshot->num_regs; i++) {
+	pcilib_register_snapshot_item_t *item = snapshot->items + i;
+	pcilib_register_value_t *buf = snapshot->words + item->pos;
+	pcilib_register_value_t res = 0;
+
+	for (j = 0; j < item->n; j++)
+	    res |= buf[j] << (j * item->access);
+
+	if (item->bits)
+	    res |= ((buf[item->n] >> item->offset)&BIT_MASK(item->bits)) << (item->n * item->access);
+
+	values[i] = res;
+    }
+
+    return 0;
+}
+
+
+static int pcilib_write_register_space_internal(pcilib_t *ctx, pcilib_register_bank_t bank, pcilib_register_addr_t addr, size_t n, pcilib_register_size_t offset, pcilib_register_size_t bits, pcilib_register_value_t rwmask, pcilib_register_space_flags_t flags, const pcilib_register_value_t *buf) {
+    int err = 0;
 
     size_t i;
     size_t space_size;
+    void *block = NULL;
 
     pcilib_register_bank_context_t *bctx = ctx->bank_ctx[bank];
     const pcilib_register_protocol_api_description_t *bapi = bctx->api;
@@ -296,9 +918,16 @@ static int pcilib_write_register_space_internal(pcilib_t *ctx, pcilib_register_b
 	return PCILIB_ERROR_OUTOFRANGE;
     }
 
-    for (i = 0; i < n; i++) {
-	err = bapi->write(ctx, bctx, addr + i * access, buf[i]);
-	if (err) break;
+    if ((flags&PCILIB_REGISTER_SPACE_FLAG_WORDWISE) == 0)
+	block = pcilib_resolve_register_block(ctx, bank, PCILIB_ADDRESS_RESOLUTION_FLAG_WRITE_ONLY, addr, n);
+
+    if (block) {
+	pcilib_write_register_block(block, buf, access, n, b->raw_endianess);
+    } else {
+	for (i = 0; i < n; i++) {
+	    err = bapi->write(ctx, bctx, addr + i * access, buf[i]);
+	    if (err) break;
+	}
     }
     
     if ((bits > 0)&&(!err)) {
@@ -333,7 +962,32 @@ int pcilib_write_register_space(pcilib_t *ctx, const char *bank, pcilib_register
 	return PCILIB_ERROR_INVALID_BANK;
     }
     
-    return pcilib_write_register_space_internal(ctx, bank_id, addr, n, 0, 0, 0, buf);
+    return pcilib_write_register_space_internal(ctx, bank_id, addr, n, 0, 0, 0, PCILIB_REGISTER_SPACE_FLAGS_DEFAULT, buf);
+}
+
+int pcilib_write_register_space_custom(pcilib_t *ctx, const char *bank, pcilib_register_addr_t addr, size_t n, pcilib_register_space_flags_t flags, const pcilib_register_value_t *buf) {
+    int err;
+    pcilib_register_value_t *check;
+
+    pcilib_register_bank_t bank_id = pcilib_find_register_bank(ctx, bank);
+    if (bank_id == PCILIB_REGISTER_BANK_INVALID) {
+	if (bank) pcilib_error("Invalid register bank is specified (%s)", bank);
+	else pcilib_error("Register bank should be specified");
+	return PCILIB_ERROR_INVALID_BANK;
+    }
+
+    err = pcilib_write_register_space_internal(ctx, bank_id, addr, n, 0, 0, 0, flags, buf);
+    if ((err)||((flags&PCILIB_REGISTER_SPACE_FLAG_VERIFY) == 0)) return err;
+
+    check = (pcilib_register_value_t*)malloc(n * sizeof(pcilib_register_value_t));
+    if (!check) return PCILIB_ERROR_MEMORY;
+
+    err = pcilib_read_register_space_internal(ctx, bank_id, addr, n, 0, 0, flags, check);
+    if ((!err)&&(memcmp(buf, check, n * sizeof(pcilib_register_value_t)))) err = PCILIB_ERROR_VERIFY;
+
+    free(check);
+
+    return err;
 }
 
 
@@ -379,7 +1033,7 @@ int pcilib_write_register_by_id(pcilib_t *ctx, pcilib_register_t reg, pcilib_reg
 	}
     }
 
-    err = pcilib_write_register_space_internal(ctx, bank, r->addr, n, r->offset, bits, r->rwmask, buf);
+    err = pcilib_write_register_space_internal(ctx, bank, r->addr, n, r->offset, bits, r->rwmask, PCILIB_REGISTER_SPACE_FLAGS_DEFAULT, buf);
     return err;
 }
 
@@ -395,13 +1049,93 @@ int pcilib_write_register(pcilib_t *ctx, const char *bank, const char *regname,
     return pcilib_write_register_by_id(ctx, reg, value);
 }
 
+int pcilib_write_register_fifo_by_id(pcilib_t *ctx, pcilib_register_t reg, size_t n, const pcilib_register_value_t *buf) {
+    int err;
+    size_t i, wrsize = 0;
+    void *data;
+    pcilib_fifo_t *fifo;
+    pcilib_register_bank_t bank;
+    pcilib_register_bank_context_t *bctx;
+    const pcilib_register_description_t *r;
+    const pcilib_model_description_t *model_info = pcilib_get_model_description(ctx);
+
+    err = pcilib_prepare_register_fifo(ctx, reg, PCILIB_REGISTER_W, &bank);
+    if (err) return err;
+
+    r = model_info->registers + reg;
+    bctx = ctx->bank_ctx[bank];
+
+    for (i = 0; i < n; i++) {
+	if ((r->bits < 8 * sizeof(pcilib_register_value_t))&&(buf[i] > BIT_MASK(r->bits))) {
+	    pcilib_error("Value %lu is too big to fit in the register %s", (unsigned long)buf[i], r->name);
+	    return PCILIB_ERROR_OUTOFRANGE;
+	}
+    }
+
+	// The bits of the bank word outside of register are not preserved, there is no way to read them from FIFO
+    fifo = pcilib_open_register_fifo(ctx, bank, PCILIB_ADDRESS_RESOLUTION_FLAG_WRITE_ONLY, r->addr);
+    if (fifo) {
+	data = malloc(n * bctx->bank->access / 8);
+	if (!data) {
+	    pcilib_close_fifo(fifo);
+	    pcilib_error("Error allocating memory for FIFO data");
+	    return PCILIB_ERROR_MEMORY;
+	}
+
+	switch (bctx->bank->access) {
+	 case 8:
+	    for (i = 0; i < n; i++) ((uint8_t*)data)[i] = buf[i] << r->offset;
+	    break;
+	 case 16:
+	    for (i = 0; i < n; i++) ((uint16_t*)data)[i] = buf[i] << r->offset;
+	    break;
+	 case 32:
+	    for (i = 0; i < n; i++) ((uint32_t*)data)[i] = buf[i] << r->offset;
+	    break;
+	 default:
+	    for (i = 0; i < n; i++) ((uint64_t*)data)[i] = buf[i] << r->offset;
+	}
+
+	err = pcilib_write_fifo_burst(fifo, n, data, &wrsize);
+	pcilib_close_fifo(fifo);
+	free(data);
+
+	if ((!err)&&(wrsize < n)) err = PCILIB_ERROR_TIMEOUT;
+	return err;
+    }
+
+    if (!bctx->api->write) {
+	pcilib_error("Used register protocol does not define a way to write value into the register");
+	return PCILIB_ERROR_NOTSUPPORTED;
+    }
+
+    for (i = 0; i < n; i++) {
+	err = bctx->api->write(ctx, bctx, r->addr, buf[i] << r->offset);
+	if (err) return err;
+    }
+
+    return 0;
+}
+
+int pcilib_write_register_fifo(pcilib_t *ctx, const char *bank, const char *regname, size_t n, const pcilib_register_value_t *buf) {
+    int reg;
+
+    reg = pcilib_find_register(ctx, bank, regname);
+    if (reg == PCILIB_REGISTER_INVALID) {
+	pcilib_error("Register (%s) is not found", regname);
+	return PCILIB_ERROR_NOTFOUND;
+    }
+
+    return pcilib_write_register_fifo_by_id(ctx, reg, n, buf);
+}
+
 
 int pcilib_get_register_attr_by_id(pcilib_t *ctx, pcilib_register_t reg, const char *attr, pcilib_value_t *val) {
     int err;
 
     assert(reg < ctx->num_reg);
 
-    err = pcilib_get_xml_attr(ctx, ctx->register_ctx[reg].xml, attr, val);
+    err = pcilib_get_xml_attr_from_table(ctx, ctx->register_ctx[reg].attrs, attr, val);
 /*
         // Shall we return from parrent register if not found?
     if ((err == PCILIB_ERROR_NOTFOUND)&&(ctx->registers[reg].type == PCILIB_REGISTER_TYPE_BITS)) {
@@ -424,81 +1158,118 @@ int pcilib_get_register_attr(pcilib_t *ctx, const char *bank, const char *regnam
     return pcilib_get_register_attr_by_id(ctx, reg, attr, val);
 }
 
-pcilib_register_info_t *pcilib_get_register_info(pcilib_t *ctx, const char *req_bank_name, const char *req_reg_name, pcilib_list_flags_t flags) {
-    pcilib_register_t i, from, to, pos = 0;
-    pcilib_register_info_t *info;
-    pcilib_register_bank_t bank;
-    pcilib_register_bank_addr_t bank_addr;
-    const char *bank_name;
+static void pcilib_fill_register_info(pcilib_t *ctx, pcilib_register_t reg, const char *bank_name, pcilib_register_info_t *info) {
+    const pcilib_register_value_range_t *range = &ctx->register_ctx[reg].range;
+    const pcilib_register_value_name_t *names = NULL;
 
-    info = (pcilib_register_info_t*)malloc((ctx->num_reg + 1) * sizeof(pcilib_register_info_t));
-    if (!info) return NULL;
+    if (ctx->registers[reg].views) {
+        int j;
+        for (j = 0; ctx->registers[reg].views[j].view; j++) {
+            pcilib_view_t view = pcilib_find_view_by_name(ctx, ctx->registers[reg].views[j].view);
+            if ((view != PCILIB_VIEW_INVALID)&&((ctx->views[view]->api == &pcilib_enum_view_xml_api)||(ctx->views[view]->api == &pcilib_enum_view_static_api)))
+                names = ((pcilib_enum_view_description_t*)(ctx->views[view]))->names;
+        }
+    }
 
-    if (req_bank_name) {
-        bank = pcilib_find_register_bank_by_name(ctx, req_bank_name);
-        if (bank == PCILIB_REGISTER_BANK_INVALID) {
-            pcilib_error("The specified bank (%s) is not found", req_bank_name);
-            return NULL;
+    if (range->min == range->max) 
+        range = NULL;
+
+    *info = (pcilib_register_info_t){
+        .id = reg,
+        .name = ctx->registers[reg].name,
+        .description = ctx->registers[reg].description,
+        .bank = bank_name,
+        .mode = ctx->registers[reg].mode,
+        .defvalue = ctx->registers[reg].defvalue,
+        .range = range,
+        .values = names
+    };
+}
+
+int pcilib_init_register_iterator(pcilib_t *ctx, pcilib_register_iterator_t *iter, const char *bank, pcilib_list_flags_t flags) {
+    memset(iter, 0, sizeof(pcilib_register_iterator_t));
+
+    if (bank) {
+        pcilib_register_bank_t bank_id = pcilib_find_register_bank_by_name(ctx, bank);
+        if (bank_id == PCILIB_REGISTER_BANK_INVALID) {
+            pcilib_error("The specified bank (%s) is not found", bank);
+            return PCILIB_ERROR_NOTFOUND;
         }
-        bank_addr = ctx->banks[bank].addr;
-        bank_name = req_bank_name;
+        iter->bank_addr = ctx->banks[bank_id].addr;
+        iter->bank_name = ctx->banks[bank_id].name;
+        iter->filter = 1;
     } else {
-        bank_addr = PCILIB_REGISTER_BANK_INVALID;
-        bank_name = NULL;
+        iter->bank_addr = PCILIB_REGISTER_BANK_INVALID;
+    }
+
+    return 0;
+}
+
+const pcilib_register_info_t *pcilib_get_next_register(pcilib_t *ctx, pcilib_register_iterator_t *iter) {
+    pcilib_register_t reg;
+    pcilib_register_bank_t bank;
+
+    for (reg = iter->pos; reg < ctx->num_reg; reg++) {
+        if (ctx->registers[reg].bank != iter->bank_addr) {
+            if (iter->filter) continue;
+
+            iter->bank_addr = ctx->registers[reg].bank;
+            bank = pcilib_find_register_bank_by_addr(ctx, iter->bank_addr);
+            if (bank == PCILIB_REGISTER_BANK_INVALID) iter->bank_name = NULL;
+            else iter->bank_name = ctx->banks[bank].name;
+        }
+
+        pcilib_fill_register_info(ctx, reg, iter->bank_name, &iter->info);
+        iter->pos = reg + 1;
+        return &iter->info;
     }
 
+    iter->pos = ctx->num_reg;
+    return NULL;
+}
+
+pcilib_register_info_t *pcilib_get_register_info(pcilib_t *ctx, const char *req_bank_name, const char *req_reg_name, pcilib_list_flags_t flags) {
+    int err;
+    size_t n = 0;
+    pcilib_register_t reg;
+    pcilib_register_info_t *info;
+    pcilib_register_iterator_t iter;
+    const pcilib_register_info_t *cur;
+
     if (req_reg_name) {
-        pcilib_register_t reg = pcilib_find_register(ctx, req_bank_name, req_reg_name);
+        pcilib_register_bank_t bank;
+
+        reg = pcilib_find_register(ctx, req_bank_name, req_reg_name);
         if (reg == PCILIB_REGISTER_INVALID) {
             pcilib_error("The specified register (%s) is not found", req_reg_name);
             return NULL;
         }
-        from = reg;
-        to = reg + 1;
-    } else {
-        from = 0;
-        to = ctx->num_reg;
-    }
-
-    for (i = from; i < to; i++) {
-        const pcilib_register_value_range_t *range = &ctx->register_ctx[i].range;
-        const pcilib_register_value_name_t *names = NULL;
-
-        if (req_bank_name) {
-            if (ctx->registers[i].bank != bank_addr) continue;
-        } else {
-            if (ctx->registers[i].bank != bank_addr) {
-                bank_addr = ctx->registers[i].bank;
-                bank = pcilib_find_register_bank_by_addr(ctx, bank_addr);
-                if (bank == PCILIB_REGISTER_BANK_INVALID) bank_name = NULL;
-                else bank_name = ctx->banks[bank].name;
-            }
-        }
 
-        if (ctx->registers[i].views) {
-            int j;
-            for (j = 0; ctx->registers[i].views[j].view; j++) {
-                pcilib_view_t view = pcilib_find_view_by_name(ctx, ctx->registers[i].views[j].view);
-                if ((view != PCILIB_VIEW_INVALID)&&((ctx->views[view]->api == &pcilib_enum_view_xml_api)||(ctx->views[view]->api == &pcilib_enum_view_static_api)))
-                    names = ((pcilib_enum_view_description_t*)(ctx->views[view]))->names;
-            }
-        }
+        info = (pcilib_register_info_t*)malloc(2 * sizeof(pcilib_register_info_t));
+        if (!info) return NULL;
+
+        bank = pcilib_find_register_bank_by_addr(ctx, ctx->registers[reg].bank);
+        pcilib_fill_register_info(ctx, reg, (bank == PCILIB_REGISTER_BANK_INVALID)?NULL:ctx->banks[bank].name, &info[0]);
+        memset(&info[1], 0, sizeof(pcilib_register_info_t));
+        return info;
+    }
+
+    err = pcilib_init_register_iterator(ctx, &iter, req_bank_name, flags);
+    if (err) return NULL;
+
+        // Only the registers of the requested bank are counted
+    if (iter.filter) {
+        for (reg = 0; reg < ctx->num_reg; reg++)
+            if (ctx->registers[reg].bank == iter.bank_addr) n++;
+    } else n = ctx->num_reg;
+
+    info = (pcilib_register_info_t*)malloc((n + 1) * sizeof(pcilib_register_info_t));
+    if (!info) return NULL;
+
+    for (n = 0; (cur = pcilib_get_next_register(ctx, &iter)); n++)
+        info[n] = *cur;
 
-        if (range->min == range->max) 
-            range = NULL;
-
-        info[pos++] = (pcilib_register_info_t){
-            .id = i,
-            .name = ctx->registers[i].name,
-            .description = ctx->registers[i].description,
-            .bank = bank_name,
-            .mode = ctx->registers[i].mode,
-            .defvalue = ctx->registers[i].defvalue,
-            .range = range,
-            .values = names
-        };
-    }
-    memset(&info[pos], 0, sizeof(pcilib_register_info_t));
+    memset(&info[n], 0, sizeof(pcilib_register_info_t));
     return info;
 }
 
@@ -49,6 +49,7 @@ typedef struct {
     pcilib_register_bank_t bank;							/**< Reference to bank containing the register */
     pcilib_register_value_range_t range;						/**< Minimum & maximum allowed values */
     pcilib_xml_node_t *xml;								/**< Additional XML properties */
+    pcilib_xml_attrs_t *attrs;								/**< Parsed XML attributes */
     pcilib_view_reference_t *views;							/**< For non-static list of views, this vairables holds a copy of a NULL-terminated list from model (if present, memory should be de-allocated) */
     UT_hash_handle hh;
 } pcilib_register_context_t;
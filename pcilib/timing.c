@@ -2,13 +2,16 @@
 #define _GNU_SOURCE
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdint.h>
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <time.h>
 #include <sched.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <sys/time.h>
 
@@ -16,6 +19,107 @@
 #include "tools.h"
 #include "error.h"
 
+#define PCILIB_TSC_CALIBRATION_TIME	20000000		/**< ns, the time spent calibrating TSC against CLOCK_MONOTONIC */
+
+typedef struct {
+    int enabled;					/**< Indicates that TSC is used by pcilib_time_ns_fast() */
+    uint64_t tsc_base;					/**< TSC value at the end of calibration */
+    pcilib_time_t ns_base;				/**< Monotonic time at the end of calibration */
+    uint64_t mult;					/**< Nanoseconds per TSC tick in 32.32 fixed point format */
+} pcilib_tsc_clock_t;
+
+static pthread_once_t pcilib_tsc_once = PTHREAD_ONCE_INIT;
+static pcilib_tsc_clock_t pcilib_tsc = {0};
+
+#if defined(__x86_64__)||defined(__i386__)
+static inline uint64_t pcilib_rdtsc() {
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static void pcilib_tsc_calibrate() {
+    uint64_t tsc1, tsc2;
+    pcilib_time_t ns1, ns2;
+    const char *env = getenv("PCILIB_TIMING_TSC");
+
+    if ((!env)||(!atoi(env))) return;
+
+    if (!pcilib_check_cpu_invariant_tsc()) {
+	pcilib_warning("The invariant TSC is not provided by CPU, using CLOCK_MONOTONIC for timing");
+	return;
+    }
+
+    ns1 = pcilib_time_ns();
+    tsc1 = pcilib_rdtsc();
+    do {
+	ns2 = pcilib_time_ns();
+	tsc2 = pcilib_rdtsc();
+    } while ((ns2 - ns1) < PCILIB_TSC_CALIBRATION_TIME);
+
+    if (tsc2 <= tsc1) return;
+
+    pcilib_tsc.mult = ((ns2 - ns1) << 32) / (tsc2 - tsc1);
+    pcilib_tsc.tsc_base = tsc2;
+    pcilib_tsc.ns_base = ns2;
+    pcilib_tsc.enabled = 1;
+
+    pcilib_info("Using TSC for timing, %.3lf ns per tick", pcilib_tsc.mult / 4294967296.);
+}
+#else /* x86 */
+static inline uint64_t pcilib_rdtsc() {
+    return 0;
+}
+
+static void pcilib_tsc_calibrate() {
+}
+#endif /* x86 */
+
+int pcilib_gettime(struct timeval *tv) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    tv->tv_sec = ts.tv_sec;
+    tv->tv_usec = ts.tv_nsec / 1000;
+
+    return 0;
+}
+
+pcilib_time_t pcilib_time_ns() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+pcilib_time_t pcilib_time_ns_fast() {
+    uint64_t delta;
+
+    pthread_once(&pcilib_tsc_once, pcilib_tsc_calibrate);
+    if (!pcilib_tsc.enabled) return pcilib_time_ns();
+
+	// 64x32 bit multiplication split to avoid overflow
+    delta = pcilib_rdtsc() - pcilib_tsc.tsc_base;
+    return pcilib_tsc.ns_base + (delta >> 32) * pcilib_tsc.mult + (((delta & 0xFFFFFFFF) * pcilib_tsc.mult) >> 32);
+}
+
+int pcilib_time_is_tsc() {
+    pthread_once(&pcilib_tsc_once, pcilib_tsc_calibrate);
+    return pcilib_tsc.enabled;
+}
+
+int pcilib_sleep_until_ns(pcilib_time_t deadline) {
+    int err;
+    struct timespec ts;
+
+    ts.tv_sec = deadline / 1000000000ull;
+    ts.tv_nsec = deadline % 1000000000ull;
+
+    while ((err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) == EINTR);
+
+    return err?PCILIB_ERROR_FAILED:0;
+}
+
 int pcilib_add_timeout(struct timeval *tv, pcilib_timeout_t timeout) {
     tv->tv_usec += timeout%1000000;
     if (tv->tv_usec > 999999) {
@@ -29,7 +133,7 @@ int pcilib_add_timeout(struct timeval *tv, pcilib_timeout_t timeout) {
 }
 
 int pcilib_calc_deadline(struct timeval *tv, pcilib_timeout_t timeout) {
-    gettimeofday(tv, NULL);
+    pcilib_gettime(tv);
     pcilib_add_timeout(tv, timeout);
 
     return 0;
@@ -41,7 +145,7 @@ int pcilib_check_deadline(struct timeval *tve, pcilib_timeout_t timeout) {
 
     if (!tve->tv_sec) return 0;
 
-    gettimeofday(&tvs, NULL);
+    pcilib_gettime(&tvs);
     res = ((tve->tv_sec - tvs.tv_sec)*1000000 + (tve->tv_usec - tvs.tv_usec));
 	// Hm... Some problems comparing signed and unsigned. So, sign check first
     if ((res < 0)||(res < timeout)) {
@@ -55,7 +159,7 @@ pcilib_timeout_t pcilib_calc_time_to_deadline(struct timeval *tve) {
     int64_t res;
     struct timeval tvs;
     
-    gettimeofday(&tvs, NULL);
+    pcilib_gettime(&tvs);
     res = ((tve->tv_sec - tvs.tv_sec)*1000000 + (tve->tv_usec - tvs.tv_usec));
     
     if (res < 0) return 0;
@@ -63,17 +167,7 @@ pcilib_timeout_t pcilib_calc_time_to_deadline(struct timeval *tve) {
 }
 
 int pcilib_sleep_until_deadline(struct timeval *tv) {
-    struct timespec wait;
-    pcilib_timeout_t duration;
-
-    duration = pcilib_calc_time_to_deadline(tv);
-    if (duration > 0) {
-	wait.tv_sec = duration / 1000000;
-	wait.tv_nsec = 1000 * (duration % 1000000);
-	nanosleep(&wait, NULL);
-    }
-
-    return 0;
+    return pcilib_sleep_until_ns(tv->tv_sec * 1000000000ull + tv->tv_usec * 1000ull);
 }
 
 pcilib_timeout_t pcilib_timediff(struct timeval *tvs, struct timeval *tve) {
@@ -1,13 +1,53 @@
 #ifndef _PCILIB_TIMING_H
 #define _PCILIB_TIMING_H
 
+#include <stdint.h>
 #include <sys/time.h>
 #include <pcilib.h>
 
+typedef uint64_t pcilib_time_t;			/**< Monotonic time in nanoseconds */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Returns the current monotonic timestamp. All deadlines and time intervals computed by pcilib are based on
+ * CLOCK_MONOTONIC and are not affected by the adjustments of the system time. Therefore, the timestamps 
+ * returned by this function are not related to the wall-clock time and should not be mixed with gettimeofday().
+ * @param[out] tv	- the current monotonic time
+ * @return 		- error code or 0 for correctness
+ */
+int pcilib_gettime(struct timeval *tv);
+
+/**
+ * Returns the current monotonic time in nanoseconds
+ * @return		- nanoseconds since unspecified starting point (CLOCK_MONOTONIC)
+ */
+pcilib_time_t pcilib_time_ns(void);
+
+/**
+ * Returns the current time in nanoseconds using the cheapest available clock. If enabled with PCILIB_TIMING_TSC 
+ * environmental variable and the CPU provides the invariant TSC, the time stamp counter calibrated against 
+ * CLOCK_MONOTONIC is used. Otherwise, this is equivalent to pcilib_time_ns(). The returned values should 
+ * only be used to measure short intervals and are not guaranteed to be consistent with pcilib_time_ns().
+ * @return		- nanoseconds since unspecified starting point
+ */
+pcilib_time_t pcilib_time_ns_fast(void);
+
+/**
+ * Indicates if pcilib_time_ns_fast() is using time stamp counter
+ * @return		- 1 if TSC is used, 0 otherwise
+ */
+int pcilib_time_is_tsc(void);
+
+/**
+ * Sleeps until the specified point of monotonic time (as returned by pcilib_time_ns())
+ * @param[in] deadline	- the monotonic time in nanoseconds
+ * @return 		- error code or 0 for correctness
+ */
+int pcilib_sleep_until_ns(pcilib_time_t deadline);
+
 
 /**
  * Add the specified number of microseconds to the time stored in \p tv
@@ -18,7 +58,7 @@ extern "C" {
 int pcilib_add_timeout(struct timeval *tv, pcilib_timeout_t timeout);
 
 /**
- * Computes the deadline by adding the specified number of microseconds to the current timestamp
+ * Computes the deadline by adding the specified number of microseconds to the current monotonic timestamp
  * @param[out] tv	- the deadline
  * @param[in] timeout	- number of microseconds to add 
  * @return 		- error code or 0 for correctness
@@ -41,8 +81,9 @@ int pcilib_check_deadline(struct timeval *tv, pcilib_timeout_t timeout);
 pcilib_timeout_t pcilib_calc_time_to_deadline(struct timeval *tv);
 
 /**
- * Executes sleep until the specified deadline
- * Real-time capabilities are not used. TThe sleep could wake slightly after the specified deadline.
+ * Executes sleep until the specified deadline. The absolute sleep is used, so the deadline is not shifted
+ * if the sleep is interrupted by signals. Real-time capabilities are not used and the sleep could wake 
+ * slightly after the specified deadline.
  * @param[in] tv	- the deadline
  * @return 		- error code or 0 for correctness
  */
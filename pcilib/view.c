@@ -104,6 +104,12 @@ int pcilib_add_views_custom(pcilib_t *ctx, size_t n, const pcilib_view_descripti
         return err;
     }
 
+    err = pcilib_add_properties_to_tree(ctx, ctx->num_views, n);
+    if (err) {
+        pcilib_clean_views(ctx, ctx->num_views);
+        return err;
+    }
+
     ctx->num_views += n;
 
     return 0;
@@ -124,6 +130,7 @@ void pcilib_clean_views(pcilib_t *ctx, pcilib_view_t start) {
 
             if (view_ctx->view >= start) {
                 HASH_DEL(ctx->view_hash, view_ctx);
+                if (view_ctx->attrs) pcilib_free_xml_attrs(ctx, view_ctx->attrs);
                 if (v->api->free) v->api->free(ctx, view_ctx);
                 else free(view_ctx);
             }
@@ -140,6 +147,8 @@ void pcilib_clean_views(pcilib_t *ctx, pcilib_view_t start) {
 
     ctx->views[start] = NULL;
     ctx->num_views = start;
+
+    pcilib_clean_property_tree(ctx, start);
 }
 
 pcilib_view_context_t *pcilib_find_view_context_by_name(pcilib_t *ctx, const char *name) {
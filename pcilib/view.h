@@ -41,6 +41,7 @@ struct pcilib_view_context_s {
     const char *name;
     pcilib_view_t view;
     pcilib_xml_node_t *xml;
+    pcilib_xml_attrs_t *attrs;
     UT_hash_handle hh;
 };
 
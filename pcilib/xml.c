@@ -22,6 +22,7 @@
 #include <errno.h>
 #include <alloca.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -38,7 +39,10 @@
 #include "bank.h"
 #include "register.h"
 #include "xml.h"
+#include "xmlcache.h"
 #include "error.h"
+#include "tools.h"
+#include "cpu.h"
 #include "view.h"
 #include "py.h"
 #include "views/enum.h"
@@ -56,6 +60,22 @@
 #define UNIT_TRANSFORMS_PATH ((xmlChar*)"./transform")				/**< all transforms of the unit */
 
 
+#define PCILIB_XML_MAX_THREADS 16						/**< Maximal number of threads parsing and validating model files */
+
+typedef struct {
+    char *name;							/**< Name of the XML file */
+    xmlDocPtr doc;						/**< Parsed and validated document */
+} pcilib_xml_file_t;
+
+typedef struct {
+    pcilib_t *ctx;						/**< pcilib context */
+    const char *path;						/**< Directory with model files */
+    size_t num_files;						/**< Number of model files */
+    pcilib_xml_file_t *files;					/**< Model files sorted by name */
+    size_t next_file;						/**< Next file to be picked by a worker */
+    pthread_mutex_t mutex;					/**< Protects next_file */
+} pcilib_xml_loader_t;
+
 static const char *pcilib_xml_bank_default_format = "0x%lx";
 static const char *pcilib_xml_enum_view_unit = "name";
 
@@ -89,6 +109,99 @@ int pcilib_get_xml_attr(pcilib_t *ctx, pcilib_xml_node_t *node, const char *attr
     return pcilib_set_value_from_static_string(ctx, val, (const char*)str);
 }
 
+    // Only the canonical forms are converted to ensure the attribute is printed exactly as written
+static int pcilib_xml_parse_attr_value(pcilib_xml_attr_t *attr) {
+    char *endptr;
+    char buf[32];
+    const char *str = attr->str;
+
+    if ((str[0] == '0')&&(str[1] == 'x')&&(str[2])&&(pcilib_isxnumber(str))) {
+	attr->ival = strtol(str, &endptr, 16);
+	attr->format = "0x%lx";
+    } else if ((str[0])&&(pcilib_isnumber(str))) {
+	attr->ival = strtol(str, &endptr, 10);
+	attr->format = NULL;
+    } else return 0;
+
+    if (*endptr) return 0;
+
+    snprintf(buf, sizeof(buf), attr->format?attr->format:"%li", attr->ival);
+    if (strcmp(buf, str)) return 0;
+
+    attr->type = PCILIB_TYPE_LONG;
+    return 0;
+}
+
+pcilib_xml_attrs_t *pcilib_parse_xml_attrs(pcilib_t *ctx, pcilib_xml_node_t *node) {
+    xmlAttr *cur;
+    size_t num = 0, size = 0, len;
+    char *pos;
+    pcilib_xml_attrs_t *attrs;
+    pcilib_xml_attr_t *attr;
+
+    for (cur = node->properties; cur != NULL; cur = cur->next) {
+        if ((!cur->children)||(!xmlNodeIsText(cur->children))) continue;
+        size += strlen((char*)cur->name) + strlen((char*)cur->children->content) + 2;
+        num++;
+    }
+
+    size += sizeof(pcilib_xml_attrs_t) + num * sizeof(pcilib_xml_attr_t);
+
+    attrs = (pcilib_xml_attrs_t*)malloc(size);
+    if (!attrs) {
+	pcilib_error("Failed to allocate %zu bytes for XML attributes", size);
+	return NULL;
+    }
+
+    attrs->num = num;
+    attrs->size = size;
+    pos = (char*)(attrs->attrs + num);
+
+    for (cur = node->properties, attr = attrs->attrs; cur != NULL; cur = cur->next) {
+        if ((!cur->children)||(!xmlNodeIsText(cur->children))) continue;
+
+	len = strlen((char*)cur->name) + 1;
+	memcpy(pos, cur->name, len);
+	attr->name = pos;
+	pos += len;
+
+	len = strlen((char*)cur->children->content) + 1;
+	memcpy(pos, cur->children->content, len);
+	attr->str = pos;
+	pos += len;
+
+	attr->type = PCILIB_TYPE_STRING;
+	pcilib_xml_parse_attr_value(attr);
+	attr++;
+    }
+
+    return attrs;
+}
+
+void pcilib_free_xml_attrs(pcilib_t *ctx, pcilib_xml_attrs_t *attrs) {
+    if (attrs) free(attrs);
+}
+
+int pcilib_get_xml_attr_from_table(pcilib_t *ctx, const pcilib_xml_attrs_t *attrs, const char *attr, pcilib_value_t *val) {
+    int err;
+    size_t i;
+
+    if (!attrs) return PCILIB_ERROR_NOTFOUND;
+
+    for (i = 0; i < attrs->num; i++) {
+	if (!strcmp(attrs->attrs[i].name, attr)) break;
+    }
+    if (i == attrs->num) return PCILIB_ERROR_NOTFOUND;
+
+    if (attrs->attrs[i].type == PCILIB_TYPE_LONG) {
+	err = pcilib_set_value_from_int(ctx, val, attrs->attrs[i].ival);
+	val->format = attrs->attrs[i].format;
+	return err;
+    }
+
+    return pcilib_set_value_from_static_string(ctx, val, attrs->attrs[i].str);
+}
+
 static int pcilib_xml_parse_view_reference(pcilib_t *ctx, xmlDocPtr doc, xmlNodePtr node, pcilib_view_reference_t *desc) {
     xmlAttr *cur;
     char *value, *name;
@@ -212,6 +325,8 @@ static int pcilib_xml_parse_register(pcilib_t *ctx, pcilib_xml_register_descript
         } else if (!strcasecmp(name, "type")) {
             if (!strcasecmp(value, "fifo")) {
                 desc->type = PCILIB_REGISTER_FIFO;
+            } else if (!strcasecmp(value, "standard")) {
+                desc->type = PCILIB_REGISTER_STANDARD;
             } else {
                 pcilib_error("Invalid register type (%s) is specified in the XML register description", value);
                 return PCILIB_ERROR_INVALID_DATA;
@@ -290,6 +405,8 @@ static int pcilib_xml_create_register(pcilib_t *ctx, pcilib_register_bank_t bank
     }
 
     ctx->register_ctx[reg].xml = node;
+    ctx->register_ctx[reg].attrs = pcilib_parse_xml_attrs(ctx, node);
+    if (!ctx->register_ctx[reg].attrs) return PCILIB_ERROR_MEMORY;
     memcpy(&ctx->register_ctx[reg].range, &desc.range, sizeof(pcilib_register_value_range_t));
     ctx->register_ctx[reg].views = desc.base.views;
 
@@ -333,6 +450,11 @@ static int pcilib_xml_create_register(pcilib_t *ctx, pcilib_register_bank_t bank
             }
 
             ctx->register_ctx[reg].xml = nodeset->nodeTab[i];
+            ctx->register_ctx[reg].attrs = pcilib_parse_xml_attrs(ctx, nodeset->nodeTab[i]);
+            if (!ctx->register_ctx[reg].attrs) {
+                xmlXPathFreeObject(nodes);
+                return PCILIB_ERROR_MEMORY;
+            }
             memcpy(&ctx->register_ctx[reg].range, &fdesc.range, sizeof(pcilib_register_value_range_t));
             ctx->register_ctx[reg].views = fdesc.base.views;
         }
@@ -459,10 +581,16 @@ static int pcilib_xml_create_bank(pcilib_t *ctx, xmlXPathContextPtr xpath, xmlDo
         return err;
     }
 
+    if (ctx->xml.bank_attrs[bank])
+        pcilib_free_xml_attrs(ctx, ctx->xml.bank_attrs[bank]);
+
     ctx->xml.bank_nodes[bank] = node;
+    ctx->xml.bank_attrs[bank] = pcilib_parse_xml_attrs(ctx, node);
     if (ctx->bank_ctx[bank]) {
         ctx->bank_ctx[bank]->xml = node;
+        ctx->bank_ctx[bank]->attrs = ctx->xml.bank_attrs[bank];
     }
+    if (!ctx->xml.bank_attrs[bank]) return PCILIB_ERROR_MEMORY;
 
     xpath->node = node;
     nodes = xmlXPathEvalExpression(REGISTERS_PATH, xpath);
@@ -604,6 +732,9 @@ static int pcilib_xml_create_transform_view(pcilib_t *ctx, xmlXPathContextPtr xp
     if (err) return err;
 
     view_ctx->xml = node;
+    view_ctx->attrs = pcilib_parse_xml_attrs(ctx, node);
+    if (!view_ctx->attrs) return PCILIB_ERROR_MEMORY;
+
     return 0;
 }
 
@@ -731,6 +862,9 @@ static int pcilib_xml_create_enum_view(pcilib_t *ctx, xmlXPathContextPtr xpath,
         return err;
     }
     view_ctx->xml = node;
+    view_ctx->attrs = pcilib_parse_xml_attrs(ctx, node);
+    if (!view_ctx->attrs) return PCILIB_ERROR_MEMORY;
+
     return 0;
 }
 
@@ -1083,51 +1217,157 @@ static xmlDocPtr pcilib_xml_load_file(pcilib_t *ctx, xmlParserCtxtPtr parser, xm
     return doc;
 }
 
-static xmlDocPtr pcilib_xml_load_model_file(pcilib_t *ctx, const char *path, const char *name) {
-    return pcilib_xml_load_file(ctx, ctx->xml.parser, ctx->xml.parts_validator, path, name);
-}
 
+static void pcilib_xml_load_model_files(pcilib_xml_loader_t *loader, xmlParserCtxtPtr parser, xmlSchemaValidCtxtPtr validator) {
+    size_t i;
 
-static int pcilib_process_xml_internal(pcilib_t *ctx, const char *model, const char *location) {
-    int err;
+    while (1) {
+        pthread_mutex_lock(&loader->mutex);
+        i = loader->next_file++;
+        pthread_mutex_unlock(&loader->mutex);
 
-    DIR *rep;
-    struct dirent *file = NULL;
-    char *model_dir, *model_path;
+        if (i >= loader->num_files) break;
 
-    xmlDocPtr doc = NULL;
-    xmlNodePtr root = NULL;
-    xmlXPathContextPtr xpath;
+        loader->files[i].doc = pcilib_xml_load_file(loader->ctx, parser, validator, loader->path, loader->files[i].name);
+    }
+}
 
-    if (ctx->xml.num_files == PCILIB_MAX_MODEL_FILES) {
-        pcilib_error("Too many XML locations for a model, only up to %zu are supported", PCILIB_MAX_MODEL_FILES);
-        return PCILIB_ERROR_TOOBIG;
+    // libxml2 parser and validation contexts can't be shared between threads, the schema itself is read-only
+static void *pcilib_xml_loader_thread(void *arg) {
+    pcilib_xml_loader_t *loader = (pcilib_xml_loader_t*)arg;
+    xmlParserCtxtPtr parser;
+    xmlSchemaValidCtxtPtr validator;
+
+    parser = xmlNewParserCtxt();
+    if (!parser) return NULL;
+
+    validator = xmlSchemaNewValidCtxt(loader->ctx->xml.parts_schema);
+    if ((!validator)||(xmlSchemaSetValidOptions(validator, XML_SCHEMA_VAL_VC_I_CREATE))) {
+        if (validator) xmlSchemaFreeValidCtxt(validator);
+        xmlFreeParserCtxt(parser);
+        return NULL;
     }
 
-    model_dir = getenv("PCILIB_MODEL_DIR");
-    if (!model_dir) model_dir = PCILIB_MODEL_DIR;
+    pcilib_xml_load_model_files(loader, parser, validator);
 
-    if (!model) model = ctx->model;
-    if (!location) location = "";
+    xmlSchemaFreeValidCtxt(validator);
+    xmlFreeParserCtxt(parser);
 
-    model_path = (char*)alloca(strlen(model_dir) + strlen(model) + strlen(location) + 3);
-    if (!model_path) return PCILIB_ERROR_MEMORY;
+    return NULL;
+}
 
-    sprintf(model_path, "%s/%s/%s", model_dir, model, location);
+static int pcilib_xml_compare_files(const void *a, const void *b) {
+    return strcmp(((const pcilib_xml_file_t*)a)->name, ((const pcilib_xml_file_t*)b)->name);
+}
+
+static int pcilib_xml_list_model_files(pcilib_t *ctx, const char *model_path, size_t *num_files, pcilib_xml_file_t **files) {
+    DIR *rep;
+    struct dirent *file = NULL;
+
+    size_t n = 0, size = 0;
+    pcilib_xml_file_t *list = NULL;
 
     rep = opendir(model_path);
     if (!rep) return PCILIB_ERROR_NOTFOUND;
 
     while ((file = readdir(rep)) != NULL) {
-        xmlDocPtr newdoc;
-        
         size_t len = strlen(file->d_name);
         if ((len < 4)||(strcasecmp(file->d_name + len - 4, ".xml"))) continue;
         if (file->d_type != DT_REG) continue;
 
-        newdoc = pcilib_xml_load_model_file(ctx, model_path, file->d_name);
+        if (n == size) {
+            pcilib_xml_file_t *new_list;
+
+            size = size?(2 * size):16;
+            new_list = (pcilib_xml_file_t*)realloc(list, size * sizeof(pcilib_xml_file_t));
+            if (!new_list) break;
+            list = new_list;
+        }
+
+        list[n].name = strdup(file->d_name);
+        if (!list[n].name) break;
+        list[n++].doc = NULL;
+    }
+    closedir(rep);
+
+    if (file) {
+        while (n) free(list[--n].name);
+        free(list);
+        pcilib_error("Error allocating memory for the list of XML files in %s", model_path);
+        return PCILIB_ERROR_MEMORY;
+    }
+
+        // The files are merged in the same order, independent of the file system and the number of threads
+    if (n) qsort(list, n, sizeof(pcilib_xml_file_t), pcilib_xml_compare_files);
+
+    *num_files = n;
+    *files = list;
+
+    return 0;
+}
+
+static size_t pcilib_xml_get_loader_threads(size_t num_files) {
+    size_t threads;
+    const char *env = getenv("PCILIB_XML_THREADS");
+
+    if ((env)&&(*env)) threads = strtoul(env, NULL, 10);
+    else threads = pcilib_get_cpu_count();
+
+    if (threads > PCILIB_XML_MAX_THREADS) threads = PCILIB_XML_MAX_THREADS;
+    if (threads > num_files) threads = num_files;
+    if (!threads) threads = 1;
+
+    return threads;
+}
+
+static int pcilib_xml_merge_model_files(pcilib_t *ctx, const char *model_path, xmlDocPtr *result) {
+    int err;
+    size_t i;
+
+    size_t num_threads, started_threads = 0;
+    pthread_t threads[PCILIB_XML_MAX_THREADS];
+    pcilib_xml_loader_t loader = { ctx, model_path, 0, NULL, 0 };
+    struct timeval start, end;
+
+    xmlDocPtr doc = NULL;
+    xmlNodePtr root = NULL;
+
+    *result = NULL;
+
+    err = pcilib_xml_list_model_files(ctx, model_path, &loader.num_files, &loader.files);
+    if (err) return err;
+
+        // Files are parsed and validated in parallel, the calling thread is one of the workers
+    pcilib_gettime(&start);
+    num_threads = pcilib_xml_get_loader_threads(loader.num_files);
+    pthread_mutex_init(&loader.mutex, NULL);
+
+    for (i = 1; i < num_threads; i++) {
+        err = pthread_create(threads + started_threads, NULL, pcilib_xml_loader_thread, &loader);
+        if (err) {
+            pcilib_warning("Error (%i) starting XML loader thread, continuing with %zu threads", err, started_threads + 1);
+            break;
+        }
+        started_threads++;
+    }
+
+    pcilib_xml_load_model_files(&loader, ctx->xml.parser, ctx->xml.parts_validator);
+
+    for (i = 0; i < started_threads; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&loader.mutex);
+
+    pcilib_gettime(&end);
+    ctx->xml.parse_time += pcilib_timediff(&start, &end);
+    ctx->xml.load_threads = started_threads + 1;
+
+    for (i = 0; i < loader.num_files; i++) {
+        const char *name = loader.files[i].name;
+        xmlDocPtr newdoc = loader.files[i].doc;
+
         if (!newdoc) {
-            pcilib_error("Error processing XML file %s", file->d_name);
+            pcilib_error("Error processing XML file %s", name);
             continue;
         }
 
@@ -1142,8 +1382,8 @@ static int pcilib_process_xml_internal(pcilib_t *ctx, const char *model, const c
             if ((!node)||(!xmlAddChildList(root, node))) {
                 xmlErrorPtr xmlerr = xmlCtxtGetLastError(ctx->xml.parser);
                 if (node) xmlFreeNode(node);
-                if (xmlerr) pcilib_error("Error manipulating XML tree of %s, libXML2 reported error %d - %s", file->d_name, xmlerr->code, xmlerr->message);
-                else pcilib_error("Error manipulating XML tree of %s", file->d_name);
+                if (xmlerr) pcilib_error("Error manipulating XML tree of %s, libXML2 reported error %d - %s", name, xmlerr->code, xmlerr->message);
+                else pcilib_error("Error manipulating XML tree of %s", name);
                 continue;
             }
         } else {
@@ -1151,8 +1391,8 @@ static int pcilib_process_xml_internal(pcilib_t *ctx, const char *model, const c
             if (!root) {
                 xmlErrorPtr xmlerr = xmlCtxtGetLastError(ctx->xml.parser);
                 xmlFreeDoc(newdoc);
-                if (xmlerr) pcilib_error("Error manipulating XML tree of %s, libXML2 reported error %d - %s", file->d_name, xmlerr->code, xmlerr->message);
-                else pcilib_error("Error manipulating XML tree of %s", file->d_name);
+                if (xmlerr) pcilib_error("Error manipulating XML tree of %s, libXML2 reported error %d - %s", name, xmlerr->code, xmlerr->message);
+                else pcilib_error("Error manipulating XML tree of %s", name);
                 continue;
             }
             doc = newdoc;
@@ -1161,7 +1401,10 @@ static int pcilib_process_xml_internal(pcilib_t *ctx, const char *model, const c
             doc->URL = xmlStrdup(BAD_CAST model_path);
         }
     }
-    closedir(rep);
+
+    for (i = 0; i < loader.num_files; i++)
+        free(loader.files[i].name);
+    if (loader.files) free(loader.files);
 
     if (!doc)
         return 0;
@@ -1175,6 +1418,68 @@ static int pcilib_process_xml_internal(pcilib_t *ctx, const char *model, const c
         return PCILIB_ERROR_VERIFY;
     }
 
+    *result = doc;
+    return 0;
+}
+
+static int pcilib_process_xml_internal(pcilib_t *ctx, const char *model, const char *location) {
+    int err;
+
+    struct stat st;
+    char *model_dir, *model_path;
+
+    xmlDocPtr doc = NULL;
+    xmlXPathContextPtr xpath;
+    pcilib_xml_cache_t *cache;
+
+    if (ctx->xml.num_files == PCILIB_MAX_MODEL_FILES) {
+        pcilib_error("Too many XML locations for a model, only up to %zu are supported", PCILIB_MAX_MODEL_FILES);
+        return PCILIB_ERROR_TOOBIG;
+    }
+
+    model_dir = getenv("PCILIB_MODEL_DIR");
+    if (!model_dir) model_dir = PCILIB_MODEL_DIR;
+
+    if (!model) model = ctx->model;
+    if (!location) location = "";
+
+    model_path = (char*)alloca(strlen(model_dir) + strlen(model) + strlen(location) + 3);
+    if (!model_path) return PCILIB_ERROR_MEMORY;
+
+    sprintf(model_path, "%s/%s/%s", model_dir, model, location);
+
+    if ((stat(model_path, &st))||(!S_ISDIR(st.st_mode))) return PCILIB_ERROR_NOTFOUND;
+
+        // The cached document is already merged and validated
+    cache = pcilib_xml_cache_open(ctx, model_dir, model_path);
+    doc = pcilib_xml_cache_get_document(ctx, cache);
+
+    if (doc) {
+        ctx->xml.num_cached++;
+    } else {
+            // Schemas are only loaded if we actually need to validate something
+        if (!ctx->xml.validator) {
+            err = pcilib_xml_load_xsd(ctx, model_dir);
+            if (err) {
+                pcilib_xml_cache_close(ctx, cache);
+                return err;
+            }
+        }
+
+        err = pcilib_xml_merge_model_files(ctx, model_path, &doc);
+        if (err) {
+            pcilib_xml_cache_close(ctx, cache);
+            return err;
+        }
+
+        if ((doc)&&(cache)) pcilib_xml_cache_store(ctx, cache, doc);
+    }
+
+    pcilib_xml_cache_close(ctx, cache);
+
+    if (!doc)
+        return 0;
+
     xpath = xmlXPathNewContext(doc);
     if (!xpath) {
         xmlErrorPtr xmlerr = xmlGetLastError();
@@ -1200,11 +1505,9 @@ int pcilib_process_xml(pcilib_t *ctx, const char *location) {
 
 int pcilib_init_xml(pcilib_t *ctx, const char *model) {
     int err;
+    struct timeval start, end;
 
-    char *model_dir;
-
-    model_dir = getenv("PCILIB_MODEL_DIR");
-    if (!model_dir) model_dir = PCILIB_MODEL_DIR;
+    pcilib_gettime(&start);
 
     ctx->xml.parser = xmlNewParserCtxt();
     if (!ctx->xml.parser) {
@@ -1214,10 +1517,12 @@ int pcilib_init_xml(pcilib_t *ctx, const char *model) {
         return PCILIB_ERROR_FAILED;
     }
 
-    err = pcilib_xml_load_xsd(ctx, model_dir);
-    if (err) return err;
+    err = pcilib_process_xml_internal(ctx, model, NULL);
+
+    pcilib_gettime(&end);
+    ctx->xml.load_time = pcilib_timediff(&start, &end);
 
-    return pcilib_process_xml_internal(ctx, model, NULL);
+    return err;
 }
 
 void pcilib_free_xml(pcilib_t *ctx) {
@@ -1225,8 +1530,17 @@ void pcilib_free_xml(pcilib_t *ctx) {
 
     memset(ctx->xml.bank_nodes, 0, sizeof(ctx->xml.bank_nodes));
     for (i = 0; i < ctx->num_banks; i++) {
-        if (ctx->bank_ctx[i])
+        if (ctx->bank_ctx[i]) {
             ctx->bank_ctx[i]->xml = NULL;
+            ctx->bank_ctx[i]->attrs = NULL;
+        }
+    }
+
+    for (i = 0; i < PCILIB_MAX_REGISTER_BANKS; i++) {
+        if (ctx->xml.bank_attrs[i]) {
+            pcilib_free_xml_attrs(ctx, ctx->xml.bank_attrs[i]);
+            ctx->xml.bank_attrs[i] = NULL;
+        }
     }
 
     for (i = 0; i < ctx->num_reg; i++) {
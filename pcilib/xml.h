@@ -21,6 +21,20 @@
 
 typedef struct pcilib_xml_s pcilib_xml_t;
 
+typedef struct {
+    const char *name;					/**< Attribute name */
+    const char *str;					/**< Attribute value as specified in the XML file */
+    pcilib_value_type_t type;				/**< PCILIB_TYPE_LONG if the value is an integer in canonical decimal or 0x-prefixed hex form, PCILIB_TYPE_STRING otherwise */
+    long ival;						/**< Parsed value if type is PCILIB_TYPE_LONG */
+    const char *format;					/**< Format reproducing the original string from ival */
+} pcilib_xml_attr_t;
+
+struct pcilib_xml_attrs_s {
+    size_t num;						/**< Number of attributes */
+    size_t size;					/**< Total size of the table including strings */
+    pcilib_xml_attr_t attrs[];				/**< Attributes followed by the copies of names and values */
+};
+
 struct pcilib_xml_s {
     size_t num_files;					/**< Number of currently loaded XML documents */
     
@@ -34,6 +48,12 @@ struct pcilib_xml_s {
     xmlSchemaValidCtxtPtr parts_validator;     		/**< Pointer to the XML validation context capable of validating individual XML files - no check for cross-references */
 
     xmlNodePtr bank_nodes[PCILIB_MAX_REGISTER_BANKS];	/**< pointer to xml nodes of banks in the xml file */
+    pcilib_xml_attrs_t *bank_attrs[PCILIB_MAX_REGISTER_BANKS];	/**< Parsed attributes of banks */
+
+    size_t load_threads;				/**< Number of threads used to parse and validate the model files during the last load */
+    pcilib_timeout_t parse_time;			/**< Time (in us) spent to parse and validate the individual model files (included in load_time) */
+    size_t num_cached;					/**< Number of documents restored from the pre-validated model cache */
+    pcilib_timeout_t load_time;				/**< Time (in us) spent to load and process the XML model during initialization */
 };
 
 #ifdef __cplusplus
@@ -90,6 +110,31 @@ int pcilib_process_xml(pcilib_t *ctx, const char *location);
  */
 int pcilib_get_xml_attr(pcilib_t *ctx, pcilib_xml_node_t *node, const char *attr, pcilib_value_t *val);
 
+/** This is an internal function which parses all attributes of the node into a compact table. The names and 
+ * values are copied, so the table does not reference the XML document. Integer values are converted once.
+ * @param[in] ctx 	- pcilib context
+ * @param[in] node 	- LibXML2 node
+ * @return 		- the attribute table which should be released with pcilib_free_xml_attrs() or NULL on error
+ */
+pcilib_xml_attrs_t *pcilib_parse_xml_attrs(pcilib_t *ctx, pcilib_xml_node_t *node);
+
+/** Releases the attribute table
+ * @param[in] ctx 	- pcilib context
+ * @param[in] attrs 	- attribute table
+ */
+void pcilib_free_xml_attrs(pcilib_t *ctx, pcilib_xml_attrs_t *attrs);
+
+/** This is an internal function which returns a specified attribute from the table created by pcilib_parse_xml_attrs()
+ * in the pcilib_value_t structure. The integer values are returned as PCILIB_TYPE_LONG with the format reproducing the
+ * original string, other values are returned as static strings.
+ * @param[in] ctx 	- pcilib context
+ * @param[in] attrs 	- attribute table, NULL is treated as empty table
+ * @param[in] attr 	- attribute name
+ * @param[out] val 	- the result will be returned in this variable. Prior to first usage pcilib_value_t variable should be initalized to 0.
+ * @return 		- error or 0 on success
+ */
+int pcilib_get_xml_attr_from_table(pcilib_t *ctx, const pcilib_xml_attrs_t *attrs, const char *attr, pcilib_value_t *val);
+
 
 #ifdef __cplusplus
 }
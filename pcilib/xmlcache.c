@@ -0,0 +1,536 @@
+#define _XOPEN_SOURCE 700
+#define _BSD_SOURCE
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <strings.h>
+#include <dirent.h>
+#include <errno.h>
+#include <alloca.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <libxml/xmlversion.h>
+#include <libxml/parser.h>
+
+#include "pci.h"
+#include "xml.h"
+#include "xmlcache.h"
+#include "version.h"
+#include "error.h"
+
+#define PCILIB_XML_CACHE_HASH_INIT	0xcbf29ce484222325ULL		/**< FNV-1a offset basis */
+#define PCILIB_XML_CACHE_HASH_PRIME	0x100000001b3ULL		/**< FNV-1a prime */
+#define PCILIB_XML_CACHE_SCHEMAS	2				/**< Number of top-level schema files, the included schemas are stamped as well */
+#define PCILIB_XML_CACHE_MAX_SCHEMA	65536				/**< Maximal size of schema file scanned for includes */
+
+static const char *pcilib_xml_cache_schemas[PCILIB_XML_CACHE_SCHEMAS] = { "model.xsd", "references.xsd" };
+
+typedef struct {
+    char magic[8];					/**< PCILIB_XML_CACHE_MAGIC */
+    uint32_t version;					/**< PCILIB_XML_CACHE_VERSION */
+    uint32_t pcilib_version;				/**< Version of pcilib which has produced the cache */
+    uint32_t libxml_version;				/**< Version of libxml2 which has serialized the document */
+    uint32_t num_files;					/**< Number of stamps (schemas + model files) */
+    uint64_t location_hash;				/**< Hash of schema and model directories */
+    uint64_t doc_size;					/**< Size of the serialized XML document following the stamps */
+} pcilib_xml_cache_header_t;
+
+typedef struct {
+    char name[PCILIB_XML_CACHE_MAX_NAME];		/**< File name relative to the model (or schema) directory */
+    uint64_t size;					/**< File size */
+    int64_t mtime_sec;					/**< Modification time, seconds */
+    int64_t mtime_nsec;					/**< Modification time, nanoseconds */
+    uint64_t hash;					/**< FNV-1a hash of the file content */
+} pcilib_xml_cache_stamp_t;
+
+struct pcilib_xml_cache_s {
+    char *path;						/**< Path to the cache file */
+    const char *schema_dir;				/**< Directory with XSD schemas */
+    const char *model_path;				/**< Directory with XML model */
+    uint64_t location_hash;				/**< Hash of schema and model directories */
+
+    size_t num_schemas;					/**< Number of stamped schemas (including the included ones) */
+    size_t num_files;					/**< Number of stamps */
+    size_t alloc_files;					/**< Number of allocated stamps */
+    pcilib_xml_cache_stamp_t *stamps;			/**< Current stamps of schemas and model files */
+    int hashed;						/**< Indicates that content hashes of all files are computed */
+
+    int valid;						/**< Indicates that the cache is up to date */
+    void *map;						/**< Memory-mapped cache file */
+    size_t map_size;					/**< Size of the mapping */
+    const char *doc;					/**< Pointer to the serialized document within mapping */
+    size_t doc_size;					/**< Size of serialized document */
+};
+
+static uint64_t pcilib_xml_cache_hash(uint64_t hash, const void *data, size_t size) {
+    size_t i;
+    const unsigned char *p = (const unsigned char*)data;
+
+    for (i = 0; i < size; i++) {
+	hash ^= p[i];
+	hash *= PCILIB_XML_CACHE_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+static int pcilib_xml_cache_hash_file(const char *path, uint64_t *hash) {
+    int fd;
+    ssize_t res;
+    char buf[65536];
+    uint64_t val = PCILIB_XML_CACHE_HASH_INIT;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return PCILIB_ERROR_NOTFOUND;
+
+    while ((res = read(fd, buf, sizeof(buf))) > 0)
+	val = pcilib_xml_cache_hash(val, buf, res);
+
+    close(fd);
+    if (res < 0) return PCILIB_ERROR_FAILED;
+
+    *hash = val;
+    return 0;
+}
+
+static const char *pcilib_xml_cache_get_dir(pcilib_xml_cache_t *cache, size_t i) {
+    return (i < cache->num_schemas)?cache->schema_dir:cache->model_path;
+}
+
+static int pcilib_xml_cache_stat(pcilib_xml_cache_t *cache, size_t i, struct stat *st) {
+    const char *dir = pcilib_xml_cache_get_dir(cache, i);
+    char *full_name = (char*)alloca(strlen(dir) + strlen(cache->stamps[i].name) + 2);
+
+    sprintf(full_name, "%s/%s", dir, cache->stamps[i].name);
+    if (stat(full_name, st)) return PCILIB_ERROR_NOTFOUND;
+
+    cache->stamps[i].size = st->st_size;
+    cache->stamps[i].mtime_sec = st->st_mtim.tv_sec;
+    cache->stamps[i].mtime_nsec = st->st_mtim.tv_nsec;
+
+    return 0;
+}
+
+static int pcilib_xml_cache_hash_stamp(pcilib_xml_cache_t *cache, size_t i) {
+    const char *dir = pcilib_xml_cache_get_dir(cache, i);
+    char *full_name = (char*)alloca(strlen(dir) + strlen(cache->stamps[i].name) + 2);
+
+    sprintf(full_name, "%s/%s", dir, cache->stamps[i].name);
+    return pcilib_xml_cache_hash_file(full_name, &cache->stamps[i].hash);
+}
+
+static int pcilib_xml_cache_compare_stamps(const void *a, const void *b) {
+    return strcmp(((const pcilib_xml_cache_stamp_t*)a)->name, ((const pcilib_xml_cache_stamp_t*)b)->name);
+}
+
+static int pcilib_xml_cache_add_stamp(pcilib_xml_cache_t *cache, const char *name, size_t len) {
+    if (len >= PCILIB_XML_CACHE_MAX_NAME) {
+	pcilib_warning("The name of XML file %s is too long for caching", name);
+	return PCILIB_ERROR_TOOBIG;
+    }
+
+    if (cache->num_files == cache->alloc_files) {
+	size_t alloc_files = cache->alloc_files?(2 * cache->alloc_files):32;
+	pcilib_xml_cache_stamp_t *stamps = (pcilib_xml_cache_stamp_t*)realloc(cache->stamps, alloc_files * sizeof(pcilib_xml_cache_stamp_t));
+	if (!stamps) return PCILIB_ERROR_MEMORY;
+
+	memset(stamps + cache->alloc_files, 0, (alloc_files - cache->alloc_files) * sizeof(pcilib_xml_cache_stamp_t));
+	cache->stamps = stamps;
+	cache->alloc_files = alloc_files;
+    }
+
+    memcpy(cache->stamps[cache->num_files].name, name, len);
+    cache->stamps[cache->num_files++].name[len] = 0;
+
+    return 0;
+}
+
+    /**
+     * Adds the schemas included or imported by the specified schema to the list of stamps, unless they
+     * are already there. The locations are resolved relative to the directory of the including schema,
+     * absolute paths and URLs are ignored.
+     */
+static int pcilib_xml_cache_scan_schema(pcilib_xml_cache_t *cache, size_t idx) {
+    int fd, err = 0;
+    ssize_t size;
+    size_t i, dir_len, len;
+    char *buf, *pos, *end, *name, quote;
+    const char *slash = strrchr(cache->stamps[idx].name, '/');
+    char *full_name = (char*)alloca(strlen(cache->schema_dir) + strlen(cache->stamps[idx].name) + 2);
+
+    sprintf(full_name, "%s/%s", cache->schema_dir, cache->stamps[idx].name);
+    fd = open(full_name, O_RDONLY);
+    if (fd < 0) return PCILIB_ERROR_NOTFOUND;
+
+    buf = (char*)malloc(PCILIB_XML_CACHE_MAX_SCHEMA + 1);
+    name = (char*)malloc(2 * PCILIB_XML_CACHE_MAX_NAME);
+    if ((!buf)||(!name)) {
+	if (buf) free(buf);
+	close(fd);
+	return PCILIB_ERROR_MEMORY;
+    }
+
+    size = read(fd, buf, PCILIB_XML_CACHE_MAX_SCHEMA + 1);
+    close(fd);
+
+    if ((size < 0)||(size > PCILIB_XML_CACHE_MAX_SCHEMA)) {
+	free(name);
+	free(buf);
+	return (size < 0)?PCILIB_ERROR_FAILED:PCILIB_ERROR_TOOBIG;
+    }
+    buf[size] = 0;
+
+    dir_len = slash?(slash - cache->stamps[idx].name + 1):0;
+    memcpy(name, cache->stamps[idx].name, dir_len);
+
+    for (pos = strstr(buf, "schemaLocation"); (!err)&&(pos); pos = strstr(pos, "schemaLocation")) {
+	pos += strlen("schemaLocation");
+	pos += strspn(pos, " \t\r\n");
+	if (*pos != '=') continue;
+	pos += 1 + strspn(pos + 1, " \t\r\n");
+	if ((*pos != '"')&&(*pos != '\'')) continue;
+
+	quote = *pos++;
+	end = strchr(pos, quote);
+	if (!end) break;
+
+	len = end - pos;
+	if ((!len)||(*pos == '/')||(memchr(pos, ':', len))) continue;
+
+	if ((dir_len + len) >= 2 * PCILIB_XML_CACHE_MAX_NAME) {
+	    err = PCILIB_ERROR_TOOBIG;
+	    break;
+	}
+
+	memcpy(name + dir_len, pos, len);
+	name[dir_len + len] = 0;
+
+	for (i = 0; i < cache->num_files; i++)
+	    if (!strcmp(cache->stamps[i].name, name)) break;
+
+	if (i == cache->num_files)
+	    err = pcilib_xml_cache_add_stamp(cache, name, dir_len + len);
+
+	pos = end + 1;
+    }
+
+    free(name);
+    free(buf);
+
+    return err;
+}
+
+    // Enumerates files exactly as pcilib_process_xml_internal does, but sorts them to get reproducible list
+static int pcilib_xml_cache_scan(pcilib_t *ctx, pcilib_xml_cache_t *cache) {
+    int err;
+    DIR *rep;
+    struct stat st;
+    struct dirent *file = NULL;
+    size_t i;
+
+    for (i = 0; i < PCILIB_XML_CACHE_SCHEMAS; i++) {
+	err = pcilib_xml_cache_add_stamp(cache, pcilib_xml_cache_schemas[i], strlen(pcilib_xml_cache_schemas[i]));
+	if (err) return err;
+    }
+
+	// The list is growing while the included schemas are discovered
+    for (i = 0; i < cache->num_files; i++) {
+	err = pcilib_xml_cache_scan_schema(cache, i);
+	if (err) return err;
+    }
+    cache->num_schemas = cache->num_files;
+
+    rep = opendir(cache->model_path);
+    if (!rep) return PCILIB_ERROR_NOTFOUND;
+
+    while ((file = readdir(rep)) != NULL) {
+        size_t len = strlen(file->d_name);
+        if ((len < 4)||(strcasecmp(file->d_name + len - 4, ".xml"))) continue;
+        if (file->d_type != DT_REG) continue;
+
+	err = pcilib_xml_cache_add_stamp(cache, file->d_name, len);
+	if (err) {
+	    closedir(rep);
+	    return err;
+	}
+    }
+    closedir(rep);
+
+    qsort(cache->stamps + cache->num_schemas, cache->num_files - cache->num_schemas, sizeof(pcilib_xml_cache_stamp_t), pcilib_xml_cache_compare_stamps);
+
+    for (i = 0; i < cache->num_files; i++) {
+	if (pcilib_xml_cache_stat(cache, i, &st))
+	    return PCILIB_ERROR_NOTFOUND;
+    }
+
+    return 0;
+}
+
+static int pcilib_xml_cache_hash_all(pcilib_t *ctx, pcilib_xml_cache_t *cache) {
+    int err;
+    size_t i;
+
+    if (cache->hashed) return 0;
+
+    for (i = 0; i < cache->num_files; i++) {
+	err = pcilib_xml_cache_hash_stamp(cache, i);
+	if (err) return err;
+    }
+
+    cache->hashed = 1;
+    return 0;
+}
+
+static int pcilib_xml_cache_mkdir(const char *path) {
+    if ((mkdir(path, 0755))&&(errno != EEXIST)) return PCILIB_ERROR_FAILED;
+    return 0;
+}
+
+static char *pcilib_xml_cache_get_path(pcilib_t *ctx, uint64_t location_hash, int create) {
+    char *path;
+    const char *base;
+    const char *cache_dir = getenv("PCILIB_CACHE_DIR");
+
+    if (cache_dir) {
+	if (!*cache_dir) return NULL;
+	if ((create)&&(pcilib_xml_cache_mkdir(cache_dir))) return NULL;
+
+	path = (char*)malloc(strlen(cache_dir) + 64);
+	if (!path) return NULL;
+
+	sprintf(path, "%s/%016llx.cache", cache_dir, (unsigned long long)location_hash);
+	return path;
+    }
+
+    base = getenv("XDG_CACHE_HOME");
+    if ((base)&&(*base)) {
+	path = (char*)malloc(strlen(base) + 64);
+	if (!path) return NULL;
+
+	sprintf(path, "%s", base);
+    } else {
+	base = getenv("HOME");
+	if ((!base)||(!*base)) return NULL;
+
+	path = (char*)malloc(strlen(base) + 64);
+	if (!path) return NULL;
+
+	sprintf(path, "%s/.cache", base);
+    }
+
+    if ((create)&&(pcilib_xml_cache_mkdir(path))) {
+	free(path);
+	return NULL;
+    }
+
+    strcat(path, "/pcilib");
+    if ((create)&&(pcilib_xml_cache_mkdir(path))) {
+	free(path);
+	return NULL;
+    }
+
+    sprintf(path + strlen(path), "/%016llx.cache", (unsigned long long)location_hash);
+    return path;
+}
+
+static int pcilib_xml_cache_map(pcilib_t *ctx, pcilib_xml_cache_t *cache) {
+    int fd;
+    size_t i;
+    struct stat st;
+    const pcilib_xml_cache_header_t *header;
+    const pcilib_xml_cache_stamp_t *stamps;
+
+    fd = open(cache->path, O_RDONLY);
+    if (fd < 0) return PCILIB_ERROR_NOTFOUND;
+
+    if ((fstat(fd, &st))||(st.st_size < sizeof(pcilib_xml_cache_header_t))) {
+	close(fd);
+	return PCILIB_ERROR_INVALID_DATA;
+    }
+
+    cache->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (cache->map == MAP_FAILED) {
+	cache->map = NULL;
+	return PCILIB_ERROR_FAILED;
+    }
+    cache->map_size = st.st_size;
+
+    header = (const pcilib_xml_cache_header_t*)cache->map;
+    if ((memcmp(header->magic, PCILIB_XML_CACHE_MAGIC, sizeof(header->magic)))||
+	(header->version != PCILIB_XML_CACHE_VERSION)||
+	(header->pcilib_version != PCILIB_VERSION)||
+	(header->libxml_version != LIBXML_VERSION)||
+	(header->location_hash != cache->location_hash)||
+	(header->num_files != cache->num_files)||
+	(cache->map_size != (sizeof(pcilib_xml_cache_header_t) + header->num_files * sizeof(pcilib_xml_cache_stamp_t) + header->doc_size)))
+	    return PCILIB_ERROR_INVALID_DATA;
+
+    stamps = (const pcilib_xml_cache_stamp_t*)(header + 1);
+    for (i = 0; i < cache->num_files; i++) {
+	if ((strncmp(stamps[i].name, cache->stamps[i].name, PCILIB_XML_CACHE_MAX_NAME))||(stamps[i].size != cache->stamps[i].size))
+	    return PCILIB_ERROR_INVALID_DATA;
+
+	if ((stamps[i].mtime_sec == cache->stamps[i].mtime_sec)&&(stamps[i].mtime_nsec == cache->stamps[i].mtime_nsec)) {
+	    cache->stamps[i].hash = stamps[i].hash;
+	    continue;
+	}
+
+	    // Only timestamp is modified (i.e. after checkout or copying), the content is verified
+	if ((pcilib_xml_cache_hash_stamp(cache, i))||(stamps[i].hash != cache->stamps[i].hash))
+	    return PCILIB_ERROR_INVALID_DATA;
+    }
+
+    cache->doc = (const char*)(stamps + cache->num_files);
+    cache->doc_size = header->doc_size;
+
+    return 0;
+}
+
+pcilib_xml_cache_t *pcilib_xml_cache_open(pcilib_t *ctx, const char *schema_dir, const char *model_path) {
+    int err;
+    uint64_t hash;
+    pcilib_xml_cache_t *cache;
+
+    hash = pcilib_xml_cache_hash(PCILIB_XML_CACHE_HASH_INIT, schema_dir, strlen(schema_dir) + 1);
+    hash = pcilib_xml_cache_hash(hash, model_path, strlen(model_path) + 1);
+
+    cache = (pcilib_xml_cache_t*)malloc(sizeof(pcilib_xml_cache_t));
+    if (!cache) return NULL;
+
+    memset(cache, 0, sizeof(pcilib_xml_cache_t));
+    cache->schema_dir = schema_dir;
+    cache->model_path = model_path;
+    cache->location_hash = hash;
+
+    cache->path = pcilib_xml_cache_get_path(ctx, hash, 0);
+    if (!cache->path) {
+	free(cache);
+	return NULL;
+    }
+
+    err = pcilib_xml_cache_scan(ctx, cache);
+    if (err) {
+	pcilib_xml_cache_close(ctx, cache);
+	return NULL;
+    }
+
+    err = pcilib_xml_cache_map(ctx, cache);
+    if (err) {
+	if (cache->map) {
+	    munmap(cache->map, cache->map_size);
+	    cache->map = NULL;
+	}
+
+	    // Hashing before the model is parsed, so concurrent modifications would invalidate the new cache
+	err = pcilib_xml_cache_hash_all(ctx, cache);
+	if (err) {
+	    pcilib_xml_cache_close(ctx, cache);
+	    return NULL;
+	}
+
+	return cache;
+    }
+
+    cache->valid = 1;
+    return cache;
+}
+
+xmlDocPtr pcilib_xml_cache_get_document(pcilib_t *ctx, pcilib_xml_cache_t *cache) {
+    xmlDocPtr doc;
+
+    if ((!cache)||(!cache->valid)) return NULL;
+
+    doc = xmlCtxtReadMemory(ctx->xml.parser, cache->doc, cache->doc_size, cache->model_path, NULL, 0);
+    if (!doc) {
+        xmlErrorPtr xmlerr = xmlCtxtGetLastError(ctx->xml.parser);
+        if (xmlerr) pcilib_warning("Error parsing cached model %s, xmlCtxtReadMemory reported error %d - %s", cache->path, xmlerr->code, xmlerr->message);
+        else pcilib_warning("Error parsing cached model %s", cache->path);
+	cache->valid = 0;
+	return NULL;
+    }
+
+    return doc;
+}
+
+int pcilib_xml_cache_store(pcilib_t *ctx, pcilib_xml_cache_t *cache, xmlDocPtr doc) {
+    int err;
+    int fd, size;
+    xmlChar *data;
+    char *path, *tmp_path;
+    pcilib_xml_cache_header_t header;
+
+    if (!cache) return PCILIB_ERROR_INVALID_ARGUMENT;
+
+    err = pcilib_xml_cache_hash_all(ctx, cache);
+    if (err) return err;
+
+    path = pcilib_xml_cache_get_path(ctx, cache->location_hash, 1);
+    if (!path) {
+	pcilib_warning("Failed to create XML cache directory");
+	return PCILIB_ERROR_FAILED;
+    }
+
+    xmlDocDumpMemory(doc, &data, &size);
+    if (!data) {
+	free(path);
+	pcilib_warning("Failed to serialize XML model for caching");
+	return PCILIB_ERROR_FAILED;
+    }
+
+    tmp_path = (char*)alloca(strlen(path) + 8);
+    sprintf(tmp_path, "%s.XXXXXX", path);
+
+	// Writing under temporary name to prevent concurrent processes from using partially written cache
+    fd = mkstemp(tmp_path);
+    if (fd < 0) {
+	xmlFree(data);
+	free(path);
+	pcilib_warning("Failed to create XML cache file %s", tmp_path);
+	return PCILIB_ERROR_FAILED;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PCILIB_XML_CACHE_MAGIC, sizeof(header.magic));
+    header.version = PCILIB_XML_CACHE_VERSION;
+    header.pcilib_version = PCILIB_VERSION;
+    header.libxml_version = LIBXML_VERSION;
+    header.num_files = cache->num_files;
+    header.location_hash = cache->location_hash;
+    header.doc_size = size;
+
+    if ((write(fd, &header, sizeof(header)) != sizeof(header))||
+	(write(fd, cache->stamps, cache->num_files * sizeof(pcilib_xml_cache_stamp_t)) != (cache->num_files * sizeof(pcilib_xml_cache_stamp_t)))||
+	(write(fd, data, size) != size)) err = PCILIB_ERROR_FAILED;
+
+    fchmod(fd, 0644);
+    close(fd);
+    xmlFree(data);
+
+    if ((!err)&&(rename(tmp_path, path))) err = PCILIB_ERROR_FAILED;
+    if (err) {
+	unlink(tmp_path);
+	pcilib_warning("Failed to write XML cache file %s", path);
+    }
+
+    free(path);
+    return err;
+}
+
+void pcilib_xml_cache_close(pcilib_t *ctx, pcilib_xml_cache_t *cache) {
+    if (!cache) return;
+
+    if (cache->map) munmap(cache->map, cache->map_size);
+    if (cache->stamps) free(cache->stamps);
+    if (cache->path) free(cache->path);
+
+    free(cache);
+}
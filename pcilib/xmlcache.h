@@ -0,0 +1,74 @@
+/**
+ * @file xmlcache.h
+ * @brief Cache of the pre-validated XML models
+ *
+ * @details Loading an XML model requires parsing of all files in the model directory, validating them
+ * against the XSD schemas, and merging them in a single document. For short-lived pcitool invocations
+ * this takes most of the startup time. The cache stores the already merged and validated document along
+ * with the stamps (size, modification time, and content hash) of all model files and schemas. If the
+ * stamps are still matching, the document is parsed directly from the memory-mapped cache and both the
+ * schema loading and the validation are skipped.
+ *
+ * The cache is stored in the directory specified by PCILIB_CACHE_DIR environmental variable or in
+ * $XDG_CACHE_HOME/pcilib (~/.cache/pcilib) otherwise. Setting PCILIB_CACHE_DIR to an empty string
+ * disables caching.
+ */
+
+#ifndef _PCILIB_XMLCACHE_H
+#define _PCILIB_XMLCACHE_H
+
+#include <libxml/tree.h>
+#include <pcilib.h>
+
+#define PCILIB_XML_CACHE_MAGIC		"PCILIBXC"	/**< Signature of the cache files */
+#define PCILIB_XML_CACHE_VERSION	1		/**< Version of the cache format, should be increased on any incompatible change */
+#define PCILIB_XML_CACHE_MAX_NAME	256		/**< Maximal length of the file name stored in the cache */
+
+typedef struct pcilib_xml_cache_s pcilib_xml_cache_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Collects stamps of the model files and schemas and checks if a valid cache exists for the
+ * specified model location. The content hashes are only computed for the files with modified
+ * timestamps or if the cache needs to be (re)created.
+ * @param[in] ctx 		- pcilib context
+ * @param[in] schema_dir	- directory with XSD schemas (model.xsd and references.xsd)
+ * @param[in] model_path	- directory with XML files of the model
+ * @return			- cache handle or NULL if caching is disabled or not possible
+ */
+pcilib_xml_cache_t *pcilib_xml_cache_open(pcilib_t *ctx, const char *schema_dir, const char *model_path);
+
+/**
+ * Parses the cached document. No validation is performed.
+ * @param[in] ctx 		- pcilib context
+ * @param[in] cache		- cache handle
+ * @return			- the parsed document or NULL if cache is not valid
+ */
+xmlDocPtr pcilib_xml_cache_get_document(pcilib_t *ctx, pcilib_xml_cache_t *cache);
+
+/**
+ * Stores the merged and validated document in the cache. The stamps collected by pcilib_xml_cache_open()
+ * are used, so the modifications of model files done in the meantime will invalidate the cache.
+ * The failures are not critical and only reported as warnings.
+ * @param[in] ctx 		- pcilib context
+ * @param[in] cache		- cache handle
+ * @param[in] doc		- merged and validated XML document
+ * @return			- error code or 0 on success
+ */
+int pcilib_xml_cache_store(pcilib_t *ctx, pcilib_xml_cache_t *cache, xmlDocPtr doc);
+
+/**
+ * Unmaps the cache and releases the associated resources
+ * @param[in] ctx 		- pcilib context
+ * @param[in] cache		- cache handle
+ */
+void pcilib_xml_cache_close(pcilib_t *ctx, pcilib_xml_cache_t *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PCILIB_XMLCACHE_H */
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <ctype.h>
 #include <stdint.h>
 #include <stdarg.h>
 #include <fcntl.h>
@@ -15,6 +16,10 @@
 #include <sys/time.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <errno.h>
 #include <alloca.h>
 #include <arpa/inet.h>
@@ -44,6 +49,7 @@
 #include "pcilib/debug.h"
 #include "pcilib/model.h"
 #include "pcilib/locking.h"
+#include "pcilib/aggregate.h"
 
 /* defines */
 #define MAX_KBUF 14
@@ -59,6 +65,7 @@
 #define BLOCK_SIZE 8
 #define BENCHMARK_ITERATIONS 128
 #define STATUS_MESSAGE_INTERVAL	5	/* seconds */
+#define TRIGGER_CHECK_INTERVAL 100000	/* us */
 
 
 #define isnumber pcilib_isnumber
@@ -106,7 +113,9 @@ typedef enum {
     MODE_LIST_LOCKS,
     MODE_FREE_LOCKS,
     MODE_LOCK,
-    MODE_UNLOCK
+    MODE_UNLOCK,
+    MODE_SAMPLE,
+    MODE_WAIT_REGISTER
 } MODE;
 
 typedef enum {
@@ -129,6 +138,11 @@ typedef enum {
     FORMAT_RINGFS
 } FORMAT;
 
+typedef enum {
+    STATS_FORMAT_TEXT = 0,
+    STATS_FORMAT_KV
+} STATS_FORMAT;
+
 typedef enum {
     PARTITION_UNKNOWN,
     PARTITION_RAW,
@@ -191,13 +205,23 @@ typedef enum {
     OPT_VERIFY,
     OPT_WAIT,
     OPT_MULTIPACKET,
-    OPT_VERBOSE
+    OPT_VERBOSE,
+    OPT_SAMPLE,
+    OPT_SAMPLE_RATE,
+    OPT_SAMPLE_TIME,
+    OPT_STATS_INTERVAL,
+    OPT_STATS_FORMAT,
+    OPT_BAR_CACHE,
+    OPT_WAIT_REGISTER,
+    OPT_AGGREGATE,
+    OPT_DROP
 } OPTIONS;
 
 static struct option long_options[] = {
     {"device",			required_argument, 0, OPT_DEVICE },
     {"model",			required_argument, 0, OPT_MODEL },
     {"bar",			required_argument, 0, OPT_BAR },
+    {"bar-cache",		required_argument, 0, OPT_BAR_CACHE },
     {"access",			required_argument, 0, OPT_ACCESS },
     {"endianess",		required_argument, 0, OPT_ENDIANESS },
     {"size",			required_argument, 0, OPT_SIZE },
@@ -217,9 +241,15 @@ static struct option long_options[] = {
     {"run-time",		required_argument, 0, OPT_RUN_TIME },
     {"trigger-rate",		required_argument, 0, OPT_TRIGGER_RATE },
     {"trigger-time",		required_argument, 0, OPT_TRIGGER_TIME },
+    {"sample",			required_argument, 0, OPT_SAMPLE },
+    {"sample-rate",		required_argument, 0, OPT_SAMPLE_RATE },
+    {"sample-time",		required_argument, 0, OPT_SAMPLE_TIME },
+    {"wait-register",		required_argument, 0, OPT_WAIT_REGISTER },
     {"format",			required_argument, 0, OPT_FORMAT },
     {"buffer",			optional_argument, 0, OPT_BUFFER },
     {"threads",			optional_argument, 0, OPT_THREADS },
+    {"stats-interval",		required_argument, 0, OPT_STATS_INTERVAL },
+    {"stats-format",		required_argument, 0, OPT_STATS_FORMAT },
     {"start-dma",		required_argument, 0, OPT_START_DMA },
     {"stop-dma",		optional_argument, 0, OPT_STOP_DMA },
     {"list-dma-engines",	no_argument, 0, OPT_LIST_DMA },
@@ -248,6 +278,8 @@ static struct option long_options[] = {
     {"verify",			no_argument, 0, OPT_VERIFY },
     {"multipacket",		no_argument, 0, OPT_MULTIPACKET },
     {"wait",			no_argument, 0, OPT_WAIT },
+    {"aggregate",		required_argument, 0, OPT_AGGREGATE },
+    {"drop",			no_argument, 0, OPT_DROP },
     {"version",			no_argument, 0, OPT_VERSION },
     {"help",			no_argument, 0, OPT_HELP },
     { 0, 0, 0, 0 }
@@ -289,6 +321,11 @@ void Usage(int argc, char *argv[], const char *format, ...) {
 "   -r <prop>[:unit]		- Read property\n"
 "   -w <prop>[:unit]		- Write property\n"
 "   -r <prop|reg>@attr		- Read register/property attribute\n"
+"   --sample <reg1,reg2,...>	- Periodically sample set of registers\n"
+"   --wait-register <cond>	- Wait until register satisfies the condition\n"
+"	reg=value[/mask]	- the masked bits are equal to the value\n"
+"	reg!=value[/mask]	- the masked bits differ from the value\n"
+"	reg[/mask]		- the masked bits are changed\n"
 "\n"
 "  Event Modes:\n"
 "   --trigger [event]		- Trigger Events\n"
@@ -326,19 +363,31 @@ void Usage(int argc, char *argv[], const char *format, ...) {
 "   --unlock <lock name> 	- Release persistent lock\n"
 "\n"
 "  Addressing:\n"
-"   -d <device>			- FPGA device (/dev/fpga0)\n"
+"   -d <device>			- FPGA device (/dev/fpga0), 'emulated' runs without hardware\n"
 "   -m <model>			- Memory model (autodetected)\n"
 "	pci			- Plain\n"
 "	ipecamera		- IPE Camera\n"
 "   -b <bank>			- PCI bar, Register bank, or DMA channel\n"
 "\n"
 "  Options:\n"
-"   -s <size>			- Number of words (default: 1)\n"
+"   -s <size>			- Number of words, or FIFO register values (default: 1)\n"
 "   -a [fifo|dma|config]<bits>	- Access type and bits per word (default: 32)\n"
 "   -e <l|b>			- Endianess Little/Big (default: host)\n"
 "   -o <file>			- Append output to file (default: stdout)\n"
 "   -t <timeout|unlimited> 	- Timeout in microseconds\n"
 "   --check			- Verify write operations\n"
+"   --bar-cache <mode>		- Caching of PCI bar mapping (requires -b)\n"
+"	default			- As configured by the system\n"
+"	uc			- Uncached\n"
+"	wc			- Write-combining, speeds up bulk writes\n"
+"	wb			- Write-back, only for prefetchable bars\n"
+"\n"
+"  Sampling Options:\n"
+"   --sample-rate <sps>		- Take sps register snapshots per second\n"
+"   --sample-time <us>		- Specifies delay between snapshots (us)\n"
+"   --run-time <us>		- Limit time to sample registers\n"
+"   -s <num|unlimited> 		- Number of snapshots to take\n"
+"   -o <file>			- Append samples to file (default: stdout)\n"
 "\n"
 "  Event Options:\n"
 "   --event <evt>		- Specifies event for trigger and grab modes\n"
@@ -355,11 +404,29 @@ void Usage(int argc, char *argv[], const char *format, ...) {
 "				  seqnum(64), offset(64), timestamp(128)\n"
 //"	ringfs			- Write to RingFS\n"
 "   --buffer [size]		- Request data buffering, size in MB\n"
-"   --threads [num]		- Allow multithreaded processing\n"
+"   --threads [num]		- Allow multithreaded processing, the events are\n"
+"				  decoded in num threads (default: all cores)\n"
+"   --stats-interval <us>	- Interval between status reports (default: 5 s)\n"
+"   --stats-format <fmt>	- Format of status reports\n"
+"	text			- Human readable, printed in verbose mode (default)\n"
+"	kv			- Single line of key=value pairs per interval\n"
 "\n"
 "  DMA Options:\n"
 "   --multipacket		- Read multiple packets\n"
 "   --wait			- Wait until data arrives\n"
+"   --aggregate <dev1,dev2,...>	- Read the DMA engine of all listed devices as well,\n"
+"				  the merged stream is written to the output\n"
+"   --format [type]		- Specifies how aggregated data should be stored\n"
+"	add_header		- Prefix blocks with 512 bit header (default):\n"
+"				  source(64), flags(64), source_seqnum(64), size(64)\n"
+"				  seqnum(64), reserved(64), timestamp(128)\n"
+"	raw			- Just write all blocks sequentially\n"
+"   --buffer [size]		- Size of aggregation queue in MB\n"
+"   --block-size <size>		- Size of aggregation queue blocks in bytes\n"
+"   --drop			- Drop data instead of stalling DMA if output is slow\n"
+"   --run-time <us>		- Limit time to read aggregated data\n"
+"   -s <size>			- Limit number of aggregated words to read\n"
+"   -t <timeout|unlimited>	- Stop if no data is coming for the specified time\n"
 "\n"
 "  Kernel Options:\n"
 "   --type <type>		- Type of kernel memory to allocate\n"
@@ -385,10 +452,17 @@ argv[0]);
 }
 
 static int StopFlag = 0;
+static int StopFd = -1;			/**< Eventfd of the grab monitor, woken up on signals */
 
 static void signal_exit_handler(int signo) { 
+    uint64_t val = 1;
+
     if (++StopFlag > 2)
 	exit(-1);
+
+    if (StopFd >= 0) {
+	if (write(StopFd, &val, sizeof(val)) != sizeof(val)) StopFd = -1;
+    }
 }
 
 void LogError(void *arg, const char *file, int line, pcilib_log_priority_t prio, const char *format, va_list ap) {
@@ -942,6 +1016,20 @@ void Info(pcilib_t *handle, const pcilib_model_description_t *model_info, const
     if (board_info)
 	printf(" Interrupt - Pin: %i, Line: %i\n", board_info->interrupt_pin, board_info->interrupt_line);
 
+    if (handle->xml.num_files)
+	printf(" XML Model - Locations: %zu (%zu cached), Load Time: %.3lf ms (parsing %.3lf ms, %zu threads)\n", handle->xml.num_files, handle->xml.num_cached, handle->xml.load_time / 1000., handle->xml.parse_time / 1000., handle->xml.load_threads);
+
+    {
+	char features[256];
+	const char *cpu_model;
+	const pcilib_cpu_info_t *cpu_info = pcilib_get_cpu_info();
+
+	for (cpu_model = cpu_info->model; isspace(*cpu_model); cpu_model++);
+
+	printf(" CPU - %s (%s), Cores: %i, LLC: %zu KB\n", *cpu_model?cpu_model:"unknown", *cpu_info->vendor?cpu_info->vendor:"unknown", pcilib_get_cpu_count(), cpu_info->llc_size / 1024);
+	printf("       Features: %s\n", pcilib_format_cpu_features(features, sizeof(features)));
+    }
+
     printf("\n");
 
     if (target) {
@@ -1115,7 +1203,7 @@ int Benchmark(pcilib_t *handle, ACCESS_MODE mode, pcilib_dma_engine_addr_t dma,
 	printf("Transfer time (Bank: %i):\n", bar);
 	
     for (size = min_size ; size < max_size; size *= 8) {
-	gettimeofday(&start,NULL);
+	pcilib_gettime(&start);
 	if (mode == ACCESS_BAR) {
 	    for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
 		pcilib_memcpy(buf, data, access, size / access);
@@ -1127,14 +1215,14 @@ int Benchmark(pcilib_t *handle, ACCESS_MODE mode, pcilib_dma_engine_addr_t dma,
 		}
 	    }
 	}
-	gettimeofday(&end,NULL);
+	pcilib_gettime(&end);
 
 	time = (end.tv_sec - start.tv_sec)*1000000 + (end.tv_usec - start.tv_usec);
 	printf("%8zu bytes - read: %8.2lf MiB/s", size, 1000000. * size * BENCHMARK_ITERATIONS / (time * 1024. * 1024.));
 	
 	fflush(0);
 
-	gettimeofday(&start,NULL);
+	pcilib_gettime(&start);
 	if (mode == ACCESS_BAR) {
 	    for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
 		pcilib_memcpy(data, buf, access, size / access);
@@ -1146,7 +1234,7 @@ int Benchmark(pcilib_t *handle, ACCESS_MODE mode, pcilib_dma_engine_addr_t dma,
 		}
 	    }
 	}
-	gettimeofday(&end,NULL);
+	pcilib_gettime(&end);
 
 	time = (end.tv_sec - start.tv_sec)*1000000 + (end.tv_usec - start.tv_usec);
 	printf(", write: %8.2lf MiB/s\n", 1000000. * size * BENCHMARK_ITERATIONS / (time * 1024. * 1024.));
@@ -1155,7 +1243,7 @@ int Benchmark(pcilib_t *handle, ACCESS_MODE mode, pcilib_dma_engine_addr_t dma,
     printf("\n\nOpen-Transfer-Close time: \n");
     
     for (size = 4 ; size < max_size; size *= 8) {
-	gettimeofday(&start,NULL);
+	pcilib_gettime(&start);
 	if (mode == ACCESS_BAR) {
 	    for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
 		pcilib_read(handle, bar, 0, access, size / access, buf);
@@ -1165,14 +1253,14 @@ int Benchmark(pcilib_t *handle, ACCESS_MODE mode, pcilib_dma_engine_addr_t dma,
 		pcilib_read_fifo(handle, bar, addr, access, size / access, buf);
 	    }
 	}
-	gettimeofday(&end,NULL);
+	pcilib_gettime(&end);
 
 	time = (end.tv_sec - start.tv_sec)*1000000 + (end.tv_usec - start.tv_usec);
 	printf("%8zu bytes - read: %8.2lf MiB/s", size, 1000000. * size * BENCHMARK_ITERATIONS / (time * 1024. * 1024.));
 	
 	fflush(0);
 
-	gettimeofday(&start,NULL);
+	pcilib_gettime(&start);
 	if (mode == ACCESS_BAR) {
 	    for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
 		pcilib_write(handle, bar, 0, access, size / access, buf);
@@ -1183,19 +1271,19 @@ int Benchmark(pcilib_t *handle, ACCESS_MODE mode, pcilib_dma_engine_addr_t dma,
 	    }
 	}
 	
-	gettimeofday(&end,NULL);
+	pcilib_gettime(&end);
 
 	time = (end.tv_sec - start.tv_sec)*1000000 + (end.tv_usec - start.tv_usec);
 	printf(", write: %8.2lf MiB/s", 1000000. * size * BENCHMARK_ITERATIONS / (time * 1024. * 1024.));
 
 	if (mode == ACCESS_BAR) {
-	    gettimeofday(&start,NULL);
+	    pcilib_gettime(&start);
 	    for (i = 0, errors = 0; i < BENCHMARK_ITERATIONS; i++) {
 		pcilib_write(handle, bar, 0, access, size / access, buf);
 		pcilib_read(handle, bar, 0, access, size / access, check);
 		if (memcmp(buf, check, size)) ++errors;
 	    }
-	    gettimeofday(&end,NULL);
+	    pcilib_gettime(&end);
 
 	    time = (end.tv_sec - start.tv_sec)*1000000 + (end.tv_usec - start.tv_usec);
 	    printf(", write-verify: %8.2lf MiB/s", 1000000. * size * BENCHMARK_ITERATIONS / (time * 1024. * 1024.));
@@ -1244,10 +1332,15 @@ static int DMACallback(void *arg, pcilib_dma_flags_t flags, size_t bufsize, void
 */
 
 
+#define DMA_MAX_CHUNKS 40		/**< DMA data of unknown size is read in the chunks of doubling size, starting from 4096 bytes */
+
 int ReadData(pcilib_t *handle, ACCESS_MODE mode, FLAGS flags, pcilib_dma_engine_addr_t dma, pcilib_bar_t bar, uintptr_t addr, size_t n, access_t access, int endianess, size_t timeout, FILE *o) {
     void *buf;
     int i, err;
     size_t ret, bytes;
+    int n_chunks = 0, cur = 0;
+    size_t cur_pos = 0;
+    struct iovec chunks[DMA_MAX_CHUNKS], iov[DMA_MAX_CHUNKS];
     size_t size = n * abs(access);
     int block_width, blocks_per_line;
     int numbers_per_block, numbers_per_line; 
@@ -1289,15 +1382,27 @@ int ReadData(pcilib_t *handle, ACCESS_MODE mode, FLAGS flags, pcilib_dma_engine_
 	} else {
 	    dma_flags |= PCILIB_DMA_FLAG_IGNORE_ERRORS;
 	    
-	    size = 2048; bytes = 0;
+		// The data is scattered over the growing list of chunks and is never moved while reading
+	    size = 0; bytes = 0;
 	    do {
 		if ((size - bytes) < 4096) {
-		    size *= 2;
-		    buf = realloc(buf, size);
-		    if (!buf) Error("Allocation of %zu bytes of memory has failed", size);
+		    if (n_chunks == DMA_MAX_CHUNKS) Error("Too much data is returned by DMA engine");
+		    chunks[n_chunks].iov_len = n_chunks?(2 * chunks[n_chunks - 1].iov_len):4096;
+		    chunks[n_chunks].iov_base = malloc(chunks[n_chunks].iov_len);
+		    if (!chunks[n_chunks].iov_base) Error("Allocation of %zu bytes of memory has failed", chunks[n_chunks].iov_len);
+		    size += chunks[n_chunks].iov_len;
+		    n_chunks++;
 		}
-	        err = pcilib_read_dma_custom(handle, dmaid, addr, size - bytes, dma_flags, timeout, buf + bytes, &ret);
+
+		iov[0].iov_base = chunks[cur].iov_base + cur_pos;
+		iov[0].iov_len = chunks[cur].iov_len - cur_pos;
+		memcpy(iov + 1, chunks + cur + 1, (n_chunks - cur - 1) * sizeof(struct iovec));
+
+	        err = pcilib_readv_dma(handle, dmaid, addr, iov, n_chunks - cur, dma_flags, timeout, &ret);
 		bytes += ret;
+
+		for (cur_pos += ret; (cur < (n_chunks - 1))&&(cur_pos >= chunks[cur].iov_len); cur++)
+		    cur_pos -= chunks[cur].iov_len;
 		
 		if ((!err)&&(flags&FLAG_MULTIPACKET)) {
 		    err = PCILIB_ERROR_TOOBIG;
@@ -1316,6 +1421,27 @@ int ReadData(pcilib_t *handle, ACCESS_MODE mode, FLAGS flags, pcilib_dma_engine_
 	size = bytes;
 	n = bytes / abs(access);
 	addr = 0;
+
+	if (n_chunks) {
+	    chunks[cur].iov_len = cur_pos;
+	    n_chunks = cur + 1;
+
+		// Only writing to the file can be done directly from the chunks
+	    if ((!o)||(n_chunks == 1)) {
+		if (n_chunks == 1) buf = chunks[0].iov_base;
+		else {
+		    buf = malloc(size);
+		    if (!buf) Error("Allocation of %zu bytes of memory has failed", size);
+
+		    for (i = 0, bytes = 0; i < n_chunks; i++) {
+			memcpy(buf + bytes, chunks[i].iov_base, chunks[i].iov_len);
+			bytes += chunks[i].iov_len;
+			free(chunks[i].iov_base);
+		    }
+		}
+		n_chunks = 0;
+	    }
+	}
       break;
       case ACCESS_FIFO:
 	pcilib_read_fifo(handle, bar, addr, access, n, buf);
@@ -1352,6 +1478,16 @@ int ReadData(pcilib_t *handle, ACCESS_MODE mode, FLAGS flags, pcilib_dma_engine_
 	pcilib_read(handle, bar, addr, access, size / access, buf);
     }
     
+    if (n_chunks) {
+	printf("Writting output (%zu bytes) to file (append to the end)...\n", n * abs(access));
+	for (i = 0; i < n_chunks; i++) {
+	    if (endianess) pcilib_swap(chunks[i].iov_base, chunks[i].iov_base, abs(access), chunks[i].iov_len / abs(access));
+	    fwrite(chunks[i].iov_base, 1, chunks[i].iov_len, o);
+	    free(chunks[i].iov_base);
+	}
+	return 0;
+    }
+
     if (endianess) pcilib_swap(buf, buf, abs(access), n);
 
     if (o) {
@@ -1385,9 +1521,220 @@ int ReadData(pcilib_t *handle, ACCESS_MODE mode, FLAGS flags, pcilib_dma_engine_
 }
 
 
+typedef struct {
+    pcilib_aggregate_t *agg;			/**< Aggregate stream */
+    size_t num_sources;				/**< Number of aggregated devices */
+    const char **devices;			/**< Names of aggregated devices */
+
+    FILE *o;					/**< Output file, data is only counted if NULL */
+    FORMAT format;				/**< Output format */
+    size_t max_size;				/**< Stop after the specified number of bytes, 0 - unlimited */
+    size_t size;				/**< Number of processed bytes */
+
+    int monitor_fd;				/**< Eventfd waking up the monitoring thread on signals and on completion */
+    int finished;				/**< Indicates that streaming is finished */
+    pcilib_timeout_t stats_interval;		/**< Interval between status reports */
+    STATS_FORMAT stats_format;			/**< Format of status reports */
+    int verbose;				/**< Verbosity level */
+} AGGREGATEContext;
+
+static int AggregateCallback(const pcilib_aggregate_block_t *block, void *user) {
+    AGGREGATEContext *ctx = (AGGREGATEContext*)user;
+
+    if (ctx->o) {
+	if (ctx->format != FORMAT_RAW) {
+	    uint64_t header[8];
+	    header[0] = block->source;
+	    header[1] = block->flags;
+	    header[2] = block->source_seqnum;
+	    header[3] = block->size;
+	    header[4] = block->seqnum;
+	    header[5] = 0;
+	    header[6] = block->timestamp / 1000000000;
+	    header[7] = block->timestamp % 1000000000;
+
+	    if (fwrite(header, sizeof(header), 1, ctx->o) != 1)
+		Error("Error writing aggregated data to the output");
+	}
 
+	if (fwrite(block->data, 1, block->size, ctx->o) != block->size)
+	    Error("Error writing aggregated data to the output");
+    }
+
+    ctx->size += block->size;
+    if ((ctx->max_size)&&(ctx->size >= ctx->max_size)) return PCILIB_STREAMING_STOP;
+    if (StopFlag) return PCILIB_STREAMING_STOP;
+
+    return PCILIB_STREAMING_CONTINUE;
+}
+
+static void AggregateReport(AGGREGATEContext *ctx) {
+    size_t i;
+    pcilib_aggregate_stats_t st;
+
+    for (i = 0; i <= ctx->num_sources; i++) {
+	if (pcilib_aggregate_get_stats(ctx->agg, (i < ctx->num_sources)?i:PCILIB_AGGREGATE_ALL, &st)) continue;
+
+	if (ctx->stats_format == STATS_FORMAT_KV) {
+	    if (i < ctx->num_sources) printf("stats source=%zu device=%s", i, ctx->devices[i]);
+	    else printf("stats source=all");
+
+	    printf(" time=%.3lf blocks=%zu bytes=%zu mbps=%.2lf dropped_blocks=%zu dropped_bytes=%zu stalls=%zu stall_time=%.3lf max_queued=%zu error=%i\n",
+		st.run_time / 1000000., st.blocks, st.bytes, st.throughput, st.dropped_blocks, st.dropped_bytes, st.stalls, st.stall_time / 1000000., st.max_queued, st.error);
+	} else {
+	    if (i < ctx->num_sources) printf("%2zu %-20s: ", i, ctx->devices[i]);
+	    else printf("%-23s: ", "Total");
+
+	    printf("Blocks: ");
+	    PrintNumber(st.blocks);
+	    printf(", Data: ");
+	    PrintSize(st.bytes);
+	    printf(", %8.1lf MB/s, Dropped: ", st.throughput);
+	    PrintNumber(st.dropped_blocks);
+	    printf(" (");
+	    PrintSize(st.dropped_bytes);
+	    printf("), Stalls: ");
+	    PrintNumber(st.stalls);
+	    printf(" (");
+	    PrintTime(st.stall_time);
+	    printf("), Max queued: %zu", st.max_queued);
+	    if (st.error) printf(", Error: %i", st.error);
+	    printf("\n");
+	}
+    }
+}
+
+static void *AggregateMonitor(void *user) {
+    int ret;
+    uint64_t val;
+    struct pollfd pfd;
+    AGGREGATEContext *ctx = (AGGREGATEContext*)user;
+    int report = (ctx->verbose > 0)||(ctx->stats_format == STATS_FORMAT_KV);
+
+    pfd.fd = ctx->monitor_fd;
+    pfd.events = POLLIN;
+
+    while (1) {
+	ret = poll(&pfd, 1, report?(ctx->stats_interval / 1000):-1);
+	if ((ret < 0)&&(errno != EINTR)) break;
+
+	if (ret > 0) {
+	    if (read(ctx->monitor_fd, &val, sizeof(val)) != sizeof(val)) continue;
+	    if (__atomic_load_n(&ctx->finished, __ATOMIC_ACQUIRE)) break;
+
+		// Woken up by the signal handler
+	    pcilib_aggregate_stop(ctx->agg);
+	} else if ((!ret)&&(report)) {
+	    AggregateReport(ctx);
+	}
+    }
+
+    return NULL;
+}
+
+int AggregateDMA(pcilib_t *handle, const char *device, const char *model, pcilib_dma_engine_addr_t dma, const char *devices, size_t size, size_t run_time, pcilib_timeout_t timeout, FORMAT format, size_t buffer_size, size_t block_size, int drop, pcilib_timeout_t stats_interval, STATS_FORMAT stats_format, int verbose, FILE *o) {
+    int err;
+    size_t i;
+    char *dev, *save;
+    char *devlist;
+    size_t queue_size = 0;
+    uint64_t val = 1;
+    pthread_t monitor_thread;
+    pcilib_dma_engine_t dmaid;
+    pcilib_t **handles;
+    AGGREGATEContext ctx;
+
+    memset(&ctx, 0, sizeof(AGGREGATEContext));
+
+    devlist = strdup(devices);
+    if (!devlist) Error("Error allocating memory for the list of devices");
+
+	// The device specified with -d is the first source
+    for (i = 2, dev = devlist; *dev; dev++)
+	if (*dev == ',') i++;
+
+    handles = (pcilib_t**)calloc(i, sizeof(pcilib_t*));
+    ctx.devices = (const char**)calloc(i, sizeof(char*));
+    if ((!handles)||(!ctx.devices)) Error("Error allocating memory for the list of devices");
+
+    handles[0] = handle;
+    ctx.devices[0] = device;
+    ctx.num_sources = 1;
+
+    for (dev = strtok_r(devlist, ",", &save); dev; dev = strtok_r(NULL, ",", &save)) {
+	handles[ctx.num_sources] = pcilib_open(dev, model);
+	if (!handles[ctx.num_sources]) Error("Error opening device %s", dev);
+	ctx.devices[ctx.num_sources++] = dev;
+    }
 
-int ReadRegister(pcilib_t *handle, const pcilib_model_description_t *model_info, const char *bank, const char *reg, const char *view, const char *unit, const char *attr) {
+    if (!block_size) block_size = BIGBUFSIZE / 16;
+    if (buffer_size) {
+	queue_size = buffer_size / block_size;
+	if (!queue_size) queue_size = 1;
+    }
+
+    ctx.agg = pcilib_aggregate_create(queue_size, block_size, drop?PCILIB_AGGREGATE_FLAG_DROP:PCILIB_AGGREGATE_FLAGS_DEFAULT);
+    if (!ctx.agg) Error("Failed to create the aggregate stream");
+
+    for (i = 0; i < ctx.num_sources; i++) {
+	dmaid = pcilib_find_dma_by_addr(handles[i], PCILIB_DMA_FROM_DEVICE, dma);
+	if (dmaid == PCILIB_DMA_ENGINE_INVALID) Error("Invalid DMA engine (%lu) is specified for device %s", dma, ctx.devices[i]);
+
+	err = pcilib_aggregate_add_source(ctx.agg, handles[i], dmaid, NULL);
+	if (err) Error("Error (%i) adding device %s to the aggregate stream", err, ctx.devices[i]);
+    }
+
+    ctx.o = o;
+    ctx.format = format;
+    ctx.max_size = size;
+    ctx.stats_interval = stats_interval;
+    ctx.stats_format = stats_format;
+    ctx.verbose = verbose;
+
+    ctx.monitor_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+    if (ctx.monitor_fd < 0) Error("Error (%i) creating eventfd for the monitoring thread", errno);
+    StopFd = ctx.monitor_fd;
+
+    if (pthread_create(&monitor_thread, NULL, AggregateMonitor, (void*)&ctx))
+	Error("Error spawning monitoring thread");
+
+    err = pcilib_aggregate_stream(ctx.agg, run_time?run_time:PCILIB_TIMEOUT_INFINITE, timeout, AggregateCallback, &ctx);
+
+    __atomic_store_n(&ctx.finished, 1, __ATOMIC_RELEASE);
+    if (write(ctx.monitor_fd, &val, sizeof(val)) != sizeof(val))
+	Error("Error (%i) waking up the monitoring thread", errno);
+    pthread_join(monitor_thread, NULL);
+
+    StopFd = -1;
+    close(ctx.monitor_fd);
+
+    if ((err)&&(err != PCILIB_ERROR_TIMEOUT))
+	Error("Error (%i) streaming aggregated DMA data", err);
+
+    if (verbose >= 0) {
+	if (o) printf("Written %zu bytes of aggregated data from %zu devices\n", ctx.size, ctx.num_sources);
+	AggregateReport(&ctx);
+    }
+
+    pcilib_aggregate_destroy(ctx.agg);
+
+    for (i = 1; i < ctx.num_sources; i++)
+	pcilib_close(handles[i]);
+
+    free(ctx.devices);
+    free(handles);
+    free(devlist);
+
+    if (err) {
+	pcilib_warning("No data is returned by DMA engines");
+	return -1;
+    }
+
+    return 0;
+}
+
+
+int ReadRegister(pcilib_t *handle, const pcilib_model_description_t *model_info, const char *bank, const char *reg, const char *view, const char *unit, const char *attr, size_t n) {
     int i;
     int err;
     const char *format;
@@ -1454,12 +1801,33 @@ int ReadRegister(pcilib_t *handle, const pcilib_model_description_t *model_info,
             bank_id = pcilib_find_register_bank_by_addr(handle, model_info->registers[regid].bank);
             format = model_info->banks[bank_id].format;
             if (!format) format = "%lu";
-            err = pcilib_read_register_by_id(handle, regid, &value);
-            if (err) Error("Error reading register %s", reg);
 
-	    printf("%s = ", reg);
-	    printf(format, value);
-	    printf("\n");
+	    if (model_info->registers[regid].type == PCILIB_REGISTER_FIFO) {
+		pcilib_register_value_t *values;
+
+		if (!n) n = 1;
+		values = (pcilib_register_value_t*)malloc(n * sizeof(pcilib_register_value_t));
+		if (!values) Error("Error allocating memory for %zu FIFO values", n);
+
+		err = pcilib_read_register_fifo_by_id(handle, regid, n, values);
+		if (err) Error("Error reading FIFO register %s", reg);
+
+		printf("%s =", reg);
+		for (i = 0; i < n; i++) {
+		    printf(" ");
+		    printf(format, values[i]);
+		}
+		printf("\n");
+
+		free(values);
+	    } else {
+		err = pcilib_read_register_by_id(handle, regid, &value);
+		if (err) Error("Error reading register %s", reg);
+
+		printf("%s = ", reg);
+		printf(format, value);
+		printf("\n");
+	    }
 	}
     } else {
 	if (model_info->registers) {
@@ -1475,6 +1843,12 @@ int ReadRegister(pcilib_t *handle, const pcilib_model_description_t *model_info,
 		    format = model_info->banks[bank_id].format;
 		    if (!format) format = "%lu";
 
+			// Reading would pop a value from FIFO
+		    if (model_info->registers[i].type == PCILIB_REGISTER_FIFO) {
+			printf(" %s = fifo\n", model_info->registers[i].name);
+			continue;
+		    }
+
 		    err = pcilib_read_register_by_id(handle, i, &value);
 		    if (err) printf(" %s = error reading value", model_info->registers[i].name);
 	    	    else {
@@ -1530,7 +1904,9 @@ int ReadRegisterRange(pcilib_t *handle, const pcilib_model_description_t *model_
     numbers_per_line = blocks_per_line * numbers_per_block;
 
 
-    pcilib_register_value_t buf[n];
+    pcilib_register_value_t *buf = (pcilib_register_value_t*)malloc(n * sizeof(pcilib_register_value_t));
+    if (!buf) Error("Allocation of %zu bytes of memory have failed", n * sizeof(pcilib_register_value_t));
+
     err = pcilib_read_register_space(handle, bank, addr, n, buf);
     if (err) Error("Error reading register space for bank \"%s\" at address %lx, size %lu", bank?bank:"default", addr, n);
 
@@ -1562,6 +1938,113 @@ int ReadRegisterRange(pcilib_t *handle, const pcilib_model_description_t *model_
     return 0;
 }
 
+int SampleRegisters(pcilib_t *handle, const pcilib_model_description_t *model_info, const char *bank, const char *reglist, size_t num, size_t run_time, size_t sample_time, FILE *o) {
+    int err;
+    size_t i, n;
+    char *names, *name, *saveptr;
+
+    pcilib_register_t *regs;
+    pcilib_register_value_t *values;
+    pcilib_register_snapshot_t *snapshot;
+
+    struct timeval start, deadline, stop, ts, now, last, end;
+    size_t count = 0, late = 0;
+    double dev, interval, duration;
+    double dev_sum = 0, dev_max = 0;
+    double jitter_sum = 0, jitter_max = 0, interval_sum = 0;
+    FILE *out = o?o:stdout;
+
+    names = strdupa(reglist);
+    for (n = 1, name = names; *name; name++)
+	if (*name == ',') n++;
+
+    regs = (pcilib_register_t*)alloca(n * sizeof(pcilib_register_t));
+    values = (pcilib_register_value_t*)alloca(n * sizeof(pcilib_register_value_t));
+
+    for (i = 0, name = strtok_r(names, ",", &saveptr); name; name = strtok_r(NULL, ",", &saveptr), i++) {
+	regs[i] = pcilib_find_register(handle, bank, name);
+	if (regs[i] == PCILIB_REGISTER_INVALID) Error("Register (%s) is not found", name);
+    }
+
+    n = i;
+    if (!n) Error("Registers to sample are not specified");
+
+    snapshot = pcilib_create_register_snapshot(handle, n, regs);
+    if (!snapshot) Error("Failed to prepare the snapshot of the specified registers");
+
+    fprintf(out, "# timestamp");
+    for (i = 0; i < n; i++)
+	fprintf(out, " %s", model_info->registers[regs[i]].name);
+    fprintf(out, "\n");
+
+    pcilib_gettime(&start);
+    deadline = start;
+    if (run_time) {
+	stop = start;
+	pcilib_add_timeout(&stop, run_time);
+    }
+
+    while (!StopFlag) {
+	    // The snapshot timestamp is wall-clock time, the schedule is tracked using monotonic clock
+	pcilib_gettime(&now);
+	err = pcilib_read_register_snapshot(handle, snapshot, &ts, values);
+	if (err) Error("Error reading the snapshot of the specified registers");
+
+	    // Deviation from the schedule
+	if (sample_time) {
+	    dev = (now.tv_sec - deadline.tv_sec) * 1000000. + (now.tv_usec - deadline.tv_usec);
+	    if (dev < 0) dev = -dev;
+	    if (dev > sample_time) late++;
+	    dev_sum += dev;
+	    if (dev > dev_max) dev_max = dev;
+	}
+
+	    // Variation of intervals between the samples
+	if (count) {
+	    interval = pcilib_timediff(&last, &now);
+	    interval_sum += interval;
+	    if (sample_time) {
+		dev = interval - sample_time;
+		if (dev < 0) dev = -dev;
+		jitter_sum += dev;
+		if (dev > jitter_max) jitter_max = dev;
+	    }
+	}
+	last = now;
+
+	fprintf(out, "%lu.%06lu", (unsigned long)ts.tv_sec, (unsigned long)ts.tv_usec);
+	for (i = 0; i < n; i++)
+	    fprintf(out, " 0x%lx", (unsigned long)values[i]);
+	fprintf(out, "\n");
+
+	if ((++count == num)&&(num)) break;
+
+	if (sample_time) {
+	    pcilib_add_timeout(&deadline, sample_time);
+	    if ((run_time)&&(pcilib_timecmp(&deadline, &stop) > 0)) break;
+	    pcilib_sleep_until_deadline(&deadline);
+	} else if ((run_time)&&(pcilib_check_deadline(&stop, 0))) break;
+    }
+
+    pcilib_gettime(&end);
+    pcilib_free_register_snapshot(handle, snapshot);
+
+    if (o) fflush(o);
+
+    duration = pcilib_timediff(&start, &end);
+
+    printf("Samples: %zu, Registers: %zu, Time: %.3lf s, Rate: %.3lf sps", count, n, duration / 1000000., (count > 1)?((count - 1) * 1000000. / interval_sum):0.);
+    if (sample_time) printf(" (requested: %.3lf sps)", 1000000. / sample_time);
+    printf("\n");
+
+    if ((sample_time)&&(count)) {
+	printf("Schedule deviation: mean %.1lf us, max %.1lf us, late samples: %zu\n", dev_sum / count, dev_max, late);
+	if (count > 1) printf("Interval jitter: mean %.1lf us, max %.1lf us\n", jitter_sum / (count - 1), jitter_max);
+    }
+
+    return 0;
+}
+
 int WriteData(pcilib_t *handle, ACCESS_MODE mode, pcilib_dma_engine_addr_t dma, pcilib_bar_t bar, uintptr_t addr, size_t n, access_t access, int endianess, char ** data, int verify) {
     int read_back = 0;
     void *buf, *check;
@@ -1627,14 +2110,13 @@ int WriteData(pcilib_t *handle, ACCESS_MODE mode, pcilib_dma_engine_addr_t dma,
 }
 
 int WriteRegisterRange(pcilib_t *handle, const pcilib_model_description_t *model_info, const char *bank, uintptr_t addr, long addr_shift, size_t n, char ** data) {
-    pcilib_register_value_t *buf, *check;
+    pcilib_register_value_t *buf;
     int res, i, err;
     unsigned long value;
     int size = n * sizeof(pcilib_register_value_t);
 
     err = posix_memalign( (void**)&buf, 256, size );
-    if (!err) err = posix_memalign( (void**)&check, 256, size );
-    if ((err)||(!buf)||(!check)) Error("Allocation of %i bytes of memory have failed", size);
+    if ((err)||(!buf)) Error("Allocation of %i bytes of memory have failed", size);
 
     for (i = 0; i < n; i++) {
 	res = sscanf(data[i], "%lx", &value);
@@ -1642,26 +2124,20 @@ int WriteRegisterRange(pcilib_t *handle, const pcilib_model_description_t *model
 	buf[i] = value;
     }
 
-    err = pcilib_write_register_space(handle, bank, addr, n, buf);
-    if (err) Error("Error writting register space for bank \"%s\" at address %lx, size %lu", bank?bank:"default", addr, n);
-    
-    err = pcilib_read_register_space(handle, bank, addr, n, check);
-    if (err) Error("Error reading register space for bank \"%s\" at address %lx, size %lu", bank?bank:"default", addr, n);
-
-    if (memcmp(buf, check, size)) {
+    err = pcilib_write_register_space_custom(handle, bank, addr, n, PCILIB_REGISTER_SPACE_FLAG_VERIFY, buf);
+    if (err == PCILIB_ERROR_VERIFY) {
 	printf("Write failed: the data written and read differ, the foolowing is read back:\n");
 	ReadRegisterRange(handle, model_info, bank, addr, addr_shift, n, NULL);
 	exit(-1);
-    }
+    } else if (err) Error("Error writting register space for bank \"%s\" at address %lx, size %lu", bank?bank:"default", addr, n);
 
-    free(check);
     free(buf);
     
     return 0;
 
 }
 
-int WriteRegister(pcilib_t *handle, const pcilib_model_description_t *model_info, const char *bank, const char *reg, const char *view, const char *unit, char **data) {
+int WriteRegister(pcilib_t *handle, const pcilib_model_description_t *model_info, const char *bank, const char *reg, const char *view, const char *unit, char **data, size_t n) {
     int err = 0;
 
     pcilib_value_t val = {0};
@@ -1698,6 +2174,32 @@ int WriteRegister(pcilib_t *handle, const pcilib_model_description_t *model_info
         pcilib_register_t regid = pcilib_find_register(handle, bank, reg);
         if (regid == PCILIB_REGISTER_INVALID) Error("Can't find register (%s) from bank (%s)", reg, bank?bank:"autodetected");
 
+	if (model_info->registers[regid].type == PCILIB_REGISTER_FIFO) {
+	    size_t i;
+	    pcilib_register_value_t *values;
+
+	    if (!n) n = 1;
+	    values = (pcilib_register_value_t*)malloc(n * sizeof(pcilib_register_value_t));
+	    if (!values) Error("Error allocating memory for %zu FIFO values", n);
+
+	    for (i = 0; i < n; i++) {
+		if (i) {
+		    err = pcilib_set_value_from_static_string(handle, &val, data[i]);
+		    if (err) Error("Error (%i) setting value", err);
+		}
+
+		values[i] = pcilib_get_value_as_register_value(handle, &val, &err);
+		if (err) Error("Error (%i) parsing data value (%s)", err, data[i]);
+	    }
+
+	    err = pcilib_write_register_fifo_by_id(handle, regid, n, values);
+	    if (err) Error("Error writting FIFO register %s\n", reg);
+
+	    free(values);
+	    printf("%zu values are written to %s\n", n, reg);
+	    return 0;
+	}
+
         value = pcilib_get_value_as_register_value(handle, &val, &err);
         if (err) Error("Error (%i) parsing data value (%s)", *data);
 
@@ -1739,13 +2241,27 @@ typedef struct {
     size_t max_triggers;
     pcilib_event_flags_t flags;
     FORMAT format;
+
+    pcilib_timeout_t stats_interval;		/**< Interval between status reports (us) */
+    STATS_FORMAT stats_format;			/**< Format of status reports */
+    int monitor_fd;				/**< Eventfd waking up the monitor thread when grabbing is stopped */
     
-    volatile int event_pending;			/**< Used to detect that we have read previously triggered event */
-    volatile int trigger_thread_started;	/**< Indicates that trigger thread is ready and we can't procced to start event recording */
-    volatile int started;			/**< Indicates that recording is started */
+    pthread_mutex_t sync_mutex;			/**< Serializes changes of the state flags below */
+    pthread_cond_t sync_cond;			/**< Signaled when any of the state flags is changed */
+
+	// The flags are changed with GrabSetState and read with atomic loads, see GrabGetState/GrabWaitState
+    int event_pending;				/**< Used to detect that we have read previously triggered event */
+    int trigger_thread_started;			/**< Indicates that trigger thread is ready and we can't procced to start event recording */
+    int started;				/**< Indicates that recording is started */
     
-    volatile int run_flag;
-    volatile int writing_flag;
+    int run_flag;
+    int writing_flag;
+
+    int handshake;				/**< Next event is triggered once the previous is read, trigger-to-event latency is measured */
+    pcilib_time_t trigger_timestamp;		/**< Time of the last trigger in handshake mode (monotonic, ns) */
+    size_t latency_count;			/**< Number of events with measured trigger-to-event latency */
+    pcilib_time_t latency_sum;			/**< Sum of trigger-to-event latencies (ns) */
+    pcilib_time_t latency_max;			/**< Maximal trigger-to-event latency (ns) */
 
     struct timeval first_frame;
     struct timeval last_frame;
@@ -1753,6 +2269,7 @@ typedef struct {
 
     size_t trigger_failed;
     size_t trigger_count;
+    pcilib_autotrigger_stats_t trigger_stats;	/**< Statistics of the software trigger generator */
     size_t event_count;				/**< Total number of events (including bad ones, but excluding events expected, but not reported by hardware) */
     size_t incomplete_count;			/**< Broken events, we even can't extract appropriate block of raw data */
     size_t broken_count;			/**< Broken events, error while decoding in the requested format */
@@ -1765,6 +2282,31 @@ typedef struct {
     struct timeval stop_time;
 } GRABContext;
 
+static inline int GrabGetState(int *flag) {
+    return __atomic_load_n(flag, __ATOMIC_ACQUIRE);
+}
+
+static void GrabSetState(GRABContext *ctx, int *flag, int value) {
+    pthread_mutex_lock(&ctx->sync_mutex);
+    __atomic_store_n(flag, value, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&ctx->sync_cond);
+    pthread_mutex_unlock(&ctx->sync_mutex);
+}
+
+static void GrabWakeMonitor(GRABContext *ctx) {
+    uint64_t val = 1;
+
+    if (write(ctx->monitor_fd, &val, sizeof(val)) != sizeof(val))
+	Error("Error (%i) waking up the monitoring thread", errno);
+}
+
+static void GrabWaitState(GRABContext *ctx, int *flag, int value) {
+    pthread_mutex_lock(&ctx->sync_mutex);
+    while (__atomic_load_n(flag, __ATOMIC_ACQUIRE) != value)
+	pthread_cond_wait(&ctx->sync_cond, &ctx->sync_mutex);
+    pthread_mutex_unlock(&ctx->sync_mutex);
+}
+
 int GrabCallback(pcilib_event_id_t event_id, const pcilib_event_info_t *info, void *user) {
     int err = 0;
     void *data;
@@ -1773,13 +2315,20 @@ int GrabCallback(pcilib_event_id_t event_id, const pcilib_event_info_t *info, vo
     GRABContext *ctx = (GRABContext*)user;
     pcilib_t *handle = ctx->handle;
 
-    gettimeofday(&ctx->last_frame, NULL);
+    pcilib_gettime(&ctx->last_frame);
 
     if (!ctx->event_count) {
 	memcpy(&ctx->first_frame, &ctx->last_frame, sizeof(struct timeval));
     }
 
-    ctx->event_pending = 0;
+    if (ctx->handshake) {
+	pcilib_time_t latency = pcilib_time_ns() - __atomic_load_n(&ctx->trigger_timestamp, __ATOMIC_ACQUIRE);
+	ctx->latency_sum += latency;
+	if (latency > ctx->latency_max) ctx->latency_max = latency;
+	ctx->latency_count++;
+    }
+
+    GrabSetState(ctx, &ctx->event_pending, 0);
     ctx->event_count++;
 
     if (ctx->last_num) {
@@ -1864,7 +2413,7 @@ int raw_data(pcilib_event_id_t event_id, const pcilib_event_info_t *info, pcilib
 
 
     if ((info)&&(info->seqnum != ctx->last_num)) {
-        gettimeofday(&ctx->last_frame, NULL);
+        pcilib_gettime(&ctx->last_frame);
 	if (!ctx->event_count) {
 	    memcpy(&ctx->first_frame, &ctx->last_frame, sizeof(struct timeval));
 	}
@@ -1892,36 +2441,58 @@ int raw_data(pcilib_event_id_t event_id, const pcilib_event_info_t *info, pcilib
 }
 
 
+int TriggerCallback(void *user) {
+    int err;
+    GRABContext *ctx = (GRABContext*)user;
+
+    err = pcilib_trigger(ctx->handle, ctx->event, 0, NULL);
+    if (err) __atomic_fetch_add(&ctx->trigger_failed, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&ctx->trigger_count, 1, __ATOMIC_RELAXED);
+
+    return err;
+}
+
 void *Trigger(void *user) {
     int err;
-    struct timeval start;
+    pcilib_autotrigger_t *at;
 
     GRABContext *ctx = (GRABContext*)user;
     size_t trigger_time = ctx->trigger_time;
     size_t max_triggers = ctx->max_triggers;
     
-    ctx->trigger_thread_started = 1;
-    ctx->event_pending = 1;
+    __atomic_store_n(&ctx->event_pending, 1, __ATOMIC_RELEASE);
+    GrabSetState(ctx, &ctx->trigger_thread_started, 1);
 
-    while (!ctx->started) ;
+    GrabWaitState(ctx, &ctx->started, 1);
 
-    gettimeofday(&start, NULL);
-    do {
-        err = pcilib_trigger(ctx->handle, ctx->event, 0, NULL);
-        if (err) ctx->trigger_failed++;
-	if ((++ctx->trigger_count == max_triggers)&&(max_triggers)) break;
-	
-	if (trigger_time) {
-	    pcilib_add_timeout(&start, trigger_time);
-	    if ((ctx->stop_time.tv_sec)&&(pcilib_timecmp(&start, &ctx->stop_time)>0)) break;
-	    pcilib_sleep_until_deadline(&start);
-	}  else {
-	    while ((ctx->event_pending)&&(ctx->run_flag)) usleep(10);
-	    ctx->event_pending = 1;
+    if (trigger_time) {
+	at = pcilib_autotrigger_start(ctx->handle, trigger_time, max_triggers, ctx->run_time, TriggerCallback, ctx);
+	if (at) {
+		// Without grabbing (no writer), we trigger until the limits are reached
+	    while (((GrabGetState(&ctx->run_flag))||(!ctx->writer))&&(!StopFlag)) {
+		if (!pcilib_autotrigger_wait(at, TRIGGER_CHECK_INTERVAL)) break;
+	    }
+	    pcilib_autotrigger_stop(at, &ctx->trigger_stats);
+	} else {
+	    ctx->trigger_failed++;
 	}
-    } while (ctx->run_flag);
+    } else {
+	do {
+	    __atomic_store_n(&ctx->trigger_timestamp, pcilib_time_ns(), __ATOMIC_RELEASE);
+	    err = pcilib_trigger(ctx->handle, ctx->event, 0, NULL);
+	    if (err) __atomic_fetch_add(&ctx->trigger_failed, 1, __ATOMIC_RELAXED);
+	    if ((__atomic_add_fetch(&ctx->trigger_count, 1, __ATOMIC_RELAXED) == max_triggers)&&(max_triggers)) break;
+
+		// Blocking until the grabbing thread have read the event or the grabbing is stopped
+	    pthread_mutex_lock(&ctx->sync_mutex);
+	    while ((ctx->event_pending)&&(ctx->run_flag))
+		pthread_cond_wait(&ctx->sync_cond, &ctx->sync_mutex);
+	    __atomic_store_n(&ctx->event_pending, 1, __ATOMIC_RELEASE);
+	    pthread_mutex_unlock(&ctx->sync_mutex);
+	} while (GrabGetState(&ctx->run_flag));
+    }
 
-    ctx->trigger_thread_started = 0;
+    GrabSetState(ctx, &ctx->trigger_thread_started, 0);
 
     return NULL;
 }
@@ -1940,7 +2511,7 @@ void GrabStats(GRABContext *ctx, struct timeval *end_time) {
 	    printf("-------------------------------------------------------------------------------\n");
 	}
     } else {
-	gettimeofday(&cur, NULL);
+	pcilib_gettime(&cur);
 	end_time = &cur;
     }
 
@@ -2053,7 +2624,7 @@ void StorageStats(GRABContext *ctx) {
     pcilib_timeout_t duration;
     struct timeval cur;
 
-    gettimeofday(&cur, NULL);
+    pcilib_gettime(&cur);
     duration = pcilib_timediff(&ctx->start_time, &cur);
 
     
@@ -2072,34 +2643,110 @@ void StorageStats(GRABContext *ctx) {
     printf(" buffer (%6.2lf%% max)\n", 100.*st.buffer_max / st.buffer_size);
 }
 
+typedef struct {
+    struct timeval time;			/**< Time of the snapshot (monotonic) */
+    size_t events;				/**< Number of captured events */
+    size_t dropped;				/**< Events dropped due to slow processing or storage */
+    size_t lost;				/**< Events not received from the hardware */
+    size_t written;				/**< Bytes written to the storage */
+} GRABSnapshot;
+
+static void GrabTakeSnapshot(GRABContext *ctx, GRABSnapshot *snapshot) {
+    fastwriter_stats_t st;
+
+    memset(snapshot, 0, sizeof(GRABSnapshot));
+    pcilib_gettime(&snapshot->time);
+    snapshot->events = ctx->event_count;
+    snapshot->dropped = ctx->dropped_count + ctx->storage_count;
+    snapshot->lost = ctx->missing_count;
+    if ((ctx->writer)&&(!fastwriter_get_stats(ctx->writer, &st)))
+	snapshot->written = st.written;
+}
+
+    /**
+     * Reports the cumulative statistics and the rates achieved since the previous report
+     */
+static void GrabReport(GRABContext *ctx, GRABSnapshot *prev, int grabbing) {
+    GRABSnapshot cur;
+    pcilib_timeout_t run, interval;
+
+    GrabTakeSnapshot(ctx, &cur);
+    run = pcilib_timediff(&ctx->start_time, &cur.time);
+    interval = pcilib_timediff(&prev->time, &cur.time);
+    if (!run) run = 1;
+    if (!interval) interval = 1;
+
+    if (ctx->stats_format == STATS_FORMAT_KV) {
+	printf("stats time=%.3lf events=%zu fps=%.1lf interval_fps=%.1lf dropped=%zu interval_dropped=%zu lost=%zu interval_lost=%zu written=%zu mibps=%.2lf interval_mibps=%.2lf\n",
+	    run / 1000000., cur.events, 1000000. * cur.events / run, 1000000. * (cur.events - prev->events) / interval,
+	    cur.dropped, cur.dropped - prev->dropped, cur.lost, cur.lost - prev->lost,
+	    cur.written, 1000000. * cur.written / run / 1024 / 1024, 1000000. * (cur.written - prev->written) / interval / 1024 / 1024);
+    } else {
+	if (grabbing) GrabStats(ctx, NULL);
+	if (ctx->writer) StorageStats(ctx);
+
+	printf("Last ");
+	PrintTime(interval);
+	printf(": FPS %5.0lf, Dropped: ", 1000000. * (cur.events - prev->events) / interval);
+	PrintNumber(cur.dropped - prev->dropped);
+	printf(", Lost: ");
+	PrintNumber(cur.lost - prev->lost);
+	printf(", Written: ");
+	PrintSize(1000000. * (cur.written - prev->written) / interval);
+	printf("/s\n");
+    }
+
+    fflush(stdout);
+    *prev = cur;
+}
+
 void *Monitor(void *user) {
+    int err, wait;
+    int timer_fd;
+    uint64_t val;
     struct timeval deadline;
-    struct timeval nextinfo;
+    struct pollfd fds[2];
+    struct itimerspec timer;
+    GRABSnapshot snapshot;
     
     GRABContext *ctx = (GRABContext*)user;
     int verbose = ctx->verbose;
+    int kv = (ctx->stats_format == STATS_FORMAT_KV);
     pcilib_timeout_t timeout = ctx->timeout;
     
     
     if (timeout == PCILIB_TIMEOUT_INFINITE) timeout = 0;
 
-//    while (!ctx->started);
-    
+    GrabTakeSnapshot(ctx, &snapshot);
+
+	// Periodic status reports are driven by timer, the monitor is woken up through eventfd once grabbing is stopped
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd < 0) Error("Error (%i) creating the status timer", errno);
+
+    memset(&timer, 0, sizeof(timer));
+    timer.it_interval.tv_sec = ctx->stats_interval / 1000000;
+    timer.it_interval.tv_nsec = 1000 * (ctx->stats_interval % 1000000);
+    timer.it_value = timer.it_interval;
+    if (timerfd_settime(timer_fd, 0, &timer, NULL))
+	Error("Error (%i) programming the status timer", errno);
+
+    fds[0].fd = timer_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = ctx->monitor_fd;
+    fds[1].events = POLLIN;
+
     if (timeout) {
 	memcpy(&deadline, (struct timeval*)&ctx->last_frame, sizeof(struct timeval));
 	pcilib_add_timeout(&deadline, timeout);
     }
     
-    if (verbose > 0) {
-	pcilib_calc_deadline(&nextinfo, STATUS_MESSAGE_INTERVAL*1000000);
-    }
-    
-    while (ctx->run_flag) {
+    while (GrabGetState(&ctx->run_flag)) {
 	if (StopFlag) {
 	    pcilib_stop(ctx->handle, PCILIB_EVENT_FLAG_STOP_ONLY);
 	    break;
 	}
 	
+	wait = -1;
 	if (timeout) {
 	    if (pcilib_calc_time_to_deadline(&deadline) == 0) {
 		memcpy(&deadline, (struct timeval*)&ctx->last_frame, sizeof(struct timeval));
@@ -2110,33 +2757,55 @@ void *Monitor(void *user) {
 		    break;
 		}
 	    }
+
+	    wait = pcilib_calc_time_to_deadline(&deadline) / 1000 + 1;
 	}
-	
-	if (verbose > 0) {
-	    if (pcilib_calc_time_to_deadline(&nextinfo) == 0) {
-		GrabStats(ctx, NULL);
-		StorageStats(ctx);
-		pcilib_calc_deadline(&nextinfo, STATUS_MESSAGE_INTERVAL*1000000);
-	    }
+
+	fds[0].revents = 0;
+	fds[1].revents = 0;
+
+	err = poll(fds, 2, wait);
+	if (err < 0) {
+	    if (errno == EINTR) continue;
+	    Error("Error (%i) waiting for the status timer", errno);
+	}
+
+	if (fds[1].revents) {
+	    if (read(ctx->monitor_fd, &val, sizeof(val)) != sizeof(val)) continue;
+	}
+
+	if (fds[0].revents) {
+	    if (read(timer_fd, &val, sizeof(val)) != sizeof(val)) continue;
+	    if ((verbose > 0)||(kv)) GrabReport(ctx, &snapshot, 1);
 	}
-	
-	usleep(100000);
     }
     
-    pcilib_calc_deadline(&nextinfo, STATUS_MESSAGE_INTERVAL*1000000);
-    while (ctx->writing_flag) {
-        if (pcilib_calc_time_to_deadline(&nextinfo) == 0) {
-	    if (verbose >= 0) StorageStats(ctx);
-	    pcilib_calc_deadline(&nextinfo, STATUS_MESSAGE_INTERVAL*1000000);
+    while (GrabGetState(&ctx->writing_flag)) {
+	fds[0].revents = 0;
+	fds[1].revents = 0;
+
+	err = poll(fds, 2, -1);
+	if (err < 0) {
+	    if (errno == EINTR) continue;
+	    Error("Error (%i) waiting for the status timer", errno);
+	}
+
+	if (fds[1].revents) {
+	    if (read(ctx->monitor_fd, &val, sizeof(val)) != sizeof(val)) continue;
+	}
+
+	if (fds[0].revents) {
+	    if (read(timer_fd, &val, sizeof(val)) != sizeof(val)) continue;
+	    if ((verbose >= 0)||(kv)) GrabReport(ctx, &snapshot, 0);
 	}
-    
-	usleep(100000);
     }
+
+    close(timer_fd);
     
     return NULL;
 }
 
-int TriggerAndGrab(pcilib_t *handle, GRAB_MODE grab_mode, const char *evname, const char *data_type, size_t num, size_t run_time, size_t trigger_time, pcilib_timeout_t timeout, PARTITION partition, FORMAT format, size_t buffer_size, size_t threads, int verbose, const char *output) {
+int TriggerAndGrab(pcilib_t *handle, GRAB_MODE grab_mode, const char *evname, const char *data_type, size_t num, size_t run_time, size_t trigger_time, pcilib_timeout_t timeout, PARTITION partition, FORMAT format, size_t buffer_size, size_t threads, pcilib_timeout_t stats_interval, STATS_FORMAT stats_format, int verbose, const char *output) {
     int err;
     GRABContext ctx;
 //    void *data = NULL;
@@ -2152,6 +2821,7 @@ int TriggerAndGrab(pcilib_t *handle, GRAB_MODE grab_mode, const char *evname, co
     struct sched_param sched;
 
     struct timeval end_time;
+    struct rusage ru_start, ru_end;
     pcilib_event_flags_t flags;
 
     if (evname) {
@@ -2180,6 +2850,8 @@ int TriggerAndGrab(pcilib_t *handle, GRAB_MODE grab_mode, const char *evname, co
     }
 
     memset(&ctx, 0, sizeof(GRABContext));
+    pthread_mutex_init(&ctx.sync_mutex, NULL);
+    pthread_cond_init(&ctx.sync_cond, NULL);
 
     ctx.handle = handle;
     ctx.event = event;
@@ -2187,6 +2859,12 @@ int TriggerAndGrab(pcilib_t *handle, GRAB_MODE grab_mode, const char *evname, co
     ctx.run_time = run_time;
     ctx.timeout = timeout;
     ctx.format = format;
+    ctx.stats_interval = stats_interval;
+    ctx.stats_format = stats_format;
+
+    ctx.monitor_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+    if (ctx.monitor_fd < 0) Error("Error (%i) creating eventfd for the monitoring thread", errno);
+    StopFd = ctx.monitor_fd;
 
     if (grab_mode&GRAB_MODE_GRAB) ctx.verbose = verbose;
     else ctx.verbose = 0;
@@ -2239,6 +2917,7 @@ int TriggerAndGrab(pcilib_t *handle, GRAB_MODE grab_mode, const char *evname, co
 	} else {
 		// Otherwise, we will trigger next event after previous one is read
 	    if (((grab_mode&GRAB_MODE_GRAB) == 0)||(flags&PCILIB_EVENT_FLAG_RAW_DATA_ONLY)) trigger_time = PCILIB_TRIGGER_TIMEOUT;
+	    else ctx.handshake = 1;
 	}
 	
 	ctx.max_triggers = num;
@@ -2256,17 +2935,18 @@ int TriggerAndGrab(pcilib_t *handle, GRAB_MODE grab_mode, const char *evname, co
 	if (pthread_create(&trigger_thread, &attr, Trigger, (void*)&ctx))
 	    Error("Error spawning trigger thread");
 
-	while (!ctx.trigger_thread_started) usleep(10);
+	GrabWaitState(&ctx, &ctx.trigger_thread_started, 1);
     }
 
-    gettimeofday(&ctx.start_time, NULL);
+    getrusage(RUSAGE_SELF, &ru_start);
+    pcilib_gettime(&ctx.start_time);
 
     if (grab_mode&GRAB_MODE_GRAB) {
 	err = pcilib_start(handle, listen_events, flags);
 	if (err) Error("Failed to start event engine, error %i", err);
     }
     
-    ctx.started = 1;
+    GrabSetState(&ctx, &ctx.started, 1);
     
     if (run_time) {
 	ctx.stop_time.tv_usec = ctx.start_time.tv_usec + run_time%1000000;
@@ -2289,20 +2969,36 @@ int TriggerAndGrab(pcilib_t *handle, GRAB_MODE grab_mode, const char *evname, co
 	if (err) Error("Error streaming events, error %i", err);
     }
     
-    ctx.run_flag = 0;
+    GrabSetState(&ctx, &ctx.run_flag, 0);
+    GrabWakeMonitor(&ctx);
 
     if (grab_mode&GRAB_MODE_TRIGGER) {
-	while (ctx.trigger_thread_started) usleep(10);
+	GrabWaitState(&ctx, &ctx.trigger_thread_started, 0);
     }
     
     if (grab_mode&GRAB_MODE_GRAB) {
         pcilib_stop(handle, PCILIB_EVENT_FLAGS_DEFAULT);
     }
 
-    gettimeofday(&end_time, NULL);
+    pcilib_gettime(&end_time);
+    getrusage(RUSAGE_SELF, &ru_end);
 
     if (grab_mode&GRAB_MODE_TRIGGER) {
 	pthread_join(trigger_thread, NULL);
+
+	if ((ctx.trigger_time)&&(verbose >= 0)) {
+	    pcilib_autotrigger_stats_t *ts = &ctx.trigger_stats;
+	    printf("Triggers: %zu (%zu failed), Rate: %.1lf Hz (requested: %.1lf Hz), Missed deadlines: %zu, Latency: mean %.1lf us, max %.1lf us\n", ts->triggers, ctx.trigger_failed, ts->rate, 1000000. / ctx.trigger_time, ts->missed, ts->mean_latency, ts->max_latency);
+	}
+
+	if ((ctx.latency_count)&&(verbose >= 0))
+	    printf("Trigger-to-event latency: mean %.1lf us, max %.1lf us (%zu events)\n", ctx.latency_sum / 1000. / ctx.latency_count, ctx.latency_max / 1000., ctx.latency_count);
+    }
+
+    if (verbose >= 0) {
+	pcilib_timeout_t run = pcilib_timediff(&ctx.start_time, &end_time);
+	pcilib_timeout_t cpu = pcilib_timediff(&ru_start.ru_utime, &ru_end.ru_utime) + pcilib_timediff(&ru_start.ru_stime, &ru_end.ru_stime);
+	if (run) printf("CPU usage: %.3lf s user, %.3lf s system, %.1lf%% of run time\n", pcilib_timediff(&ru_start.ru_utime, &ru_end.ru_utime) / 1000000., pcilib_timediff(&ru_start.ru_stime, &ru_end.ru_stime) / 1000000., 100. * cpu / run);
     }
     
 
@@ -2314,10 +3010,14 @@ int TriggerAndGrab(pcilib_t *handle, GRAB_MODE grab_mode, const char *evname, co
 	if (err) Error("Storage problems, error %i", err);
     }
 
-    ctx.writing_flag = 0;
+    GrabSetState(&ctx, &ctx.writing_flag, 0);
+    GrabWakeMonitor(&ctx);
 
     pthread_join(monitor_thread, NULL);
 
+    StopFd = -1;
+    close(ctx.monitor_fd);
+
     if ((grab_mode&GRAB_MODE_GRAB)&&(verbose>=0)) {
 	GrabStats(&ctx, &end_time);
 	StorageStats(&ctx);
@@ -2325,6 +3025,9 @@ int TriggerAndGrab(pcilib_t *handle, GRAB_MODE grab_mode, const char *evname, co
 
     fastwriter_destroy(ctx.writer);
 
+    pthread_cond_destroy(&ctx.sync_cond);
+    pthread_mutex_destroy(&ctx.sync_mutex);
+
     return 0;
 }
 
@@ -3011,21 +3714,95 @@ int DisableIRQ(pcilib_t *handle, const pcilib_model_description_t *model_info, p
     return err;
 }
 
+typedef struct {
+    int negate;					/**< Wait until the masked bits differ from the value */
+    pcilib_register_value_t mask;		/**< Checked bits */
+    pcilib_register_value_t value;		/**< Expected (or initial if negated) value of the checked bits */
+} WAIT_CONDITION;
+
+static int CheckWaitCondition(void *arg, pcilib_register_value_t value) {
+    WAIT_CONDITION *cond = (WAIT_CONDITION*)arg;
+    int res = ((value & cond->mask) == cond->value);
+    return cond->negate?!res:res;
+}
+
+int WaitRegister(pcilib_t *handle, const pcilib_model_description_t *model_info, const char *bank, const char *spec, pcilib_timeout_t timeout, int verbose) {
+    int err;
+    char *name, *value, *mask;
+    pcilib_register_t reg;
+    pcilib_register_value_t regval;
+    pcilib_register_wait_stats_t stats;
+    WAIT_CONDITION cond = { 0, (pcilib_register_value_t)-1, 0 };
+
+    name = strdupa(spec);
+
+    mask = strchr(name, '/');
+    if (mask) {
+	*(mask++) = 0;
+	if (isnumber(mask)) cond.mask = strtoul(mask, NULL, 10);
+	else if (isxnumber(mask)) cond.mask = strtoul(mask, NULL, 16);
+	else Error("Invalid mask (%s) is specified", mask);
+    }
+
+    value = strchr(name, '=');
+    if (value) {
+	if ((value > name)&&(value[-1] == '!')) {
+	    cond.negate = 1;
+	    value[-1] = 0;
+	}
+	*(value++) = 0;
+	if (isnumber(value)) cond.value = strtoul(value, NULL, 10);
+	else if (isxnumber(value)) cond.value = strtoul(value, NULL, 16);
+	else Error("Invalid value (%s) is specified", value);
+    }
+
+    reg = pcilib_find_register(handle, bank, name);
+    if (reg == PCILIB_REGISTER_INVALID) Error("Register (%s) is not found", name);
+
+	// Without value, we are waiting for any change of the masked bits
+    if (!value) {
+	cond.negate = 1;
+	err = pcilib_read_register_by_id(handle, reg, &cond.value);
+	if (err) Error("Error reading register %s", name);
+    }
+    cond.value &= cond.mask;
+
+    err = pcilib_wait_register_custom(handle, reg, CheckWaitCondition, &cond, NULL, timeout, &regval, &stats);
+
+    if (verbose > 0)
+	printf("Polls: %zu, sleeps: %zu, IRQs: %zu, wait time: %lu us\n", stats.polls, stats.sleeps, stats.irqs, (unsigned long)stats.wait_time);
+
+    if (err) {
+	if (err == PCILIB_ERROR_TIMEOUT) Error("Timeout waiting for register %s, the last value is 0x%lx", name, regval);
+	else Error("Error (%i) waiting for register %s", err, name);
+    }
+
+    printf("%s = 0x%lx\n", name, regval);
+
+    return 0;
+}
+
 int AckIRQ(pcilib_t *handle, const pcilib_model_description_t *model_info, pcilib_irq_hw_source_t irq_source) {
     pcilib_clear_irq(handle, irq_source);
     return 0;
 }
 
-int WaitIRQ(pcilib_t *handle, const pcilib_model_description_t *model_info, pcilib_irq_hw_source_t irq_source, pcilib_timeout_t timeout) {
+int WaitIRQ(pcilib_t *handle, const pcilib_model_description_t *model_info, pcilib_irq_hw_source_t irq_source, pcilib_timeout_t timeout, int verbose) {
     int err;
     size_t count;
+    uint64_t timestamp;
+    pcilib_time_t now;
 
-    err = pcilib_wait_irq(handle, irq_source, timeout, &count);
+    err = pcilib_wait_irq_timestamp(handle, irq_source, timeout, &count, &timestamp);
+    now = pcilib_time_ns();
     if (err) {
 	if (err == PCILIB_ERROR_TIMEOUT) Error("Timeout waiting for IRQ");
 	else Error("Error waiting for IRQ");
     }
 
+    if (verbose > 0)
+	printf("IRQs: %zu, latency of the last IRQ: %.1lf us\n", count, (now > timestamp)?((now - timestamp) / 1000.):0.);
+
     return 0;
 }
 
@@ -3054,10 +3831,13 @@ int main(int argc, char **argv) {
     MODE mode = MODE_INVALID;
     GRAB_MODE grab_mode = 0;
     size_t trigger_time = 0;
+    size_t sample_time = 0;
     size_t run_time = 0;
     size_t buffer = 0;
     size_t threads = 1;
     FORMAT format = FORMAT_DEFAULT;
+    STATS_FORMAT stats_format = STATS_FORMAT_TEXT;
+    pcilib_timeout_t stats_interval = STATUS_MESSAGE_INTERVAL * 1000000;
     PARTITION partition = PARTITION_UNKNOWN;
     FLAGS flags = 0;
     const char *atype = NULL;
@@ -3065,6 +3845,8 @@ int main(int argc, char **argv) {
     ACCESS_MODE amode = ACCESS_BAR;
     const char *fpga_device = DEFAULT_FPGA_DEVICE;
     pcilib_bar_t bar = PCILIB_BAR_DETECT;
+    pcilib_bar_cache_t bar_cache = PCILIB_BAR_CACHE_DEFAULT;
+    int bar_cache_set = 0;
     const char *addr = NULL;
     const char *reg = NULL;
     const char *view = NULL;
@@ -3079,6 +3861,8 @@ int main(int argc, char **argv) {
     const char *lock = NULL;
     const char *info_target = NULL;
     const char *list_target = NULL;
+    const char *aggregate = NULL;
+    int drop = 0;
     size_t block = (size_t)-1;
     pcilib_irq_type_t irq_type = PCILIB_IRQ_TYPE_ALL;
     pcilib_irq_hw_source_t irq_source =  PCILIB_IRQ_SOURCE_DEFAULT;
@@ -3380,6 +4164,16 @@ int main(int argc, char **argv) {
 		mode = MODE_UNLOCK;
 		lock = optarg;
 	    break;
+	    case OPT_SAMPLE:
+		if (mode != MODE_INVALID) Usage(argc, argv, "Multiple operations are not supported");
+		mode = MODE_SAMPLE;
+		reg = optarg;
+	    break;
+	    case OPT_WAIT_REGISTER:
+		if (mode != MODE_INVALID) Usage(argc, argv, "Multiple operations are not supported");
+		mode = MODE_WAIT_REGISTER;
+		reg = optarg;
+	    break;
 	    case OPT_DEVICE:
 		fpga_device = optarg;
 	    break;
@@ -3507,6 +4301,16 @@ int main(int argc, char **argv) {
 		    
 		    trigger_time = (1000000 / ztmp) + ((1000000 % ztmp)?1:0);
 	    break;
+	    case OPT_SAMPLE_TIME:
+		if ((!isnumber(optarg))||(sscanf(optarg, "%zu", &sample_time) != 1))
+		    Usage(argc, argv, "Invalid sample-time is specified (%s)", optarg);
+	    break;
+	    case OPT_SAMPLE_RATE:
+		if ((!isnumber(optarg))||(sscanf(optarg, "%zu", &ztmp) != 1)||(!ztmp))
+		    Usage(argc, argv, "Invalid sample-rate is specified (%s)", optarg);
+
+		sample_time = 1000000 / ztmp;
+	    break;
 	    case OPT_BUFFER:
 		if (optarg) num_offset = optarg;
 		else if ((optind < argc)&&(argv[optind][0] != '-')) num_offset = argv[optind++];
@@ -3541,6 +4345,22 @@ int main(int argc, char **argv) {
 //		else if (!strcasecmp(optarg, "ringfs")) format =  FORMAT_RINGFS;
 		else if (strcasecmp(optarg, "default")) Error("Invalid format (%s) is specified", optarg);
 	    break; 
+	    case OPT_STATS_INTERVAL:
+		if ((!isnumber(optarg))||(sscanf(optarg, "%zu", &ztmp) != 1)||(!ztmp))
+		    Usage(argc, argv, "Invalid stats-interval is specified (%s)", optarg);
+		stats_interval = ztmp;
+	    break;
+	    case OPT_STATS_FORMAT:
+		if (!strcasecmp(optarg, "kv")) stats_format = STATS_FORMAT_KV;
+		else if (strcasecmp(optarg, "text")) Usage(argc, argv, "Invalid stats format (%s) is specified", optarg);
+	    break;
+	    case OPT_BAR_CACHE:
+		if (!strcasecmp(optarg, "uc")) bar_cache = PCILIB_BAR_CACHE_UC;
+		else if (!strcasecmp(optarg, "wc")) bar_cache = PCILIB_BAR_CACHE_WC;
+		else if (!strcasecmp(optarg, "wb")) bar_cache = PCILIB_BAR_CACHE_WB;
+		else if (strcasecmp(optarg, "default")) Usage(argc, argv, "Invalid bar caching mode (%s) is specified", optarg);
+		bar_cache_set = 1;
+	    break;
 	    case OPT_QUIETE:
 		quiete = 1;
 		verbose = -1;
@@ -3569,6 +4389,12 @@ int main(int argc, char **argv) {
 	    case OPT_WAIT:
 		flags |= FLAG_WAIT;
 	    break;
+	    case OPT_AGGREGATE:
+		aggregate = optarg;
+	    break;
+	    case OPT_DROP:
+		drop = 1;
+	    break;
 	    default:
 		Usage(argc, argv, "Unknown option (%s) with argument (%s)", optarg?argv[optind-2]:argv[optind-1], optarg?optarg:"(null)");
 	}
@@ -3775,6 +4601,20 @@ int main(int argc, char **argv) {
 	    if (run_time) size = 0;
 	}
     }
+
+    if (mode == MODE_SAMPLE) {
+	if (!size_set) size = 0;
+    }
+
+    if (aggregate) {
+	if ((mode != MODE_READ)||(amode != ACCESS_DMA))
+	    Usage(argc, argv, "The aggregation is only supported for DMA reads");
+
+	if (!timeout_set) {
+	    if (run_time) timeout = PCILIB_TIMEOUT_INFINITE;
+	    else timeout = PCILIB_EVENT_TIMEOUT;
+	}
+    } else if (drop) Usage(argc, argv, "Dropping data is only supported with --aggregate");
     
     if (mode != MODE_GRAB) {
 	if (size == (size_t)-1)
@@ -3801,6 +4641,14 @@ int main(int argc, char **argv) {
 	}
     }
 
+    if (bar_cache_set) {
+	if ((amode != ACCESS_BAR)||(bar == PCILIB_BAR_DETECT))
+	    Usage(argc, argv, "The bar caching mode can be only specified for PCI bar access with -b");
+
+	err = pcilib_set_bar_cache(handle, bar, bar_cache);
+	if (err) Error("Failed to set caching mode of PCI bar %i", bar);
+    }
+
     signal(SIGINT, signal_exit_handler);
 
     if ((mode != MODE_GRAB)&&(output)) {
@@ -3817,6 +4665,7 @@ int main(int argc, char **argv) {
         if (amode != ACCESS_DMA)
 	    break;
      case MODE_BENCHMARK:
+     case MODE_SAMPLE:
         sched_param.sched_priority = sched_get_priority_max(SCHED_FIFO);
         err = sched_setscheduler(0, SCHED_FIFO, &sched_param);
         if (err) pcilib_info("Failed to acquire real-time priority (errno: %i)", errno);
@@ -3847,7 +4696,9 @@ int main(int argc, char **argv) {
         Benchmark(handle, amode, dma, bar, start, size_set?size:0, access, iterations);
      break;
      case MODE_READ:
-	if (amode == ACCESS_DMA) {
+	if ((amode == ACCESS_DMA)&&(aggregate)) {
+	    err = AggregateDMA(handle, fpga_device, model, dma, aggregate, size_set?size*abs(access):0, run_time, timeout, format, buffer, block_size, drop, stats_interval, stats_format, verbose, ofile);
+	} else if (amode == ACCESS_DMA) {
 	    err = ReadData(handle, amode, flags, dma, bar, start, size_set?size:0, access, endianess, timeout_set?timeout:(size_t)-1, ofile);
 	} else if (amode == ACCESS_CONFIG) {
 	    err = ReadData(handle, amode, flags, dma, bar, addr?start:0, (addr||size_set)?size:(256/abs(access)), access, endianess, (size_t)-1, ofile);
@@ -3860,7 +4711,7 @@ int main(int argc, char **argv) {
      case MODE_READ_REGISTER:
      case MODE_READ_PROPERTY:
      case MODE_READ_ATTR:
-        if ((reg)||(view)||(attr)||(!addr)) ReadRegister(handle, model_info, bank, reg, view, unit, attr);
+        if ((reg)||(view)||(attr)||(!addr)) ReadRegister(handle, model_info, bank, reg, view, unit, attr, size_set?size:0);
 	else ReadRegisterRange(handle, model_info, bank, start, addr_shift, size, ofile);
      break;
      case MODE_WRITE:
@@ -3868,14 +4719,14 @@ int main(int argc, char **argv) {
      break;
      case MODE_WRITE_REGISTER:
      case MODE_WRITE_PROPERTY:
-        if (reg||view) WriteRegister(handle, model_info, bank, reg, view, unit, data);
+        if (reg||view) WriteRegister(handle, model_info, bank, reg, view, unit, data, size);
 	else WriteRegisterRange(handle, model_info, bank, start, addr_shift, size, data);
      break;
      case MODE_RESET:
         pcilib_reset(handle);
      break;
      case MODE_GRAB:
-        TriggerAndGrab(handle, grab_mode, event, data_type, size, run_time, trigger_time, timeout, partition, format, buffer, threads, verbose, output);
+        TriggerAndGrab(handle, grab_mode, event, data_type, size, run_time, trigger_time, timeout, partition, format, buffer, threads, stats_interval, stats_format, verbose, output);
      break;
      case MODE_LIST_DMA:
         ListDMA(handle, fpga_device, model_info);
@@ -3902,7 +4753,7 @@ int main(int argc, char **argv) {
         AckIRQ(handle, model_info, irq_source);
      break;
      case MODE_WAIT_IRQ:
-        WaitIRQ(handle, model_info, irq_source, timeout);
+        WaitIRQ(handle, model_info, irq_source, timeout, verbose);
      break;
      case MODE_SET_DMASK:
         pcilib_set_dma_mask(handle, dma_mask);
@@ -3935,6 +4786,12 @@ int main(int argc, char **argv) {
     case MODE_UNLOCK:
 	LockUnlock(handle, lock, 0, timeout_set?timeout:PCILIB_TIMEOUT_INFINITE);
     break;
+     case MODE_SAMPLE:
+        SampleRegisters(handle, model_info, bank, reg, size, run_time, sample_time, ofile);
+     break;
+     case MODE_WAIT_REGISTER:
+        WaitRegister(handle, model_info, bank, reg, timeout_set?timeout:PCILIB_TIMEOUT_INFINITE, verbose);
+     break;
      case MODE_INVALID:
         break;
     }
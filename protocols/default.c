@@ -26,6 +26,7 @@ uintptr_t pcilib_default_resolve(pcilib_t *ctx, pcilib_register_bank_context_t *
 	break;
      case PCILIB_ADDRESS_RESOLUTION_FLAG_WRITE_ONLY:
         addr = b->write_addr + reg_addr;
+	break;
      default:
         return PCILIB_ADDRESS_INVALID;
     }
@@ -126,7 +126,7 @@ int pcilib_software_registers_read(pcilib_t *ctx, pcilib_register_bank_context_t
 
     pcilib_register_value_t val = 0;
 
-    if ((addr + sizeof(pcilib_register_value_t)) > bank_ctx->bank->size) {
+    if ((addr + access) > bank_ctx->bank->size) {
 	pcilib_error("Trying to access space outside of the define register bank (bank: %s, addr: 0x%lx)", bank_ctx->bank->name, addr);
 	return PCILIB_ERROR_INVALID_ADDRESS;
     }
@@ -141,7 +141,7 @@ int pcilib_software_registers_write(pcilib_t *ctx, pcilib_register_bank_context_
     const pcilib_register_bank_description_t *b = bank_ctx->bank;
     int access = b->access / 8;
 
-    if ((addr + sizeof(pcilib_register_value_t)) > bank_ctx->bank->size) {
+    if ((addr + access) > bank_ctx->bank->size) {
 	pcilib_error("Trying to access space outside of the define register bank (bank: %s, addr: 0x%lx)", bank_ctx->bank->name, addr);
 	return PCILIB_ERROR_INVALID_ADDRESS;
     }
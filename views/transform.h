@@ -12,7 +12,7 @@ typedef struct {
 } pcilib_transform_view_description_t;
 
 #ifndef _PCILIB_VIEW_TRANSFORM_C
-const pcilib_view_api_description_t pcilib_transform_view_api;
+extern const pcilib_view_api_description_t pcilib_transform_view_api;
 #endif /* _PCILIB_VIEW_TRANSFORM_C */
 
 #endif /* _PCILIB_VIEW_TRANSFORM_H */